@@ -0,0 +1,643 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/container/free_list.h"
+#include "engine/memory/arena.h"
+#include "engine/memory/dyn_alloc.h"
+#include "engine/memory/memory.h"
+#include "engine/memory/stack.h"
+#include "engine/platform/platform.h"
+
+#include <malloc.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Allocator suite, run with `make bench-alloc`.
+ *
+ * Every allocator gets the same patterns, as far as it can serve them:
+ *   lifo    allocate a batch, free it newest first
+ *   fifo    allocate a batch, free it oldest first
+ *   random  keep a live set of small blocks, replace a random one
+ *   mixed   same with sizes from 16B to 64KiB, log distributed
+ *   frame   bursts of short lived blocks, all gone at the end of the frame
+ * Arena only drops everything at once and stack only frees newest first,
+ * so they sit out the patterns they cannot do.
+ *
+ * Each run goes twice, a timed pass and an untimed one that samples the
+ * footprint after every allocation. Footprint is the span from the start of
+ * the allocator's memory to the highest byte it handed out, committed pages
+ * for memory_alloc and mallinfo2 heap size for malloc. Fragmentation is
+ * 1 - largest free / free at the end of the steady part of the pattern,
+ * -1 where the allocator cannot tell.
+ *
+ * Usage: bench_alloc [--json path] [--csv path]. The table always goes to
+ * stdout, the files hold the same rows for tracking across versions. */
+
+#define BENCH_SCHEMA_VERSION 1
+#define HEAP_SIZE MEBIBYTES(64)
+#define RUN_BUDGET 1.0 // seconds per timed run, the freelist gets slow
+
+#define BATCH_ROUNDS 200
+#define BATCH_COUNT 5000
+#define RANDOM_LIVE 20000
+#define RANDOM_OPS 1000000
+#define MIXED_LIVE 2000
+#define MIXED_OPS 500000
+#define FRAME_COUNT 2000
+#define FRAME_BURST 1000
+
+#define SMALL_MIN 16
+#define SMALL_MAX 1024
+#define MIXED_MAX KIBIBYTES(64)
+#define FRAME_MAX 4096
+
+#define SIZE_TABLE_COUNT 65536 // power of two, indexed with a mask
+
+typedef enum bench_pattern_t {
+	PATTERN_LIFO = 0x00,
+	PATTERN_FIFO,
+	PATTERN_RANDOM,
+	PATTERN_MIXED,
+	PATTERN_FRAME,
+	PATTERN_MAX
+} bench_pattern_t;
+
+static const char *pattern_names[PATTERN_MAX] = {"lifo", "fifo", "random",
+												 "mixed", "frame"};
+
+typedef struct bench_allocator_t {
+	const char *name;
+	uint32_t patterns; // 1 << bench_pattern_t it can run
+	b8 (*init)(void);
+	void (*shut)(void);
+	void *(*alloc)(uint64_t size);
+	void (*free)(void *block, uint64_t size);
+	void (*reset)(void);       // drop everything, null if not supported
+	uint64_t (*footprint)(void);
+	float (*fragmentation)(void);
+} bench_allocator_t;
+
+typedef struct bench_result_t {
+	const char *allocator;
+	const char *pattern;
+	uint64_t ops;
+	double ns_per_op;
+	uint64_t peak_footprint;
+	uint64_t peak_live;
+	float fragmentation;
+} bench_result_t;
+
+typedef struct bench_block_t {
+	void *block;
+	uint64_t size;
+} bench_block_t;
+
+/* Sampling state of the footprint pass. */
+typedef struct bench_track_t {
+	b8 enabled;
+	uint64_t live;
+	uint64_t peak_live;
+	uint64_t peak_footprint;
+	float fragmentation;
+} bench_track_t;
+
+static uint64_t rng_state;
+static uint64_t small_sizes[SIZE_TABLE_COUNT];
+static uint64_t mixed_sizes[SIZE_TABLE_COUNT];
+static uint64_t frame_sizes[SIZE_TABLE_COUNT];
+
+static const bench_allocator_t *current;
+static bench_track_t track;
+
+static uint64_t rng_next(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+/* ===== Allocators ===== */
+static void *heap_memory;
+static uint64_t heap_require;
+static uintptr_t heap_high;
+static dyn_alloc_t heap;
+static freelist_t freelist;
+static arena_allocator_t arena;
+static stack_allocator_t stack;
+static stack_marker *stack_markers;
+static uint64_t stack_marker_count;
+
+_arinline void high_water(void *block, uint64_t size) {
+	uintptr_t end = (uintptr_t)block + size;
+	if (end > heap_high)
+		heap_high = end;
+}
+
+static b8 tlsf_init_bench(void) {
+	dyn_alloc_config_t config = {0};
+	config.type = DYN_ALLOC_TLSF;
+	config.total_size = HEAP_SIZE;
+	config.lazy_commit = true;
+	dyn_alloc_init(config, &heap_require, 0, 0);
+	heap_memory = platform_reserve(heap_require, PLATFORM_PAGES_NORMAL);
+	heap_high = (uintptr_t)heap_memory;
+	return heap_memory &&
+		   dyn_alloc_init(config, &heap_require, heap_memory, &heap);
+}
+
+static void tlsf_shut_bench(void) {
+	dyn_alloc_shut(&heap);
+	platform_release(heap_memory, heap_require);
+}
+
+static void *tlsf_alloc_bench(uint64_t size) {
+	void *block = dyn_alloc_allocate(&heap, size);
+	if (track.enabled && block)
+		high_water(block, size);
+	return block;
+}
+
+static void tlsf_free_bench(void *block, uint64_t size) {
+	dyn_alloc_free(&heap, block, size);
+}
+
+static uint64_t heap_footprint(void) {
+	return heap_high - (uintptr_t)heap_memory;
+}
+
+static float tlsf_frag_bench(void) {
+	return dyn_alloc_fragmentation(&heap).fragmentation;
+}
+
+/* Raw freelist hands out offsets, the bench maps them onto a committed
+ * block so callers can write through them. Sizes round to the granule the
+ * same way dyn_alloc rounds them. */
+static uint64_t freelist_granule(uint64_t size) {
+	return (size + DYN_ALLOC_ALIGNMENT - 1) & ~(uint64_t)(DYN_ALLOC_ALIGNMENT - 1);
+}
+
+static b8 freelist_init_bench(void) {
+	uint64_t node_require = 0;
+	freelist_init(HEAP_SIZE, DYN_ALLOC_ALIGNMENT, &node_require, 0, 0);
+	heap_require = node_require + HEAP_SIZE;
+	heap_memory = platform_allocate_pages(heap_require, PLATFORM_PAGES_NORMAL);
+	if (!heap_memory)
+		return false;
+
+	freelist_init(HEAP_SIZE, DYN_ALLOC_ALIGNMENT, &node_require, heap_memory,
+				  &freelist);
+	heap_high = (uintptr_t)heap_memory + node_require;
+	return true;
+}
+
+static void freelist_shut_bench(void) {
+	freelist_shut(&freelist);
+	platform_free_pages(heap_memory, heap_require, PLATFORM_PAGES_NORMAL);
+}
+
+static char *freelist_base(void) {
+	return (char *)heap_memory + (heap_require - HEAP_SIZE);
+}
+
+static void *freelist_alloc_bench(uint64_t size) {
+	uint64_t offset = 0;
+	if (!freelist_block_alloc(&freelist, freelist_granule(size), &offset))
+		return 0;
+
+	void *block = freelist_base() + offset;
+	if (track.enabled)
+		high_water(block, size);
+	return block;
+}
+
+static void freelist_free_bench(void *block, uint64_t size) {
+	freelist_block_free(&freelist, freelist_granule(size),
+						(uint64_t)((char *)block - freelist_base()));
+}
+
+static uint64_t freelist_footprint(void) {
+	return heap_high - (uintptr_t)freelist_base();
+}
+
+static float freelist_frag_bench(void) {
+	uint64_t free_space = freelist_space_free(&freelist);
+	if (!free_space)
+		return 0.0f;
+	return 1.0f - (float)freelist_largest_free(&freelist) / (float)free_space;
+}
+
+static b8 memory_init_bench(void) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = HEAP_SIZE;
+	config.alloc_type = DYN_ALLOC_TLSF;
+	return memory_init(config);
+}
+
+static void *memory_alloc_bench(uint64_t size) {
+	return memory_alloc_uninit(size, MEMTAG_GAME);
+}
+
+static void memory_free_bench(void *block, uint64_t size) {
+	memory_free(block, size, MEMTAG_GAME);
+}
+
+static uint64_t memory_footprint(void) { return memory_get_stats().committed; }
+
+static float memory_frag_bench(void) {
+	return memory_get_stats().fragmentation;
+}
+
+static b8 arena_init_bench(void) {
+	heap_high = 0;
+	return arena_init_virtual(HEAP_SIZE, false, &arena);
+}
+
+static void arena_shut_bench(void) { arena_shut(&arena); }
+
+static void *arena_alloc_bench(uint64_t size) {
+	void *block = arena_allocate(&arena, size);
+	if (track.enabled && arena.curr_offset > heap_high)
+		heap_high = arena.curr_offset;
+	return block;
+}
+
+static void arena_free_bench(void *block, uint64_t size) {
+	(void)block, (void)size;
+}
+
+static void arena_reset_bench(void) { arena_reset(&arena); }
+
+static uint64_t arena_footprint(void) { return heap_high; }
+
+static b8 stack_init_bench(void) {
+	heap_high = 0;
+	heap_memory = platform_allocate_pages(HEAP_SIZE, PLATFORM_PAGES_NORMAL);
+	if (!heap_memory)
+		return false;
+	stack_init(HEAP_SIZE, heap_memory, &stack);
+	stack_marker_count = 0;
+	return true;
+}
+
+static void stack_shut_bench(void) {
+	stack_shut(&stack);
+	platform_free_pages(heap_memory, HEAP_SIZE, PLATFORM_PAGES_NORMAL);
+}
+
+/* Stack frees go back to the marker taken before the matching alloc. */
+static void *stack_alloc_bench(uint64_t size) {
+	stack_markers[stack_marker_count++] = stack_get_marker(&stack);
+	void *block = stack_allocate(&stack, size);
+	if (track.enabled && stack.offset > heap_high)
+		heap_high = stack.offset;
+	return block;
+}
+
+static void stack_free_bench(void *block, uint64_t size) {
+	(void)block, (void)size;
+	stack_free_to_marker(&stack, stack_markers[--stack_marker_count]);
+}
+
+static void stack_reset_bench(void) {
+	stack_reset(&stack);
+	stack_marker_count = 0;
+}
+
+static uint64_t stack_footprint(void) { return heap_high; }
+
+static b8 malloc_init_bench(void) {
+	heap_high = 0;
+	return true;
+}
+
+static void malloc_shut_bench(void) { malloc_trim(0); }
+
+static void *malloc_alloc_bench(uint64_t size) { return malloc(size); }
+
+static void malloc_free_bench(void *block, uint64_t size) {
+	(void)size;
+	free(block);
+}
+
+static uint64_t malloc_footprint(void) {
+	struct mallinfo2 info = mallinfo2();
+	return info.arena + info.hblkhd;
+}
+
+static float no_frag(void) { return -1.0f; }
+
+#define ALL_PATTERNS ((1u << PATTERN_MAX) - 1)
+
+static const bench_allocator_t allocators[] = {
+	{"dyn_alloc", ALL_PATTERNS, tlsf_init_bench, tlsf_shut_bench,
+	 tlsf_alloc_bench, tlsf_free_bench, 0, heap_footprint, tlsf_frag_bench},
+	{"freelist", ALL_PATTERNS, freelist_init_bench, freelist_shut_bench,
+	 freelist_alloc_bench, freelist_free_bench, 0, freelist_footprint,
+	 freelist_frag_bench},
+	{"memory_alloc", ALL_PATTERNS, memory_init_bench, memory_shut,
+	 memory_alloc_bench, memory_free_bench, 0, memory_footprint,
+	 memory_frag_bench},
+	{"arena", 1u << PATTERN_FRAME, arena_init_bench, arena_shut_bench,
+	 arena_alloc_bench, arena_free_bench, arena_reset_bench, arena_footprint,
+	 no_frag},
+	{"stack", (1u << PATTERN_LIFO) | (1u << PATTERN_FRAME), stack_init_bench,
+	 stack_shut_bench, stack_alloc_bench, stack_free_bench, stack_reset_bench,
+	 stack_footprint, no_frag},
+	{"malloc", ALL_PATTERNS, malloc_init_bench, malloc_shut_bench,
+	 malloc_alloc_bench, malloc_free_bench, 0, malloc_footprint, no_frag},
+};
+#define ALLOCATOR_COUNT (sizeof(allocators) / sizeof(allocators[0]))
+
+/* ===== Patterns ===== */
+_arinline void *bench_alloc(uint64_t size) {
+	void *block = current->alloc(size);
+	if (track.enabled) {
+		track.live += size;
+		if (track.live > track.peak_live)
+			track.peak_live = track.live;
+		uint64_t footprint = current->footprint();
+		if (footprint > track.peak_footprint)
+			track.peak_footprint = footprint;
+	}
+	return block;
+}
+
+_arinline void bench_free(void *block, uint64_t size) {
+	current->free(block, size);
+	if (track.enabled)
+		track.live -= size;
+}
+
+_arinline b8 over_budget(uint64_t ops, double deadline) {
+	return (ops & 1023) == 0 && deadline > 0.0 && get_absolute_time() > deadline;
+}
+
+static uint64_t run_batches(b8 lifo, bench_block_t *blocks, uint64_t max_ops,
+							double deadline) {
+	uint64_t ops = 0;
+	uint64_t at = 0;
+	for (uint32_t round = 0; round < BATCH_ROUNDS; ++round) {
+		for (uint32_t i = 0; i < BATCH_COUNT; ++i) {
+			uint64_t size = small_sizes[at++ & (SIZE_TABLE_COUNT - 1)];
+			blocks[i].block = bench_alloc(size);
+			blocks[i].size = size;
+		}
+
+		if (round == BATCH_ROUNDS / 2)
+			track.fragmentation = current->fragmentation();
+
+		for (uint32_t i = 0; i < BATCH_COUNT; ++i) {
+			bench_block_t *b = &blocks[lifo ? BATCH_COUNT - 1 - i : i];
+			bench_free(b->block, b->size);
+		}
+
+		ops += BATCH_COUNT * 2;
+		if (ops >= max_ops || over_budget(0, deadline))
+			break;
+	}
+
+	return ops;
+}
+
+static uint64_t run_replace(const uint64_t *sizes, uint32_t live_count,
+							uint64_t op_count, bench_block_t *blocks,
+							uint64_t max_ops, double deadline) {
+	uint64_t at = 0;
+	for (uint32_t i = 0; i < live_count; ++i) {
+		blocks[i].size = sizes[at++ & (SIZE_TABLE_COUNT - 1)];
+		blocks[i].block = bench_alloc(blocks[i].size);
+	}
+
+	uint64_t ops = 0;
+	if (op_count > max_ops)
+		op_count = max_ops;
+	for (uint64_t op = 0; op < op_count; ++op) {
+		bench_block_t *b = &blocks[rng_next() % live_count];
+		bench_free(b->block, b->size);
+		b->size = sizes[at++ & (SIZE_TABLE_COUNT - 1)];
+		b->block = bench_alloc(b->size);
+		ops += 2;
+		if (over_budget(op, deadline))
+			break;
+	}
+
+	track.fragmentation = current->fragmentation();
+	for (uint32_t i = 0; i < live_count; ++i)
+		bench_free(blocks[i].block, blocks[i].size);
+
+	return ops;
+}
+
+static uint64_t run_frames(bench_block_t *blocks, uint64_t max_ops,
+						   double deadline) {
+	uint64_t ops = 0;
+	uint64_t at = 0;
+	for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame) {
+		for (uint32_t i = 0; i < FRAME_BURST; ++i) {
+			uint64_t size = frame_sizes[at++ & (SIZE_TABLE_COUNT - 1)];
+			blocks[i].block = bench_alloc(size);
+			blocks[i].size = size;
+		}
+
+		if (frame == FRAME_COUNT / 2)
+			track.fragmentation = current->fragmentation();
+
+		/* Linear allocators drop the frame in one go, the rest free each
+		 * block. Only the allocations count as ops for them. */
+		if (current->reset) {
+			current->reset();
+			track.live = 0;
+			ops += FRAME_BURST;
+		} else {
+			for (uint32_t i = 0; i < FRAME_BURST; ++i)
+				bench_free(blocks[i].block, blocks[i].size);
+			ops += FRAME_BURST * 2;
+		}
+
+		if (ops >= max_ops || over_budget(0, deadline))
+			break;
+	}
+
+	return ops;
+}
+
+static uint64_t run_pattern(bench_pattern_t pattern, bench_block_t *blocks,
+							uint64_t max_ops, double deadline) {
+	rng_state = 0x9E3779B97F4A7C15ull;
+	switch (pattern) {
+	case PATTERN_LIFO:
+		return run_batches(true, blocks, max_ops, deadline);
+	case PATTERN_FIFO:
+		return run_batches(false, blocks, max_ops, deadline);
+	case PATTERN_RANDOM:
+		return run_replace(small_sizes, RANDOM_LIVE, RANDOM_OPS, blocks,
+						   max_ops, deadline);
+	case PATTERN_MIXED:
+		return run_replace(mixed_sizes, MIXED_LIVE, MIXED_OPS, blocks,
+						   max_ops, deadline);
+	case PATTERN_FRAME:
+		return run_frames(blocks, max_ops, deadline);
+	default:
+		return 0;
+	}
+}
+
+static b8 bench_one(const bench_allocator_t *allocator, bench_pattern_t pattern,
+					bench_block_t *blocks, bench_result_t *result) {
+	current = allocator;
+	memset(&track, 0, sizeof(track));
+	if (!allocator->init())
+		return false;
+
+	double start = get_absolute_time();
+	uint64_t ops = run_pattern(pattern, blocks, UINT64_MAX, start + RUN_BUDGET);
+	double elapsed = get_absolute_time() - start;
+	allocator->shut();
+
+	/* Same ops again on a fresh allocator, this time sampling. */
+	if (!allocator->init())
+		return false;
+	track.enabled = true;
+	run_pattern(pattern, blocks, ops, 0.0);
+	allocator->shut();
+
+	result->allocator = allocator->name;
+	result->pattern = pattern_names[pattern];
+	result->ops = ops;
+	result->ns_per_op = ops ? elapsed * 1e9 / (double)ops : 0.0;
+	result->peak_footprint = track.peak_footprint;
+	result->peak_live = track.peak_live;
+	result->fragmentation = track.fragmentation;
+	return true;
+}
+
+/* ===== Output ===== */
+static void write_json(const char *path, const bench_result_t *results,
+					   uint32_t count) {
+	FILE *f = fopen(path, "w");
+	if (!f) {
+		printf("unable to write %s\n", path);
+		return;
+	}
+
+	fprintf(f, "{\n  \"schema\": %d,\n  \"heap_size\": %llu,\n  \"results\": [\n",
+			BENCH_SCHEMA_VERSION, (unsigned long long)HEAP_SIZE);
+	for (uint32_t i = 0; i < count; ++i) {
+		const bench_result_t *r = &results[i];
+		fprintf(f,
+				"    {\"allocator\": \"%s\", \"pattern\": \"%s\", \"ops\": %llu, "
+				"\"ns_per_op\": %.3f, \"peak_footprint\": %llu, "
+				"\"peak_live\": %llu, \"fragmentation\": ",
+				r->allocator, r->pattern, (unsigned long long)r->ops,
+				r->ns_per_op, (unsigned long long)r->peak_footprint,
+				(unsigned long long)r->peak_live);
+		if (r->fragmentation < 0.0f) {
+			fprintf(f, "null}");
+		} else {
+			fprintf(f, "%.4f}", r->fragmentation);
+		}
+		fprintf(f, "%s\n", i + 1 < count ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+	fclose(f);
+}
+
+static void write_csv(const char *path, const bench_result_t *results,
+					  uint32_t count) {
+	FILE *f = fopen(path, "w");
+	if (!f) {
+		printf("unable to write %s\n", path);
+		return;
+	}
+
+	fprintf(f, "allocator,pattern,ops,ns_per_op,peak_footprint,peak_live,"
+			   "fragmentation\n");
+	for (uint32_t i = 0; i < count; ++i) {
+		const bench_result_t *r = &results[i];
+		fprintf(f, "%s,%s,%llu,%.3f,%llu,%llu,", r->allocator, r->pattern,
+				(unsigned long long)r->ops, r->ns_per_op,
+				(unsigned long long)r->peak_footprint,
+				(unsigned long long)r->peak_live);
+		if (r->fragmentation >= 0.0f)
+			fprintf(f, "%.4f", r->fragmentation);
+		fprintf(f, "\n");
+	}
+	fclose(f);
+}
+
+static void print_row(const bench_result_t *r) {
+	char frag[16] = "-";
+	if (r->fragmentation >= 0.0f)
+		snprintf(frag, sizeof(frag), "%.1f%%", r->fragmentation * 100.0f);
+
+	printf("%-13s %-7s %10llu %10.2f %11.2f %11.2f %8s\n", r->allocator,
+		   r->pattern, (unsigned long long)r->ops, r->ns_per_op,
+		   r->peak_footprint / (double)MEBIBYTES(1),
+		   r->peak_live / (double)MEBIBYTES(1), frag);
+}
+
+/* Log uniform between lo and hi, small sizes are far more common. */
+static uint64_t log_size(uint64_t lo, uint64_t hi) {
+	double t = (double)(rng_next() % 1000000) / 1000000.0;
+	return (uint64_t)((double)lo * exp(t * log((double)hi / (double)lo)));
+}
+
+int main(int argc, char **argv) {
+	const char *json_path = 0;
+	const char *csv_path = 0;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--json")) {
+			json_path = argv[i + 1];
+		} else if (!strcmp(argv[i], "--csv")) {
+			csv_path = argv[i + 1];
+		} else {
+			printf("usage: %s [--json path] [--csv path]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	setvbuf(stdout, 0, _IOLBF, 0);
+	rng_state = 0xD1B54A32D192ED03ull;
+	for (uint32_t i = 0; i < SIZE_TABLE_COUNT; ++i) {
+		small_sizes[i] = SMALL_MIN + rng_next() % (SMALL_MAX - SMALL_MIN + 1);
+		mixed_sizes[i] = log_size(SMALL_MIN, MIXED_MAX);
+		frame_sizes[i] = SMALL_MIN + rng_next() % (FRAME_MAX - SMALL_MIN + 1);
+	}
+
+	uint64_t block_count = RANDOM_LIVE > BATCH_COUNT ? RANDOM_LIVE : BATCH_COUNT;
+	bench_block_t *blocks =
+		platform_allocate(sizeof(bench_block_t) * block_count, false);
+	stack_markers = platform_allocate(sizeof(stack_marker) * block_count, false);
+	bench_result_t results[ALLOCATOR_COUNT * PATTERN_MAX];
+	uint32_t result_count = 0;
+
+	printf("%-13s %-7s %10s %10s %11s %11s %8s\n", "allocator", "pattern",
+		   "ops", "ns/op", "peak MiB", "live MiB", "frag");
+	for (uint32_t p = 0; p < PATTERN_MAX; ++p) {
+		for (uint32_t a = 0; a < ALLOCATOR_COUNT; ++a) {
+			if (!(allocators[a].patterns & (1u << p)))
+				continue;
+
+			bench_result_t *result = &results[result_count];
+			if (!bench_one(&allocators[a], (bench_pattern_t)p, blocks, result)) {
+				printf("%-13s %-7s failed to set up\n", allocators[a].name,
+					   pattern_names[p]);
+				continue;
+			}
+			print_row(result);
+			result_count++;
+		}
+	}
+
+	if (json_path)
+		write_json(json_path, results, result_count);
+	if (csv_path)
+		write_csv(csv_path, results, result_count);
+
+	platform_free(stack_markers, false);
+	platform_free(blocks, false);
+	return 0;
+}
@@ -0,0 +1,190 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/container/dyn_array.h"
+#include "engine/core/ar_strings.h"
+#include "engine/memory/memory.h"
+#include "engine/platform/filesystem.h"
+
+#include <stdio.h>
+
+/* Bytes written by allocation zeroing, before and after the hot callers
+ * moved to memory_alloc_uninit. The "zeroed" run replays what the old code
+ * did: every memory_alloc cleared the block and _array_create cleared it a
+ * second time. The "uninit" run goes through the engine code as it is now. */
+
+#define FRAME_COUNT 2000
+#define FRAME_ARRAYS 32
+#define FRAME_ARRAY_PUSH 256
+#define FRAME_STRINGS 64
+#define LOAD_ROUNDS 50
+
+typedef struct bench_item_t {
+	uint64_t id;
+	float value[2];
+} bench_item_t;
+
+static const char *asset_files[] = {
+	"assets/textures/cobblestone.png",
+	"assets/textures/paving.png",
+	"assets/textures/paving2.png",
+	"assets/textures/ui_512.png",
+	"assets/shaders/Builtin.MaterialShader.vert.glsl",
+	"assets/shaders/Builtin.MaterialShader.frag.glsl",
+	"assets/materials/test_material.ar_mat",
+};
+
+static uint64_t legacy_written;
+
+/* ===== What the engine did before: zero in memory_alloc, zero again in
+ * _array_create, then overwrite. ===== */
+static void *legacy_array_create(uint64_t capacity, uint64_t stride) {
+	uint64_t size = DYN_ARRAY_FIELD_LENGTH * sizeof(uint64_t) + capacity * stride;
+	uint64_t *array = memory_alloc_zeroed(size, MEMTAG_DYN_ARRAY);
+	memory_set(array, 0, size);
+	legacy_written += size;
+
+	array[DYN_ARRAY_CAPACITY] = capacity;
+	array[DYN_ARRAY_LENGTH] = 0;
+	array[DYN_ARRAY_STRIDE] = stride;
+	return array + DYN_ARRAY_FIELD_LENGTH;
+}
+
+static void *legacy_array_push(void *array, const void *value) {
+	uint64_t *header = DYN_ARRAY_META(array);
+	uint64_t length = header[DYN_ARRAY_LENGTH];
+	uint64_t stride = header[DYN_ARRAY_STRIDE];
+	if (length >= header[DYN_ARRAY_CAPACITY]) {
+		void *temp = legacy_array_create(
+			header[DYN_ARRAY_CAPACITY] * DYN_ARRAY_RESIZE_FACTOR, stride);
+		memory_copy(temp, array, length * stride);
+		_array_destroy(array);
+		array = temp;
+		header = DYN_ARRAY_META(array);
+	}
+
+	memory_copy((char *)array + length * stride, value, stride);
+	header[DYN_ARRAY_LENGTH] = length + 1;
+	return array;
+}
+
+static char *legacy_string_duplicate(const char *str) {
+	uint64_t length = string_length(str);
+	char *copy = memory_alloc_zeroed(length + 1, MEMTAG_STRING);
+	memory_copy(copy, str, length + 1);
+	return copy;
+}
+
+/* ===== Workloads ===== */
+static void run_frame(b8 legacy, const char *path) {
+	void *arrays[FRAME_ARRAYS];
+	char *strings[FRAME_STRINGS];
+
+	for (uint32_t a = 0; a < FRAME_ARRAYS; ++a) {
+		arrays[a] = legacy ? legacy_array_create(DYN_ARRAY_DEF_CAPACITY,
+												 sizeof(bench_item_t))
+						   : dyn_array_create(bench_item_t);
+
+		for (uint64_t i = 0; i < FRAME_ARRAY_PUSH; ++i) {
+			bench_item_t item = {i, {(float)i, (float)a}};
+			if (legacy) {
+				arrays[a] = legacy_array_push(arrays[a], &item);
+			} else {
+				dyn_array_push(arrays[a], item);
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < FRAME_STRINGS; ++i)
+		strings[i] =
+			legacy ? legacy_string_duplicate(path) : string_duplicate(path);
+
+	for (uint32_t i = 0; i < FRAME_STRINGS; ++i)
+		memory_free(strings[i], string_length(strings[i]) + 1, MEMTAG_STRING);
+	for (uint32_t a = 0; a < FRAME_ARRAYS; ++a)
+		dyn_array_destroy(arrays[a]);
+}
+
+/* Same steps as binary_loader_load, minus the resource bookkeeping. */
+static uint64_t run_load(b8 legacy, const char *path) {
+	file_handle_t f;
+	if (!filesystem_open(path, MODE_READ, true, &f))
+		return 0;
+
+	uint64_t file_size = 0;
+	filesystem_size(&f, &file_size);
+
+	uint8_t *data = legacy ? memory_alloc_zeroed(file_size, MEMTAG_ARRAY)
+						   : memory_alloc_uninit(file_size, MEMTAG_ARRAY);
+	uint64_t read_size = 0;
+	filesystem_read_all_byte(&f, data, &read_size);
+	filesystem_close(&f);
+
+	memory_free(data, file_size, MEMTAG_ARRAY);
+	return read_size;
+}
+
+static void report(const char *name, const char *mode, uint64_t written,
+				   uint64_t units, double seconds) {
+	printf("%-6s %-7s %12.1f B zeroed/%s  %10.2f us/%s\n", name, mode,
+		   written / (double)units, name, seconds * 1e6 / (double)units, name);
+}
+
+static void bench_frames(b8 legacy) {
+	const char *path = "assets/textures/some/deeply/nested/texture/directory/"
+					   "for/the/path/buffer/cobblestone_albedo_roughness.png";
+	legacy_written = 0;
+	uint64_t before = memory_get_stats().zeroed;
+	double start = get_absolute_time();
+
+	for (uint32_t i = 0; i < FRAME_COUNT; ++i)
+		run_frame(legacy, path);
+
+	double elapsed = get_absolute_time() - start;
+	uint64_t written = memory_get_stats().zeroed - before + legacy_written;
+	report("frame", legacy ? "zeroed" : "uninit", written, FRAME_COUNT, elapsed);
+}
+
+static void bench_loads(b8 legacy) {
+	const uint32_t file_count = sizeof(asset_files) / sizeof(asset_files[0]);
+	uint64_t before = memory_get_stats().zeroed;
+	uint64_t loads = 0;
+	uint64_t read = 0;
+	double start = get_absolute_time();
+
+	for (uint32_t r = 0; r < LOAD_ROUNDS; ++r) {
+		for (uint32_t i = 0; i < file_count; ++i) {
+			read += run_load(legacy, asset_files[i]);
+			loads++;
+		}
+	}
+
+	double elapsed = get_absolute_time() - start;
+	uint64_t written = memory_get_stats().zeroed - before;
+	report("load", legacy ? "zeroed" : "uninit", written, loads, elapsed);
+	if (!read)
+		printf("load   no asset read, run from the repository root\n");
+}
+
+int main(void) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = MEBIBYTES(256);
+	config.alloc_type = DYN_ALLOC_TLSF;
+	if (!memory_init(config))
+		return 1;
+
+	setvbuf(stdout, 0, _IOLBF, 0);
+	printf("allocation zeroing, %d frames of %d arrays x %d pushes + %d "
+		   "strings, %d rounds of %d asset loads\n",
+		   FRAME_COUNT, FRAME_ARRAYS, FRAME_ARRAY_PUSH, FRAME_STRINGS,
+		   LOAD_ROUNDS, (int)(sizeof(asset_files) / sizeof(asset_files[0])));
+
+	bench_frames(true);
+	bench_frames(false);
+	bench_loads(true);
+	bench_loads(false);
+
+	memory_shut();
+	return 0;
+}
@@ -0,0 +1,160 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/memory/memory.h"
+
+#include <stdio.h>
+
+/* Level streaming on a small heap, plain blocks against handle blocks.
+ *
+ * Every level loads a batch of assets and then drops them, but a few blocks
+ * made while it was loaded (save data, caches, UI state) outlive it. Those
+ * survivors end up scattered over the heap, and after a few levels the
+ * free space is plenty but no single hole holds the next big allocation.
+ * With handles the survivors get slid down between levels, a
+ * COMPACT_BUDGET slice per frame, and the free space stays in one piece. */
+
+#define HEAP_SIZE MEBIBYTES(64)
+#define LEVELS 24
+#define LEVEL_ASSETS 96
+#define ASSET_MIN KIBIBYTES(64)
+#define ASSET_MAX KIBIBYTES(640)
+#define SURVIVOR_EVERY 4
+#define SURVIVOR_SIZE KIBIBYTES(96)
+#define SURVIVOR_MAX 256
+#define LARGE_SIZE MEBIBYTES(24)
+#define COMPACT_FRAMES 30
+#define COMPACT_BUDGET 0.0005
+
+typedef struct block_ref_t {
+	void *block;
+	mem_handle_t handle;
+	uint64_t size;
+} block_ref_t;
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rng_next(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static b8 ref_alloc(b8 handles, uint64_t size, block_ref_t *ref) {
+	ref->size = size;
+	ref->block = 0;
+	ref->handle = INVALID_HANDLE;
+	if (handles) {
+		ref->handle = memory_handle_alloc(size, MEMTAG_GAME);
+		return ref->handle != INVALID_HANDLE;
+	}
+
+	ref->block = memory_alloc_uninit(size, MEMTAG_GAME);
+	return ref->block != 0;
+}
+
+static void ref_free(block_ref_t *ref) {
+	if (ref->handle != INVALID_HANDLE) {
+		memory_handle_free(ref->handle);
+	} else {
+		memory_free(ref->block, ref->size, MEMTAG_GAME);
+	}
+	ref->size = 0;
+}
+
+static void bench_levels(b8 handles) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = HEAP_SIZE;
+	config.alloc_type = DYN_ALLOC_TLSF;
+	memory_init(config);
+	rng_state = 0x9E3779B97F4A7C15ull;
+
+	block_ref_t assets[LEVEL_ASSETS];
+	block_ref_t survivors[SURVIVOR_MAX];
+	uint32_t survivor_count = 0;
+	uint32_t large_ok = 0;
+	uint32_t load_failed = 0;
+	uint64_t moved = 0;
+	double compact_time = 0.0;
+	double worst_frame = 0.0;
+
+	printf("%s\n", handles ? "handle blocks" : "plain blocks");
+	for (uint32_t level = 0; level < LEVELS; ++level) {
+		for (uint32_t i = 0; i < LEVEL_ASSETS; ++i) {
+			uint64_t size = ASSET_MIN + rng_next() % (ASSET_MAX - ASSET_MIN);
+			if (!ref_alloc(handles, size, &assets[i])) {
+				assets[i].size = 0;
+				load_failed++;
+			}
+
+			if (i % SURVIVOR_EVERY == 0 && survivor_count < SURVIVOR_MAX) {
+				if (ref_alloc(handles, SURVIVOR_SIZE,
+							  &survivors[survivor_count]))
+					survivor_count++;
+			}
+		}
+
+		for (uint32_t i = 0; i < LEVEL_ASSETS; ++i) {
+			if (assets[i].size)
+				ref_free(&assets[i]);
+		}
+
+		/* Some old survivors finally go too. */
+		for (uint32_t i = 0; i < survivor_count;) {
+			if (rng_next() % 3 == 0) {
+				ref_free(&survivors[i]);
+				survivors[i] = survivors[--survivor_count];
+			} else {
+				++i;
+			}
+		}
+
+		/* Loading screen frames. */
+		for (uint32_t frame = 0; frame < COMPACT_FRAMES; ++frame) {
+			double start = get_absolute_time();
+			moved += memory_compact(COMPACT_BUDGET);
+			double elapsed = get_absolute_time() - start;
+			compact_time += elapsed;
+			if (elapsed > worst_frame)
+				worst_frame = elapsed;
+		}
+
+		memory_stats_t stats = memory_get_stats();
+		printf("  level %2u  survivors %3u  largest free %6.2f MiB in %4llu "
+			   "blocks  %5.1f%% fragmented\n",
+			   level, survivor_count, stats.largest_free / (double)MEBIBYTES(1),
+			   (unsigned long long)stats.free_blocks,
+			   stats.fragmentation * 100.0f);
+
+		/* The next level wants one big streaming buffer. */
+		void *large = memory_alloc_uninit(LARGE_SIZE, MEMTAG_GAME);
+		if (large) {
+			large_ok++;
+			memory_free(large, LARGE_SIZE, MEMTAG_GAME);
+		}
+	}
+
+	printf("  large %uMiB allocations: %u/%u ok, asset loads failed %u\n",
+		   (uint32_t)(LARGE_SIZE / MEBIBYTES(1)), large_ok, LEVELS,
+		   load_failed);
+	printf("  compaction moved %.2f MiB in %.2f ms, worst frame %.3f ms\n",
+		   moved / (double)MEBIBYTES(1), compact_time * 1e3,
+		   worst_frame * 1e3);
+
+	for (uint32_t i = 0; i < survivor_count; ++i)
+		ref_free(&survivors[i]);
+	memory_shut();
+}
+
+int main(void) {
+	setvbuf(stdout, 0, _IOLBF, 0);
+	printf("%d levels of %d assets %d-%dKiB on a %dMiB heap, then a %dMiB "
+		   "block\n",
+		   LEVELS, LEVEL_ASSETS, ASSET_MIN / 1024, ASSET_MAX / 1024,
+		   (int)(HEAP_SIZE / MEBIBYTES(1)), (int)(LARGE_SIZE / MEBIBYTES(1)));
+	bench_levels(false);
+	bench_levels(true);
+	return 0;
+}
@@ -0,0 +1,131 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/memory/dyn_alloc.h"
+#include "engine/platform/platform.h"
+
+#include <stdio.h>
+
+/* Allocate/free latency of each dyn_alloc engine while the number of live
+ * blocks grows. Every step fills the heap up to 'live' blocks, then replaces
+ * random live blocks with fresh ones and times the free + alloc pair. */
+
+#define HEAP_SIZE (512ull * 1024 * 1024)
+#define ALLOC_SIZE_MIN 16
+#define ALLOC_SIZE_MAX 128
+#define CHURN_OPS 200000
+#define CHURN_BUDGET 0.5 // seconds per step, the freelist gets slow
+
+typedef struct live_block_t {
+	void *ptr;
+	uint64_t size;
+} live_block_t;
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rng_next(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static uint64_t rng_size(void) {
+	return ALLOC_SIZE_MIN + rng_next() % (ALLOC_SIZE_MAX - ALLOC_SIZE_MIN + 1);
+}
+
+static void run_engine(dyn_alloc_type_t type, const char *name,
+                       const uint64_t *steps, uint32_t step_count,
+                       uint64_t max_live, live_block_t *blocks) {
+	dyn_alloc_config_t config = {0};
+	config.type = type;
+	config.total_size = HEAP_SIZE;
+	config.lazy_commit = true;
+
+	uint64_t require = 0;
+	dyn_alloc_t alloc;
+	dyn_alloc_init(config, &require, 0, 0);
+
+	/* Same reservation memory_init sets up for the engine heap. */
+	void *memory = platform_reserve(require, PLATFORM_PAGES_NORMAL);
+	if (!memory || !dyn_alloc_init(config, &require, memory, &alloc)) {
+		printf("%-8s failed to create heap of %llu bytes\n", name,
+			   (unsigned long long)require);
+		if (memory)
+			platform_release(memory, require);
+		return;
+	}
+
+	uint64_t live = 0;
+	for (uint32_t i = 0; i < step_count; ++i) {
+		if (steps[i] > max_live) {
+			printf("%-8s %10llu live  skipped, refilling past the churned "
+				   "holes takes minutes\n",
+				   name, (unsigned long long)steps[i]);
+			continue;
+		}
+
+		while (live < steps[i]) {
+			uint64_t size = rng_size();
+			void *ptr = dyn_alloc_allocate(&alloc, size);
+			if (!ptr)
+				break;
+
+			blocks[live].ptr = ptr;
+			blocks[live].size = size;
+			live++;
+		}
+
+		if (live < steps[i]) {
+			printf("%-8s %10llu live  heap exhausted\n", name,
+				   (unsigned long long)steps[i]);
+			break;
+		}
+
+		uint64_t ops = 0;
+		double start = get_absolute_time();
+		double elapsed = 0;
+		while (ops < CHURN_OPS) {
+			live_block_t *b = &blocks[rng_next() % live];
+			dyn_alloc_free(&alloc, b->ptr, b->size);
+			b->size = rng_size();
+			b->ptr = dyn_alloc_allocate(&alloc, b->size);
+			ops++;
+
+			/* Checking the clock every op would dominate TLSF timings. */
+			if ((ops & 0xFF) == 0) {
+				elapsed = get_absolute_time() - start;
+				if (elapsed > CHURN_BUDGET)
+					break;
+			}
+		}
+		elapsed = get_absolute_time() - start;
+
+		printf("%-8s %10llu live  %10.1f ns/op  (%llu ops)\n", name,
+			   (unsigned long long)live, elapsed * 1e9 / (double)ops,
+			   (unsigned long long)ops);
+	}
+
+	dyn_alloc_shut(&alloc);
+	platform_release(memory, require);
+}
+
+int main(void) {
+	const uint64_t steps[] = {1000, 10000, 100000, 1000000, 4000000};
+	const uint32_t step_count = sizeof(steps) / sizeof(steps[0]);
+
+	live_block_t *blocks =
+		platform_allocate(sizeof(live_block_t) * steps[step_count - 1], false);
+
+	setvbuf(stdout, 0, _IOLBF, 0);
+	printf("dyn_alloc free+alloc pair, sizes %d-%dB, heap %lluMiB\n", ALLOC_SIZE_MIN,
+		   ALLOC_SIZE_MAX, HEAP_SIZE / (1024 * 1024));
+	run_engine(DYN_ALLOC_TLSF, "tlsf", steps, step_count, steps[step_count - 1],
+			   blocks);
+	run_engine(DYN_ALLOC_FREELIST, "freelist", steps, step_count, 100000,
+			   blocks);
+
+	platform_free(blocks, false);
+	return 0;
+}
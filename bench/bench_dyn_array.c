@@ -0,0 +1,250 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/container/dyn_array.h"
+#include "engine/memory/memory.h"
+
+#include <stdio.h>
+
+/* Push heavy dyn_array use, before and after the rework. The legacy side is
+ * the old array kept verbatim: capacity 1 to start, every push reads the
+ * header through out of line field getters and copies through a temp.
+ *
+ * listeners: every event code gets its listener array, each registration
+ *            scans for a duplicate then pushes, afterwards they are all
+ *            unregistered again (ordered remove, like event_unreg).
+ * commands:  one command list cleared and refilled every frame, pushed one
+ *            at a time and, for the new array, appended in batches. */
+
+#define EVENT_CODES 512
+#define EVENT_LISTENERS 24
+#define LISTENER_ROUNDS 50
+#define FRAME_COUNT 1000
+#define FRAME_COMMANDS 4096
+#define COMMAND_BATCH 16
+
+typedef struct bench_listener_t {
+	void *listener;
+	void *callback;
+} bench_listener_t;
+
+typedef struct bench_command_t {
+	uint32_t type;
+	uint32_t geometry;
+	uint32_t material;
+	uint32_t flags;
+	float model[12];
+} bench_command_t;
+
+/* ===== The old array, out of line like it was in its own unit ===== */
+enum { LEGACY_CAPACITY, LEGACY_LENGTH, LEGACY_STRIDE, LEGACY_FIELDS };
+
+__attribute__((noinline)) static uint64_t legacy_get_field(void *array,
+														   uint64_t field) {
+	return ((uint64_t *)array - LEGACY_FIELDS)[field];
+}
+
+__attribute__((noinline)) static void legacy_set_field(void *array,
+													   uint64_t field,
+													   uint64_t value) {
+	((uint64_t *)array - LEGACY_FIELDS)[field] = value;
+}
+
+static void *legacy_create(uint64_t capacity, uint64_t stride) {
+	uint64_t *array = memory_alloc_uninit(
+		LEGACY_FIELDS * sizeof(uint64_t) + capacity * stride, MEMTAG_DYN_ARRAY);
+	array[LEGACY_CAPACITY] = capacity;
+	array[LEGACY_LENGTH] = 0;
+	array[LEGACY_STRIDE] = stride;
+	return array + LEGACY_FIELDS;
+}
+
+static void legacy_destroy(void *array) {
+	uint64_t *header = (uint64_t *)array - LEGACY_FIELDS;
+	memory_free(header,
+				LEGACY_FIELDS * sizeof(uint64_t) +
+					header[LEGACY_CAPACITY] * header[LEGACY_STRIDE],
+				MEMTAG_DYN_ARRAY);
+}
+
+__attribute__((noinline)) static void *legacy_resize(void *array) {
+	uint64_t *header = (uint64_t *)array - LEGACY_FIELDS;
+	uint64_t size_header = LEGACY_FIELDS * sizeof(uint64_t);
+	uint64_t stride = header[LEGACY_STRIDE];
+	uint64_t capacity = header[LEGACY_CAPACITY];
+	uint64_t new_capacity = capacity ? 2 * capacity : 1;
+	header = memory_realloc(header, size_header + capacity * stride,
+							size_header + new_capacity * stride,
+							MEMTAG_DYN_ARRAY);
+	header[LEGACY_CAPACITY] = new_capacity;
+	return header + LEGACY_FIELDS;
+}
+
+__attribute__((noinline)) static void *legacy_push(void *array,
+												   const void *value_ptr) {
+	uint64_t length = legacy_get_field(array, LEGACY_LENGTH);
+	uint64_t stride = legacy_get_field(array, LEGACY_STRIDE);
+	if (length >= legacy_get_field(array, LEGACY_CAPACITY))
+		array = legacy_resize(array);
+
+	memory_copy((char *)array + length * stride, value_ptr, stride);
+	legacy_set_field(array, LEGACY_LENGTH, length + 1);
+	return array;
+}
+
+/* Shift corrected to memmove, the old memcpy one read past the end. */
+__attribute__((noinline)) static void legacy_pop_at(void *array,
+													uint64_t index,
+													void *target) {
+	uint64_t length = legacy_get_field(array, LEGACY_LENGTH);
+	uint64_t stride = legacy_get_field(array, LEGACY_STRIDE);
+	char *at = (char *)array + index * stride;
+	memory_copy(target, at, stride);
+	memmove(at, at + stride, stride * (length - index - 1));
+	legacy_set_field(array, LEGACY_LENGTH, length - 1);
+}
+
+#define legacy_push_value(array, value)                                        \
+	do {                                                                       \
+		__typeof__(value) temp = (value);                                      \
+		(array) = legacy_push((array), &temp);                                 \
+	} while (0)
+
+/* ===== Listener registration ===== */
+static uint64_t listener_checksum;
+
+static double bench_listeners(b8 legacy) {
+	bench_listener_t *codes[EVENT_CODES];
+
+	double start = get_absolute_time();
+	for (uint32_t round = 0; round < LISTENER_ROUNDS; ++round) {
+		for (uint32_t c = 0; c < EVENT_CODES; ++c)
+			codes[c] = legacy ? legacy_create(1, sizeof(bench_listener_t))
+							  : dyn_array_create(bench_listener_t);
+
+		for (uint64_t l = 0; l < EVENT_LISTENERS; ++l) {
+			for (uint32_t c = 0; c < EVENT_CODES; ++c) {
+				bench_listener_t listener = {(void *)(l + 1),
+											 (void *)(uint64_t)(c + 1)};
+				uint64_t count = legacy ? legacy_get_field(codes[c], LEGACY_LENGTH)
+										: dyn_array_length(codes[c]);
+				b8 found = false;
+				for (uint64_t i = 0; i < count; ++i)
+					found |= codes[c][i].listener == listener.listener;
+				if (found)
+					continue;
+
+				if (legacy)
+					legacy_push_value(codes[c], listener);
+				else
+					dyn_array_push(codes[c], listener);
+			}
+		}
+
+		for (uint32_t c = 0; c < EVENT_CODES; ++c) {
+			bench_listener_t pop;
+			for (uint32_t l = 0; l < EVENT_LISTENERS; ++l) {
+				if (legacy)
+					legacy_pop_at(codes[c], 0, &pop);
+				else
+					dyn_array_pop_at(codes[c], 0, &pop);
+				listener_checksum += (uint64_t)pop.listener;
+			}
+
+			if (legacy)
+				legacy_destroy(codes[c]);
+			else
+				dyn_array_destroy(codes[c]);
+		}
+	}
+
+	return get_absolute_time() - start;
+}
+
+/* ===== Command list ===== */
+static uint64_t command_checksum;
+
+typedef enum command_mode_t {
+	COMMAND_LEGACY,
+	COMMAND_PUSH,
+	COMMAND_APPEND
+} command_mode_t;
+
+static double bench_commands(command_mode_t mode) {
+	bench_command_t *list = mode == COMMAND_LEGACY
+								? legacy_create(1, sizeof(bench_command_t))
+								: dyn_array_create(bench_command_t);
+	bench_command_t batch[COMMAND_BATCH] = {0};
+
+	double start = get_absolute_time();
+	for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame) {
+		if (mode == COMMAND_LEGACY)
+			legacy_set_field(list, LEGACY_LENGTH, 0);
+		else
+			dyn_array_clear(list);
+
+		for (uint32_t i = 0; i < FRAME_COMMANDS; i += COMMAND_BATCH) {
+			for (uint32_t b = 0; b < COMMAND_BATCH; ++b) {
+				batch[b].type = frame;
+				batch[b].geometry = i + b;
+				batch[b].model[0] = (float)b;
+			}
+
+			if (mode == COMMAND_APPEND) {
+				dyn_array_append_n(list, batch, COMMAND_BATCH);
+				continue;
+			}
+
+			for (uint32_t b = 0; b < COMMAND_BATCH; ++b) {
+				if (mode == COMMAND_LEGACY)
+					legacy_push_value(list, batch[b]);
+				else
+					dyn_array_push(list, batch[b]);
+			}
+		}
+
+		command_checksum += list[frame % FRAME_COMMANDS].geometry;
+	}
+	double elapsed = get_absolute_time() - start;
+
+	if (mode == COMMAND_LEGACY)
+		legacy_destroy(list);
+	else
+		dyn_array_destroy(list);
+	return elapsed;
+}
+
+int main(void) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = MEBIBYTES(64);
+	config.alloc_type = DYN_ALLOC_TLSF;
+	if (!memory_init(config))
+		return 1;
+
+	setvbuf(stdout, 0, _IOLBF, 0);
+
+	uint64_t ops = (uint64_t)LISTENER_ROUNDS * EVENT_CODES * EVENT_LISTENERS;
+	double legacy = bench_listeners(true);
+	double reworked = bench_listeners(false);
+	printf("listeners, %d codes x %d, reg + unreg %d rounds\n", EVENT_CODES,
+		   EVENT_LISTENERS, LISTENER_ROUNDS);
+	printf("  legacy %8.1f ns/op\n", legacy * 1e9 / ops);
+	printf("  new    %8.1f ns/op\n", reworked * 1e9 / ops);
+
+	ops = (uint64_t)FRAME_COUNT * FRAME_COMMANDS;
+	legacy = bench_commands(COMMAND_LEGACY);
+	reworked = bench_commands(COMMAND_PUSH);
+	double append = bench_commands(COMMAND_APPEND);
+	printf("commands, %d per frame, %d frames\n", FRAME_COMMANDS, FRAME_COUNT);
+	printf("  legacy %8.2f ns/op\n", legacy * 1e9 / ops);
+	printf("  push   %8.2f ns/op\n", reworked * 1e9 / ops);
+	printf("  append %8.2f ns/op\n", append * 1e9 / ops);
+
+	/* keeps the loops from being thrown away */
+	if (!listener_checksum || !command_checksum)
+		printf("checksum 0\n");
+
+	memory_shut();
+	return 0;
+}
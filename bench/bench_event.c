@@ -0,0 +1,209 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/container/dyn_array.h"
+#include "engine/core/event.h"
+#include "engine/memory/memory.h"
+
+#include <stdio.h>
+
+/* Listener table, before and after the flat dispatch table. The legacy
+ * side is the old event.c table: a dyn_array per code out of 8124 slots,
+ * a duplicate scan on register and a search plus ordered shift on
+ * unregister. Same listeners, same callback, both ways.
+ *
+ * churn:    every code gets its listeners, then they all go again in a
+ *           shuffled order.
+ * dispatch: event_push on codes with a handful of listeners each. */
+
+#define LEGACY_MAX_CODE 8124
+#define CHURN_CODES 64
+#define CHURN_LISTENERS 32
+#define CHURN_ROUNDS 200
+#define DISPATCH_CODES 16
+#define DISPATCH_LISTENERS 8
+#define DISPATCH_PUSHES 2000000
+
+static uint64_t calls;
+
+static b8 on_event(uint16_t code, void *sender, void *listener,
+				   event_context_t data) {
+	(void)code;
+	(void)sender;
+	(void)data;
+	calls += (uint64_t)listener;
+	return false;
+}
+
+/* ===== What the engine did before ===== */
+typedef struct legacy_listener_t {
+	void *listener;
+	p_on_event callback;
+} legacy_listener_t;
+
+static legacy_listener_t *legacy_table[LEGACY_MAX_CODE];
+
+static b8 legacy_reg(uint16_t code, void *listener, p_on_event event) {
+	if (legacy_table[code] == 0)
+		legacy_table[code] = dyn_array_create(legacy_listener_t);
+
+	uint64_t count = dyn_array_length(legacy_table[code]);
+	for (uint64_t i = 0; i < count; ++i) {
+		if (legacy_table[code][i].listener == listener)
+			return false;
+	}
+
+	legacy_listener_t reg = {listener, event};
+	dyn_array_push(legacy_table[code], reg);
+	return true;
+}
+
+static b8 legacy_unreg(uint16_t code, void *listener, p_on_event event) {
+	uint64_t count = dyn_array_length(legacy_table[code]);
+	for (uint64_t i = 0; i < count; ++i) {
+		legacy_listener_t e = legacy_table[code][i];
+		if (e.listener == listener && e.callback == event) {
+			dyn_array_pop_at(legacy_table[code], i, 0);
+			return true;
+		}
+	}
+	return false;
+}
+
+static b8 legacy_push(uint16_t code, void *sender, event_context_t context) {
+	if (legacy_table[code] == 0)
+		return false;
+
+	uint64_t count = dyn_array_length(legacy_table[code]);
+	for (uint64_t i = 0; i < count; ++i) {
+		legacy_listener_t e = legacy_table[code][i];
+		if (e.callback(code, sender, e.listener, context))
+			return true;
+	}
+	return false;
+}
+
+static void legacy_shut(void) {
+	for (uint32_t i = 0; i < LEGACY_MAX_CODE; ++i) {
+		if (legacy_table[i])
+			dyn_array_destroy(legacy_table[i]);
+		legacy_table[i] = 0;
+	}
+}
+
+/* ===== Runs ===== */
+static double churn(b8 legacy) {
+	uint32_t handles[CHURN_CODES][CHURN_LISTENERS];
+	uint32_t order[CHURN_LISTENERS];
+	uint64_t seed = 0x9E3779B97F4A7C15ull;
+	for (uint32_t i = 0; i < CHURN_LISTENERS; ++i)
+		order[i] = i;
+	for (uint32_t i = CHURN_LISTENERS - 1; i > 0; --i) {
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		uint32_t j = (uint32_t)(seed % (i + 1));
+		uint32_t swap = order[i];
+		order[i] = order[j];
+		order[j] = swap;
+	}
+
+	double start = get_absolute_time();
+	for (uint32_t round = 0; round < CHURN_ROUNDS; ++round) {
+		for (uint16_t c = 0; c < CHURN_CODES; ++c) {
+			for (uint64_t l = 0; l < CHURN_LISTENERS; ++l) {
+				if (legacy)
+					legacy_reg(c, (void *)(l + 1), on_event);
+				else
+					handles[c][l] = event_reg(c, (void *)(l + 1), on_event);
+			}
+		}
+
+		for (uint16_t c = 0; c < CHURN_CODES; ++c) {
+			for (uint32_t i = 0; i < CHURN_LISTENERS; ++i) {
+				uint64_t l = order[i];
+				if (legacy)
+					legacy_unreg(c, (void *)(l + 1), on_event);
+				else
+					event_unreg_handle(handles[c][l]);
+			}
+		}
+	}
+	return get_absolute_time() - start;
+}
+
+static double dispatch(b8 legacy) {
+	uint32_t handles[DISPATCH_CODES][DISPATCH_LISTENERS];
+	for (uint16_t c = 0; c < DISPATCH_CODES; ++c) {
+		for (uint64_t l = 0; l < DISPATCH_LISTENERS; ++l) {
+			if (legacy)
+				legacy_reg(c, (void *)(l + 1), on_event);
+			else
+				handles[c][l] = event_reg(c, (void *)(l + 1), on_event);
+		}
+	}
+
+	event_context_t context = {0};
+	double start = get_absolute_time();
+	for (uint32_t i = 0; i < DISPATCH_PUSHES; ++i) {
+		uint16_t code = (uint16_t)(i % DISPATCH_CODES);
+		if (legacy)
+			legacy_push(code, 0, context);
+		else
+			event_push(code, 0, context);
+	}
+	double elapsed = get_absolute_time() - start;
+
+	for (uint16_t c = 0; c < DISPATCH_CODES; ++c) {
+		for (uint32_t l = 0; l < DISPATCH_LISTENERS; ++l) {
+			if (!legacy)
+				event_unreg_handle(handles[c][l]);
+		}
+	}
+	return elapsed;
+}
+
+int main(void) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = MEBIBYTES(64);
+	config.alloc_type = DYN_ALLOC_TLSF;
+	if (!memory_init(config))
+		return 1;
+
+	uint64_t require;
+	event_init(&require, 0);
+	void *state = memory_alloc_uninit(require, MEMTAG_APPLICATION);
+	event_init(&require, state);
+
+	setvbuf(stdout, 0, _IOLBF, 0);
+
+	uint64_t ops = (uint64_t)CHURN_ROUNDS * CHURN_CODES * CHURN_LISTENERS;
+	double legacy = churn(true);
+	legacy_shut();
+	double flat = churn(false);
+	printf("reg + unreg, %d codes x %d listeners, %d rounds\n", CHURN_CODES,
+		   CHURN_LISTENERS, CHURN_ROUNDS);
+	printf("  legacy %8.1f ns/op\n", legacy * 1e9 / ops);
+	printf("  flat   %8.1f ns/op\n", flat * 1e9 / ops);
+
+	uint64_t legacy_calls = calls;
+	legacy = dispatch(true);
+	legacy_calls = calls - legacy_calls;
+	legacy_shut();
+	uint64_t flat_calls = calls;
+	flat = dispatch(false);
+	flat_calls = calls - flat_calls;
+	printf("event_push, %d listeners per code, %d pushes\n", DISPATCH_LISTENERS,
+		   DISPATCH_PUSHES);
+	printf("  legacy %8.1f ns/push\n", legacy * 1e9 / DISPATCH_PUSHES);
+	printf("  flat   %8.1f ns/push\n", flat * 1e9 / DISPATCH_PUSHES);
+	if (legacy_calls != flat_calls)
+		printf("listener calls differ: %llu vs %llu\n",
+			   (unsigned long long)legacy_calls, (unsigned long long)flat_calls);
+
+	event_shut(state);
+	memory_free(state, require, MEMTAG_APPLICATION);
+	memory_shut();
+	return 0;
+}
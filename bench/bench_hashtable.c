@@ -0,0 +1,210 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/container/hashtable.h"
+#include "engine/core/ar_strings.h"
+#include "engine/memory/memory.h"
+
+#include <stdio.h>
+
+/* The name table before and after the move to a keyed Swiss table, at the
+ * size the texture system registers (65536). The old table hashed straight
+ * to a value slot and kept no key, so names sharing a slot overwrote each
+ * other; "wrong" counts the names that read back another name's value. */
+
+#define NAME_COUNT 65536
+#define NAME_LENGTH 48
+#define ROUNDS 8
+
+typedef struct bench_ref_t {
+	uint64_t ref_count;
+	uint32_t handle;
+	b8 auto_release;
+} bench_ref_t;
+
+static char (*names)[NAME_LENGTH];
+static char (*misses)[NAME_LENGTH];
+static uint32_t *order;
+static volatile uint64_t sink;
+
+/* ===== What the engine did before ===== */
+typedef struct legacy_table_t {
+	uint64_t element_size;
+	uint32_t element_count;
+	void *memory;
+} legacy_table_t;
+
+static uint64_t legacy_hash_name(const char *name, uint32_t element_count) {
+	static const uint64_t multiplier = 97;
+	uint64_t hash = 0;
+	for (const unsigned char *us = (const unsigned char *)name; *us; us++)
+		hash = hash * multiplier + *us;
+	return hash % element_count;
+}
+
+static void legacy_set(legacy_table_t *table, const char *name, void *value) {
+	uint64_t hash = legacy_hash_name(name, table->element_count);
+	memory_copy((char *)table->memory + table->element_size * hash, value,
+				table->element_size);
+}
+
+static void legacy_get(legacy_table_t *table, const char *name, void *value) {
+	uint64_t hash = legacy_hash_name(name, table->element_count);
+	memory_copy(value, (char *)table->memory + table->element_size * hash,
+				table->element_size);
+}
+
+/* ===== Workloads ===== */
+static uint32_t next_random(uint32_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+static void report(const char *table, const char *op, double seconds,
+				   uint64_t ops) {
+	printf("%-7s %-14s %8.1f ns/op\n", table, op, seconds * 1e9 / (double)ops);
+}
+
+static void bench_legacy(void) {
+	legacy_table_t table = {sizeof(bench_ref_t), NAME_COUNT, 0};
+	table.memory = memory_alloc(sizeof(bench_ref_t) * NAME_COUNT, MEMTAG_ARRAY);
+	bench_ref_t ref = {0};
+
+	double start = get_absolute_time();
+	for (uint32_t r = 0; r < ROUNDS; ++r) {
+		for (uint32_t i = 0; i < NAME_COUNT; ++i) {
+			ref.handle = i;
+			legacy_set(&table, names[i], &ref);
+		}
+	}
+	report("legacy", "insert", get_absolute_time() - start,
+		   (uint64_t)ROUNDS * NAME_COUNT);
+
+	uint32_t wrong = 0;
+	start = get_absolute_time();
+	for (uint32_t r = 0; r < ROUNDS; ++r) {
+		for (uint32_t i = 0; i < NAME_COUNT; ++i) {
+			legacy_get(&table, names[order[i]], &ref);
+			wrong += ref.handle != order[i];
+		}
+	}
+	report("legacy", "lookup hit", get_absolute_time() - start,
+		   (uint64_t)ROUNDS * NAME_COUNT);
+
+	start = get_absolute_time();
+	for (uint32_t r = 0; r < ROUNDS; ++r) {
+		for (uint32_t i = 0; i < NAME_COUNT; ++i) {
+			legacy_get(&table, misses[i], &ref);
+			sink += ref.handle;
+		}
+	}
+	report("legacy", "lookup miss", get_absolute_time() - start,
+		   (uint64_t)ROUNDS * NAME_COUNT);
+
+	printf("legacy  %u of %u names read back another name's value\n",
+		   wrong / ROUNDS, NAME_COUNT);
+	memory_free(table.memory, sizeof(bench_ref_t) * NAME_COUNT, MEMTAG_ARRAY);
+}
+
+static void bench_swiss(const char *label, uint32_t reserve) {
+	uint64_t require = hashtable_memory_require(sizeof(bench_ref_t), reserve);
+	void *memory = memory_alloc_aligned(require, AR_CACHE_LINE, MEMTAG_ARRAY);
+	bench_ref_t ref = {0};
+	bench_ref_t invalid = {0, INVALID_ID, false};
+	hashtable_t table;
+	double insert = 0;
+	double hit = 0;
+	double miss = 0;
+	double churn = 0;
+	uint32_t wrong = 0;
+
+	for (uint32_t r = 0; r < ROUNDS; ++r) {
+		hashtable_init(sizeof(bench_ref_t), reserve, memory, false, &table);
+		hashtable_fill(&table, &invalid);
+
+		double start = get_absolute_time();
+		for (uint32_t i = 0; i < NAME_COUNT; ++i) {
+			ref.handle = i;
+			hashtable_set(&table, names[i], &ref);
+		}
+		insert += get_absolute_time() - start;
+
+		start = get_absolute_time();
+		for (uint32_t i = 0; i < NAME_COUNT; ++i) {
+			hashtable_get(&table, names[order[i]], &ref);
+			wrong += ref.handle != order[i];
+		}
+		hit += get_absolute_time() - start;
+
+		start = get_absolute_time();
+		for (uint32_t i = 0; i < NAME_COUNT; ++i) {
+			hashtable_get(&table, misses[i], &ref);
+			wrong += ref.handle != INVALID_ID;
+		}
+		miss += get_absolute_time() - start;
+
+		/* Unload and load back a quarter of the names, the way textures
+		 * cycle through the registry. */
+		start = get_absolute_time();
+		for (uint32_t i = 0; i < NAME_COUNT; i += 4)
+			hashtable_erase(&table, names[order[i]]);
+		for (uint32_t i = 0; i < NAME_COUNT; i += 4) {
+			ref.handle = order[i];
+			hashtable_set(&table, names[order[i]], &ref);
+		}
+		churn += get_absolute_time() - start;
+
+		hashtable_shut(&table);
+	}
+
+	uint64_t ops = (uint64_t)ROUNDS * NAME_COUNT;
+	printf("%s\n", label);
+	report("swiss", "insert", insert, ops);
+	report("swiss", "lookup hit", hit, ops);
+	report("swiss", "lookup miss", miss, ops);
+	report("swiss", "erase+insert", churn, ops / 2);
+	printf("swiss   %u wrong reads, %llu bytes of table\n", wrong,
+		   (unsigned long long)require);
+	memory_free_aligned(memory, require, AR_CACHE_LINE, MEMTAG_ARRAY);
+}
+
+int main(void) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = MEBIBYTES(256);
+	config.alloc_type = DYN_ALLOC_TLSF;
+	if (!memory_init(config))
+		return 1;
+
+	names = memory_alloc(sizeof(*names) * NAME_COUNT, MEMTAG_ARRAY);
+	misses = memory_alloc(sizeof(*misses) * NAME_COUNT, MEMTAG_ARRAY);
+	order = memory_alloc(sizeof(uint32_t) * NAME_COUNT, MEMTAG_ARRAY);
+
+	uint32_t seed = 0x9E3779B9u;
+	for (uint32_t i = 0; i < NAME_COUNT; ++i) {
+		snprintf(names[i], NAME_LENGTH, "textures/tex_%05u.png", i);
+		snprintf(misses[i], NAME_LENGTH, "materials/mat_%05u.ar_mat", i);
+		order[i] = i;
+	}
+	for (uint32_t i = NAME_COUNT - 1; i > 0; --i) {
+		uint32_t j = next_random(&seed) % (i + 1);
+		uint32_t t = order[i];
+		order[i] = order[j];
+		order[j] = t;
+	}
+
+	setvbuf(stdout, 0, _IOLBF, 0);
+	printf("name table, %d names x %d rounds\n", NAME_COUNT, ROUNDS);
+
+	bench_legacy();
+	bench_swiss("swiss, sized for every name", NAME_COUNT);
+	bench_swiss("swiss, growing from one group", 1);
+
+	memory_free(order, sizeof(uint32_t) * NAME_COUNT, MEMTAG_ARRAY);
+	memory_free(misses, sizeof(*misses) * NAME_COUNT, MEMTAG_ARRAY);
+	memory_free(names, sizeof(*names) * NAME_COUNT, MEMTAG_ARRAY);
+	memory_shut();
+	return 0;
+}
@@ -0,0 +1,261 @@
+/* syscall() for perf_event_open sits behind _GNU_SOURCE. */
+#define _GNU_SOURCE
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/container/dyn_array.h"
+#include "engine/memory/arena.h"
+#include "engine/memory/memory.h"
+#include "engine/platform/platform.h"
+
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Heap, arena and container work with and without huge page backing.
+ *
+ * Every run reports ns/op and dTLB load misses per op from a perf counter
+ * (needs kernel.perf_event_paranoid <= 2, prints n/a otherwise), and how
+ * much of the process ended up on transparent huge pages. With THP set to
+ * "never" both columns come out the same, that is the fallback working. */
+
+#define HEAP_SIZE GIBIBYTES(1)
+#define TOUCH_BLOCKS 2048
+#define TOUCH_BLOCK_SIZE KIBIBYTES(128)
+#define TOUCH_OPS 20000000
+#define CHURN_LIVE 50000
+#define CHURN_OPS 2000000
+#define ARRAY_COUNT 64
+#define ARRAY_ITEMS 65536
+#define ARRAY_READS 20000000
+#define ARENA_SIZE MEBIBYTES(256)
+#define CHASE_OPS 20000000
+
+typedef struct bench_item_t {
+	uint64_t key;
+	uint64_t value;
+} bench_item_t;
+
+typedef struct churn_block_t {
+	uint8_t *block;
+	uint64_t size;
+} churn_block_t;
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static volatile uint64_t sink;
+
+/* ===== dTLB counter ===== */
+static int32_t tlb_open(void) {
+	struct perf_event_attr attr = {0};
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_DTLB |
+				  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int32_t)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void tlb_start(int32_t fd) {
+	if (fd < 0)
+		return;
+	ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+static int64_t tlb_stop(int32_t fd) {
+	if (fd < 0)
+		return -1;
+
+	uint64_t count = 0;
+	ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	if (read(fd, &count, sizeof(count)) != sizeof(count))
+		return -1;
+	return (int64_t)count;
+}
+
+static uint64_t huge_backed_kib(void) {
+	FILE *rollup = fopen("/proc/self/smaps_rollup", "r");
+	if (!rollup)
+		return 0;
+
+	char line[128];
+	unsigned long long kib = 0;
+	while (fgets(line, sizeof(line), rollup)) {
+		if (sscanf(line, "AnonHugePages: %llu kB", &kib) == 1)
+			break;
+	}
+	fclose(rollup);
+	return kib;
+}
+
+static void report(const char *name, b8 huge, uint64_t ops, double seconds,
+				   int64_t misses) {
+	char miss_text[32] = "n/a";
+	if (misses >= 0)
+		snprintf(miss_text, sizeof(miss_text), "%.4f", misses / (double)ops);
+
+	printf("  %-12s %-6s %8.2f ns/op  %10s dTLB miss/op  %6llu MiB huge\n",
+		   name, huge ? "huge" : "normal", seconds * 1e9 / ops, miss_text,
+		   (unsigned long long)(huge_backed_kib() / 1024));
+}
+
+/* ===== Workloads ===== */
+/* Random word reads and writes over blocks spread across the heap, the way
+ * subsystems poke at their own state. */
+static void bench_touch(b8 huge, int32_t tlb) {
+	uint64_t *blocks[TOUCH_BLOCKS];
+	const uint64_t words = TOUCH_BLOCK_SIZE / sizeof(uint64_t);
+	for (uint32_t i = 0; i < TOUCH_BLOCKS; ++i)
+		blocks[i] = memory_alloc_zeroed(TOUCH_BLOCK_SIZE, MEMTAG_GAME);
+
+	tlb_start(tlb);
+	double start = get_absolute_time();
+	uint64_t acc = 0;
+	for (uint32_t op = 0; op < TOUCH_OPS; ++op) {
+		uint64_t r = rng_next();
+		uint64_t *word = &blocks[r % TOUCH_BLOCKS][(r >> 20) % words];
+		acc += *word;
+		*word = acc;
+	}
+	double elapsed = get_absolute_time() - start;
+	report("heap touch", huge, TOUCH_OPS, elapsed, tlb_stop(tlb));
+	sink = acc;
+
+	for (uint32_t i = 0; i < TOUCH_BLOCKS; ++i)
+		memory_free(blocks[i], TOUCH_BLOCK_SIZE, MEMTAG_GAME);
+}
+
+/* Replace a random live block with a new one of random size, writing both
+ * ends like a caller filling it would. */
+static void bench_churn(b8 huge, int32_t tlb, churn_block_t *live) {
+	for (uint32_t i = 0; i < CHURN_LIVE; ++i) {
+		live[i].size = 64 + rng_next() % KIBIBYTES(16);
+		live[i].block = memory_alloc_uninit(live[i].size, MEMTAG_GAME);
+	}
+
+	tlb_start(tlb);
+	double start = get_absolute_time();
+	for (uint32_t op = 0; op < CHURN_OPS; ++op) {
+		churn_block_t *slot = &live[rng_next() % CHURN_LIVE];
+		memory_free(slot->block, slot->size, MEMTAG_GAME);
+		slot->size = 64 + rng_next() % KIBIBYTES(16);
+		slot->block = memory_alloc_uninit(slot->size, MEMTAG_GAME);
+		slot->block[0] = (uint8_t)op;
+		slot->block[slot->size - 1] = (uint8_t)op;
+	}
+	double elapsed = get_absolute_time() - start;
+	report("alloc churn", huge, CHURN_OPS, elapsed, tlb_stop(tlb));
+
+	for (uint32_t i = 0; i < CHURN_LIVE; ++i)
+		memory_free(live[i].block, live[i].size, MEMTAG_GAME);
+}
+
+/* Grow a set of dyn_arrays, then read them at random. */
+static void bench_arrays(b8 huge, int32_t tlb) {
+	bench_item_t *arrays[ARRAY_COUNT];
+
+	tlb_start(tlb);
+	double start = get_absolute_time();
+	for (uint32_t a = 0; a < ARRAY_COUNT; ++a) {
+		arrays[a] = dyn_array_create(bench_item_t);
+		for (uint64_t i = 0; i < ARRAY_ITEMS; ++i) {
+			bench_item_t item = {i, i * a};
+			dyn_array_push(arrays[a], item);
+		}
+	}
+	double elapsed = get_absolute_time() - start;
+	report("array push", huge, ARRAY_COUNT * ARRAY_ITEMS, elapsed,
+		   tlb_stop(tlb));
+
+	tlb_start(tlb);
+	start = get_absolute_time();
+	uint64_t acc = 0;
+	for (uint32_t op = 0; op < ARRAY_READS; ++op) {
+		uint64_t r = rng_next();
+		acc += arrays[r % ARRAY_COUNT][(r >> 16) % ARRAY_ITEMS].value;
+	}
+	elapsed = get_absolute_time() - start;
+	report("array read", huge, ARRAY_READS, elapsed, tlb_stop(tlb));
+	sink = acc;
+
+	for (uint32_t a = 0; a < ARRAY_COUNT; ++a)
+		dyn_array_destroy(arrays[a]);
+}
+
+/* Pointer chase through a page backed arena, one random cycle over all of
+ * it so every step is a dependent load somewhere else. */
+static void bench_arena(b8 huge, int32_t tlb) {
+	arena_allocator_t arena;
+	if (!arena_init_virtual(ARENA_SIZE, huge, &arena))
+		return;
+
+	const uint64_t count = ARENA_SIZE / sizeof(uint64_t) / 8;
+	uint64_t *slots = arena_allocate(&arena, count * 8 * sizeof(uint64_t));
+	for (uint64_t i = 0; i < count; ++i)
+		slots[i * 8] = i;
+	for (uint64_t i = count - 1; i > 0; --i) {
+		uint64_t j = rng_next() % (i + 1);
+		uint64_t t = slots[i * 8];
+		slots[i * 8] = slots[j * 8];
+		slots[j * 8] = t;
+	}
+
+	tlb_start(tlb);
+	double start = get_absolute_time();
+	uint64_t at = 0;
+	for (uint32_t op = 0; op < CHASE_OPS; ++op)
+		at = slots[at * 8];
+	double elapsed = get_absolute_time() - start;
+	report("arena chase", huge, CHASE_OPS, elapsed, tlb_stop(tlb));
+	sink = at;
+
+	arena_shut(&arena);
+}
+
+static void bench_run(b8 huge, int32_t tlb, churn_block_t *live) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = HEAP_SIZE;
+	config.alloc_type = DYN_ALLOC_TLSF;
+	config.huge_pages = huge;
+	if (!memory_init(config))
+		return;
+
+	rng_state = 0x9E3779B97F4A7C15ull;
+	bench_touch(huge, tlb);
+	bench_churn(huge, tlb, live);
+	bench_arrays(huge, tlb);
+	bench_arena(huge, tlb);
+	memory_shut();
+}
+
+int main(void) {
+	setvbuf(stdout, 0, _IOLBF, 0);
+	int32_t tlb = tlb_open();
+	churn_block_t *live =
+		platform_allocate(sizeof(churn_block_t) * CHURN_LIVE, false);
+
+	printf("huge page size %llu KiB, dTLB counter %s\n",
+		   (unsigned long long)(platform_huge_page_size() / 1024),
+		   tlb >= 0 ? "on" : "unavailable");
+	bench_run(false, tlb, live);
+	bench_run(true, tlb, live);
+
+	platform_free(live, false);
+	if (tlb >= 0)
+		close(tlb);
+	return 0;
+}
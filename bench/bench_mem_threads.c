@@ -0,0 +1,95 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/memory/memory.h"
+#include "engine/platform/platform_thread.h"
+
+#include <stdio.h>
+
+/* memory_alloc / memory_free throughput with 1..N threads hammering the
+ * heap at once. Each thread keeps a window of live blocks and replaces a
+ * random one per op, sizes 16-512B so everything stays on the thread
+ * caches. After all threads flush, the tag totals must be back to zero. */
+
+#define THREAD_MAX 8
+#define THREAD_OPS 2000000
+#define THREAD_LIVE 256
+#define ALLOC_SIZE_MIN 16
+#define ALLOC_SIZE_MAX 512
+
+typedef struct worker_t {
+	platform_thread_t thread;
+	uint64_t seed;
+	double elapsed;
+} worker_t;
+
+static uint64_t rng_next(uint64_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static void *worker_run(void *arg) {
+	worker_t *worker = arg;
+	void *blocks[THREAD_LIVE];
+	uint64_t sizes[THREAD_LIVE];
+
+	double start = get_absolute_time();
+	for (uint32_t i = 0; i < THREAD_LIVE; ++i) {
+		sizes[i] = ALLOC_SIZE_MIN +
+				   rng_next(&worker->seed) % (ALLOC_SIZE_MAX - ALLOC_SIZE_MIN);
+		blocks[i] = memory_alloc_uninit(sizes[i], MEMTAG_GAME);
+	}
+
+	for (uint32_t op = 0; op < THREAD_OPS; ++op) {
+		uint64_t r = rng_next(&worker->seed);
+		uint32_t slot = (uint32_t)(r % THREAD_LIVE);
+		memory_free(blocks[slot], sizes[slot], MEMTAG_GAME);
+
+		sizes[slot] = ALLOC_SIZE_MIN + (r >> 32) % (ALLOC_SIZE_MAX - ALLOC_SIZE_MIN);
+		blocks[slot] = memory_alloc_uninit(sizes[slot], MEMTAG_GAME);
+	}
+
+	for (uint32_t i = 0; i < THREAD_LIVE; ++i)
+		memory_free(blocks[i], sizes[i], MEMTAG_GAME);
+	worker->elapsed = get_absolute_time() - start;
+
+	memory_thread_flush();
+	return 0;
+}
+
+int main(void) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = MEBIBYTES(256);
+	config.alloc_type = DYN_ALLOC_TLSF;
+	if (!memory_init(config))
+		return 1;
+
+	setvbuf(stdout, 0, _IOLBF, 0);
+	printf("memory_alloc/free pairs, %d ops per thread, sizes %d-%dB\n",
+		   THREAD_OPS, ALLOC_SIZE_MIN, ALLOC_SIZE_MAX);
+
+	worker_t workers[THREAD_MAX];
+	for (uint32_t count = 1; count <= THREAD_MAX; count *= 2) {
+		double start = get_absolute_time();
+		for (uint32_t i = 0; i < count; ++i) {
+			workers[i].seed = 0x9E3779B97F4A7C15ull * (i + 1);
+			platform_thread_create(worker_run, &workers[i], &workers[i].thread);
+		}
+		for (uint32_t i = 0; i < count; ++i)
+			platform_thread_join(&workers[i].thread);
+		double wall = get_absolute_time() - start;
+
+		uint64_t ops = (uint64_t)count * THREAD_OPS;
+		memory_stats_t stats = memory_get_stats();
+		printf("%u threads  %8.2f Mops/s  %6.1f ns/op per thread  used after "
+			   "flush: %llu\n",
+			   count, ops / wall / 1e6, workers[0].elapsed * 1e9 / THREAD_OPS,
+			   (unsigned long long)stats.used);
+	}
+
+	memory_shut();
+	return 0;
+}
@@ -0,0 +1,159 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/container/dyn_array.h"
+#include "engine/memory/memory.h"
+
+#include <stdio.h>
+
+/* Growing large arrays, in place realloc against always moving.
+ *
+ * Builds a few geometry sized vertex lists one push at a time while other
+ * blocks come and go around them. Every growth either extends the block
+ * where it is or moves it, the moves column counts the second kind. "move"
+ * does what _array_resize did before memory_realloc: allocate, copy, free.
+ *
+ * "sequential" fills one list after the other, the way a loader fills its
+ * buffers. "interleaved" grows them all at once, each list then sits right
+ * in front of the next one's block and has to move most of the time. */
+
+#define ARRAYS 4
+#define VERTICES 1000000
+#define NOISE_EVERY 4096
+#define NOISE_SIZE KIBIBYTES(8)
+#define NOISE_LIVE 64
+
+typedef struct vertex_t {
+	float position[3];
+	float normal[3];
+	float texcoord[2];
+} vertex_t;
+
+typedef struct grow_array_t {
+	vertex_t *data;
+	uint64_t length;
+	uint64_t capacity;
+} grow_array_t;
+
+static uint64_t growths;
+static uint64_t moves;
+
+static void array_grow(grow_array_t *array, b8 in_place) {
+	uint64_t size = array->capacity * sizeof(vertex_t);
+	uint64_t new_capacity = array->capacity ? array->capacity * 2 : 16;
+	uint64_t new_size = new_capacity * sizeof(vertex_t);
+
+	vertex_t *data = 0;
+	if (!array->data) {
+		data = memory_alloc_uninit(new_size, MEMTAG_ARRAY);
+	} else if (in_place) {
+		data = memory_realloc(array->data, size, new_size, MEMTAG_ARRAY);
+	} else {
+		data = memory_alloc_uninit(new_size, MEMTAG_ARRAY);
+		memory_copy(data, array->data, array->length * sizeof(vertex_t));
+		memory_free(array->data, size, MEMTAG_ARRAY);
+	}
+
+	if (array->data) {
+		growths++;
+		if (data != array->data)
+			moves++;
+	}
+
+	array->data = data;
+	array->capacity = new_capacity;
+}
+
+static void bench_grow(dyn_alloc_type_t type, b8 interleaved, b8 in_place) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = GIBIBYTES(1);
+	config.alloc_type = type;
+	memory_init(config);
+
+	grow_array_t arrays[ARRAYS] = {0};
+	void *noise[NOISE_LIVE] = {0};
+	uint32_t noise_at = 0;
+	growths = 0;
+	moves = 0;
+
+	double start = get_absolute_time();
+	for (uint32_t i = 0; i < ARRAYS * VERTICES; ++i) {
+		uint32_t a = interleaved ? i % ARRAYS : i / VERTICES;
+		uint32_t v = interleaved ? i / ARRAYS : i % VERTICES;
+		grow_array_t *array = &arrays[a];
+		if (array->length == array->capacity)
+			array_grow(array, in_place);
+
+		vertex_t vertex = {{(float)v, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+						   {0.0f, 0.0f}};
+		array->data[array->length++] = vertex;
+
+		/* Something else allocates now and then, a ring of blocks that
+		 * live a while and then go. */
+		if (i % NOISE_EVERY == 0) {
+			memory_free(noise[noise_at], NOISE_SIZE, MEMTAG_GAME);
+			noise[noise_at] = memory_alloc_uninit(NOISE_SIZE, MEMTAG_GAME);
+			noise_at = (noise_at + 1) % NOISE_LIVE;
+		}
+	}
+	double elapsed = get_absolute_time() - start;
+
+	memory_stats_t stats = memory_get_stats();
+	printf("  %-8s %-11s %-8s %7.2f ms  %3llu/%3llu growths moved  "
+		   "committed %7.2f MiB\n",
+		   type == DYN_ALLOC_TLSF ? "tlsf" : "freelist",
+		   interleaved ? "interleaved" : "sequential",
+		   in_place ? "realloc" : "move", elapsed * 1e3,
+		   (unsigned long long)moves, (unsigned long long)growths,
+		   stats.committed / (double)MEBIBYTES(1));
+
+	for (uint32_t a = 0; a < ARRAYS; ++a)
+		memory_free(arrays[a].data, arrays[a].capacity * sizeof(vertex_t),
+					MEMTAG_ARRAY);
+	for (uint32_t i = 0; i < NOISE_LIVE; ++i)
+		memory_free(noise[i], NOISE_SIZE, MEMTAG_GAME);
+	memory_shut();
+}
+
+/* dyn_array_push goes through _array_resize, same story end to end. */
+static void bench_dyn_array(void) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = GIBIBYTES(1);
+	config.alloc_type = DYN_ALLOC_TLSF;
+	memory_init(config);
+
+	vertex_t *array = dyn_array_create(vertex_t);
+	uint64_t moved = 0;
+	double start = get_absolute_time();
+	for (uint32_t v = 0; v < VERTICES; ++v) {
+		vertex_t *before = array;
+		vertex_t vertex = {{(float)v, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+						   {0.0f, 0.0f}};
+		dyn_array_push(array, vertex);
+		if (array != before)
+			moved++;
+	}
+	double elapsed = get_absolute_time() - start;
+
+	printf("  dyn_array_push %u vertices %7.2f ms, array moved %llu times\n",
+		   VERTICES, elapsed * 1e3, (unsigned long long)moved);
+	dyn_array_destroy(array);
+	memory_shut();
+}
+
+int main(void) {
+	setvbuf(stdout, 0, _IOLBF, 0);
+	printf("grow %d arrays to %d vertices of %dB, a %dKiB block churns every "
+		   "%d pushes\n",
+		   ARRAYS, VERTICES, (int)sizeof(vertex_t), NOISE_SIZE / 1024,
+		   NOISE_EVERY);
+	for (uint32_t type = DYN_ALLOC_FREELIST; type <= DYN_ALLOC_TLSF; ++type) {
+		for (uint32_t interleaved = 0; interleaved < 2; ++interleaved) {
+			bench_grow((dyn_alloc_type_t)type, interleaved, false);
+			bench_grow((dyn_alloc_type_t)type, interleaved, true);
+		}
+	}
+	bench_dyn_array();
+	return 0;
+}
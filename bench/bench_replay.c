@@ -0,0 +1,600 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/memory/dyn_alloc.h"
+#include "engine/memory/memory.h"
+#include "engine/memory/memory_trace.h"
+#include "engine/platform/filesystem.h"
+#include "engine/platform/platform.h"
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Replay a recorded allocation trace, run with `make bench-replay
+ * TRACE=session.trace` or straight as bench_replay <trace> [allocator...].
+ *
+ * Record one by setting memory_sys_config_t.trace_path (the dummy game
+ * reads ARCADIA_MEMORY_TRACE). The trace gets boiled down to a list of
+ * operations on numbered live blocks first, so the timed pass only calls
+ * the allocator and writes the first and last byte of each block the way a
+ * caller would. A second, untimed pass samples the footprint after every
+ * operation and the fragmentation every SAMPLE_EVERY operations.
+ *
+ * Allocators: tlsf, freelist (bare dyn_alloc), memory (memory_alloc with
+ * its magazines) and malloc. With none named all of them run. Frees of
+ * blocks allocated before the trace began are skipped. */
+
+#define SAMPLE_EVERY 1024
+#define HEAP_MIN MEBIBYTES(64)
+#define SITE_TOP 5
+
+typedef enum replay_kind_t {
+	REPLAY_ALLOC = 0x00,
+	REPLAY_FREE,
+	REPLAY_REALLOC
+} replay_kind_t;
+
+typedef struct replay_op_t {
+	uint64_t size;
+	uint32_t slot;
+	uint8_t kind;
+	uint8_t align_log2;
+} replay_op_t;
+
+typedef struct replay_trace_t {
+	replay_op_t *ops;
+	uint64_t op_count;
+	uint32_t slot_count;
+	uint64_t peak_live;
+	uint64_t duration; // ns from first to last event
+	uint64_t skipped;
+
+	char **site_names;
+	uint64_t *site_allocs;
+	uint64_t *site_bytes;
+	uint32_t site_count;
+} replay_trace_t;
+
+typedef struct replay_allocator_t {
+	const char *name;
+	b8 (*init)(uint64_t heap_size);
+	void (*shut)(void);
+	void *(*alloc)(uint64_t size, uint64_t alignment);
+	void (*free)(void *block, uint64_t size, uint64_t alignment);
+	void *(*realloc)(void *block, uint64_t size, uint64_t new_size);
+	uint64_t (*footprint)(void);
+	float (*fragmentation)(void); // -1 when it cannot tell
+} replay_allocator_t;
+
+/* ===== Trace loading ===== */
+/* Address -> slot while converting. Linear probing, a free overwrites its
+ * entry with a tombstone since addresses come back all the time. */
+#define MAP_EMPTY 0
+#define MAP_DEAD 1
+
+typedef struct slot_map_t {
+	uint64_t *keys;
+	uint32_t *slots;
+	uint64_t capacity;
+	uint64_t used; // live + tombstones
+} slot_map_t;
+
+static uint64_t map_hash(uint64_t key) {
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDull;
+	key ^= key >> 33;
+	return key;
+}
+
+static void map_put(slot_map_t *map, uint64_t key, uint32_t slot);
+
+static void map_grow(slot_map_t *map) {
+	slot_map_t old = *map;
+	map->capacity = old.capacity ? old.capacity * 2 : 4096;
+	map->keys = calloc(map->capacity, sizeof(uint64_t));
+	map->slots = calloc(map->capacity, sizeof(uint32_t));
+	map->used = 0;
+
+	for (uint64_t i = 0; i < old.capacity; ++i) {
+		if (old.keys[i] > MAP_DEAD)
+			map_put(map, old.keys[i], old.slots[i]);
+	}
+	free(old.keys);
+	free(old.slots);
+}
+
+static void map_put(slot_map_t *map, uint64_t key, uint32_t slot) {
+	if ((map->used + 1) * 2 > map->capacity)
+		map_grow(map);
+
+	uint64_t mask = map->capacity - 1;
+	uint64_t i = map_hash(key) & mask;
+	while (map->keys[i] > MAP_DEAD && map->keys[i] != key)
+		i = (i + 1) & mask;
+
+	if (map->keys[i] == MAP_EMPTY)
+		map->used++;
+	map->keys[i] = key;
+	map->slots[i] = slot;
+}
+
+/* Takes the entry out, INVALID_ID if the address is not live. */
+static uint32_t map_take(slot_map_t *map, uint64_t key) {
+	if (!map->capacity)
+		return INVALID_ID;
+
+	uint64_t mask = map->capacity - 1;
+	uint64_t i = map_hash(key) & mask;
+	while (map->keys[i] != MAP_EMPTY) {
+		if (map->keys[i] == key) {
+			map->keys[i] = MAP_DEAD;
+			return map->slots[i];
+		}
+		i = (i + 1) & mask;
+	}
+	return INVALID_ID;
+}
+
+static uint32_t map_find(slot_map_t *map, uint64_t key) {
+	uint32_t slot = map_take(map, key);
+	if (slot != INVALID_ID)
+		map_put(map, key, slot);
+	return slot;
+}
+
+static b8 trace_load(const char *path, replay_trace_t *trace) {
+	file_handle_t file;
+	if (!filesystem_open(path, MODE_READ, true, &file))
+		return false;
+
+	uint64_t file_size = 0;
+	filesystem_size(&file, &file_size);
+	uint8_t *data = malloc(file_size ? file_size : 1);
+	uint64_t read = 0;
+	b8 ok = filesystem_read_all_byte(&file, data, &read);
+	filesystem_close(&file);
+
+	memory_trace_header_t header;
+	if (!ok || read < sizeof(header)) {
+		printf("%s: unable to read trace\n", path);
+		free(data);
+		return false;
+	}
+
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != MEMORY_TRACE_MAGIC ||
+		header.version != MEMORY_TRACE_VERSION ||
+		header.event_size != sizeof(memory_trace_event_t)) {
+		printf("%s: not a version %d memory trace\n", path,
+			   MEMORY_TRACE_VERSION);
+		free(data);
+		return false;
+	}
+
+	uint64_t max_ops = (read - sizeof(header)) / sizeof(memory_trace_event_t);
+	memset(trace, 0, sizeof(*trace));
+	trace->ops = malloc(sizeof(replay_op_t) * (max_ops ? max_ops : 1));
+
+	slot_map_t map = {0};
+	uint32_t *free_slots = malloc(sizeof(uint32_t) * (max_ops ? max_ops : 1));
+	uint64_t *slot_sizes = malloc(sizeof(uint64_t) * (max_ops ? max_ops : 1));
+	uint32_t free_count = 0;
+	uint64_t live = 0;
+	uint64_t first_time = 0, last_time = 0;
+	uint32_t site_capacity = 0;
+
+	uint64_t at = sizeof(header);
+	while (at + sizeof(memory_trace_event_t) <= read) {
+		memory_trace_event_t event;
+		memcpy(&event, data + at, sizeof(event));
+		at += sizeof(event);
+
+		if (!trace->op_count)
+			first_time = event.time;
+		last_time = event.time;
+
+		if (event.kind == MEMORY_TRACE_SITE) {
+			if (at + event.size > read)
+				break;
+			if (event.site >= site_capacity) {
+				uint32_t capacity = site_capacity ? site_capacity : 64;
+				while (capacity <= event.site)
+					capacity *= 2;
+				trace->site_names =
+					realloc(trace->site_names, sizeof(char *) * capacity);
+				trace->site_allocs =
+					realloc(trace->site_allocs, sizeof(uint64_t) * capacity);
+				trace->site_bytes =
+					realloc(trace->site_bytes, sizeof(uint64_t) * capacity);
+				for (uint32_t i = site_capacity; i < capacity; ++i) {
+					trace->site_names[i] = 0;
+					trace->site_allocs[i] = 0;
+					trace->site_bytes[i] = 0;
+				}
+				site_capacity = capacity;
+			}
+
+			char *name = malloc(event.size + 1);
+			memcpy(name, data + at, event.size);
+			name[event.size] = 0;
+			trace->site_names[event.site] = name;
+			if (event.site >= trace->site_count)
+				trace->site_count = event.site + 1;
+			at += event.size;
+			continue;
+		}
+
+		replay_op_t op = {0};
+		op.kind = event.kind;
+		op.size = event.size;
+		op.align_log2 = event.align_log2;
+
+		if (event.kind == MEMORY_TRACE_ALLOC) {
+			op.slot = free_count ? free_slots[--free_count]
+								 : trace->slot_count++;
+			slot_sizes[op.slot] = event.size;
+			map_put(&map, event.block, op.slot);
+			live += event.size;
+			if (event.site < trace->site_count) {
+				trace->site_allocs[event.site]++;
+				trace->site_bytes[event.site] += event.size;
+			}
+		} else if (event.kind == MEMORY_TRACE_FREE) {
+			op.slot = map_take(&map, event.block);
+			if (op.slot == INVALID_ID) {
+				trace->skipped++;
+				continue;
+			}
+			free_slots[free_count++] = op.slot;
+			live -= slot_sizes[op.slot];
+		} else if (event.kind == MEMORY_TRACE_REALLOC) {
+			op.slot = map_find(&map, event.block);
+			if (op.slot == INVALID_ID) {
+				trace->skipped++;
+				continue;
+			}
+			live += event.size - slot_sizes[op.slot];
+			slot_sizes[op.slot] = event.size;
+		} else {
+			continue;
+		}
+
+		if (live > trace->peak_live)
+			trace->peak_live = live;
+		trace->ops[trace->op_count++] = op;
+	}
+
+	trace->duration = last_time - first_time;
+	free(map.keys);
+	free(map.slots);
+	free(free_slots);
+	free(slot_sizes);
+	free(data);
+	return true;
+}
+
+/* ===== Allocators ===== */
+static void *heap_memory;
+static uint64_t heap_require;
+static dyn_alloc_t heap;
+
+static b8 heap_init(dyn_alloc_type_t type, uint64_t heap_size) {
+	dyn_alloc_config_t config = {0};
+	config.type = type;
+	config.total_size = heap_size;
+	config.lazy_commit = true;
+	dyn_alloc_init(config, &heap_require, 0, 0);
+	heap_memory = platform_reserve(heap_require, PLATFORM_PAGES_NORMAL);
+	return heap_memory &&
+		   dyn_alloc_init(config, &heap_require, heap_memory, &heap);
+}
+
+static b8 tlsf_init_replay(uint64_t heap_size) {
+	return heap_init(DYN_ALLOC_TLSF, heap_size);
+}
+
+static b8 freelist_init_replay(uint64_t heap_size) {
+	return heap_init(DYN_ALLOC_FREELIST, heap_size);
+}
+
+static void heap_shut(void) {
+	dyn_alloc_shut(&heap);
+	platform_release(heap_memory, heap_require);
+}
+
+static void *heap_alloc(uint64_t size, uint64_t alignment) {
+	return dyn_alloc_allocate_aligned(&heap, size, alignment);
+}
+
+static void heap_free(void *block, uint64_t size, uint64_t alignment) {
+	(void)alignment;
+	dyn_alloc_free(&heap, block, size);
+}
+
+static void *heap_realloc(void *block, uint64_t size, uint64_t new_size) {
+	if (dyn_alloc_resize(&heap, block, size, new_size))
+		return block;
+
+	void *moved = dyn_alloc_allocate(&heap, new_size);
+	if (moved) {
+		memcpy(moved, block, size < new_size ? size : new_size);
+		dyn_alloc_free(&heap, block, size);
+	}
+	return moved;
+}
+
+static uint64_t heap_footprint(void) {
+	return dyn_alloc_committed(&heap);
+}
+
+static float heap_fragmentation(void) {
+	return dyn_alloc_fragmentation(&heap).fragmentation;
+}
+
+static b8 memory_init_replay(uint64_t heap_size) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = heap_size;
+	config.alloc_type = DYN_ALLOC_TLSF;
+	return memory_init(config);
+}
+
+static void memory_shut_replay(void) {
+	memory_shut();
+}
+
+static void *memory_alloc_replay(uint64_t size, uint64_t alignment) {
+	return memory_alloc_aligned_uninit(size, alignment, MEMTAG_GAME);
+}
+
+static void memory_free_replay(void *block, uint64_t size, uint64_t alignment) {
+	memory_free_aligned(block, size, alignment, MEMTAG_GAME);
+}
+
+static void *memory_realloc_replay(void *block, uint64_t size,
+								   uint64_t new_size) {
+	return memory_realloc(block, size, new_size, MEMTAG_GAME);
+}
+
+static uint64_t memory_footprint(void) {
+	return memory_get_stats().committed;
+}
+
+static float memory_fragmentation(void) {
+	return memory_get_stats().fragmentation;
+}
+
+static b8 malloc_init_replay(uint64_t heap_size) {
+	(void)heap_size;
+	return true;
+}
+
+static void malloc_shut_replay(void) {
+	malloc_trim(0);
+}
+
+static void *malloc_alloc_replay(uint64_t size, uint64_t alignment) {
+	if (alignment <= 16)
+		return malloc(size);
+
+	void *block = 0;
+	return posix_memalign(&block, alignment, size) ? 0 : block;
+}
+
+static void malloc_free_replay(void *block, uint64_t size, uint64_t alignment) {
+	(void)size, (void)alignment;
+	free(block);
+}
+
+static void *malloc_realloc_replay(void *block, uint64_t size,
+								   uint64_t new_size) {
+	(void)size;
+	return realloc(block, new_size);
+}
+
+static uint64_t malloc_footprint(void) {
+	struct mallinfo2 info = mallinfo2();
+	return info.arena + info.hblkhd;
+}
+
+static float malloc_fragmentation(void) {
+	return -1.0f;
+}
+
+static const replay_allocator_t allocators[] = {
+	{"tlsf", tlsf_init_replay, heap_shut, heap_alloc, heap_free, heap_realloc,
+	 heap_footprint, heap_fragmentation},
+	{"freelist", freelist_init_replay, heap_shut, heap_alloc, heap_free,
+	 heap_realloc, heap_footprint, heap_fragmentation},
+	{"memory", memory_init_replay, memory_shut_replay, memory_alloc_replay,
+	 memory_free_replay, memory_realloc_replay, memory_footprint,
+	 memory_fragmentation},
+	{"malloc", malloc_init_replay, malloc_shut_replay, malloc_alloc_replay,
+	 malloc_free_replay, malloc_realloc_replay, malloc_footprint,
+	 malloc_fragmentation},
+};
+
+#define ALLOCATOR_COUNT (sizeof(allocators) / sizeof(allocators[0]))
+
+/* ===== Replay ===== */
+typedef struct replay_result_t {
+	double seconds;
+	uint64_t failed;
+	uint64_t peak_footprint;
+	float frag_avg;
+	float frag_max;
+} replay_result_t;
+
+static void replay_pass(const replay_allocator_t *allocator,
+						const replay_trace_t *trace, void **blocks,
+						uint64_t *sizes, uint8_t *aligns, b8 sample,
+						replay_result_t *result) {
+	uint64_t samples = 0;
+	double frag_total = 0.0;
+
+	for (uint64_t i = 0; i < trace->op_count; ++i) {
+		const replay_op_t *op = &trace->ops[i];
+		uint32_t slot = op->slot;
+
+		if (op->kind == REPLAY_ALLOC) {
+			uint64_t alignment = (uint64_t)1 << op->align_log2;
+			uint8_t *block = allocator->alloc(op->size ? op->size : 1,
+											  alignment);
+			if (block && op->size) {
+				block[0] = (uint8_t)i;
+				block[op->size - 1] = (uint8_t)i;
+			}
+			if (!block)
+				result->failed++;
+			blocks[slot] = block;
+			sizes[slot] = op->size ? op->size : 1;
+			aligns[slot] = op->align_log2;
+		} else if (op->kind == REPLAY_FREE) {
+			if (blocks[slot])
+				allocator->free(blocks[slot], sizes[slot],
+								(uint64_t)1 << aligns[slot]);
+			blocks[slot] = 0;
+		} else if (blocks[slot]) {
+			uint8_t *block =
+				allocator->realloc(blocks[slot], sizes[slot], op->size);
+			if (block) {
+				block[op->size - 1] = (uint8_t)i;
+				blocks[slot] = block;
+				sizes[slot] = op->size;
+			} else {
+				result->failed++;
+			}
+		}
+
+		if (sample) {
+			uint64_t footprint = allocator->footprint();
+			if (footprint > result->peak_footprint)
+				result->peak_footprint = footprint;
+
+			if (i % SAMPLE_EVERY == 0) {
+				float frag = allocator->fragmentation();
+				frag_total += frag;
+				samples++;
+				if (frag > result->frag_max)
+					result->frag_max = frag;
+			}
+		}
+	}
+
+	if (sample)
+		result->frag_avg = samples ? (float)(frag_total / samples) : 0.0f;
+
+	/* Whatever the session still held at the end goes now. */
+	for (uint32_t slot = 0; slot < trace->slot_count; ++slot) {
+		if (blocks[slot])
+			allocator->free(blocks[slot], sizes[slot],
+							(uint64_t)1 << aligns[slot]);
+		blocks[slot] = 0;
+	}
+}
+
+static void replay_run(const replay_allocator_t *allocator,
+					   const replay_trace_t *trace, uint64_t heap_size) {
+	if (!allocator->init(heap_size)) {
+		printf("  %-9s unable to init\n", allocator->name);
+		return;
+	}
+
+	void **blocks = calloc(trace->slot_count + 1, sizeof(void *));
+	uint64_t *sizes = calloc(trace->slot_count + 1, sizeof(uint64_t));
+	uint8_t *aligns = calloc(trace->slot_count + 1, sizeof(uint8_t));
+	replay_result_t result = {0};
+	double start = get_absolute_time();
+	replay_pass(allocator, trace, blocks, sizes, aligns, false, &result);
+	result.seconds = get_absolute_time() - start;
+	allocator->shut();
+
+	replay_result_t sampled = {0};
+	allocator->init(heap_size);
+	replay_pass(allocator, trace, blocks, sizes, aligns, true, &sampled);
+	allocator->shut();
+
+	char frag_text[32] = "n/a";
+	if (sampled.frag_avg >= 0.0f)
+		snprintf(frag_text, sizeof(frag_text), "%5.1f%% / %5.1f%%",
+				 sampled.frag_avg * 100.0f, sampled.frag_max * 100.0f);
+
+	printf("  %-9s %9.2f ms %8.1f ns/op  peak %9.2f MiB  frag avg/max %-16s"
+		   "  failed %llu\n",
+		   allocator->name, result.seconds * 1e3,
+		   result.seconds * 1e9 / (trace->op_count ? trace->op_count : 1),
+		   sampled.peak_footprint / (double)MEBIBYTES(1), frag_text,
+		   (unsigned long long)result.failed);
+
+	free(blocks);
+	free(sizes);
+	free(aligns);
+}
+
+static void trace_print(const char *path, const replay_trace_t *trace) {
+	printf("%s: %llu ops over %.2f s, %u blocks at most, peak live %.2f MiB, "
+		   "%llu frees of older blocks skipped\n",
+		   path, (unsigned long long)trace->op_count, trace->duration / 1e9,
+		   trace->slot_count, trace->peak_live / (double)MEBIBYTES(1),
+		   (unsigned long long)trace->skipped);
+
+	/* Busiest callsites by allocation count, a plain selection is fine for
+	 * a handful. */
+	b8 *shown = calloc(trace->site_count + 1, sizeof(b8));
+	for (uint32_t n = 0; n < SITE_TOP && n < trace->site_count; ++n) {
+		uint32_t best = INVALID_ID;
+		for (uint32_t s = 0; s < trace->site_count; ++s) {
+			if (!shown[s] && trace->site_names[s] &&
+				(best == INVALID_ID ||
+				 trace->site_allocs[s] > trace->site_allocs[best]))
+				best = s;
+		}
+		if (best == INVALID_ID || !trace->site_allocs[best])
+			break;
+
+		shown[best] = true;
+		printf("  %10llu allocs %10.2f MiB  %s\n",
+			   (unsigned long long)trace->site_allocs[best],
+			   trace->site_bytes[best] / (double)MEBIBYTES(1),
+			   trace->site_names[best]);
+	}
+	free(shown);
+}
+
+int main(int argc, char **argv) {
+	setvbuf(stdout, 0, _IOLBF, 0);
+	if (argc < 2) {
+		printf("usage: bench_replay <trace> [tlsf|freelist|memory|malloc]...\n");
+		return 1;
+	}
+
+	replay_trace_t trace;
+	if (!trace_load(argv[1], &trace))
+		return 1;
+	trace_print(argv[1], &trace);
+
+	/* Room for twice the peak, the heaps only commit what they touch. */
+	uint64_t heap_size = trace.peak_live * 2;
+	if (heap_size < HEAP_MIN)
+		heap_size = HEAP_MIN;
+
+	for (uint32_t a = 0; a < ALLOCATOR_COUNT; ++a) {
+		b8 selected = argc == 2;
+		for (int32_t i = 2; i < argc; ++i) {
+			if (!strcmp(argv[i], allocators[a].name))
+				selected = true;
+		}
+		if (selected)
+			replay_run(&allocators[a], &trace, heap_size);
+	}
+
+	for (uint32_t s = 0; s < trace.site_count; ++s)
+		free(trace.site_names[s]);
+	free(trace.site_names);
+	free(trace.site_allocs);
+	free(trace.site_bytes);
+	free(trace.ops);
+	return 0;
+}
@@ -0,0 +1,310 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/container/ring.h"
+#include "engine/memory/memory.h"
+#include "engine/platform/platform_thread.h"
+
+#include <stdio.h>
+
+/* Stress check first, then throughput.
+ *
+ * stress:     small rings so both sides keep running into full/empty and
+ *             the futex path gets used. Producers tag every item with their
+ *             id and a running number, mixing push, push_n and push_wait.
+ *             Each consumer has to see every producer's numbers going up
+ *             (pops come out in ring order) and across consumers every item
+ *             has to show up exactly once.
+ * throughput: items per second through the blocking calls and through
+ *             batches, for a spread of producer/consumer counts. */
+
+#define STRESS_CAPACITY 64
+#define STRESS_ITEMS 400000
+#define BENCH_CAPACITY 4096
+#define BENCH_ITEMS 4000000
+#define BENCH_BATCH 32
+#define THREAD_MAX 8
+
+#define ITEM_SHIFT 40
+#define ITEM_PRODUCER(item) ((item) >> ITEM_SHIFT)
+#define ITEM_NUMBER(item) ((item) & ((1ull << ITEM_SHIFT) - 1))
+
+typedef struct worker_t {
+	platform_thread_t thread;
+	void *ring;
+	b8 mpmc;
+	b8 batch;
+	uint32_t id;
+	uint64_t items;
+	uint32_t producers;
+	/* consumer results */
+	uint64_t received;
+	uint64_t sum;
+	uint64_t order_errors;
+	uint64_t last[THREAD_MAX];
+} worker_t;
+
+static void ring_push_wait(worker_t *worker, const uint64_t *item) {
+	if (worker->mpmc)
+		ring_mpmc_push_wait(worker->ring, item);
+	else
+		ring_spsc_push_wait(worker->ring, item);
+}
+
+static void ring_pop_wait(worker_t *worker, uint64_t *item) {
+	if (worker->mpmc)
+		ring_mpmc_pop_wait(worker->ring, item);
+	else
+		ring_spsc_pop_wait(worker->ring, item);
+}
+
+static uint32_t ring_push_n(worker_t *worker, const uint64_t *items,
+							uint32_t count) {
+	return worker->mpmc ? ring_mpmc_push_n(worker->ring, items, count)
+						: ring_spsc_push_n(worker->ring, items, count);
+}
+
+static uint32_t ring_pop_n(worker_t *worker, uint64_t *items, uint32_t count) {
+	return worker->mpmc ? ring_mpmc_pop_n(worker->ring, items, count)
+						: ring_spsc_pop_n(worker->ring, items, count);
+}
+
+/* Numbers start at 1 so 'last' can start at 0. */
+static void *producer_run(void *arg) {
+	worker_t *worker = arg;
+	uint64_t batch[BENCH_BATCH];
+	uint64_t next = 1;
+
+	while (next <= worker->items) {
+		uint64_t left = worker->items - next + 1;
+		uint32_t count = left < BENCH_BATCH ? (uint32_t)left : BENCH_BATCH;
+		b8 use_batch = worker->batch || (next % 7 == 0);
+		if (!use_batch) {
+			uint64_t item = ((uint64_t)worker->id << ITEM_SHIFT) | next++;
+			ring_push_wait(worker, &item);
+			continue;
+		}
+
+		for (uint32_t i = 0; i < count; ++i)
+			batch[i] = ((uint64_t)worker->id << ITEM_SHIFT) | (next + i);
+
+		/* batches go in as far as they fit, the rest one at a time */
+		uint32_t pushed = ring_push_n(worker, batch, count);
+		for (uint32_t i = pushed; i < count; ++i)
+			ring_push_wait(worker, &batch[i]);
+		next += count;
+	}
+
+	return 0;
+}
+
+static void consume(worker_t *worker, uint64_t item) {
+	uint64_t producer = ITEM_PRODUCER(item);
+	uint64_t number = ITEM_NUMBER(item);
+	if (producer >= worker->producers || number <= worker->last[producer])
+		worker->order_errors++;
+	else
+		worker->last[producer] = number;
+	worker->received++;
+	worker->sum += item;
+}
+
+/* Consumers stop on a 0 item, one is posted per consumer at the end. */
+static void *consumer_run(void *arg) {
+	worker_t *worker = arg;
+	uint64_t batch[BENCH_BATCH];
+
+	for (;;) {
+		uint32_t count = worker->batch ? ring_pop_n(worker, batch, BENCH_BATCH)
+									   : 0;
+		if (!count) {
+			ring_pop_wait(worker, &batch[0]);
+			count = 1;
+		}
+
+		for (uint32_t i = 0; i < count; ++i) {
+			if (!batch[i]) {
+				/* a stop item in the middle of a batch hands the rest on */
+				if (i + 1 < count) {
+					uint32_t pushed =
+						ring_push_n(worker, &batch[i + 1], count - i - 1);
+					for (uint32_t j = i + 1 + pushed; j < count; ++j)
+						ring_push_wait(worker, &batch[j]);
+				}
+				return 0;
+			}
+			consume(worker, batch[i]);
+		}
+	}
+}
+
+typedef struct run_result_t {
+	double elapsed;
+	uint64_t received;
+	uint64_t order_errors;
+	b8 sum_ok;
+} run_result_t;
+
+static run_result_t run(b8 mpmc, b8 batch, uint32_t producers,
+						uint32_t consumers, uint32_t capacity, uint64_t items) {
+	uint64_t require = mpmc ? ring_mpmc_memory_require(sizeof(uint64_t), capacity)
+							: ring_spsc_memory_require(sizeof(uint64_t), capacity);
+	void *memory = memory_alloc(require, MEMTAG_ARRAY);
+	void *ring = mpmc ? memory_alloc_aligned(sizeof(ring_mpmc_t), AR_CACHE_LINE,
+											 MEMTAG_ARRAY)
+					  : memory_alloc_aligned(sizeof(ring_spsc_t), AR_CACHE_LINE,
+											 MEMTAG_ARRAY);
+	if (mpmc)
+		ring_mpmc_init(sizeof(uint64_t), capacity, memory, ring);
+	else
+		ring_spsc_init(sizeof(uint64_t), capacity, memory, ring);
+
+	worker_t producer[THREAD_MAX] = {0};
+	worker_t consumer[THREAD_MAX] = {0};
+	uint64_t per_producer = items / producers;
+
+	double start = get_absolute_time();
+	for (uint32_t i = 0; i < consumers; ++i) {
+		consumer[i].ring = ring;
+		consumer[i].mpmc = mpmc;
+		consumer[i].batch = batch;
+		consumer[i].producers = producers;
+		platform_thread_create(consumer_run, &consumer[i], &consumer[i].thread);
+	}
+	for (uint32_t i = 0; i < producers; ++i) {
+		producer[i].ring = ring;
+		producer[i].mpmc = mpmc;
+		producer[i].batch = batch;
+		producer[i].id = i;
+		producer[i].items = per_producer;
+		platform_thread_create(producer_run, &producer[i], &producer[i].thread);
+	}
+
+	for (uint32_t i = 0; i < producers; ++i)
+		platform_thread_join(&producer[i].thread);
+	uint64_t stop = 0;
+	for (uint32_t i = 0; i < consumers; ++i)
+		ring_push_wait(&producer[0], &stop);
+	for (uint32_t i = 0; i < consumers; ++i)
+		platform_thread_join(&consumer[i].thread);
+	double elapsed = get_absolute_time() - start;
+
+	/* every producer sent id << shift + 1..n */
+	uint64_t expect_sum = 0;
+	for (uint64_t p = 0; p < producers; ++p)
+		expect_sum += (p << ITEM_SHIFT) * per_producer +
+					  per_producer * (per_producer + 1) / 2;
+
+	run_result_t result = {elapsed, 0, 0, false};
+	uint64_t sum = 0;
+	for (uint32_t i = 0; i < consumers; ++i) {
+		result.received += consumer[i].received;
+		result.order_errors += consumer[i].order_errors;
+		sum += consumer[i].sum;
+	}
+	result.sum_ok = sum == expect_sum &&
+					result.received == per_producer * producers;
+
+	memory_free(memory, require, MEMTAG_ARRAY);
+	memory_free_aligned(ring,
+						mpmc ? sizeof(ring_mpmc_t) : sizeof(ring_spsc_t),
+						AR_CACHE_LINE, MEMTAG_ARRAY);
+	return result;
+}
+
+/* Zero sized _n calls on an empty, a part filled and a full ring have to
+ * come straight back with 0 and leave the ring alone. */
+static b8 zero_count_check(b8 mpmc) {
+	uint64_t require = mpmc ? ring_mpmc_memory_require(sizeof(uint64_t), 4)
+							: ring_spsc_memory_require(sizeof(uint64_t), 4);
+	uint64_t ring_size = mpmc ? sizeof(ring_mpmc_t) : sizeof(ring_spsc_t);
+	void *memory = memory_alloc(require, MEMTAG_ARRAY);
+	void *ring = memory_alloc_aligned(ring_size, AR_CACHE_LINE, MEMTAG_ARRAY);
+	if (mpmc)
+		ring_mpmc_init(sizeof(uint64_t), 4, memory, ring);
+	else
+		ring_spsc_init(sizeof(uint64_t), 4, memory, ring);
+
+	worker_t worker = {0};
+	worker.ring = ring;
+	worker.mpmc = mpmc;
+
+	b8 ok = true;
+	uint64_t items[4] = {1, 2, 3, 4};
+	uint32_t fills[] = {0, 2, 2};
+	uint64_t filled = 0;
+	for (uint32_t i = 0; i < 3; ++i) {
+		filled += ring_push_n(&worker, items, fills[i]);
+		ok &= ring_push_n(&worker, items, 0) == 0;
+		ok &= ring_pop_n(&worker, items, 0) == 0;
+		uint64_t count = mpmc ? ring_mpmc_count(ring) : ring_spsc_count(ring);
+		ok &= count == filled;
+	}
+	ok &= ring_pop_n(&worker, items, 4) == 4 && items[0] == 1 && items[3] == 2;
+
+	memory_free(memory, require, MEMTAG_ARRAY);
+	memory_free_aligned(ring, ring_size, AR_CACHE_LINE, MEMTAG_ARRAY);
+	return ok;
+}
+
+static const uint32_t shapes[][2] = {{1, 1}, {2, 2}, {4, 4}, {1, 4}, {4, 1}};
+#define SHAPE_COUNT (sizeof(shapes) / sizeof(shapes[0]))
+
+int main(void) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = MEBIBYTES(64);
+	config.alloc_type = DYN_ALLOC_TLSF;
+	if (!memory_init(config))
+		return 1;
+
+	setvbuf(stdout, 0, _IOLBF, 0);
+	b8 failed = false;
+
+	printf("zero count _n calls\n");
+	for (uint32_t mpmc = 0; mpmc < 2; ++mpmc) {
+		b8 ok = zero_count_check(mpmc);
+		printf("  %s  %s\n", mpmc ? "mpmc" : "spsc", ok ? "ok" : "FAILED");
+		failed |= !ok;
+	}
+
+	printf("stress, capacity %d, %d items\n", STRESS_CAPACITY, STRESS_ITEMS);
+	run_result_t spsc =
+		run(false, false, 1, 1, STRESS_CAPACITY, STRESS_ITEMS);
+	printf("  spsc 1:1  %s\n",
+		   spsc.sum_ok && !spsc.order_errors ? "ok" : "FAILED");
+	failed |= !spsc.sum_ok || spsc.order_errors;
+
+	for (uint32_t s = 0; s < SHAPE_COUNT; ++s) {
+		run_result_t r = run(true, s & 1, shapes[s][0], shapes[s][1],
+							 STRESS_CAPACITY, STRESS_ITEMS);
+		b8 ok = r.sum_ok && !r.order_errors;
+		printf("  mpmc %u:%u  %s (received %llu, order errors %llu)\n",
+			   shapes[s][0], shapes[s][1], ok ? "ok" : "FAILED",
+			   (unsigned long long)r.received,
+			   (unsigned long long)r.order_errors);
+		failed |= !ok;
+	}
+
+	printf("throughput, capacity %d, %d items, Mitems/s\n", BENCH_CAPACITY,
+		   BENCH_ITEMS);
+	printf("%-10s %10s %10s\n", "", "single", "batch 32");
+	run_result_t single = run(false, false, 1, 1, BENCH_CAPACITY, BENCH_ITEMS);
+	run_result_t batch = run(false, true, 1, 1, BENCH_CAPACITY, BENCH_ITEMS);
+	printf("%-10s %10.1f %10.1f\n", "spsc 1:1", BENCH_ITEMS / single.elapsed / 1e6,
+		   BENCH_ITEMS / batch.elapsed / 1e6);
+
+	for (uint32_t s = 0; s < SHAPE_COUNT; ++s) {
+		single = run(true, false, shapes[s][0], shapes[s][1], BENCH_CAPACITY,
+					 BENCH_ITEMS);
+		batch = run(true, true, shapes[s][0], shapes[s][1], BENCH_CAPACITY,
+					BENCH_ITEMS);
+		printf("mpmc %u:%u   %10.1f %10.1f\n", shapes[s][0], shapes[s][1],
+			   BENCH_ITEMS / single.elapsed / 1e6,
+			   BENCH_ITEMS / batch.elapsed / 1e6);
+		failed |= !single.sum_ok || !batch.sum_ok;
+	}
+
+	memory_shut();
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,294 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/memory/dyn_alloc.h"
+#include "engine/memory/memory.h"
+#include "engine/memory/slab.h"
+#include "engine/platform/platform.h"
+
+#include <stdio.h>
+
+/* Small object latency and heap growth, slab against dyn_alloc.
+ *
+ * Latency: keep LIVE objects of one size alive and replace a random one per
+ * op, through a per type slab, the size class slabs, memory_alloc and a bare
+ * TLSF dyn_alloc.
+ *
+ * Growth: load and unload assets the way the loaders do, a big pixel buffer
+ * that goes away after upload plus a path string and a resource struct that
+ * stay until the asset is unloaded. Small objects sprinkled between the big
+ * buffers pin holes the next buffers cannot use, so the heap has to grow.
+ * Committed bytes at the end show how much. memory_alloc already batches
+ * small blocks through the thread magazines, so the gap to slab here is
+ * smaller than against a bare dyn_alloc, and the class slabs pay one span
+ * per size class up front. The same workload then runs on a bare TLSF heap,
+ * once with everything in dyn_alloc and once with the small objects in
+ * class slabs over that heap, and reports its fragmentation as well. */
+
+#define LIVE 10000
+#define OPS 1000000
+#define ASSET_ROUNDS 4000
+#define ASSET_LIVE 512
+#define PIXELS_MIN KIBIBYTES(16)
+#define PIXELS_MAX KIBIBYTES(256)
+
+/* Tight enough that the untouched reserve does not hide the holes in the
+ * fragmentation figure, roomy enough that the workload always fits. */
+#define BARE_HEAP_SIZE MEBIBYTES(2)
+
+typedef enum bench_mode_t {
+	MODE_SLAB_POOL = 0x00,
+	MODE_SLAB_CLASS,
+	MODE_MEMORY,
+	MODE_DYN_ALLOC
+} bench_mode_t;
+
+static const char *mode_names[] = {"slab pool", "slab class", "memory_alloc",
+								   "dyn_alloc"};
+
+typedef struct asset_t {
+	void *path;
+	uint64_t path_size;
+	void *data;
+} asset_t;
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rng_next(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+static void bench_latency(bench_mode_t mode, uint64_t size, void **blocks) {
+	slab_t pool;
+	dyn_alloc_t heap;
+	void *heap_memory = 0;
+	uint64_t heap_require = 0;
+
+	if (mode == MODE_SLAB_POOL) {
+		slab_init(size, 256, MEMTAG_GAME, &pool);
+	} else if (mode == MODE_DYN_ALLOC) {
+		dyn_alloc_config_t config = {0};
+		config.type = DYN_ALLOC_TLSF;
+		config.total_size = MEBIBYTES(64);
+		config.lazy_commit = true;
+		dyn_alloc_init(config, &heap_require, 0, 0);
+		heap_memory = platform_reserve(heap_require, PLATFORM_PAGES_NORMAL);
+		dyn_alloc_init(config, &heap_require, heap_memory, &heap);
+	}
+
+#define BENCH_ALLOC()                                                          \
+	(mode == MODE_SLAB_POOL    ? slab_allocate(&pool)                          \
+	 : mode == MODE_SLAB_CLASS ? slab_alloc(size, MEMTAG_GAME)                 \
+	 : mode == MODE_MEMORY     ? memory_alloc_uninit(size, MEMTAG_GAME)        \
+							   : dyn_alloc_allocate(&heap, size))
+#define BENCH_FREE(block)                                                      \
+	(mode == MODE_SLAB_POOL    ? slab_release(&pool, block)                    \
+	 : mode == MODE_SLAB_CLASS ? slab_free(block, size, MEMTAG_GAME)           \
+	 : mode == MODE_MEMORY     ? memory_free(block, size, MEMTAG_GAME)         \
+							   : (void)dyn_alloc_free(&heap, block, size))
+
+	for (uint32_t i = 0; i < LIVE; ++i)
+		blocks[i] = BENCH_ALLOC();
+
+	double start = get_absolute_time();
+	for (uint32_t op = 0; op < OPS; ++op) {
+		uint32_t slot = (uint32_t)(rng_next() % LIVE);
+		BENCH_FREE(blocks[slot]);
+		blocks[slot] = BENCH_ALLOC();
+	}
+	double elapsed = get_absolute_time() - start;
+
+	for (uint32_t i = 0; i < LIVE; ++i)
+		BENCH_FREE(blocks[i]);
+
+#undef BENCH_ALLOC
+#undef BENCH_FREE
+
+	printf("  %-13s %5lluB  %8.1f ns/op\n", mode_names[mode],
+		   (unsigned long long)size, elapsed * 1e9 / OPS);
+
+	if (mode == MODE_SLAB_POOL) {
+		slab_shut(&pool);
+	} else if (mode == MODE_DYN_ALLOC) {
+		dyn_alloc_shut(&heap);
+		platform_release(heap_memory, heap_require);
+	}
+}
+
+static void asset_unload(b8 slab, asset_t *asset) {
+	if (slab) {
+		slab_free(asset->path, asset->path_size, MEMTAG_STRING);
+		slab_free(asset->data, 24, MEMTAG_TEXTURE);
+	} else {
+		memory_free(asset->path, asset->path_size, MEMTAG_STRING);
+		memory_free(asset->data, 24, MEMTAG_TEXTURE);
+	}
+	asset->path = 0;
+}
+
+static void bench_growth(b8 slab, asset_t *assets) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = GIBIBYTES(1);
+	config.alloc_type = DYN_ALLOC_TLSF;
+	memory_init(config);
+	rng_state = 0x9E3779B97F4A7C15ull;
+
+	for (uint32_t i = 0; i < ASSET_LIVE; ++i)
+		assets[i].path = 0;
+
+	double start = get_absolute_time();
+	for (uint32_t round = 0; round < ASSET_ROUNDS; ++round) {
+		asset_t *asset = &assets[rng_next() % ASSET_LIVE];
+		if (asset->path)
+			asset_unload(slab, asset);
+
+		uint64_t pixel_size =
+			PIXELS_MIN + rng_next() % (PIXELS_MAX - PIXELS_MIN);
+		void *pixels = memory_alloc_uninit(pixel_size, MEMTAG_ARRAY);
+
+		asset->path_size = 48 + rng_next() % 160;
+		asset->path = slab ? slab_alloc(asset->path_size, MEMTAG_STRING)
+						   : memory_alloc_uninit(asset->path_size,
+												 MEMTAG_STRING);
+		asset->data = slab ? slab_alloc(24, MEMTAG_TEXTURE)
+						   : memory_alloc_uninit(24, MEMTAG_TEXTURE);
+
+		/* Upload done, the pixels are gone but the metadata stays. */
+		memory_free(pixels, pixel_size, MEMTAG_ARRAY);
+	}
+	double elapsed = get_absolute_time() - start;
+
+	memory_stats_t stats = memory_get_stats();
+	printf("  %-13s committed %7.2f MiB  used %7.2f MiB  %6.2f us/asset\n",
+		   slab ? "slab" : "memory_alloc", stats.committed / (double)MEBIBYTES(1),
+		   stats.used / (double)MEBIBYTES(1), elapsed * 1e6 / ASSET_ROUNDS);
+
+	for (uint32_t i = 0; i < ASSET_LIVE; ++i) {
+		if (assets[i].path)
+			asset_unload(slab, &assets[i]);
+	}
+	memory_shut();
+}
+
+/* Asset workload on a bare heap, no thread magazines in between. */
+static void bench_growth_heap(b8 slab, asset_t *assets) {
+	dyn_alloc_t heap;
+	uint64_t heap_require = 0;
+	dyn_alloc_config_t config = {0};
+	config.type = DYN_ALLOC_TLSF;
+	config.total_size = BARE_HEAP_SIZE;
+	config.lazy_commit = true;
+	dyn_alloc_init(config, &heap_require, 0, 0);
+	void *heap_memory = platform_reserve(heap_require, PLATFORM_PAGES_NORMAL);
+	if (!heap_memory || !dyn_alloc_init(config, &heap_require, heap_memory,
+										&heap)) {
+		printf("  bare heap init failed\n");
+		return;
+	}
+
+	slab_classes_t classes;
+	if (slab)
+		slab_classes_init(&classes, &heap);
+	rng_state = 0x9E3779B97F4A7C15ull;
+	uint64_t used = 0;
+
+#define SMALL_ALLOC(size)                                                      \
+	(slab ? slab_classes_pop(&classes, size) : dyn_alloc_allocate(&heap, size))
+#define SMALL_FREE(block, size)                                                \
+	(slab ? slab_classes_push(&classes, block, size)                           \
+		  : (void)dyn_alloc_free(&heap, block, size))
+
+	for (uint32_t i = 0; i < ASSET_LIVE; ++i)
+		assets[i].path = 0;
+
+	double start = get_absolute_time();
+	for (uint32_t round = 0; round < ASSET_ROUNDS; ++round) {
+		asset_t *asset = &assets[rng_next() % ASSET_LIVE];
+		if (asset->path) {
+			SMALL_FREE(asset->path, asset->path_size);
+			SMALL_FREE(asset->data, 24);
+			used -= asset->path_size + 24;
+			asset->path = 0;
+		}
+
+		uint64_t pixel_size =
+			PIXELS_MIN + rng_next() % (PIXELS_MAX - PIXELS_MIN);
+		void *pixels = dyn_alloc_allocate(&heap, pixel_size);
+
+		asset->path_size = 48 + rng_next() % 160;
+		asset->path = SMALL_ALLOC(asset->path_size);
+		asset->data = SMALL_ALLOC(24);
+		if (!pixels || !asset->path || !asset->data) {
+			printf("  bare heap out of space at round %u\n", round);
+			if (pixels)
+				dyn_alloc_free(&heap, pixels, pixel_size);
+			if (asset->path)
+				SMALL_FREE(asset->path, asset->path_size);
+			if (asset->data)
+				SMALL_FREE(asset->data, 24);
+			asset->path = 0;
+			break;
+		}
+		used += asset->path_size + 24;
+
+		dyn_alloc_free(&heap, pixels, pixel_size);
+	}
+	double elapsed = get_absolute_time() - start;
+
+	dyn_alloc_frag_t frag = dyn_alloc_fragmentation(&heap);
+	printf("  %-13s committed %7.2f MiB  used %7.2f MiB  %6.2f us/asset  "
+		   "frag %.3f over %llu holes\n",
+		   slab ? "heap + slab" : "heap",
+		   dyn_alloc_committed(&heap) / (double)MEBIBYTES(1),
+		   used / (double)MEBIBYTES(1), elapsed * 1e6 / ASSET_ROUNDS,
+		   frag.fragmentation, (unsigned long long)frag.free_blocks);
+
+	for (uint32_t i = 0; i < ASSET_LIVE; ++i) {
+		if (assets[i].path) {
+			SMALL_FREE(assets[i].path, assets[i].path_size);
+			SMALL_FREE(assets[i].data, 24);
+		}
+	}
+
+#undef SMALL_ALLOC
+#undef SMALL_FREE
+
+	if (slab)
+		slab_classes_shut(&classes);
+	dyn_alloc_shut(&heap);
+	platform_release(heap_memory, heap_require);
+}
+
+int main(void) {
+	setvbuf(stdout, 0, _IOLBF, 0);
+	void **blocks = platform_allocate(sizeof(void *) * LIVE, false);
+	asset_t *assets = platform_allocate(sizeof(asset_t) * ASSET_LIVE, false);
+
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = MEBIBYTES(256);
+	config.alloc_type = DYN_ALLOC_TLSF;
+	memory_init(config);
+
+	const uint64_t sizes[] = {32, 128, 544};
+	printf("replace a random one of %d live objects, %d ops\n", LIVE, OPS);
+	for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+		for (uint32_t mode = MODE_SLAB_POOL; mode <= MODE_DYN_ALLOC; ++mode)
+			bench_latency((bench_mode_t)mode, sizes[s], blocks);
+	}
+	memory_shut();
+
+	printf("load/unload %d assets, %d resident, pixels %d-%dKiB\n",
+		   ASSET_ROUNDS, ASSET_LIVE, PIXELS_MIN / 1024, PIXELS_MAX / 1024);
+	bench_growth(false, assets);
+	bench_growth(true, assets);
+	bench_growth_heap(false, assets);
+	bench_growth_heap(true, assets);
+
+	platform_free(assets, false);
+	platform_free(blocks, false);
+	return 0;
+}
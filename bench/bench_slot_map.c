@@ -0,0 +1,112 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/container/slot_map.h"
+#include "engine/memory/memory.h"
+
+#include <stdio.h>
+
+/* Registry acquire + release at the texture registry size, before and after
+ * the registries moved onto slot_map_t. The old registries scanned for the
+ * first entry with id == INVALID_ID, so the cost followed how full the
+ * registry was; the slot map pops its free list. The registry is filled to
+ * each level first, then the same slot is taken and given back. */
+
+#define REGISTRY_COUNT 65536
+#define CYCLES 20000
+
+typedef struct bench_entry_t {
+	uint64_t ref_count;
+	uint32_t id;
+	uint32_t gen;
+	uint32_t width;
+	uint32_t height;
+	void *internal_data;
+	uint32_t name;
+	uint8_t auto_release;
+} bench_entry_t;
+
+static const uint32_t fill_levels[] = {0, 50, 90, 99};
+
+/* ===== What the engine did before ===== */
+static uint32_t legacy_acquire(bench_entry_t *entries) {
+	for (uint32_t i = 0; i < REGISTRY_COUNT; ++i) {
+		if (entries[i].id == INVALID_ID) {
+			entries[i].id = i;
+			entries[i].ref_count = 1;
+			return i;
+		}
+	}
+
+	return INVALID_ID;
+}
+
+static void legacy_release(bench_entry_t *entries, uint32_t id) {
+	entries[id].id = INVALID_ID;
+	entries[id].ref_count = 0;
+}
+
+static double bench_legacy(uint32_t fill) {
+	bench_entry_t *entries =
+		memory_alloc(sizeof(bench_entry_t) * REGISTRY_COUNT, MEMTAG_ARRAY);
+	for (uint32_t i = 0; i < REGISTRY_COUNT; ++i)
+		entries[i].id = INVALID_ID;
+	for (uint32_t i = 0; i < REGISTRY_COUNT / 100 * fill; ++i)
+		legacy_acquire(entries);
+
+	double start = get_absolute_time();
+	for (uint32_t i = 0; i < CYCLES; ++i)
+		legacy_release(entries, legacy_acquire(entries));
+	double elapsed = get_absolute_time() - start;
+
+	memory_free(entries, sizeof(bench_entry_t) * REGISTRY_COUNT, MEMTAG_ARRAY);
+	return elapsed;
+}
+
+/* ===== Slot map ===== */
+static double bench_slot_map(uint32_t fill) {
+	uint64_t require =
+		slot_map_memory_require(sizeof(bench_entry_t), REGISTRY_COUNT);
+	void *memory = memory_alloc(require, MEMTAG_ARRAY);
+	slot_map_t map;
+	slot_map_init(sizeof(bench_entry_t), REGISTRY_COUNT, memory, &map);
+	for (uint32_t i = 0; i < REGISTRY_COUNT / 100 * fill; ++i)
+		slot_map_insert(&map, 0);
+
+	double start = get_absolute_time();
+	for (uint32_t i = 0; i < CYCLES; ++i) {
+		bench_entry_t *entry;
+		uint32_t handle = slot_map_insert(&map, (void **)&entry);
+		entry->id = handle;
+		entry->ref_count = 1;
+		slot_map_remove(&map, handle);
+	}
+	double elapsed = get_absolute_time() - start;
+
+	memory_free(memory, require, MEMTAG_ARRAY);
+	return elapsed;
+}
+
+int main(void) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = MEBIBYTES(64);
+	config.alloc_type = DYN_ALLOC_TLSF;
+	if (!memory_init(config))
+		return 1;
+
+	setvbuf(stdout, 0, _IOLBF, 0);
+	printf("registry acquire + release, %d entries, %d cycles\n",
+		   REGISTRY_COUNT, CYCLES);
+	printf("%-6s %14s %14s\n", "full", "scan ns/op", "slot map ns/op");
+
+	for (uint32_t i = 0; i < sizeof(fill_levels) / sizeof(fill_levels[0]); ++i) {
+		double legacy = bench_legacy(fill_levels[i]);
+		double slots = bench_slot_map(fill_levels[i]);
+		printf("%5u%% %14.1f %14.1f\n", fill_levels[i], legacy * 1e9 / CYCLES,
+			   slots * 1e9 / CYCLES);
+	}
+
+	memory_shut();
+	return 0;
+}
@@ -0,0 +1,112 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/container/soa.h"
+#include "engine/memory/memory.h"
+
+#include <stdio.h>
+
+/* One hot field read across a registry, array of structs against
+ * structure of arrays. The struct is what a registry entry looked like with
+ * the name buffer inline (geometry_t had char name[256]), the loop only
+ * wants ref_count and internal_id. */
+
+#define ENTRY_COUNT 65536
+#define PASSES 200
+#define BENCH_NAME_LENGTH 256
+
+typedef struct bench_entry_t {
+	uint64_t ref_count;
+	uint32_t id;
+	uint32_t gen;
+	uint32_t internal_id;
+	char name[BENCH_NAME_LENGTH];
+	void *material;
+	b8 auto_release;
+} bench_entry_t;
+
+#define BENCH_FIELDS(X)                                                        \
+	X(uint64_t, ref_count)                                                     \
+	X(uint32_t, id)                                                            \
+	X(uint32_t, gen)                                                           \
+	X(uint32_t, internal_id)                                                   \
+	X(void *, material)                                                        \
+	X(b8, auto_release)
+SOA_DECLARE(bench_soa, BENCH_FIELDS)
+
+static uint64_t checksum;
+
+static double bench_aos(void) {
+	bench_entry_t *entries =
+		memory_alloc(sizeof(bench_entry_t) * ENTRY_COUNT, MEMTAG_ARRAY);
+	for (uint32_t i = 0; i < ENTRY_COUNT; ++i) {
+		entries[i].ref_count = i & 3;
+		entries[i].internal_id = i;
+	}
+
+	double start = get_absolute_time();
+	for (uint32_t pass = 0; pass < PASSES; ++pass) {
+		uint64_t sum = 0;
+		for (uint32_t i = 0; i < ENTRY_COUNT; ++i) {
+			if (entries[i].ref_count)
+				sum += entries[i].internal_id;
+		}
+		checksum += sum;
+	}
+	double elapsed = get_absolute_time() - start;
+
+	memory_free(entries, sizeof(bench_entry_t) * ENTRY_COUNT, MEMTAG_ARRAY);
+	return elapsed;
+}
+
+static double bench_soa(void) {
+	bench_soa_t soa;
+	bench_soa_init(&soa, ENTRY_COUNT);
+	for (uint32_t i = 0; i < ENTRY_COUNT; ++i) {
+		uint32_t row = bench_soa_push(&soa);
+		soa.ref_count[row] = i & 3;
+		soa.internal_id[row] = i;
+	}
+
+	double start = get_absolute_time();
+	for (uint32_t pass = 0; pass < PASSES; ++pass) {
+		const uint64_t *ref_count = soa_column(&soa, ref_count);
+		const uint32_t *internal_id = soa_column(&soa, internal_id);
+		uint64_t sum = 0;
+		for (uint32_t i = 0; i < soa_length(&soa); ++i) {
+			if (ref_count[i])
+				sum += internal_id[i];
+		}
+		checksum += sum;
+	}
+	double elapsed = get_absolute_time() - start;
+
+	bench_soa_shut(&soa);
+	return elapsed;
+}
+
+int main(void) {
+	memory_sys_config_t config = {0};
+	config.total_alloc_size = MEBIBYTES(128);
+	config.alloc_type = DYN_ALLOC_TLSF;
+	if (!memory_init(config))
+		return 1;
+
+	setvbuf(stdout, 0, _IOLBF, 0);
+	double aos = bench_aos();
+	uint64_t aos_sum = checksum;
+	checksum = 0;
+	double soa = bench_soa();
+
+	uint64_t rows = (uint64_t)ENTRY_COUNT * PASSES;
+	printf("hot field scan, %d entries (%d byte struct), %d passes\n",
+		   ENTRY_COUNT, (int)sizeof(bench_entry_t), PASSES);
+	printf("  aos %8.2f ns/row\n", aos * 1e9 / rows);
+	printf("  soa %8.2f ns/row\n", soa * 1e9 / rows);
+	if (aos_sum != checksum)
+		printf("checksum mismatch\n");
+
+	memory_shut();
+	return 0;
+}
@@ -2,6 +2,8 @@
 
 #include "engine/engine_entry.h"
 
+#include <stdlib.h>
+
 /* this function was expected by the engine.
  * so the engine knows what game want to do*/
 
@@ -9,6 +11,13 @@ b8 game_entry_point(game_entry *game) {
 	game->app_config.width = 1280;
 	game->app_config.height = 720;
 	game->app_config.name = "Arcadia Engine";
+	game->app_config.huge_pages = true;
+
+	/* ARCADIA_MEMORY_TRACE=session.trace records the heap for bench_replay. */
+	game->app_config.memory_trace = getenv("ARCADIA_MEMORY_TRACE");
+
+	/* ARCADIA_MEMORY_PROFILE=profile.json dumps the callsite profile. */
+	game->app_config.memory_profile = getenv("ARCADIA_MEMORY_PROFILE");
 
 	game->init = game_init;
 	game->run = game_run;
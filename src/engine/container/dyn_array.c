@@ -4,19 +4,49 @@
 
 #include <stdlib.h>
 
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+void *array_realloc(void *array, uint64_t new_capacity) {
+	uint64_t *header = DYN_ARRAY_META(array);
+	uint64_t size_header = DYN_ARRAY_FIELD_LENGTH * sizeof(uint64_t);
+	uint64_t stride = header[DYN_ARRAY_STRIDE];
+
+	/* Mostly grows in place, only copies when the heap has no room after
+	 * the array. */
+	header = memory_realloc(header,
+							size_header + header[DYN_ARRAY_CAPACITY] * stride,
+							size_header + new_capacity * stride,
+							MEMTAG_DYN_ARRAY);
+	if (!header) {
+		ar_ERROR("array_realloc - unable to resize array to %llu elements",
+				 new_capacity);
+		return 0;
+	}
+
+	header[DYN_ARRAY_CAPACITY] = new_capacity;
+	return (void *)(header + DYN_ARRAY_FIELD_LENGTH);
+}
+
+void *array_at(void *array, uint64_t index) {
+	return (char *)array + index * DYN_ARRAY_META(array)[DYN_ARRAY_STRIDE];
+}
+/* ========================================================================== */
+/* ========================================================================== */
+
 void *_array_create(uint64_t length, uint64_t stride) {
 	uint64_t size_header = DYN_ARRAY_FIELD_LENGTH * sizeof(uint64_t);
 	uint64_t size_array = length * stride;
 
-	uint64_t *array = memory_alloc(size_header + size_array, MEMTAG_DYN_ARRAY);
+	/* Slots past length are never read before a push writes them. */
+	uint64_t *array =
+		memory_alloc_uninit(size_header + size_array, MEMTAG_DYN_ARRAY);
 	if (!array) 
 		return NULL;
 
-	memory_set(array, 0, size_header + size_array);
-
 	array[DYN_ARRAY_CAPACITY] 	= length;
 	array[DYN_ARRAY_LENGTH] 	= 0;
 	array[DYN_ARRAY_STRIDE] 	= stride;
+	array[DYN_ARRAY_GROWTH] 	= DYN_ARRAY_DEF_GROWTH;
 
 	return (void *)(array + DYN_ARRAY_FIELD_LENGTH);
 }
@@ -40,80 +70,134 @@ void _array_set_field(void *array, uint64_t field, uint64_t value) {
 }
 
 void *_array_resize(void *array) {
-	uint64_t length = dyn_array_length(array);
-	uint64_t stride = dyn_array_stride(array);
+	return _array_grow(array, dyn_array_capacity(array) + 1);
+}
 
-	void *temp = _array_create(DYN_ARRAY_RESIZE_FACTOR * 
-				dyn_array_capacity(array), stride);
-	memory_copy(temp, array, length * stride);
+void *_array_grow(void *array, uint64_t min_capacity) {
+	uint64_t *header = DYN_ARRAY_META(array);
+	uint64_t capacity = header[DYN_ARRAY_CAPACITY];
+	if (min_capacity <= capacity)
+		return array;
 
-	_array_set_field(temp, DYN_ARRAY_LENGTH, length);
-	_array_destroy(array);
-	return temp;
+	uint64_t growth = header[DYN_ARRAY_GROWTH];
+	if (growth <= 100)
+		growth = DYN_ARRAY_DEF_GROWTH;
+
+	/* Bulk appends past the next step get exactly what they asked for,
+	 * the step after that goes back to the policy. */
+	uint64_t new_capacity = capacity * growth / 100;
+	if (new_capacity <= capacity)
+		new_capacity = capacity + 1;
+	if (new_capacity < DYN_ARRAY_DEF_CAPACITY)
+		new_capacity = DYN_ARRAY_DEF_CAPACITY;
+	if (new_capacity < min_capacity)
+		new_capacity = min_capacity;
+
+	return array_realloc(array, new_capacity);
 }
 
-void *_array_push(void *array, const void *value_ptr) {
+void *_array_reserve(void *array, uint64_t capacity) {
+	if (capacity <= dyn_array_capacity(array))
+		return array;
+	return array_realloc(array, capacity);
+}
+
+void *_array_shrink(void *array) {
 	uint64_t length = dyn_array_length(array);
-	uint64_t stride = dyn_array_stride(array);
-	if (length >= dyn_array_capacity(array))
-		array = _array_resize(array);
+	if (length == dyn_array_capacity(array))
+		return array;
+	return array_realloc(array, length);
+}
+
+void *_array_push(void *array, const void *value_ptr) {
+	uint64_t *header = DYN_ARRAY_META(array);
+	uint64_t length = header[DYN_ARRAY_LENGTH];
+	if (length >= header[DYN_ARRAY_CAPACITY]) {
+		array = _array_grow(array, length + 1);
+		if (!array)
+			return 0;
+		header = DYN_ARRAY_META(array);
+	}
 
-	uint64_t address = (uint64_t)array;
-	address += (length * stride);
-	memory_copy((void *)address, value_ptr, stride);
-	_array_set_field(array, DYN_ARRAY_LENGTH, length + 1);
+	memory_copy(array_at(array, length), value_ptr, header[DYN_ARRAY_STRIDE]);
+	header[DYN_ARRAY_LENGTH] = length + 1;
 	return array;
 }
 
 void _array_pop(void *array, void *target) {
+	uint64_t *header = DYN_ARRAY_META(array);
+	uint64_t length = header[DYN_ARRAY_LENGTH] - 1;
+	memory_copy(target, array_at(array, length), header[DYN_ARRAY_STRIDE]);
+	header[DYN_ARRAY_LENGTH] = length;
+}
+
+void *_array_append_n(void *array, const void *values, uint64_t count) {
+	if (!count)
+		return array;
+
 	uint64_t length = dyn_array_length(array);
-	uint64_t stride = dyn_array_stride(array);
-	uint64_t address = (uint64_t)array;
+	array = _array_grow(array, length + count);
+	if (!array)
+		return 0;
 
-	address += ((length - 1) * stride);
-	memory_copy(target, (void *)address, stride);
-	_array_set_field(array, DYN_ARRAY_LENGTH, length - 1);
+	memory_copy(array_at(array, length), values, count * dyn_array_stride(array));
+	dyn_array_length_set(array, length + count);
+	return array;
 }
 
 void *_array_pop_at(void *array, uint64_t index, void *target) {
 	uint64_t length = dyn_array_length(array);
 	uint64_t stride = dyn_array_stride(array);
 	if (index >= length) {
-		ar_WARNING("Index outside of bounds. Length: &lu, Index: %lu.",
+		ar_WARNING("Index outside of bounds. Length: %llu, Index: %llu.",
 					length, index);
 		return array;
 	}
 
-	uint64_t address = (uint64_t)array;
-	memory_copy(target, (void *)(address + (index * stride)), stride);
-	if (index != length - 1)
-		memory_copy((void *)(address + (index * stride)),
-					(void *)(address + ((index + 1) * stride)),
-					stride * (length - index));
+	if (target)
+		memory_copy(target, array_at(array, index), stride);
+	/* Source and target overlap, memcpy is not allowed to do this. */
+	memmove(array_at(array, index), array_at(array, index + 1),
+			stride * (length - index - 1));
 
-	_array_set_field(array, DYN_ARRAY_LENGTH, length - 1);
+	dyn_array_length_set(array, length - 1);
 	return array;
 }
 
 void *_array_insert_at(void *array, uint64_t index, void *value_ptr) {
 	uint64_t length = dyn_array_length(array);
 	uint64_t stride = dyn_array_stride(array);
-	if (index >= length) {
-		ar_WARNING("Index outside of bounds! Length: %lu, Index: %lu.\n",
+	if (index > length) {
+		ar_WARNING("Index outside of bounds! Length: %llu, Index: %llu.",
 					length, index);
 		return array;
 	}
 
-	if (length >= dyn_array_capacity(array))
-		array = _array_resize(array);
+	array = _array_grow(array, length + 1);
+	if (!array)
+		return 0;
 
-	uint64_t address = (uint64_t)array;
+	memmove(array_at(array, index + 1), array_at(array, index),
+			stride * (length - index));
+	memory_copy(array_at(array, index), value_ptr, stride);
+	dyn_array_length_set(array, length + 1);
+	return array;
+}
+
+void _array_swap_remove(void *array, uint64_t index, void *target) {
+	uint64_t length = dyn_array_length(array);
+	uint64_t stride = dyn_array_stride(array);
+	if (index >= length) {
+		ar_WARNING("Index outside of bounds. Length: %llu, Index: %llu.",
+					length, index);
+		return;
+	}
+
+	if (target)
+		memory_copy(target, array_at(array, index), stride);
 	if (index != length - 1)
-		memory_copy((void *)(address + ((index - 1) * stride)),
-					(void *)(address + (index * stride)),
-					stride * (length - index));
+		memory_copy(array_at(array, index), array_at(array, length - 1),
+					stride);
 
-	memory_copy((void *)(address + (index * stride)), value_ptr, stride);
-	_array_set_field(array, DYN_ARRAY_LENGTH, length + 1);
-	return array;
+	dyn_array_length_set(array, length - 1);
 }
@@ -3,13 +3,17 @@
 
 #include "engine/define.h"
 
+#include <string.h>
+
 enum {
 	DYN_ARRAY_CAPACITY, 	// Total allocated elements
 	DYN_ARRAY_LENGTH, 		// Number elements currently used
 	DYN_ARRAY_STRIDE, 		// Size of elements in byte
+	DYN_ARRAY_GROWTH, 		// Growth policy, new capacity in % of the old
 	DYN_ARRAY_FIELD_LENGTH 	// Total metadata fields
 };
 
+/* Four fields keep the elements 16 byte aligned behind the header. */
 #define DYN_ARRAY_META(arr) ((uint64_t *)(arr) - DYN_ARRAY_FIELD_LENGTH)
 
 void *_array_create(uint64_t length, uint64_t stride);
@@ -19,14 +23,29 @@ uint64_t _array_get_field(void *array, uint64_t field);
 void _array_set_field(void *array, uint64_t field, uint64_t value);
 void *_array_resize(void *array);
 
+/* Grow following the array's growth policy until 'min_capacity' fits. */
+void *_array_grow(void *array, uint64_t min_capacity);
+/* Grow to exactly 'capacity' when smaller, never shrinks. */
+void *_array_reserve(void *array, uint64_t capacity);
+/* Give back the capacity past length. */
+void *_array_shrink(void *array);
+
 void *_array_push(void *array, const void *value_ptr);
 void _array_pop(void *array, void *target);
+void *_array_append_n(void *array, const void *values, uint64_t count);
 
+/* Ordered, shifts the tail. 'target' may be null. */
 void *_array_pop_at(void *array, uint64_t index, void *target);
+/* 'index' up to length, inserting at length appends. */
 void *_array_insert_at(void *array, uint64_t index, void *value_ptr);
+/* Unordered O(1) remove, the last element takes the slot. 'target' may
+ * be null. */
+void _array_swap_remove(void *array, uint64_t index, void *target);
 
-#define DYN_ARRAY_DEF_CAPACITY 0x01
+/* First allocation of a grown array, and the default growth in %. */
+#define DYN_ARRAY_DEF_CAPACITY 0x08
 #define DYN_ARRAY_RESIZE_FACTOR 0x02
+#define DYN_ARRAY_DEF_GROWTH (DYN_ARRAY_RESIZE_FACTOR * 100)
 
 #define dyn_array_create(type) 													\
 	_array_create(DYN_ARRAY_DEF_CAPACITY, sizeof(type))
@@ -36,25 +55,75 @@ void *_array_insert_at(void *array, uint64_t index, void *value_ptr);
 
 #define dyn_array_destroy(array) _array_destroy(array)
 
-#define dyn_array_push(array, value) { 											\
-		__typeof__(value) temp = (value); 										\
-		(array) = _array_push((array), &temp);}
-
-
-#define dyn_array_insert_at(array, index, value) { 								\
-		__typeof__(value) temp = value; 										\
-		array = _array_insert_at(array, index, &temp);}
+/* Push/pop read the header once and only call out when the array has to
+ * grow. 'value' has to be of the element type, its size is what's copied
+ * on push.
+ *
+ * Growing goes through a temp: when it fails 'array' keeps its old block and
+ * the push, insert or append is skipped, so a length that did not move is
+ * how a caller sees it. */
+#define dyn_array_push(array, value) do { 										\
+		__typeof__(value) _da_value = (value); 									\
+		uint64_t *_da_meta = DYN_ARRAY_META(array); 							\
+		if (_da_meta[DYN_ARRAY_LENGTH] >= _da_meta[DYN_ARRAY_CAPACITY]) { 		\
+			void *_da_grown = 													\
+				_array_grow((array), _da_meta[DYN_ARRAY_LENGTH] + 1); 			\
+			if (!_da_grown) 													\
+				break; 															\
+			(array) = _da_grown; 												\
+			_da_meta = DYN_ARRAY_META(array); 									\
+		} 																		\
+		memcpy((char *)(array) + 												\
+			   _da_meta[DYN_ARRAY_LENGTH] * _da_meta[DYN_ARRAY_STRIDE], 		\
+			   &_da_value, sizeof(_da_value)); 									\
+		_da_meta[DYN_ARRAY_LENGTH]++; 											\
+	} while (0)
+
+#define dyn_array_pop(array, value_ptr) do { 									\
+		uint64_t *_da_meta = DYN_ARRAY_META(array); 							\
+		_da_meta[DYN_ARRAY_LENGTH]--; 											\
+		memcpy((value_ptr), (char *)(array) + 									\
+			   _da_meta[DYN_ARRAY_LENGTH] * _da_meta[DYN_ARRAY_STRIDE], 		\
+			   _da_meta[DYN_ARRAY_STRIDE]); 									\
+	} while (0)
+
+/* Assign the result of a call that can move the array, only when it worked. */
+#define DYN_ARRAY_UPDATE(array, call) do { 										\
+		void *_da_result = (call); 												\
+		if (_da_result) 														\
+			(array) = _da_result; 												\
+	} while (0)
+
+#define dyn_array_insert_at(array, index, value) do { 							\
+		__typeof__(value) _da_value = (value); 									\
+		DYN_ARRAY_UPDATE(array, _array_insert_at((array), (index), &_da_value));\
+	} while (0)
 
-#define dyn_array_pop(array, value_ptr) _array_pop(array, value_ptr)
 #define dyn_array_pop_at(array, index, value_ptr) 								\
 	_array_pop_at(array, index, value_ptr)
+#define dyn_array_swap_remove(array, index, value_ptr) 							\
+	_array_swap_remove(array, index, value_ptr)
+
+#define dyn_array_append_n(array, values, count) 								\
+	DYN_ARRAY_UPDATE(array, _array_append_n((array), (values), (count)))
+#define dyn_array_extend(array, other) 											\
+	dyn_array_append_n(array, other, dyn_array_length(other))
+
+#define dyn_array_reserve(array, capacity) 										\
+	DYN_ARRAY_UPDATE(array, _array_reserve((array), (capacity)))
+#define dyn_array_shrink(array) DYN_ARRAY_UPDATE(array, _array_shrink(array))
+
+/* Growth in % of the current capacity, anything at or under 100 falls back
+ * to DYN_ARRAY_DEF_GROWTH. */
+#define dyn_array_growth_set(array, percent) 									\
+	(DYN_ARRAY_META(array)[DYN_ARRAY_GROWTH] = (percent))
 
-#define dyn_array_clear(array) _array_set_field(array, DYN_ARRAY_LENGTH, 0)
-#define dyn_array_capacity(array) _array_get_field(array, DYN_ARRAY_CAPACITY)
-#define dyn_array_length(array) _array_get_field(array, DYN_ARRAY_LENGTH)
-#define dyn_array_stride(array) _array_get_field(array, DYN_ARRAY_STRIDE)
+#define dyn_array_clear(array) (DYN_ARRAY_META(array)[DYN_ARRAY_LENGTH] = 0)
+#define dyn_array_capacity(array) (DYN_ARRAY_META(array)[DYN_ARRAY_CAPACITY])
+#define dyn_array_length(array) (DYN_ARRAY_META(array)[DYN_ARRAY_LENGTH])
+#define dyn_array_stride(array) (DYN_ARRAY_META(array)[DYN_ARRAY_STRIDE])
 
 #define dyn_array_length_set(array, value) 										\
-	_array_set_field(array, DYN_ARRAY_LENGTH, value)
+	(DYN_ARRAY_META(array)[DYN_ARRAY_LENGTH] = (value))
 
 #endif //__DYNAMIC_ARRAY_H__
@@ -3,71 +3,237 @@
 #include "engine/core/logger.h"
 #include "engine/memory/memory.h"
 
+/* Free ranges sit in two treaps at once, one ordered by offset for
+ * coalescing and one by (size, offset) for best fit. A node's priority is a
+ * hash of its index, so neither tree stores any balance data. Links are
+ * node indices, INVALID_ID for none. */
+#define TREE_OFFSET 0
+#define TREE_SIZE 1
+
+/* Aligned fit looks at this many ranges from the best fit up before going
+ * straight to one big enough for any alignment pad. */
+#define ALIGNED_PROBES 16
+
 typedef struct freelist_node_t {
 	uint64_t offset;
 	uint64_t size;
-	struct freelist_node_t *next;
+	uint32_t link[2][2]; // [tree][left, right], free nodes chain through [0][0]
 } freelist_node_t;
 
 typedef struct internal_state_t {
 	uint64_t total_size;
-	uint64_t max_entry;
-	freelist_node_t *head;
+	uint64_t free_space;
+	uint64_t lost_space; // ranges dropped while the node pool was empty
+	uint32_t max_entry;
+	uint32_t range_count;
+	uint32_t node_free;
+	uint32_t node_used; // nodes below this have been handed out before
+	uint32_t root[2];
 	freelist_node_t *nodes;
 } internal_state_t;
 
 /* ========================= PRIVATE FUNCTION =============================== */
 /* ========================================================================== */
-freelist_node_t *get_node(freelist_t *freelist) {
-	internal_state_t *state = freelist->memory;
+uint32_t node_priority(uint32_t index) {
+	index ^= index >> 16;
+	index *= 0x7FEB352Du;
+	index ^= index >> 15;
+	index *= 0x846CA68Bu;
+	return index ^ (index >> 16);
+}
 
-	for (uint64_t i = 0; i < state->max_entry; ++i) {
-		if (state->nodes[i].offset == INVALID_ID) {
-			return &state->nodes[i];
+/* Node n orders before the key (size, offset) in 'tree'. Offsets are
+ * unique, so (size, offset) is too. */
+_arinline b8 node_before(const freelist_node_t *n, uint64_t size,
+						 uint64_t offset, uint32_t tree) {
+	if (tree == TREE_SIZE && n->size != size)
+		return n->size < size;
+	return n->offset < offset;
+}
+
+/* Top down, no recursion. Walk to where the node's priority belongs and
+ * split what hangs there around it. */
+void node_insert(internal_state_t *state, uint32_t node, uint32_t tree) {
+	freelist_node_t *key = &state->nodes[node];
+	uint32_t priority = node_priority(node);
+	uint32_t *at = &state->root[tree];
+	while (*at != INVALID_ID && node_priority(*at) >= priority) {
+		freelist_node_t *n = &state->nodes[*at];
+		at = &n->link[tree][node_before(n, key->size, key->offset, tree)];
+	}
+
+	uint32_t root = *at;
+	uint32_t *left = &key->link[tree][0];
+	uint32_t *right = &key->link[tree][1];
+	while (root != INVALID_ID) {
+		freelist_node_t *n = &state->nodes[root];
+		if (node_before(n, key->size, key->offset, tree)) {
+			*left = root;
+			left = &n->link[tree][1];
+			root = *left;
+		} else {
+			*right = root;
+			right = &n->link[tree][0];
+			root = *right;
 		}
 	}
+	*left = *right = INVALID_ID;
+	*at = node;
+}
+
+/* Find the link holding the node, then merge its two subtrees into it. */
+void node_remove(internal_state_t *state, uint32_t node, uint32_t tree) {
+	freelist_node_t *key = &state->nodes[node];
+	uint32_t *at = &state->root[tree];
+	while (*at != node) {
+		freelist_node_t *n = &state->nodes[*at];
+		at = &n->link[tree][node_before(n, key->size, key->offset, tree)];
+	}
 
-	return 0;
+	uint32_t a = key->link[tree][0];
+	uint32_t b = key->link[tree][1];
+	while (a != INVALID_ID && b != INVALID_ID) {
+		if (node_priority(a) > node_priority(b)) {
+			*at = a;
+			at = &state->nodes[a].link[tree][1];
+			a = *at;
+		} else {
+			*at = b;
+			at = &state->nodes[b].link[tree][0];
+			b = *at;
+		}
+	}
+	*at = a != INVALID_ID ? a : b;
 }
 
-void return_node(freelist_t *freelist, freelist_node_t *node) {
-	(void)freelist;
-	node->offset = INVALID_ID;
-	node->size = INVALID_ID;
-	node->next = 0;
+/* Returned nodes first, then the next one never used. */
+uint32_t get_node(internal_state_t *state) {
+	uint32_t node = state->node_free;
+	if (node != INVALID_ID) {
+		state->node_free = state->nodes[node].link[TREE_OFFSET][0];
+	} else if (state->node_used < state->max_entry) {
+		node = state->node_used++;
+	} else {
+		return INVALID_ID;
+	}
+	state->range_count++;
+	return node;
+}
+
+void return_node(internal_state_t *state, uint32_t node) {
+	state->nodes[node].offset = INVALID_ID;
+	state->nodes[node].size = 0;
+	state->nodes[node].link[TREE_OFFSET][0] = state->node_free;
+	state->node_free = node;
+	state->range_count--;
+}
+
+/* Smallest range of at least 'size', the lowest one among equals. */
+uint32_t find_fit(internal_state_t *state, uint64_t size) {
+	uint32_t best = INVALID_ID;
+	uint32_t node = state->root[TREE_SIZE];
+	while (node != INVALID_ID) {
+		freelist_node_t *n = &state->nodes[node];
+		if (n->size >= size) {
+			best = node;
+			node = n->link[TREE_SIZE][0];
+		} else {
+			node = n->link[TREE_SIZE][1];
+		}
+	}
+	return best;
+}
+
+/* Next range in size order. */
+uint32_t find_fit_after(internal_state_t *state, uint32_t after) {
+	freelist_node_t *key = &state->nodes[after];
+	uint32_t best = INVALID_ID;
+	uint32_t node = state->root[TREE_SIZE];
+	while (node != INVALID_ID) {
+		freelist_node_t *n = &state->nodes[node];
+		if (node_before(n, key->size, key->offset + 1, TREE_SIZE)) {
+			node = n->link[TREE_SIZE][1];
+		} else {
+			best = node;
+			node = n->link[TREE_SIZE][0];
+		}
+	}
+	return best;
 }
 
+/* Last range starting below 'offset' and first one starting at or after. */
+void find_neighbours(internal_state_t *state, uint64_t offset, uint32_t *prev,
+					 uint32_t *next) {
+	*prev = *next = INVALID_ID;
+	uint32_t node = state->root[TREE_OFFSET];
+	while (node != INVALID_ID) {
+		freelist_node_t *n = &state->nodes[node];
+		if (n->offset < offset) {
+			*prev = node;
+			node = n->link[TREE_OFFSET][1];
+		} else {
+			*next = node;
+			node = n->link[TREE_OFFSET][0];
+		}
+	}
+}
+
+/* Takes 'size' off the front of a range. Moving its offset up keeps the
+ * offset order, only the size tree needs it again. */
+void range_take_front(internal_state_t *state, uint32_t node, uint64_t size) {
+	freelist_node_t *n = &state->nodes[node];
+	node_remove(state, node, TREE_SIZE);
+	if (n->size == size) {
+		node_remove(state, node, TREE_OFFSET);
+		return_node(state, node);
+	} else {
+		n->offset += size;
+		n->size -= size;
+		node_insert(state, node, TREE_SIZE);
+	}
+	state->free_space -= size;
+}
+
+void range_reset(internal_state_t *state) {
+	state->free_space = state->total_size;
+	state->lost_space = 0;
+	state->range_count = 0;
+	state->root[TREE_OFFSET] = INVALID_ID;
+	state->root[TREE_SIZE] = INVALID_ID;
+
+	state->node_free = INVALID_ID;
+	state->node_used = 0;
+
+	uint32_t node = get_node(state);
+	state->nodes[node].offset = 0;
+	state->nodes[node].size = state->total_size;
+	node_insert(state, node, TREE_OFFSET);
+	node_insert(state, node, TREE_SIZE);
+}
 /* ========================================================================== */
 /* ========================================================================== */
-void freelist_init(uint64_t total_size, uint64_t *mem_require,
-                          void *memory, freelist_t *freelist) {
-	uint64_t max_entry = (total_size / sizeof(freelist_node_t));
+void freelist_init(uint64_t total_size, uint64_t granule,
+                   uint64_t *mem_require, void *memory, freelist_t *freelist) {
+	/* Every free range but the last is followed by a live block, both at
+	 * least a granule long. */
+	if (!granule)
+		granule = 1;
+	uint64_t max_entry = total_size / (granule * 2) + 1;
+	if (max_entry >= INVALID_ID)
+		max_entry = INVALID_ID - 1;
+
 	*mem_require = sizeof(internal_state_t) + (sizeof(freelist_node_t) * max_entry);
-	if (!memory) 
+	if (!memory)
 		return;
 
-	uint64_t mem_min = (sizeof(internal_state_t) + sizeof(freelist_node_t)) * 8;
-    if (total_size < mem_min) {
-        ar_WARNING("freelist not efficient with amount of memory less than "
-                   "%iB. Not recommended to use this structure");
-    }
-
 	freelist->memory = memory;
 
-	memory_zero(freelist->memory, *mem_require);
+	memory_zero(freelist->memory, sizeof(internal_state_t));
 	internal_state_t *state = freelist->memory;
 	state->nodes = (void *)((char *)freelist->memory + sizeof(internal_state_t));
-	state->max_entry = max_entry;
+	state->max_entry = (uint32_t)max_entry;
 	state->total_size = total_size;
-	state->head = &state->nodes[0];
-	state->head->offset = 0;
-	state->head->size = total_size;
-	state->head->next = 0;
-
-	for (uint64_t i = 1; i < state->max_entry; ++i) {
-		state->nodes[i].offset = INVALID_ID;
-		state->nodes[i].size = INVALID_ID;
-	}
+	range_reset(state);
 }
 
 void freelist_shut(freelist_t *freelist) {
@@ -75,155 +241,232 @@ void freelist_shut(freelist_t *freelist) {
         internal_state_t *state = freelist->memory;
         memory_zero(freelist->memory,
                     sizeof(internal_state_t) +
-                        sizeof(freelist_node_t) * state->max_entry);
+                        sizeof(freelist_node_t) * state->node_used);
         freelist->memory = 0;
     }
 }
 
 b8 freelist_block_alloc(freelist_t *freelist, uint64_t size,
                                uint64_t *offset) {
-	if (!freelist || !offset || !freelist->memory) {
+	if (!freelist || !offset || !freelist->memory || !size) {
 		return false;
 	}
 
 	internal_state_t *state = freelist->memory;
-	freelist_node_t *node = state->head;
-	freelist_node_t *prev = 0;
-
-	while (node) {
-		if (node->size == size) {
-			*offset = node->offset;
-			freelist_node_t *node_ret = 0;
-			if (prev) {
-				prev->next = node->next;
-				node_ret = node;
-			} else {
-				node_ret = state->head;
-				state->head = node->next;
-			}
-
-			return_node(freelist, node_ret);
-			return true;
-		} else if (node->size > size) {
-			*offset = node->offset;
-			node->size -= size;
-			node->offset += size;
-			return true;
-		}
-
-		prev = node;
-		node = node->next;
+	uint32_t node = find_fit(state, size);
+	if (node != INVALID_ID) {
+		*offset = state->nodes[node].offset;
+		range_take_front(state, node, size);
+		return true;
 	}
 
-	uint64_t free_space = freelist_space_free(freelist);
     ar_WARNING("freelist_block - no block with enough free space found. "
                "Requested: %lluB, available: %lluB",
-               size, free_space);
+               size, state->free_space);
 
     return false;
 }
 
+b8 freelist_block_alloc_aligned(freelist_t *freelist, uint64_t size,
+                                uint64_t alignment, uint64_t *offset) {
+	if (!freelist || !offset || !freelist->memory || !size || !alignment ||
+		(alignment & (alignment - 1)))
+		return false;
+
+	internal_state_t *state = freelist->memory;
+	uint32_t node = find_fit(state, size);
+	for (uint32_t probe = 0; node != INVALID_ID; ++probe) {
+		freelist_node_t *n = &state->nodes[node];
+		uint64_t aligned = (n->offset + alignment - 1) & ~(alignment - 1);
+		if (n->size >= aligned - n->offset + size)
+			break;
+
+		/* Past a handful, take one big enough for any pad. */
+		if (probe + 1 == ALIGNED_PROBES) {
+			node = find_fit(state, size + alignment - 1);
+			break;
+		}
+		node = find_fit_after(state, node);
+	}
+
+	if (node == INVALID_ID)
+		return false;
+
+	freelist_node_t *n = &state->nodes[node];
+	uint64_t aligned = (n->offset + alignment - 1) & ~(alignment - 1);
+	uint64_t pad = aligned - n->offset;
+	if (!pad) {
+		*offset = n->offset;
+		range_take_front(state, node, size);
+		return true;
+	}
+
+	/* Front stays free in this range, the rest after the block needs a
+	 * range of its own. */
+	uint64_t tail = n->size - pad - size;
+	uint32_t tail_node = INVALID_ID;
+	if (tail) {
+		tail_node = get_node(state);
+		if (tail_node == INVALID_ID)
+			return false;
+	}
+
+	node_remove(state, node, TREE_SIZE);
+	n->size = pad;
+	node_insert(state, node, TREE_SIZE);
+
+	if (tail_node != INVALID_ID) {
+		state->nodes[tail_node].offset = aligned + size;
+		state->nodes[tail_node].size = tail;
+		node_insert(state, tail_node, TREE_OFFSET);
+		node_insert(state, tail_node, TREE_SIZE);
+	}
+
+	state->free_space -= size;
+	*offset = aligned;
+	return true;
+}
+
 b8 freelist_block_free(freelist_t *freelist, uint64_t size, uint64_t offset) {
     if (!freelist || !freelist->memory || !size)
         return false;
 
     internal_state_t *state = freelist->memory;
-    freelist_node_t  *node  = state->head;
-    freelist_node_t  *prev  = 0;
-
-    if (!node) {
-        freelist_node_t *new_node = get_node(freelist);
-        new_node->offset          = offset;
-        new_node->size            = size;
-        new_node->next            = 0;
-        state->head               = new_node;
+    uint32_t prev = INVALID_ID, next = INVALID_ID;
+    find_neighbours(state, offset, &prev, &next);
+
+    freelist_node_t *p = prev != INVALID_ID ? &state->nodes[prev] : 0;
+    freelist_node_t *n = next != INVALID_ID ? &state->nodes[next] : 0;
+    if ((p && p->offset + p->size > offset) ||
+        (n && n->offset < offset + size) || offset + size > state->total_size) {
+        ar_WARNING("Unable to find block to be freed.");
+        return false;
+    }
+
+    b8 join_prev = p && p->offset + p->size == offset;
+    b8 join_next = n && offset + size == n->offset;
+    state->free_space += size;
+
+    if (join_prev) {
+        node_remove(state, prev, TREE_SIZE);
+        p->size += size;
+        if (join_next) {
+            p->size += n->size;
+            node_remove(state, next, TREE_SIZE);
+            node_remove(state, next, TREE_OFFSET);
+            return_node(state, next);
+        }
+        node_insert(state, prev, TREE_SIZE);
+        return true;
+    }
+
+    if (join_next) {
+        /* Still the first range after prev, the offset order holds. */
+        node_remove(state, next, TREE_SIZE);
+        n->offset = offset;
+        n->size += size;
+        node_insert(state, next, TREE_SIZE);
         return true;
-    } else {
-        while (node) {
-            if (node->offset == offset) {
-                node->size += size;
-
-                if (node->next &&
-                    node->next->offset == node->offset + node->size) {
-                    node->size += node->next->size;
-                    freelist_node_t *next = node->next;
-                    node->next            = node->next->next;
-                    return_node(freelist, next);
-                }
-                return true;
-            } else if (node->offset > offset) {
-                freelist_node_t *new_node = get_node(freelist);
-                new_node->offset          = offset;
-                new_node->size            = size;
-
-                /* If there is previous node, new node should be inserted
-                 * between this and it */
-                if (prev) {
-                    prev->next     = new_node;
-                    new_node->next = node;
-                } else {
-                    new_node->next = node;
-                    state->head    = new_node;
-                }
-
-                /* Double check next node to see if can be joined */
-                if (new_node->next && new_node->offset + new_node->size ==
-                                          new_node->next->offset) {
-                    new_node->size += new_node->next->size;
-                    freelist_node_t *garbage = new_node->next;
-                    new_node->next           = garbage->next;
-                    return_node(freelist, garbage);
-                }
-
-                /* Double check previous node to see if new node can be joined
-                 */
-                if (prev && prev->offset + prev->size == new_node->offset) {
-                    prev->size += new_node->size;
-                    freelist_node_t *garbage = new_node;
-                    prev->next               = garbage->next;
-                    return_node(freelist, garbage);
-                }
-
-                return true;
-            }
-
-            prev = node;
-            node = node->next;
+    }
+
+    uint32_t node = get_node(state);
+    if (node == INVALID_ID) {
+        /* The pool holds every range the granule allows, so this is a
+         * caller freeing off the granule. Give up the smallest range, or
+         * this block if it is smaller still, and say so. */
+        uint32_t smallest = find_fit(state, 0);
+        if (!state->lost_space)
+            ar_ERROR("freelist - out of range nodes, a block off the "
+                     "granule was freed, small free ranges are lost");
+
+        if (smallest == INVALID_ID || state->nodes[smallest].size >= size) {
+            state->free_space -= size;
+            state->lost_space += size;
+            return true;
         }
+
+        uint64_t lost = state->nodes[smallest].size;
+        node_remove(state, smallest, TREE_SIZE);
+        node_remove(state, smallest, TREE_OFFSET);
+        return_node(state, smallest);
+        state->free_space -= lost;
+        state->lost_space += lost;
+        node = get_node(state);
     }
 
-    ar_WARNING("Unable to find block to be freed.");
-    return false;
+    state->nodes[node].offset = offset;
+    state->nodes[node].size = size;
+    node_insert(state, node, TREE_OFFSET);
+    node_insert(state, node, TREE_SIZE);
+    return true;
+}
+
+b8 freelist_block_resize(freelist_t *freelist, uint64_t offset, uint64_t size,
+                         uint64_t new_size) {
+	if (!freelist || !freelist->memory || !size || !new_size)
+		return false;
+
+	if (new_size == size)
+		return true;
+
+	if (new_size < size)
+		return freelist_block_free(freelist, size - new_size, offset + new_size);
+
+	/* Growing needs a free range starting right at the block's end. */
+	internal_state_t *state = freelist->memory;
+	uint64_t extra = new_size - size;
+	uint32_t prev = INVALID_ID, next = INVALID_ID;
+	find_neighbours(state, offset + size, &prev, &next);
+
+	if (next == INVALID_ID || state->nodes[next].offset != offset + size ||
+		state->nodes[next].size < extra)
+		return false;
+
+	range_take_front(state, next, extra);
+	return true;
 }
 
 void freelist_clear(freelist_t *freelist) {
 	if (!freelist || !freelist->memory)
 		return;
 
-	internal_state_t *state = freelist->memory;
-	for (uint64_t i = 0; i < state->max_entry; ++i) {
-		state->nodes[i].offset = INVALID_ID;
-		state->nodes[i].size = INVALID_ID;
-	}
-
-	state->head->offset = 0;
-	state->head->size = state->total_size;
-	state->head->next = 0;
+	range_reset(freelist->memory);
 }
 
 uint64_t freelist_space_free(freelist_t *freelist) {
 	if (!freelist || !freelist->memory)
 		return 0;
 
-	uint64_t run_total = 0;
 	internal_state_t *state = freelist->memory;
-	freelist_node_t *node = state->head;
+	return state->free_space;
+}
 
-	while (node) {
-		run_total += node->size;
-		node = node->next;
-	}
+uint64_t freelist_largest_free(freelist_t *freelist) {
+	if (!freelist || !freelist->memory)
+		return 0;
+
+	internal_state_t *state = freelist->memory;
+	uint32_t node = state->root[TREE_SIZE];
+	if (node == INVALID_ID)
+		return 0;
+
+	while (state->nodes[node].link[TREE_SIZE][1] != INVALID_ID)
+		node = state->nodes[node].link[TREE_SIZE][1];
+	return state->nodes[node].size;
+}
+
+uint64_t freelist_block_count(freelist_t *freelist) {
+	if (!freelist || !freelist->memory)
+		return 0;
 
-	return run_total;
+	internal_state_t *state = freelist->memory;
+	return state->range_count;
 }
 
+uint64_t freelist_space_lost(freelist_t *freelist) {
+	if (!freelist || !freelist->memory)
+		return 0;
+
+	internal_state_t *state = freelist->memory;
+	return state->lost_space;
+}
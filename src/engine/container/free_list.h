@@ -3,21 +3,48 @@
 
 #include "engine/define.h"
 
+/* Offset range allocator over memory it never touches, the heap behind
+ * dyn_alloc and just as well a GPU buffer. Free ranges are kept ordered by
+ * offset and by size, allocs take the best fit and frees join neighbours,
+ * both O(log n). Callers keep every offset and size a multiple of the
+ * 'granule' given at init. Free ranges never outnumber live blocks by more
+ * than one, so a pool of total / (2 * granule) + 1 nodes always holds them.
+ * Nodes are handed out low first, pages past the busiest point so far are
+ * never touched. */
+
 typedef struct freelist_t {
 	void *memory;
 } freelist_t;
 
-_arapi void freelist_init(uint64_t total_size, uint64_t *mem_require,
-                          void *memory, freelist_t *freelist);
+_arapi void freelist_init(uint64_t total_size, uint64_t granule,
+                          uint64_t *mem_require, void *memory,
+                          freelist_t *freelist);
 
 _arapi void freelist_shut(freelist_t *freelist);
+
+/* Smallest free range that fits, the lowest one among equal sizes. */
 _arapi b8 freelist_block_alloc(freelist_t *freelist, uint64_t size,
                                uint64_t *offset);
 
+/* Best fitting range where an offset on 'alignment' (a power of two) fits
+ * 'size'. Quiet on failure, freed like any other block. */
+_arapi b8 freelist_block_alloc_aligned(freelist_t *freelist, uint64_t size,
+                                       uint64_t alignment, uint64_t *offset);
+
 _arapi b8 freelist_block_free(freelist_t *freelist, uint64_t size,
                               uint64_t offset);
 
+/* Grow or shrink the block at 'offset' without moving it. Growing takes
+ * from the free range right after it, false if that is not enough. */
+_arapi b8 freelist_block_resize(freelist_t *freelist, uint64_t offset,
+                                uint64_t size, uint64_t new_size);
+
 _arapi void     freelist_clear(freelist_t *freelist);
 _arapi uint64_t freelist_space_free(freelist_t *freelist);
+_arapi uint64_t freelist_largest_free(freelist_t *freelist);
+_arapi uint64_t freelist_block_count(freelist_t *freelist);
+/* Space dropped because the node pool ran dry, only ever non zero when a
+ * caller broke the granule. */
+_arapi uint64_t freelist_space_lost(freelist_t *freelist);
 
 #endif //__FREE_LIST_H__
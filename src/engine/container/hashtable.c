@@ -1,25 +1,302 @@
 #include "engine/container/hashtable.h"
 
+#include "engine/core/ar_strings.h"
 #include "engine/core/logger.h"
 #include "engine/memory/memory.h"
 
-uint64_t hash_name(const char *name, uint32_t element_count) {
-	// use prime number to avoiding collisions.
-	static const uint64_t multi = 97;
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HASHTABLE_SSE2 1
+#else
+#define HASHTABLE_SSE2 0
+#endif
 
-	unsigned const char *us;
-	uint64_t hash = 0;
+/* Control bytes. Full slots hold the low 7 bits of their hash, so the top
+ * bit alone tells a free slot from a taken one. */
+#define CTRL_EMPTY ((uint8_t)0x80)
+#define CTRL_DELETED ((uint8_t)0xFE)
 
-	for (us = (unsigned const char *)name; *us; us++) {
-		hash = hash * multi + *us;
-	}
+/* Names up to this long are kept inside the slot, with the value right
+ * behind them a hit reads one slot and nothing else. */
+#define HASHTABLE_KEY_INLINE 32
+
+/* Every slot starts with this, the value follows. */
+typedef struct hashtable_slot_t {
+	uint64_t hash;
+	uint32_t length; // name length, without the terminator
+	union {
+		char text[HASHTABLE_KEY_INLINE]; // short names, not terminated
+		char *copy;                      // longer ones, string_duplicate
+	} key;
+} hashtable_slot_t;
 
-	// modulate against the size of table
-	hash %= element_count;
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+/* FNV-1a with a murmur finaliser, the low bits go into the control bytes
+ * and the rest picks the first group. The length falls out of the walk. */
+uint64_t hash_name(const char *name, uint32_t *length) {
+	uint64_t hash = 0xCBF29CE484222325ull;
+	const unsigned char *us = (const unsigned char *)name;
+	for (; *us; us++) {
+		hash ^= *us;
+		hash *= 0x100000001B3ull;
+	}
+	*length = (uint32_t)(us - (const unsigned char *)name);
 
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
 	return hash;
 }
 
+uint32_t table_capacity(uint32_t element_count) {
+	uint64_t wanted = (uint64_t)element_count * 8 / 7 + 1;
+	uint64_t capacity = HASHTABLE_GROUP;
+	while (capacity < wanted)
+		capacity <<= 1;
+	return (uint32_t)capacity;
+}
+
+uint64_t table_value_size(uint64_t element_size) {
+	return (element_size + 7) & ~(uint64_t)7;
+}
+
+uint64_t table_ctrl_size(uint32_t capacity) {
+	return ((uint64_t)capacity + HASHTABLE_GROUP + 15) & ~(uint64_t)15;
+}
+
+/* Rounded to 16, a 48 byte slot header and up to 16 bytes of value make a
+ * 64 byte slot that never straddles two lines of a line aligned table. */
+uint64_t table_slot_size(uint64_t element_size) {
+	return (sizeof(hashtable_slot_t) + table_value_size(element_size) + 15) &
+		   ~(uint64_t)15;
+}
+
+uint64_t table_require(uint64_t element_size, uint32_t capacity) {
+	return table_slot_size(element_size) * capacity +
+		   table_ctrl_size(capacity) + table_value_size(element_size);
+}
+
+/* Layout: the slots first, so they start where the block does, then the
+ * control bytes (the first group mirrored past the end so a probe can read
+ * 16 from any slot) and the fill value. */
+hashtable_slot_t *table_slot(hashtable_t *table, uint32_t index) {
+	return (hashtable_slot_t *)((char *)table->memory +
+								table_slot_size(table->element_size) * index);
+}
+
+uint8_t *table_ctrl(hashtable_t *table) {
+	return (uint8_t *)table_slot(table, table->element_count);
+}
+
+void *table_fill_value(hashtable_t *table) {
+	return table_ctrl(table) + table_ctrl_size(table->element_count);
+}
+
+void *slot_value(hashtable_slot_t *slot) {
+	return (char *)slot + sizeof(hashtable_slot_t);
+}
+
+const char *slot_key(hashtable_slot_t *slot) {
+	return slot->length <= HASHTABLE_KEY_INLINE ? slot->key.text
+												: slot->key.copy;
+}
+
+b8 slot_key_set(hashtable_slot_t *slot, const char *name, uint32_t length) {
+	slot->length = length;
+	if (length <= HASHTABLE_KEY_INLINE) {
+		memory_copy(slot->key.text, name, length);
+		return true;
+	}
+
+	slot->key.copy = string_duplicate(name);
+	return slot->key.copy != 0;
+}
+
+void slot_key_free(hashtable_slot_t *slot) {
+	if (slot->length > HASHTABLE_KEY_INLINE)
+		memory_free(slot->key.copy, (uint64_t)slot->length + 1, MEMTAG_STRING);
+}
+
+void set_ctrl(hashtable_t *table, uint32_t index, uint8_t value) {
+	uint8_t *ctrl = table_ctrl(table);
+	ctrl[index] = value;
+	if (index < HASHTABLE_GROUP)
+		ctrl[table->element_count + index] = value;
+}
+
+/* Bit i set when control byte i of the group equals 'value'. */
+uint32_t group_match(const uint8_t *group, uint8_t value) {
+#if HASHTABLE_SSE2
+	__m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+	return (uint32_t)_mm_movemask_epi8(
+		_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)value)));
+#else
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < HASHTABLE_GROUP; ++i)
+		mask |= (uint32_t)(group[i] == value) << i;
+	return mask;
+#endif
+}
+
+/* Bit i set when slot i of the group is empty or erased. */
+uint32_t group_free(const uint8_t *group) {
+#if HASHTABLE_SSE2
+	return (uint32_t)_mm_movemask_epi8(
+		_mm_loadu_si128((const __m128i *)group));
+#else
+	uint32_t mask = 0;
+	for (uint32_t i = 0; i < HASHTABLE_GROUP; ++i)
+		mask |= (uint32_t)(group[i] >> 7) << i;
+	return mask;
+#endif
+}
+
+/* Slot holding 'name', INVALID_ID when it is not in the table. Groups are
+ * visited in triangular steps, which covers every group of a power of two
+ * table. An empty slot in a group ends the search. */
+uint32_t table_find(hashtable_t *table, const char *name, uint64_t hash,
+				   uint32_t length) {
+	uint8_t *ctrl = table_ctrl(table);
+	uint32_t mask = table->element_count - 1;
+	uint32_t pos = (uint32_t)(hash >> 7) & mask;
+	uint8_t h2 = (uint8_t)(hash & 0x7F);
+
+	/* The name usually sits in its home slot, start that line coming in
+	 * while the control group is read. */
+	__builtin_prefetch(table_slot(table, pos));
+
+	for (uint32_t stride = 0; stride <= mask; stride += HASHTABLE_GROUP) {
+		const uint8_t *group = ctrl + pos;
+		for (uint32_t match = group_match(group, h2); match;
+			 match &= match - 1) {
+			uint32_t index = (pos + (uint32_t)__builtin_ctz(match)) & mask;
+			hashtable_slot_t *slot = table_slot(table, index);
+			if (slot->hash == hash && slot->length == length &&
+				memcmp(slot_key(slot), name, length) == 0)
+				return index;
+		}
+
+		if (group_match(group, CTRL_EMPTY))
+			return INVALID_ID;
+		pos = (pos + stride + HASHTABLE_GROUP) & mask;
+	}
+
+	return INVALID_ID;
+}
+
+/* First empty or erased slot along the probe sequence of 'hash'. */
+uint32_t table_find_free(hashtable_t *table, uint64_t hash) {
+	uint8_t *ctrl = table_ctrl(table);
+	uint32_t mask = table->element_count - 1;
+	uint32_t pos = (uint32_t)(hash >> 7) & mask;
+
+	for (uint32_t stride = 0;; stride += HASHTABLE_GROUP) {
+		uint32_t free_mask = group_free(ctrl + pos);
+		if (free_mask)
+			return (pos + (uint32_t)__builtin_ctz(free_mask)) & mask;
+		pos = (pos + stride + HASHTABLE_GROUP) & mask;
+	}
+}
+
+void table_clear_ctrl(hashtable_t *table) {
+	memory_set(table_ctrl(table), CTRL_EMPTY,
+			   (uint64_t)table->element_count + HASHTABLE_GROUP);
+}
+
+/* Moves every entry into storage for 'capacity' slots. Same capacity only
+ * drops the erased slots. Hashes are stored, nothing gets hashed again. */
+b8 table_rehash(hashtable_t *table, uint32_t capacity) {
+	uint64_t require = table_require(table->element_size, capacity);
+	void *memory =
+		memory_alloc_aligned_uninit(require, AR_CACHE_LINE, MEMTAG_HASHTABLE);
+	if (!memory) {
+		ar_ERROR("hashtable - unable to grow to %u slots", capacity);
+		return false;
+	}
+
+	hashtable_t old = *table;
+	table->memory = memory;
+	table->element_count = capacity;
+	table->deleted = 0;
+	table->owns_memory = true;
+	table_clear_ctrl(table);
+	memory_copy(table_fill_value(table), table_fill_value(&old),
+				table->element_size);
+
+	uint8_t *old_ctrl = table_ctrl(&old);
+	uint64_t slot_size = table_slot_size(table->element_size);
+	for (uint32_t i = 0; i < old.element_count; ++i) {
+		if (old_ctrl[i] & CTRL_EMPTY)
+			continue;
+
+		hashtable_slot_t *slot = table_slot(&old, i);
+		uint32_t index = table_find_free(table, slot->hash);
+		set_ctrl(table, index, (uint8_t)(slot->hash & 0x7F));
+		memory_copy(table_slot(table, index), slot, slot_size);
+	}
+
+	if (old.owns_memory)
+		memory_free_aligned(old.memory,
+							table_require(old.element_size, old.element_count),
+							AR_CACHE_LINE, MEMTAG_HASHTABLE);
+	return true;
+}
+
+/* Value storage for 'name', added when missing. */
+void *table_upsert(hashtable_t *table, const char *name) {
+	uint32_t length;
+	uint64_t hash = hash_name(name, &length);
+	uint32_t index = table_find(table, name, hash, length);
+	if (index != INVALID_ID)
+		return slot_value(table_slot(table, index));
+
+	/* 7/8 is the most a probe sequence stays short at. Mostly erased slots
+	 * clean up in place, otherwise double. */
+	uint64_t limit = (uint64_t)table->element_count * 7 / 8;
+	if (table->count + table->deleted + 1 > limit) {
+		uint32_t capacity = table->deleted > table->count / 2
+								? table->element_count
+								: table->element_count * 2;
+		if (!table_rehash(table, capacity))
+			return 0;
+	}
+
+	index = table_find_free(table, hash);
+	hashtable_slot_t *slot = table_slot(table, index);
+	if (!slot_key_set(slot, name, length))
+		return 0;
+
+	if (table_ctrl(table)[index] == CTRL_DELETED)
+		table->deleted--;
+	slot->hash = hash;
+	set_ctrl(table, index, (uint8_t)(hash & 0x7F));
+	table->count++;
+	return slot_value(slot);
+}
+
+/* Reads a name's value, the fill value or zeroes when it is missing. */
+void table_read(hashtable_t *table, const char *name, void *value) {
+	uint32_t length;
+	uint64_t hash = hash_name(name, &length);
+	uint32_t index = table_find(table, name, hash, length);
+	if (index != INVALID_ID) {
+		memory_copy(value, slot_value(table_slot(table, index)),
+					table->element_size);
+	} else if (table->has_fill) {
+		memory_copy(value, table_fill_value(table), table->element_size);
+	} else {
+		memory_zero(value, table->element_size);
+	}
+}
+/* ========================================================================== */
+/* ========================================================================== */
+
+uint64_t hashtable_memory_require(uint64_t element_size,
+                                  uint32_t element_count) {
+	return table_require(element_size, table_capacity(element_count));
+}
+
 void hashtable_init(uint64_t element_size, uint32_t element_count, void *memory,
                     b8 is_pointer_type, hashtable_t *table) {
     if (!memory || !table) {
@@ -32,18 +309,38 @@ void hashtable_init(uint64_t element_size, uint32_t element_count, void *memory,
         return;
     }
 
-    // TODO: might be require an allocator & allocate this memory instead.
+    /* 'memory' holds hashtable_memory_require(element_size, element_count)
+     * bytes, growing past that moves to memory_alloc. */
     table->memory          = memory;
-    table->element_count   = element_count;
+    table->element_count   = table_capacity(element_count);
     table->element_size    = element_size;
+    table->count           = 0;
+    table->deleted         = 0;
     table->is_pointer_type = is_pointer_type;
-    memory_zero(table->memory, element_count * element_size);
+    table->has_fill        = false;
+    table->owns_memory     = false;
+    table_clear_ctrl(table);
+    memory_zero(table_fill_value(table), element_size);
 }
 
 void hashtable_shut(hashtable_t *table) {
-	if (table) {
-		memory_zero(table, sizeof(hashtable_t));
+	if (!table)
+		return;
+
+	if (table->memory) {
+		uint8_t *ctrl = table_ctrl(table);
+		for (uint32_t i = 0; i < table->element_count; ++i)
+			if (!(ctrl[i] & CTRL_EMPTY))
+				slot_key_free(table_slot(table, i));
+
+		if (table->owns_memory)
+			memory_free_aligned(table->memory,
+								table_require(table->element_size,
+											  table->element_count),
+								AR_CACHE_LINE, MEMTAG_HASHTABLE);
 	}
+
+	memory_zero(table, sizeof(hashtable_t));
 }
 
 b8 hashtable_set(hashtable_t *table, const char *name, void *value) {
@@ -58,9 +355,11 @@ b8 hashtable_set(hashtable_t *table, const char *name, void *value) {
         return false;
     }
 
-    uint64_t hash = hash_name(name, table->element_count);
-    memory_copy((char *)table->memory + (table->element_size * hash), value,
-                table->element_size);
+    void *entry = table_upsert(table, name);
+    if (!entry)
+        return false;
+
+    memory_copy(entry, value, table->element_size);
     return true;
 }
 
@@ -77,8 +376,11 @@ b8 hashtable_set_ptr(hashtable_t *table, const char *name, void **value) {
         return false;
     }
 
-    uint64_t hash                  = hash_name(name, table->element_count);
-    ((void **)table->memory)[hash] = value ? *value : 0;
+    void **entry = table_upsert(table, name);
+    if (!entry)
+        return false;
+
+    *entry = value ? *value : 0;
     return true;
 }
 
@@ -94,9 +396,7 @@ b8 hashtable_get(hashtable_t *table, const char *name, void *value) {
         return false;
     }
 
-    uint64_t hash = hash_name(name, table->element_count);
-    memory_copy(value, (char *)table->memory + (table->element_size * hash),
-                table->element_size);
+    table_read(table, name, value);
     return true;
 }
 
@@ -112,8 +412,11 @@ b8 hashtable_get_ptr(hashtable_t *table, const char *name, void **value) {
         return false;
     }
 
-    uint64_t hash = hash_name(name, table->element_count);
-    *value        = ((void **)table->memory)[hash];
+    uint32_t length;
+    uint64_t hash = hash_name(name, &length);
+    uint32_t index = table_find(table, name, hash, length);
+    *value = index != INVALID_ID ? *(void **)slot_value(table_slot(table, index))
+                                 : 0;
     return true;
 }
 
@@ -129,10 +432,59 @@ b8 hashtable_fill(hashtable_t *table, void *value) {
         return false;
     }
 
+    memory_copy(table_fill_value(table), value, table->element_size);
+    table->has_fill = true;
+
+    uint8_t *ctrl = table_ctrl(table);
     for (uint32_t i = 0; i < table->element_count; ++i) {
-        memory_copy((char *)table->memory + (table->element_size * i), value,
-                    table->element_size);
+        if (!(ctrl[i] & CTRL_EMPTY))
+            memory_copy(slot_value(table_slot(table, i)), value,
+                        table->element_size);
     }
 
     return true;
 }
+
+b8 hashtable_contains(hashtable_t *table, const char *name) {
+	if (!table || !name || !table->memory)
+		return false;
+
+	uint32_t length;
+	uint64_t hash = hash_name(name, &length);
+	return table_find(table, name, hash, length) != INVALID_ID;
+}
+
+b8 hashtable_erase(hashtable_t *table, const char *name) {
+	if (!table || !name || !table->memory)
+		return false;
+
+	uint32_t length;
+	uint64_t hash = hash_name(name, &length);
+	uint32_t index = table_find(table, name, hash, length);
+	if (index == INVALID_ID)
+		return false;
+
+	slot_key_free(table_slot(table, index));
+
+	/* When the taken run around the slot is shorter than a group, every
+	 * window a probe read over it held an empty slot and stopped there, so
+	 * the slot can go straight back to empty. */
+	uint32_t mask = table->element_count - 1;
+	uint8_t *ctrl = table_ctrl(table);
+	uint32_t before = (index - HASHTABLE_GROUP) & mask;
+	uint32_t empty_after = group_match(ctrl + index, CTRL_EMPTY);
+	uint32_t empty_before = group_match(ctrl + before, CTRL_EMPTY);
+	b8 short_run = empty_after && empty_before &&
+				   (uint32_t)__builtin_ctz(empty_after) +
+						   (uint32_t)__builtin_clz(empty_before << 16) <
+					   HASHTABLE_GROUP;
+	if (short_run) {
+		set_ctrl(table, index, CTRL_EMPTY);
+	} else {
+		set_ctrl(table, index, CTRL_DELETED);
+		table->deleted++;
+	}
+
+	table->count--;
+	return true;
+}
@@ -3,13 +3,40 @@
 
 #include "engine/define.h"
 
+/* Open addressing table keyed by name, laid out as a Swiss table. Each slot
+ * keeps the full 64 bit hash and its own copy of the name, so two names
+ * never share an entry. One control byte per slot holds 7 bits of the hash
+ * (or empty / erased), lookups test 16 of them at once with SSE2 and only
+ * compare names on a control byte match.
+ *
+ * Names up to 32 characters sit in the slot next to the value, so a hit
+ * touches the control group and one slot; with values up to 16 bytes a
+ * slot is 64 bytes. Longer names get a copy of their own.
+ *
+ * The first storage is the caller's, sized with hashtable_memory_require;
+ * slots start at its first byte, give it a 64 byte boundary for one line
+ * per slot. Once 7/8 of the slots are taken the table rehashes into line
+ * aligned memory_alloc storage twice the size, hashtable_shut gives that
+ * and the long name copies back. A name never set reads as the
+ * hashtable_fill value, or zeroes. */
+
+#define HASHTABLE_GROUP 16
+
 typedef struct hashtable_t {
 	uint64_t element_size;
-	uint32_t element_count;
+	uint32_t element_count; // slots, a power of two of at least a group
+	uint32_t count;         // names in the table
+	uint32_t deleted;       // erased slots not taken again yet
 	b8 is_pointer_type;
+	b8 has_fill;
+	b8 owns_memory;
 	void *memory;
 } hashtable_t;
 
+/* Bytes for a table holding 'element_count' names without growing. */
+_arapi uint64_t hashtable_memory_require(uint64_t element_size,
+                                         uint32_t element_count);
+
 _arapi void hashtable_init(uint64_t element_size, uint32_t element_count,
                            void *memory, b8 is_pointer_type,
                            hashtable_t *table);
@@ -19,6 +46,14 @@ _arapi b8 hashtable_set(hashtable_t *table, const char *name, void *value);
 _arapi b8 hashtable_set_ptr(hashtable_t *table, const char *name, void **value);
 _arapi b8 hashtable_get(hashtable_t *table, const char *name, void *value);
 _arapi b8 hashtable_get_ptr(hashtable_t *table, const char *name, void **value);
+
+/* Sets the value names not in the table read as, and overwrites every entry
+ * already in it. */
 _arapi b8 hashtable_fill(hashtable_t *table, void *value);
 
+_arapi b8 hashtable_contains(hashtable_t *table, const char *name);
+
+/* False if the name was not in the table. */
+_arapi b8 hashtable_erase(hashtable_t *table, const char *name);
+
 #endif //__HASHTABLE_H__
@@ -0,0 +1,346 @@
+#include "engine/container/ring.h"
+
+#include "engine/core/logger.h"
+#include "engine/platform/platform_thread.h"
+
+#include <string.h>
+
+/* Tries before a _wait call goes to sleep, a handoff is usually a few
+ * hundred cycles away. */
+#define RING_SPIN_COUNT 256
+#define RING_MAX_CAPACITY 0x80000000u
+
+typedef b8 (*ring_try_fn)(void *ring, void *value);
+
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+uint64_t ring_capacity(uint32_t capacity) {
+	if (capacity > RING_MAX_CAPACITY) {
+		ar_ERROR("ring - capacity %u over the %u limit, clamped", capacity,
+				 RING_MAX_CAPACITY);
+		capacity = RING_MAX_CAPACITY;
+	}
+
+	uint64_t rounded = 2;
+	while (rounded < capacity)
+		rounded <<= 1;
+	return rounded;
+}
+
+uint64_t ring_cell_size(uint64_t element_size) {
+	return (sizeof(uint64_t) + element_size + 7) & ~(uint64_t)7;
+}
+
+void ring_signal_init(ring_signal_t *signal) {
+	atomic_init(&signal->seq, 0);
+	atomic_init(&signal->waiting, 0);
+}
+
+/* Called after publishing. The fence pairs with the one in ring_block: a
+ * sleeper either sees what was published before it sleeps or has its flag
+ * seen here. Clearing the flag keeps a burst of pushes to one wake call. */
+void ring_notify(ring_signal_t *signal) {
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&signal->waiting, memory_order_relaxed) &&
+		atomic_exchange_explicit(&signal->waiting, 0, memory_order_relaxed)) {
+		atomic_fetch_add_explicit(&signal->seq, 1, memory_order_release);
+		platform_futex_wake(&signal->seq, INVALID_ID);
+	}
+}
+
+/* Retry 'try_op' until it goes through, sleeping on 'signal' once spinning
+ * did not help. Every sleep raises the flag again, a wake clears it and
+ * gets all sleepers going. */
+void ring_block(ring_signal_t *signal, ring_try_fn try_op, void *ring,
+				void *value) {
+	for (uint32_t i = 0; i < RING_SPIN_COUNT; ++i) {
+		if (try_op(ring, value))
+			return;
+	}
+
+	for (;;) {
+		atomic_store_explicit(&signal->waiting, 1, memory_order_relaxed);
+		uint32_t key = atomic_load_explicit(&signal->seq, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+
+		if (try_op(ring, value))
+			return;
+		platform_futex_wait(&signal->seq, key);
+		if (try_op(ring, value))
+			return;
+	}
+}
+
+/* Copy 'count' elements in/out starting at ring position 'pos', in two
+ * pieces when the range wraps. */
+void ring_copy_in(uint8_t *slots, uint64_t mask, uint64_t size, uint64_t pos,
+				  const uint8_t *values, uint64_t count) {
+	uint64_t index = pos & mask;
+	uint64_t first = mask + 1 - index;
+	if (first > count)
+		first = count;
+	memcpy(slots + index * size, values, first * size);
+	memcpy(slots, values + first * size, (count - first) * size);
+}
+
+void ring_copy_out(uint8_t *slots, uint64_t mask, uint64_t size, uint64_t pos,
+				   uint8_t *out, uint64_t count) {
+	uint64_t index = pos & mask;
+	uint64_t first = mask + 1 - index;
+	if (first > count)
+		first = count;
+	memcpy(out, slots + index * size, first * size);
+	memcpy(out + first * size, slots, (count - first) * size);
+}
+
+_Atomic uint64_t *ring_mpmc_seq(ring_mpmc_t *ring, uint64_t pos) {
+	return (void *)(ring->cells + (pos & ring->mask) * ring->cell_size);
+}
+
+void *ring_mpmc_value(ring_mpmc_t *ring, uint64_t pos) {
+	return ring->cells + (pos & ring->mask) * ring->cell_size +
+		   sizeof(uint64_t);
+}
+
+b8 ring_spsc_try_push(void *ring, void *value) {
+	return ring_spsc_push(ring, value);
+}
+
+b8 ring_spsc_try_pop(void *ring, void *out) {
+	return ring_spsc_pop(ring, out);
+}
+
+b8 ring_mpmc_try_push(void *ring, void *value) {
+	return ring_mpmc_push(ring, value);
+}
+
+b8 ring_mpmc_try_pop(void *ring, void *out) {
+	return ring_mpmc_pop(ring, out);
+}
+/* ========================================================================== */
+/* ========================================================================== */
+
+/* ================================== SPSC ================================== */
+uint64_t ring_spsc_memory_require(uint64_t element_size, uint32_t capacity) {
+	return element_size * ring_capacity(capacity);
+}
+
+void ring_spsc_init(uint64_t element_size, uint32_t capacity, void *memory,
+					ring_spsc_t *ring) {
+	if (!memory || !ring || !capacity || !element_size) {
+		ar_ERROR("ring_spsc_init require memory, ring and non zero size & "
+				 "capacity");
+		return;
+	}
+
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	ring->tail_cache = 0;
+	ring->head_cache = 0;
+	ring->mask = ring_capacity(capacity) - 1;
+	ring->element_size = element_size;
+	ring->slots = memory;
+	ring_signal_init(&ring->not_empty);
+	ring_signal_init(&ring->not_full);
+}
+
+b8 ring_spsc_push(ring_spsc_t *ring, const void *value) {
+	return ring_spsc_push_n(ring, value, 1) == 1;
+}
+
+b8 ring_spsc_pop(ring_spsc_t *ring, void *out) {
+	return ring_spsc_pop_n(ring, out, 1) == 1;
+}
+
+uint32_t ring_spsc_push_n(ring_spsc_t *ring, const void *values,
+						  uint32_t count) {
+	uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	uint64_t capacity = ring->mask + 1;
+
+	/* Only go and read the consumer's line when the cached view is full. */
+	uint64_t space = capacity - (head - ring->tail_cache);
+	if (space < count) {
+		ring->tail_cache =
+			atomic_load_explicit(&ring->tail, memory_order_acquire);
+		space = capacity - (head - ring->tail_cache);
+	}
+
+	uint64_t n = space < count ? space : count;
+	if (!n)
+		return 0;
+
+	ring_copy_in(ring->slots, ring->mask, ring->element_size, head, values, n);
+	atomic_store_explicit(&ring->head, head + n, memory_order_release);
+	ring_notify(&ring->not_empty);
+	return (uint32_t)n;
+}
+
+uint32_t ring_spsc_pop_n(ring_spsc_t *ring, void *out, uint32_t count) {
+	uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+	uint64_t ready = ring->head_cache - tail;
+	if (ready < count) {
+		ring->head_cache =
+			atomic_load_explicit(&ring->head, memory_order_acquire);
+		ready = ring->head_cache - tail;
+	}
+
+	uint64_t n = ready < count ? ready : count;
+	if (!n)
+		return 0;
+
+	ring_copy_out(ring->slots, ring->mask, ring->element_size, tail, out, n);
+	atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+	ring_notify(&ring->not_full);
+	return (uint32_t)n;
+}
+
+void ring_spsc_push_wait(ring_spsc_t *ring, const void *value) {
+	ring_block(&ring->not_full, ring_spsc_try_push, ring, (void *)value);
+}
+
+void ring_spsc_pop_wait(ring_spsc_t *ring, void *out) {
+	ring_block(&ring->not_empty, ring_spsc_try_pop, ring, out);
+}
+
+uint64_t ring_spsc_count(ring_spsc_t *ring) {
+	uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	return head - tail;
+}
+
+/* ================================== MPMC ================================== */
+uint64_t ring_mpmc_memory_require(uint64_t element_size, uint32_t capacity) {
+	return ring_cell_size(element_size) * ring_capacity(capacity);
+}
+
+void ring_mpmc_init(uint64_t element_size, uint32_t capacity, void *memory,
+					ring_mpmc_t *ring) {
+	if (!memory || !ring || !capacity || !element_size) {
+		ar_ERROR("ring_mpmc_init require memory, ring and non zero size & "
+				 "capacity");
+		return;
+	}
+
+	atomic_init(&ring->enqueue, 0);
+	atomic_init(&ring->dequeue, 0);
+	ring->mask = ring_capacity(capacity) - 1;
+	ring->element_size = element_size;
+	ring->cell_size = ring_cell_size(element_size);
+	ring->cells = memory;
+	ring_signal_init(&ring->not_empty);
+	ring_signal_init(&ring->not_full);
+
+	/* A cell is free for position p when its sequence is p, holds a value
+	 * for p when it is p + 1. */
+	for (uint64_t i = 0; i <= ring->mask; ++i)
+		atomic_init(ring_mpmc_seq(ring, i), i);
+}
+
+b8 ring_mpmc_push(ring_mpmc_t *ring, const void *value) {
+	return ring_mpmc_push_n(ring, value, 1) == 1;
+}
+
+b8 ring_mpmc_pop(ring_mpmc_t *ring, void *out) {
+	return ring_mpmc_pop_n(ring, out, 1) == 1;
+}
+
+/* Claim the run of free cells from the enqueue position in one CAS. A cell
+ * seen free can't be taken from under us without enqueue moving first,
+ * which fails the CAS and starts over. */
+uint32_t ring_mpmc_push_n(ring_mpmc_t *ring, const void *values,
+						  uint32_t count) {
+	/* nothing to claim, the retry loop below would spin on it */
+	if (!count)
+		return 0;
+
+	uint64_t pos = atomic_load_explicit(&ring->enqueue, memory_order_relaxed);
+	uint64_t n;
+	for (;;) {
+		int64_t diff = 0;
+		for (n = 0; n < count; ++n) {
+			uint64_t seq = atomic_load_explicit(ring_mpmc_seq(ring, pos + n),
+												memory_order_acquire);
+			diff = (int64_t)(seq - (pos + n));
+			if (diff)
+				break;
+		}
+
+		if (n) {
+			if (atomic_compare_exchange_weak_explicit(
+					&ring->enqueue, &pos, pos + n, memory_order_relaxed,
+					memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return 0; // cell still holds last round's value, full
+		} else {
+			pos = atomic_load_explicit(&ring->enqueue, memory_order_relaxed);
+		}
+	}
+
+	const uint8_t *source = values;
+	for (uint64_t i = 0; i < n; ++i) {
+		memcpy(ring_mpmc_value(ring, pos + i), source + i * ring->element_size,
+			   ring->element_size);
+		atomic_store_explicit(ring_mpmc_seq(ring, pos + i), pos + i + 1,
+							  memory_order_release);
+	}
+
+	ring_notify(&ring->not_empty);
+	return (uint32_t)n;
+}
+
+uint32_t ring_mpmc_pop_n(ring_mpmc_t *ring, void *out, uint32_t count) {
+	if (!count)
+		return 0;
+
+	uint64_t pos = atomic_load_explicit(&ring->dequeue, memory_order_relaxed);
+	uint64_t n;
+	for (;;) {
+		int64_t diff = 0;
+		for (n = 0; n < count; ++n) {
+			uint64_t seq = atomic_load_explicit(ring_mpmc_seq(ring, pos + n),
+												memory_order_acquire);
+			diff = (int64_t)(seq - (pos + n + 1));
+			if (diff)
+				break;
+		}
+
+		if (n) {
+			if (atomic_compare_exchange_weak_explicit(
+					&ring->dequeue, &pos, pos + n, memory_order_relaxed,
+					memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return 0; // nothing posted at this position yet, empty
+		} else {
+			pos = atomic_load_explicit(&ring->dequeue, memory_order_relaxed);
+		}
+	}
+
+	uint8_t *target = out;
+	for (uint64_t i = 0; i < n; ++i) {
+		memcpy(target + i * ring->element_size, ring_mpmc_value(ring, pos + i),
+			   ring->element_size);
+		/* free again for the push one lap later */
+		atomic_store_explicit(ring_mpmc_seq(ring, pos + i),
+							  pos + i + ring->mask + 1, memory_order_release);
+	}
+
+	ring_notify(&ring->not_full);
+	return (uint32_t)n;
+}
+
+void ring_mpmc_push_wait(ring_mpmc_t *ring, const void *value) {
+	ring_block(&ring->not_full, ring_mpmc_try_push, ring, (void *)value);
+}
+
+void ring_mpmc_pop_wait(ring_mpmc_t *ring, void *out) {
+	ring_block(&ring->not_empty, ring_mpmc_try_pop, ring, out);
+}
+
+uint64_t ring_mpmc_count(ring_mpmc_t *ring) {
+	uint64_t dequeue = atomic_load_explicit(&ring->dequeue, memory_order_acquire);
+	uint64_t enqueue = atomic_load_explicit(&ring->enqueue, memory_order_acquire);
+	return enqueue > dequeue ? enqueue - dequeue : 0;
+}
@@ -0,0 +1,82 @@
+#ifndef __RING_H__
+#define __RING_H__
+
+#include "engine/define.h"
+
+#include <stdatomic.h>
+
+/* Bounded lock-free queues of fixed size elements, for handing work between
+ * threads (log lines, streamed assets, render submission). Capacity rounds
+ * up to a power of two, elements are copied in and out.
+ *
+ * ring_spsc_t: one producer thread, one consumer thread.
+ * ring_mpmc_t: any number of both, every slot carries a sequence number
+ *              that says whose turn it is (bounded queue after D. Vyukov).
+ *
+ * Push/pop never block and report a full/empty ring. The _n versions move
+ * as many as fit in one go and return the count. The _wait versions spin a
+ * little, then sleep on a futex until the other side makes room or posts.
+ *
+ * Index fields of each side sit on their own cache line, so the struct has
+ * to live on a 64 byte boundary: embed it or use memory_alloc_aligned.
+ * Slot memory is the caller's, sized with *_memory_require. */
+
+typedef struct ring_signal_t {
+	_Atomic uint32_t seq;     // bumped on every wake, what sleepers wait on
+	_Atomic uint32_t waiting; // raised before sleeping, cleared by the wake
+} ring_signal_t;
+
+typedef struct ring_spsc_t {
+	_aralignline _Atomic uint64_t head; // next write, producer's
+	uint64_t tail_cache;                // producer's last look at tail
+
+	_aralignline _Atomic uint64_t tail; // next read, consumer's
+	uint64_t head_cache;                // consumer's last look at head
+
+	_aralignline uint64_t mask;
+	uint64_t element_size;
+	uint8_t *slots;
+	ring_signal_t not_empty;
+	ring_signal_t not_full;
+} ring_spsc_t;
+
+typedef struct ring_mpmc_t {
+	_aralignline _Atomic uint64_t enqueue; // next position to claim for push
+	_aralignline _Atomic uint64_t dequeue; // next position to claim for pop
+
+	_aralignline uint64_t mask;
+	uint64_t element_size;
+	uint64_t cell_size; // sequence + element, rounded up to 8
+	uint8_t *cells;
+	ring_signal_t not_empty;
+	ring_signal_t not_full;
+} ring_mpmc_t;
+
+uint64_t ring_spsc_memory_require(uint64_t element_size, uint32_t capacity);
+void ring_spsc_init(uint64_t element_size, uint32_t capacity, void *memory,
+                    ring_spsc_t *ring);
+
+b8 ring_spsc_push(ring_spsc_t *ring, const void *value);
+b8 ring_spsc_pop(ring_spsc_t *ring, void *out);
+uint32_t ring_spsc_push_n(ring_spsc_t *ring, const void *values, uint32_t count);
+uint32_t ring_spsc_pop_n(ring_spsc_t *ring, void *out, uint32_t count);
+void ring_spsc_push_wait(ring_spsc_t *ring, const void *value);
+void ring_spsc_pop_wait(ring_spsc_t *ring, void *out);
+
+/* Snapshot, already stale when the other side is running. */
+uint64_t ring_spsc_count(ring_spsc_t *ring);
+
+uint64_t ring_mpmc_memory_require(uint64_t element_size, uint32_t capacity);
+void ring_mpmc_init(uint64_t element_size, uint32_t capacity, void *memory,
+                    ring_mpmc_t *ring);
+
+b8 ring_mpmc_push(ring_mpmc_t *ring, const void *value);
+b8 ring_mpmc_pop(ring_mpmc_t *ring, void *out);
+uint32_t ring_mpmc_push_n(ring_mpmc_t *ring, const void *values, uint32_t count);
+uint32_t ring_mpmc_pop_n(ring_mpmc_t *ring, void *out, uint32_t count);
+void ring_mpmc_push_wait(ring_mpmc_t *ring, const void *value);
+void ring_mpmc_pop_wait(ring_mpmc_t *ring, void *out);
+
+uint64_t ring_mpmc_count(ring_mpmc_t *ring);
+
+#endif //__RING_H__
@@ -0,0 +1,142 @@
+#include "engine/container/slot_map.h"
+
+#include "engine/core/logger.h"
+#include "engine/memory/memory.h"
+
+/* Index bits never go past this, the generation keeps 8 at the least. */
+#define SLOT_MAP_MAX_INDEX_BITS 24
+
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+uint64_t slot_map_stride(uint64_t element_size) {
+	return (element_size + 7) & ~(uint64_t)7;
+}
+
+uint32_t slot_map_index_bits(uint32_t capacity) {
+	uint32_t bits = 1;
+	while (bits < SLOT_MAP_MAX_INDEX_BITS && (1u << bits) < capacity)
+		bits++;
+	return bits;
+}
+
+uint32_t slot_map_index(slot_map_t *map, uint32_t handle) {
+	return handle & ((1u << map->index_bits) - 1);
+}
+
+uint32_t slot_map_handle(slot_map_t *map, uint32_t index) {
+	return (map->gens[index] << map->index_bits) | index;
+}
+
+void *slot_map_value(slot_map_t *map, uint32_t index) {
+	return (char *)map->values + map->element_size * index;
+}
+
+/* Slot of a live handle, INVALID_ID otherwise. */
+uint32_t slot_map_resolve(slot_map_t *map, uint32_t handle) {
+	uint32_t index = slot_map_index(map, handle);
+	if (handle == INVALID_ID || index >= map->capacity ||
+		slot_map_handle(map, index) != handle)
+		return INVALID_ID;
+
+	/* A free slot matches the handle it will give out next, or one from
+	 * a wrapped generation, so it has to be live as well. */
+	uint32_t pos = map->links[index];
+	if (pos >= map->count || map->dense[pos] != index)
+		return INVALID_ID;
+	return index;
+}
+/* ========================================================================== */
+/* ========================================================================== */
+
+uint64_t slot_map_memory_require(uint64_t element_size, uint32_t capacity) {
+	return sizeof(uint32_t) * 3 * (uint64_t)capacity +
+		   slot_map_stride(element_size) * capacity;
+}
+
+void slot_map_init(uint64_t element_size, uint32_t capacity, void *memory,
+                   slot_map_t *map) {
+	if (!memory || !map || !capacity || !element_size) {
+		ar_ERROR("slot_map_init require memory, map and non zero size & "
+				 "capacity");
+		return;
+	}
+
+	if (capacity > (1u << SLOT_MAP_MAX_INDEX_BITS)) {
+		ar_ERROR("slot_map_init - capacity %u over the %u slot limit, clamped",
+				 capacity, 1u << SLOT_MAP_MAX_INDEX_BITS);
+		capacity = 1u << SLOT_MAP_MAX_INDEX_BITS;
+	}
+
+	map->element_size = slot_map_stride(element_size);
+	map->capacity = capacity;
+	map->count = 0;
+	map->index_bits = slot_map_index_bits(capacity);
+
+	/* values first, they are what callers keep pointers into */
+	map->values = memory;
+	map->gens = (uint32_t *)((char *)memory + map->element_size * capacity);
+	map->links = map->gens + capacity;
+	map->dense = map->links + capacity;
+
+	for (uint32_t i = 0; i < capacity; ++i) {
+		map->gens[i] = 0;
+		map->links[i] = i + 1 < capacity ? i + 1 : INVALID_ID;
+	}
+	map->free_head = 0;
+}
+
+uint32_t slot_map_insert(slot_map_t *map, void **out) {
+	uint32_t index = map->free_head;
+	if (index == INVALID_ID) {
+		if (out)
+			*out = 0;
+		return INVALID_ID;
+	}
+
+	map->free_head = map->links[index];
+	map->links[index] = map->count;
+	map->dense[map->count++] = index;
+
+	void *value = slot_map_value(map, index);
+	memory_zero(value, map->element_size);
+	if (out)
+		*out = value;
+	return slot_map_handle(map, index);
+}
+
+b8 slot_map_remove(slot_map_t *map, uint32_t handle) {
+	uint32_t index = slot_map_resolve(map, handle);
+	if (index == INVALID_ID)
+		return false;
+
+	/* last live slot takes the removed one's dense position */
+	uint32_t pos = map->links[index];
+	uint32_t last = map->dense[--map->count];
+	map->dense[pos] = last;
+	map->links[last] = pos;
+
+	/* The all ones generation is skipped, INVALID_ID stays invalid. */
+	uint32_t gen_limit = (1u << (32 - map->index_bits)) - 1;
+	map->gens[index] = (map->gens[index] + 1) % gen_limit;
+
+	map->links[index] = map->free_head;
+	map->free_head = index;
+	return true;
+}
+
+void *slot_map_get(slot_map_t *map, uint32_t handle) {
+	uint32_t index = slot_map_resolve(map, handle);
+	return index != INVALID_ID ? slot_map_value(map, index) : 0;
+}
+
+uint32_t slot_map_count(slot_map_t *map) {
+	return map->count;
+}
+
+void *slot_map_at(slot_map_t *map, uint32_t i) {
+	return i < map->count ? slot_map_value(map, map->dense[i]) : 0;
+}
+
+uint32_t slot_map_handle_at(slot_map_t *map, uint32_t i) {
+	return i < map->count ? slot_map_handle(map, map->dense[i]) : INVALID_ID;
+}
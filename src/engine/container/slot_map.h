@@ -0,0 +1,51 @@
+#ifndef __SLOT_MAP_H__
+#define __SLOT_MAP_H__
+
+#include "engine/define.h"
+
+/* Fixed capacity pool of elements addressed by 32 bit handles, for resource
+ * registries. A handle is the slot index in the low bits and the slot's
+ * generation in the rest; removing an element bumps the generation, so
+ * handles kept past a remove stop resolving instead of reaching whatever
+ * took the slot next. INVALID_ID is never handed out.
+ *
+ * Elements never move while they are alive, pointers from slot_map_get stay
+ * good until the remove. Free slots are chained through the slot table, so
+ * insert and remove are O(1) however full the map is. Live slots are also
+ * listed densely, slot_map_at(map, 0 .. count - 1) visits every element
+ * without touching the free ones (order changes on remove).
+ *
+ * Memory is the caller's, sized with slot_map_memory_require. */
+
+typedef struct slot_map_t {
+	uint64_t element_size; // stride, rounded up to 8
+	uint32_t capacity;
+	uint32_t count;
+	uint32_t free_head;  // first free slot, INVALID_ID when full
+	uint32_t index_bits; // handle bits taken by the slot index
+	uint32_t *gens;      // generation of every slot
+	uint32_t *links;     // dense position when live, next free slot if not
+	uint32_t *dense;     // slot of every live element
+	void *values;
+} slot_map_t;
+
+uint64_t slot_map_memory_require(uint64_t element_size, uint32_t capacity);
+void slot_map_init(uint64_t element_size, uint32_t capacity, void *memory,
+                   slot_map_t *map);
+
+/* Handle of a zeroed element, INVALID_ID when the map is full. 'out' gets
+ * the element when not null. */
+uint32_t slot_map_insert(slot_map_t *map, void **out);
+
+/* False for a handle that is stale or was never handed out. */
+b8 slot_map_remove(slot_map_t *map, uint32_t handle);
+
+/* 0 for a handle that is stale or was never handed out. */
+void *slot_map_get(slot_map_t *map, uint32_t handle);
+
+/* Dense iteration, 'i' below slot_map_count. */
+uint32_t slot_map_count(slot_map_t *map);
+void *slot_map_at(slot_map_t *map, uint32_t i);
+uint32_t slot_map_handle_at(slot_map_t *map, uint32_t i);
+
+#endif //__SLOT_MAP_H__
@@ -0,0 +1,102 @@
+#include "engine/container/soa.h"
+
+#include "engine/core/logger.h"
+#include "engine/memory/memory.h"
+
+/* First allocation when a push finds no room, 16 rows fill a line of the
+ * narrowest (4 byte) columns. */
+#define SOA_MIN_CAPACITY 16
+
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+uint64_t soa_column_bytes(uint64_t size, uint32_t capacity) {
+	uint64_t line = AR_CACHE_LINE - 1;
+	return (size * capacity + line) & ~line;
+}
+/* ========================================================================== */
+/* ========================================================================== */
+
+b8 _soa_reserve(soa_header_t *header, soa_columns_t columns,
+				uint32_t capacity) {
+	if (capacity <= header->capacity)
+		return true;
+
+	uint64_t block_size = 0;
+	for (uint32_t i = 0; i < columns.count; ++i)
+		block_size += soa_column_bytes(columns.sizes[i], capacity);
+
+	uint8_t *block =
+		memory_alloc_aligned_uninit(block_size, AR_CACHE_LINE, MEMTAG_ARRAY);
+	if (!block) {
+		ar_ERROR("_soa_reserve - unable to grow to %u rows", capacity);
+		return false;
+	}
+
+	/* columns move one by one into the new block, rows past length are
+	 * never read before a push zeroes them */
+	uint64_t offset = 0;
+	for (uint32_t i = 0; i < columns.count; ++i) {
+		void *column = block + offset;
+		if (header->length)
+			memory_copy(column, *columns.columns[i],
+						columns.sizes[i] * header->length);
+		*columns.columns[i] = column;
+		offset += soa_column_bytes(columns.sizes[i], capacity);
+	}
+
+	if (header->block)
+		memory_free_aligned(header->block, header->block_size, AR_CACHE_LINE,
+							MEMTAG_ARRAY);
+	header->block = block;
+	header->block_size = block_size;
+	header->capacity = capacity;
+	return true;
+}
+
+void _soa_shut(soa_header_t *header, soa_columns_t columns) {
+	if (header->block)
+		memory_free_aligned(header->block, header->block_size, AR_CACHE_LINE,
+							MEMTAG_ARRAY);
+
+	for (uint32_t i = 0; i < columns.count; ++i)
+		*columns.columns[i] = 0;
+	header->length = 0;
+	header->capacity = 0;
+	header->block = 0;
+	header->block_size = 0;
+}
+
+uint32_t _soa_push(soa_header_t *header, soa_columns_t columns) {
+	if (header->length == header->capacity) {
+		uint32_t capacity =
+			header->capacity ? header->capacity * 2 : SOA_MIN_CAPACITY;
+		if (!_soa_reserve(header, columns, capacity))
+			return INVALID_ID;
+	}
+
+	uint32_t index = header->length++;
+	for (uint32_t i = 0; i < columns.count; ++i)
+		memory_zero((uint8_t *)*columns.columns[i] + columns.sizes[i] * index,
+					columns.sizes[i]);
+	return index;
+}
+
+uint32_t _soa_swap_remove(soa_header_t *header, soa_columns_t columns,
+						  uint32_t index) {
+	if (index >= header->length) {
+		ar_WARNING("_soa_swap_remove - row %u outside of %u rows", index,
+				   header->length);
+		return INVALID_ID;
+	}
+
+	uint32_t last = --header->length;
+	if (index == last)
+		return INVALID_ID;
+
+	for (uint32_t i = 0; i < columns.count; ++i) {
+		uint8_t *column = *columns.columns[i];
+		memory_copy(column + columns.sizes[i] * index,
+					column + columns.sizes[i] * last, columns.sizes[i]);
+	}
+	return last;
+}
@@ -0,0 +1,109 @@
+#ifndef __SOA_H__
+#define __SOA_H__
+
+#include "engine/define.h"
+
+/* Structure of arrays: one contiguous column per field, all sharing a
+ * length and capacity, so a loop over one field only pulls that field into
+ * cache. Fields are listed once as an X macro and SOA_DECLARE generates the
+ * struct and its functions:
+ *
+ *     #define MESH_FIELDS(X)                                              \
+ *         X(vec3, position)                                               \
+ *         X(uint32_t, geometry)                                           \
+ *         X(name_t, name)
+ *     SOA_DECLARE(mesh_soa, MESH_FIELDS)
+ *
+ * gives mesh_soa_t { soa_header_t header; vec3 *position; ... } with
+ * mesh_soa_init/shut/reserve/push/swap_remove. A row is an index, every
+ * column is indexed with it: soa.position[i], soa.geometry[i].
+ *
+ * All columns share one memory_alloc_aligned block, each starting on a
+ * 64 byte boundary. Growing moves the columns, so column pointers and row
+ * indices are only good until the next push. Swap remove moves the last
+ * row into the hole, keep cold fields (names, paths) in their own SOA or
+ * off to the side so hot loops never touch them. */
+
+typedef struct soa_header_t {
+	uint32_t length;
+	uint32_t capacity;
+	void *block;
+	uint64_t block_size;
+} soa_header_t;
+
+/* Column pointers and element sizes, in field order. */
+typedef struct soa_columns_t {
+	void ***columns;
+	const uint64_t *sizes;
+	uint32_t count;
+} soa_columns_t;
+
+b8 _soa_reserve(soa_header_t *header, soa_columns_t columns,
+				uint32_t capacity);
+void _soa_shut(soa_header_t *header, soa_columns_t columns);
+uint32_t _soa_push(soa_header_t *header, soa_columns_t columns);
+uint32_t _soa_swap_remove(soa_header_t *header, soa_columns_t columns,
+						  uint32_t index);
+
+/* Column with its 64 byte alignment spelled out, lets the compiler use
+ * aligned vector loads in loops over it. */
+#if defined(__GNUC__) || defined(__clang__)
+	#define soa_column(soa, field)                                             \
+		((__typeof__((soa)->field))__builtin_assume_aligned((soa)->field,      \
+															AR_CACHE_LINE))
+#else
+	#define soa_column(soa, field) ((soa)->field)
+#endif
+
+#define soa_length(soa) ((soa)->header.length)
+#define soa_capacity(soa) ((soa)->header.capacity)
+
+#define SOA_MEMBER(type, field) type *field;
+#define SOA_COLUMN(type, field) (void **)&soa->field,
+#define SOA_SIZE(type, field) sizeof(type),
+#define SOA_ONE(type, field) +1
+
+#define SOA_DECLARE(name, FIELDS)                                              \
+	typedef struct name##_t {                                                  \
+		soa_header_t header;                                                   \
+		FIELDS(SOA_MEMBER)                                                     \
+	} name##_t;                                                                \
+                                                                               \
+	/* Pointers are taken from 'soa', so the table is built per call. */      \
+	_arinline b8 name##_reserve(name##_t *soa, uint32_t capacity) {            \
+		void **columns[] = {FIELDS(SOA_COLUMN)};                               \
+		static const uint64_t sizes[] = {FIELDS(SOA_SIZE)};                    \
+		soa_columns_t table = {columns, sizes, 0 FIELDS(SOA_ONE)};             \
+		return _soa_reserve(&soa->header, table, capacity);                    \
+	}                                                                          \
+                                                                               \
+	_arinline b8 name##_init(name##_t *soa, uint32_t capacity) {               \
+		*soa = (name##_t){0};                                                  \
+		return name##_reserve(soa, capacity);                                  \
+	}                                                                          \
+                                                                               \
+	_arinline void name##_shut(name##_t *soa) {                                \
+		void **columns[] = {FIELDS(SOA_COLUMN)};                               \
+		static const uint64_t sizes[] = {FIELDS(SOA_SIZE)};                    \
+		soa_columns_t table = {columns, sizes, 0 FIELDS(SOA_ONE)};             \
+		_soa_shut(&soa->header, table);                                        \
+	}                                                                          \
+                                                                               \
+	/* Index of a new zeroed row, INVALID_ID when growing failed. */           \
+	_arinline uint32_t name##_push(name##_t *soa) {                            \
+		void **columns[] = {FIELDS(SOA_COLUMN)};                               \
+		static const uint64_t sizes[] = {FIELDS(SOA_SIZE)};                    \
+		soa_columns_t table = {columns, sizes, 0 FIELDS(SOA_ONE)};             \
+		return _soa_push(&soa->header, table);                                 \
+	}                                                                          \
+                                                                               \
+	/* Old index of the row moved into 'index', INVALID_ID when nothing      \
+	 * moved (last row removed or 'index' out of range). */                   \
+	_arinline uint32_t name##_swap_remove(name##_t *soa, uint32_t index) {     \
+		void **columns[] = {FIELDS(SOA_COLUMN)};                               \
+		static const uint64_t sizes[] = {FIELDS(SOA_SIZE)};                    \
+		soa_columns_t table = {columns, sizes, 0 FIELDS(SOA_ONE)};             \
+		return _soa_swap_remove(&soa->header, table, index);                   \
+	}
+
+#endif //__SOA_H__
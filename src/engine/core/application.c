@@ -8,9 +8,13 @@ else since platform_time using _POSIX_C_SOURCE. */
 #include "engine/core/logger.h"
 #include "engine/core/event.h"
 #include "engine/core/input.h"
+#include "engine/core/name.h"
 #include "engine/core/ar_strings.h"
 #include "engine/memory/memory.h"
 #include "engine/memory/arena.h"
+#include "engine/memory/frame_alloc.h"
+#include "engine/memory/memory_profile.h"
+#include "engine/memory/scratch.h"
 #include "engine/platform/platform.h"
 #include "engine/renderer/renderer_fe.h"
 
@@ -22,6 +26,8 @@ else since platform_time using _POSIX_C_SOURCE. */
 // TODO: Temporary
 #include "engine/math/maths.h"
 
+#define APP_LISTENER_COUNT 7
+
 typedef struct subsys_state_t {
 	uint64_t size;
 	void *state;
@@ -38,10 +44,13 @@ typedef struct application_state_t {
 	int16_t last_time;
 
 	arena_allocator_t arena;
+	frame_alloc_t frame_alloc;
 
 	subsys_state_t event;
+	uint32_t listeners[APP_LISTENER_COUNT]; // event handles
 	subsys_state_t log;
 	subsys_state_t input;
+	subsys_state_t name;
 	subsys_state_t platform;
 	subsys_state_t resources;
 	subsys_state_t renderer;
@@ -182,6 +191,21 @@ b8 application_init(struct game_entry *game_inst) {
 	/* Memory System */
 	memory_sys_config_t mem_system_config = {};
 	mem_system_config.total_alloc_size = GIBIBYTES(1);
+	mem_system_config.alloc_type = DYN_ALLOC_TLSF;
+	mem_system_config.huge_pages = game_inst->app_config.huge_pages;
+	mem_system_config.trace_path = game_inst->app_config.memory_trace;
+
+	/* Short lived strings on size class slabs, texture data on a heap of its
+	 * own, so neither leaves holes between renderer and game state. */
+	mem_system_config.heap_count = 2;
+	mem_system_config.heaps[0].name = "strings";
+	mem_system_config.heaps[0].budget = MEBIBYTES(64);
+	mem_system_config.heaps[0].engine = MEMORY_ENGINE_SLAB;
+	mem_system_config.heaps[0].tags = MEMTAG_BIT(MEMTAG_STRING);
+	mem_system_config.heaps[1].name = "textures";
+	mem_system_config.heaps[1].budget = MEBIBYTES(256);
+	mem_system_config.heaps[1].engine = MEMORY_ENGINE_FREELIST;
+	mem_system_config.heaps[1].tags = MEMTAG_BIT(MEMTAG_TEXTURE);
 	if (!memory_init(mem_system_config)) {
 		ar_ERROR("Failed to Initialized memory system. Shutdown.");
 		return false;
@@ -197,9 +221,13 @@ b8 application_init(struct game_entry *game_inst) {
 	p_state->is_running = false;
 	p_state->is_suspend = false;
 
-	/* set chunk of memory allocation */
+	/* Subsystem states. Address space for all of them up front, pages only
+	 * as they get used, so the per-system maximums are free to grow. Falls
+	 * back to a fixed block of the heap. */
 	uint64_t total_size_alloc = 64 * 1024 * 1024; // 64 Mb
-	arena_init(total_size_alloc, 0, &p_state->arena);
+	if (!arena_init_virtual(GIBIBYTES(1), game_inst->app_config.huge_pages,
+							&p_state->arena))
+		arena_init(total_size_alloc, 0, &p_state->arena);
 
 	/* Set event memory allocation */
 	event_init(&p_state->event.size, 0);
@@ -216,13 +244,19 @@ b8 application_init(struct game_entry *game_inst) {
 	p_state->input.state = arena_allocate(&p_state->arena, p_state->input.size);
 	input_init(&p_state->input.size, p_state->input.state);
 
-	event_reg(EVENT_CODE_APPLICATION_QUIT, 0, app_on_event);
-	event_reg(EVENT_CODE_KEY_PRESSED, 0, app_on_key);
-	event_reg(EVENT_CODE_KEY_RELEASE, 0, app_on_key);
-	event_reg(EVENT_CODE_RESIZED, 0, app_on_resized);
-	event_reg(EVENT_CODE_APP_SUSPEND, 0, app_on_event);
-	event_reg(EVENT_CODE_APP_RESUME, 0, app_on_event);
-	event_reg(EVENT_CODE_DEBUG0, 0, app_on_debug);
+	/* set name memory allocation, resources keep interned names */
+	name_init(&p_state->name.size, 0);
+	p_state->name.state = arena_allocate(&p_state->arena, p_state->name.size);
+	name_init(&p_state->name.size, p_state->name.state);
+
+	uint32_t *listeners = p_state->listeners;
+	listeners[0] = event_reg(EVENT_CODE_APPLICATION_QUIT, 0, app_on_event);
+	listeners[1] = event_reg(EVENT_CODE_KEY_PRESSED, 0, app_on_key);
+	listeners[2] = event_reg(EVENT_CODE_KEY_RELEASE, 0, app_on_key);
+	listeners[3] = event_reg(EVENT_CODE_RESIZED, 0, app_on_resized);
+	listeners[4] = event_reg(EVENT_CODE_APP_SUSPEND, 0, app_on_event);
+	listeners[5] = event_reg(EVENT_CODE_APP_RESUME, 0, app_on_event);
+	listeners[6] = event_reg(EVENT_CODE_DEBUG0, 0, app_on_debug);
 
 	/* set platform memory allocation */
 	platform_init(&p_state->platform.size, 0, 0, 0, 0, 0, 0);
@@ -258,6 +292,15 @@ b8 application_init(struct game_entry *game_inst) {
 	  return false;
 	}
 
+    /* Per frame memory, one arena being recorded plus one per frame the GPU
+     * may still be reading. */
+    uint8_t frame_buffers = renderer_frames_in_flight() + 1;
+    if (!frame_alloc_init(MEBIBYTES(4), frame_buffers, 0,
+                          &p_state->frame_alloc)) {
+        ar_FATAL("Frame allocator failed to initialize");
+        return false;
+    }
+
     /* set texture memory allocation */
     texture_sys_config_t tex_sys_config;
     tex_sys_config.max_texture_count = 65536;
@@ -371,6 +414,7 @@ b8 application_run(void) {
 	double runtime = 0;
 	uint8_t frame_count = 0;
 	float target_frame_seconds = 1.0f / 60;
+	double compact_budget = 0.0005; // heap compaction time per frame
 	const b8 limit = false;
 
 	char *stats = memory_debug_stats();
@@ -381,6 +425,9 @@ b8 application_run(void) {
 		if (!platform_push())
 			p_state->is_running = false;
 
+		/* Everything the platform posted this frame, coalesced. */
+		event_dispatch();
+
 		if (!p_state->is_suspend) {
 			time_update(&p_state->time);
 			double current_time = p_state->time.elapsed;
@@ -404,19 +451,28 @@ b8 application_run(void) {
 
 			render_packet_t packet;
 			packet.delta = delta;
+			packet.frame_alloc = &p_state->frame_alloc;
 
 			// TODO: Temporary
-			geo_render_data_t test_render;
-			test_render.geometry = p_state->test_geo;
-			test_render.model = mat4_identity();
+			geo_render_data_t *test_render = frame_alloc_allocate(
+				&p_state->frame_alloc, sizeof(geo_render_data_t));
+			geo_render_data_t *test_ui_render = frame_alloc_allocate(
+				&p_state->frame_alloc, sizeof(geo_render_data_t));
+			if (!test_render || !test_ui_render) {
+				ar_FATAL("Frame memory exhausted");
+				p_state->is_running = false;
+				break;
+			}
+
+			test_render->geometry = p_state->test_geo;
+			test_render->model = mat4_identity();
 			packet.geo_count = 1;
-			packet.geometries = &test_render;
+			packet.geometries = test_render;
 
-			geo_render_data_t test_ui_render;
-			test_ui_render.geometry = p_state->test_ui_geo;
-			test_ui_render.model = mat4_translate(vec3_zero());
+			test_ui_render->geometry = p_state->test_ui_geo;
+			test_ui_render->model = mat4_translate(vec3_zero());
 			packet.ui_geo_count = 1;
-			packet.ui_geometries = &test_ui_render;
+			packet.ui_geometries = test_ui_render;
 
 			renderer_draw_frame(&packet);
 
@@ -435,6 +491,13 @@ b8 application_run(void) {
 
 			input_update(delta);
 
+			/* Frame boundary, the oldest frame's memory gets reused. */
+			frame_alloc_next(&p_state->frame_alloc);
+			memory_profile_frame();
+
+			/* Close up holes between relocatable blocks a bit at a time. */
+			memory_compact(compact_budget);
+
 			/* hahahahaa */
 			//ar_TRACE("runtime: %f, frame_count: %u", runtime, frame_count);
 			(void)runtime;
@@ -445,24 +508,28 @@ b8 application_run(void) {
 	/* engine end loop */
 	p_state->is_running = false;
 	
-	event_unreg(EVENT_CODE_APPLICATION_QUIT, 0, app_on_event);
-	event_unreg(EVENT_CODE_KEY_PRESSED, 0, app_on_key);
-	event_unreg(EVENT_CODE_KEY_RELEASE, 0, app_on_key);
-	event_unreg(EVENT_CODE_RESIZED, 0, app_on_resized);
-	event_unreg(EVENT_CODE_APP_SUSPEND, 0, app_on_event);
-	event_unreg(EVENT_CODE_APP_RESUME, 0, app_on_event);
-	event_unreg(EVENT_CODE_DEBUG0, 0, app_on_debug);
+	for (uint32_t i = 0; i < APP_LISTENER_COUNT; ++i)
+		event_unreg_handle(p_state->listeners[i]);
 	
 	input_shut(p_state->input.state);
 	geometry_sys_shut(p_state->geometry.state);
 	material_sys_shut(p_state->material.state);
 	texture_sys_shut(p_state->textures.state);
+	frame_alloc_shut(&p_state->frame_alloc);
 	renderer_shut(p_state->renderer.state);
 	resource_sys_shut(p_state->resources.state);
+	name_shut(p_state->name.state);
 	platform_shut(p_state->platform.state);
 	log_shut(p_state->log.state);
 	event_shut(p_state->event.state);
+	arena_shut(&p_state->arena);
+
+	/* Callsite profile of the whole run, debug builds only. */
+	const char *profile_path = p_state->game_inst->app_config.memory_profile;
+	if (profile_path)
+		memory_profile_dump(profile_path, MEMORY_PROFILE_JSON);
 	memory_shut();
+	scratch_thread_shut();
 
 	return true;
 }
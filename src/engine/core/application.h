@@ -9,6 +9,17 @@ typedef struct application_config_t {
 	int32_t pos_x, pos_y;
 	uint32_t width, height;
 	char *name;
+
+	/* Back the engine heap and the application arena with huge pages. */
+	b8 huge_pages;
+
+	/* Trace heap allocations of the whole run to this file, for
+	 * bench_replay. Null to skip. */
+	const char *memory_trace;
+
+	/* Write the callsite memory profile here as JSON at shutdown, debug
+	 * builds only. Null to skip. */
+	const char *memory_profile;
 } application_config_t;
 
 b8 application_init(struct game_entry *game_inst);
@@ -4,6 +4,7 @@
 #include "engine/define.h"
 #include "engine/math/math_type.h"
 #include "engine/memory/memory.h"
+#include "engine/memory/scratch.h"
 
 #include <stdio.h>
 #include <stdarg.h>
@@ -28,7 +29,7 @@ _arinline uint64_t string_length(const char *str) {
 
 _arinline char *string_duplicate(const char *str) {
 	uint64_t length = string_length(str);
-	char *copy = memory_alloc(length + 1, MEMTAG_STRING);
+	char *copy = memory_alloc_uninit(length + 1, MEMTAG_STRING);
 	memory_copy(copy, str, length + 1);
 	return copy;
 }
@@ -45,12 +46,26 @@ _arinline b8 string_equali(const char *str1, const char *str2) {
 #endif
 }
 
+#define STRING_FORMAT_LENGTH 24000
+
 _arinline int32_t string_format_v(char *dest, const char *format, va_list va_lispt) {
 	if (dest) {
-		char buffer[24000];
-		int32_t written = vsnprintf(buffer, 24000, format, va_lispt);
-		buffer[written] = 0;
-		memory_copy(dest, buffer, (uint16_t)written + 1);
+		/* Format into scratch first, 'dest' may be one of the arguments. */
+		scratch_t scratch = scratch_begin();
+		char *buffer = scratch_alloc(&scratch, STRING_FORMAT_LENGTH);
+		if (!buffer) {
+			scratch_end(scratch);
+			return -1;
+		}
+
+		int32_t written =
+			vsnprintf(buffer, STRING_FORMAT_LENGTH, format, va_lispt);
+		if (written >= STRING_FORMAT_LENGTH)
+			written = STRING_FORMAT_LENGTH - 1;
+		if (written >= 0)
+			memory_copy(dest, buffer, (uint64_t)written + 1);
+
+		scratch_end(scratch);
 		return written;
 	}
 
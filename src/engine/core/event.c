@@ -1,33 +1,242 @@
 #include "engine/core/event.h"
 #include "engine/memory/memory.h"
 #include "engine/container/dyn_array.h"
+#include "engine/container/slot_map.h"
+#include "engine/container/soa.h"
 #include "engine/core/logger.h"
 
-typedef struct register_event_t {
-	void *listener;
-	p_on_event callback;
-} register_event_t;
+/* Every listener of every code lives in one pool. A code owns a contiguous
+ * range of rows in it, sorted by priority, so dispatch walks two dense
+ * columns. Ranges start small and move to the end of the pool, doubled,
+ * when they fill; the pool is repacked once the abandoned ranges add up. */
+#define EVENT_POOL_FIELDS(X)                                                   \
+	X(p_on_event, callback)                                                    \
+	X(void *, listener)                                                        \
+	X(uint32_t, handle)                                                        \
+	X(int16_t, priority)                                                       \
+	X(uint16_t, code)
+SOA_DECLARE(event_pool, EVENT_POOL_FIELDS)
 
-typedef struct event_entry_t {
-	register_event_t *events;
-} event_entry_t;
+typedef struct event_range_t {
+	uint32_t first;    // pool row the code's range starts at
+	uint16_t capacity; // rows reserved for the code
+	uint16_t count;    // rows in use, unregistered ones included
+	uint16_t dead;     // unregistered rows not squeezed out yet
+	uint8_t firing;    // event_push calls running over the range
+	b8 unsorted;       // rows appended while firing, sorted once it ends
+} event_range_t;
 
-#define MAX_MSG_CODE 8124
+typedef struct queued_event_t {
+	uint16_t code;
+	void *sender;
+	event_context_t context;
+} queued_event_t;
+
+#define EVENT_CODE_SLOTS 4 // rows a code gets on its first listener
+#define EVENT_MAX_LISTENERS 2048
+#define EVENT_QUEUE_CAPACITY 64
 
 typedef struct event_state_t {
-	event_entry_t registered[MAX_MSG_CODE];
+	event_range_t ranges[MAX_EVENT_CODE + 1];
+	event_pool_t pool;
+	uint32_t waste;     // pool rows in ranges that were moved away from
+	slot_map_t handles; // listener handle -> pool row
+
+	/* Posts go to queue[write], dispatch flips and drains the other one. */
+	queued_event_t *queue[2];
+	uint8_t write;
+	b8 dispatching;
+	uint8_t coalesce[MAX_EVENT_CODE + 1];
+	uint32_t pending[MAX_EVENT_CODE + 1]; // queue[write] slot, coalesced codes
 } event_state_t;
 
 static event_state_t *p_state;
 
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+/* Stands in for an unregistered listener until its row is squeezed out, so
+ * the dispatch loop needs no check. */
+b8 event_dead(uint16_t code, void *sender, void *listener,
+			  event_context_t data) {
+	(void)code;
+	(void)sender;
+	(void)listener;
+	(void)data;
+	return false;
+}
+
+/* Row copy, within one pool or into another, keeping the handle on it. */
+void event_row_copy(event_pool_t *dst, uint32_t to, event_pool_t *src,
+					uint32_t from) {
+	dst->callback[to] = src->callback[from];
+	dst->listener[to] = src->listener[from];
+	dst->handle[to] = src->handle[from];
+	dst->priority[to] = src->priority[from];
+	dst->code[to] = src->code[from];
+
+	uint32_t *row = slot_map_get(&p_state->handles, src->handle[from]);
+	if (row)
+		*row = to;
+}
+
+uint32_t event_pool_extend(uint32_t rows) {
+	uint32_t first = soa_length(&p_state->pool);
+	for (uint32_t i = 0; i < rows; ++i) {
+		if (event_pool_push(&p_state->pool) == INVALID_ID)
+			return INVALID_ID;
+	}
+	return first;
+}
+
+/* Pack every range back to back, in code order. */
+b8 event_pool_compact(void) {
+	uint32_t live = soa_length(&p_state->pool) - p_state->waste;
+	event_pool_t packed;
+	if (!event_pool_init(&packed, live))
+		return false;
+
+	for (uint32_t c = 0; c <= MAX_EVENT_CODE; ++c) {
+		event_range_t *entry = &p_state->ranges[c];
+		if (!entry->capacity)
+			continue;
+
+		uint32_t first = soa_length(&packed);
+		for (uint32_t i = 0; i < entry->capacity; ++i)
+			event_pool_push(&packed);
+		for (uint32_t i = 0; i < entry->count; ++i)
+			event_row_copy(&packed, first + i, &p_state->pool, entry->first + i);
+		entry->first = first;
+	}
+
+	event_pool_shut(&p_state->pool);
+	p_state->pool = packed;
+	p_state->waste = 0;
+	return true;
+}
+
+b8 event_range_grow(event_range_t *entry) {
+	uint32_t capacity = entry->capacity ? entry->capacity * 2u
+										: EVENT_CODE_SLOTS;
+	if (capacity > UINT16_MAX) {
+		ar_ERROR("event_reg - a code can't hold more than %u listeners",
+				 entry->capacity);
+		return false;
+	}
+
+	/* Last range in the pool grows where it is. */
+	uint32_t end = entry->first + entry->capacity;
+	if (entry->capacity && end == soa_length(&p_state->pool)) {
+		if (event_pool_extend(capacity - entry->capacity) == INVALID_ID)
+			return false;
+		entry->capacity = (uint16_t)capacity;
+		return true;
+	}
+
+	uint32_t first = event_pool_extend(capacity);
+	if (first == INVALID_ID)
+		return false;
+
+	for (uint32_t i = 0; i < entry->count; ++i)
+		event_row_copy(&p_state->pool, first + i, &p_state->pool,
+					   entry->first + i);
+	p_state->waste += entry->capacity;
+	entry->first = first;
+	entry->capacity = (uint16_t)capacity;
+
+	/* The range has moved either way, a failed repack only keeps the
+	 * waste around for the next try. */
+	if (p_state->waste > soa_length(&p_state->pool) / 2)
+		event_pool_compact();
+	return true;
+}
+
+/* Move 'row' up its range to behind everything of the same or higher
+ * priority, so equal ones stay in registration order. */
+void event_row_place(event_range_t *entry, uint32_t row) {
+	event_pool_t *pool = &p_state->pool;
+	int16_t priority = pool->priority[row];
+	if (row == entry->first || pool->priority[row - 1] >= priority)
+		return;
+
+	p_on_event callback = pool->callback[row];
+	void *listener = pool->listener[row];
+	uint32_t handle = pool->handle[row];
+	uint16_t code = pool->code[row];
+
+	uint32_t at = row;
+	while (at > entry->first && pool->priority[at - 1] < priority) {
+		event_row_copy(pool, at, pool, at - 1);
+		at--;
+	}
+
+	pool->callback[at] = callback;
+	pool->listener[at] = listener;
+	pool->handle[at] = handle;
+	pool->priority[at] = priority;
+	pool->code[at] = code;
+
+	uint32_t *slot = slot_map_get(&p_state->handles, handle);
+	if (slot)
+		*slot = at;
+}
+
+/* Once the last event_push over the range is done: put rows appended in the
+ * meantime in priority order and drop a range that is all dead. */
+void event_range_settle(event_range_t *entry) {
+	if (entry->unsorted) {
+		for (uint32_t i = 1; i < entry->count; ++i)
+			event_row_place(entry, entry->first + i);
+		entry->unsorted = false;
+	}
+
+	if (entry->dead == entry->count) {
+		entry->count = 0;
+		entry->dead = 0;
+	}
+}
+
+/* Drop unregistered rows, the rest keep their order. */
+void event_range_squeeze(event_range_t *entry) {
+	event_pool_t *pool = &p_state->pool;
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < entry->count; ++i) {
+		uint32_t row = entry->first + i;
+		if (pool->handle[row] == INVALID_ID)
+			continue;
+		if (kept != i)
+			event_row_copy(pool, entry->first + kept, pool, row);
+		kept++;
+	}
+
+	entry->count = (uint16_t)kept;
+	entry->dead = 0;
+}
+/* ========================================================================== */
+/* ========================================================================== */
+
 void event_init(uint64_t *memory_require, void *state) {
-	*memory_require = sizeof(event_state_t);
+	uint64_t handles_require =
+		slot_map_memory_require(sizeof(uint32_t), EVENT_MAX_LISTENERS);
+	*memory_require = sizeof(event_state_t) + handles_require;
 	if (state == 0)
 		return;
 
-	memory_zero(state, sizeof(state));
+	memory_zero(state, sizeof(event_state_t));
 	p_state = state;
 
+	slot_map_init(sizeof(uint32_t), EVENT_MAX_LISTENERS,
+				  (uint8_t *)state + sizeof(event_state_t), &p_state->handles);
+	event_pool_init(&p_state->pool, EVENT_CODE_SLOTS * 16);
+
+	p_state->queue[0] = dyn_array_reserved(queued_event_t, EVENT_QUEUE_CAPACITY);
+	p_state->queue[1] = dyn_array_reserved(queued_event_t, EVENT_QUEUE_CAPACITY);
+	memory_set(p_state->pending, 0xFF, sizeof(p_state->pending));
+
+	/* A burst of these in one frame only needs to land once. */
+	p_state->coalesce[EVENT_CODE_RESIZED] = EVENT_COALESCE_LAST;
+	p_state->coalesce[EVENT_CODE_MOUSE_MOVE] = EVENT_COALESCE_LAST;
+	p_state->coalesce[EVENT_CODE_MOUSE_WHEEL] = EVENT_COALESCE_ACCUMULATE;
+
 	ar_INFO("Event System Initialized");
 }
 
@@ -35,71 +244,194 @@ void event_shut(void *state) {
 	(void)state;
 
 	if (p_state) {
-		for (uint16_t i = 0; i < MAX_EVENT_CODE; ++i) {
-			if (p_state->registered[i].events != 0) {
-				dyn_array_destroy(p_state->registered[i].events);
-				p_state->registered[i].events = 0;
-			}
-		}
+		event_pool_shut(&p_state->pool);
+		dyn_array_destroy(p_state->queue[0]);
+		dyn_array_destroy(p_state->queue[1]);
 	}
 
 	p_state = 0;
 }
 
-b8 event_reg(uint16_t code, void *listener, p_on_event event) {
-	if (!p_state)
-		return false;
+uint32_t event_reg(uint16_t code, void *listener, p_on_event event) {
+	return event_reg_priority(code, listener, event, 0);
+}
 
-	if (p_state->registered[code].events == 0)
-		p_state->registered[code].events = dyn_array_create(register_event_t);
+uint32_t event_reg_priority(uint16_t code, void *listener, p_on_event event,
+							int16_t priority) {
+	if (!p_state || !event || code > MAX_EVENT_CODE)
+		return INVALID_ID;
 
-	uint64_t count = dyn_array_length(p_state->registered[code].events);
-	for (uint64_t i = 0; i < count; ++i) {
-		if (p_state->registered[code].events[i].listener == listener)
-			return false;
+	/* While the code is firing rows must keep their index: no squeeze, and
+	 * the new row goes on the end until the dispatch settles the range.
+	 * Growing is fine, the rows move over in order. */
+	event_range_t *entry = &p_state->ranges[code];
+	if (entry->dead && !entry->firing)
+		event_range_squeeze(entry);
+	if (entry->count == entry->capacity && !event_range_grow(entry))
+		return INVALID_ID;
+
+	uint32_t *slot;
+	uint32_t handle = slot_map_insert(&p_state->handles, (void **)&slot);
+	if (handle == INVALID_ID) {
+		ar_ERROR("event_reg - all %u listener handles are taken",
+				 EVENT_MAX_LISTENERS);
+		return INVALID_ID;
 	}
 
-	register_event_t reg_events;
-	reg_events.listener = listener;
-	reg_events.callback = event;
-	dyn_array_push(p_state->registered[code].events, reg_events);
+	event_pool_t *pool = &p_state->pool;
+	uint32_t at = entry->first + entry->count;
+	pool->callback[at] = event;
+	pool->listener[at] = listener;
+	pool->handle[at] = handle;
+	pool->priority[at] = priority;
+	pool->code[at] = code;
+	*slot = at;
+	entry->count++;
 
-	return true;
+	if (entry->firing)
+		entry->unsorted = true;
+	else
+		event_row_place(entry, at);
+	return handle;
 }
 
-b8 event_unreg(uint16_t code, void *listener, p_on_event event) {
+b8 event_unreg_handle(uint32_t handle) {
 	if (!p_state)
 		return false;
 
-	if (p_state->registered[code].events == 0)
+	uint32_t *slot = slot_map_get(&p_state->handles, handle);
+	if (!slot)
 		return false;
 
-	uint64_t count = dyn_array_length(p_state->registered[code].events);
-	for (uint64_t i = 0; i < count; ++i) {
-		register_event_t e = p_state->registered[code].events[i];
-		if (e.listener == listener && e.callback == event) {
-			register_event_t pop;
-			dyn_array_pop_at(p_state->registered[code].events, i, &pop);
-			return true;
-		}
+	/* The row stays put so a dispatch running over this code isn't thrown
+	 * off, the code's next registration squeezes it out. */
+	event_pool_t *pool = &p_state->pool;
+	uint32_t row = *slot;
+	event_range_t *entry = &p_state->ranges[pool->code[row]];
+	pool->callback[row] = event_dead;
+	pool->listener[row] = 0;
+	pool->handle[row] = INVALID_ID;
+	slot_map_remove(&p_state->handles, handle);
+
+	if (++entry->dead == entry->count && !entry->firing) {
+		entry->count = 0;
+		entry->dead = 0;
+	}
+	return true;
+}
+
+b8 event_unreg(uint16_t code, void *listener, p_on_event event) {
+	if (!p_state || code > MAX_EVENT_CODE)
+		return false;
+
+	event_range_t *entry = &p_state->ranges[code];
+	event_pool_t *pool = &p_state->pool;
+	for (uint32_t row = entry->first; row < entry->first + entry->count;
+		 ++row) {
+		if (pool->callback[row] == event && pool->listener[row] == listener)
+			return event_unreg_handle(pool->handle[row]);
 	}
 
 	return false;
 }
 
 b8 event_push(uint16_t code, void *sender, event_context_t ev_context) {
-	if (!p_state)
+	if (!p_state || code > MAX_EVENT_CODE)
 		return false;
 
-	if (p_state->registered[code].events == 0)
+	/* Rows keep their index while the range is firing, but a registration
+	 * can still grow it somewhere else, so 'first' and the columns are read
+	 * every round. Listeners registered from in here wait for the next
+	 * push, the count is taken up front. */
+	event_range_t *entry = &p_state->ranges[code];
+	uint32_t count = entry->count;
+	b8 handled = false;
+	entry->firing++;
+	for (uint32_t i = 0; i < count; ++i) {
+		uint32_t row = entry->first + i;
+		if (p_state->pool.callback[row](code, sender, p_state->pool.listener[row],
+										ev_context)) {
+			handled = true;
+			break;
+		}
+	}
+
+	if (!--entry->firing)
+		event_range_settle(entry);
+	return handled;
+}
+
+b8 event_post(uint16_t code, void *sender, event_context_t ev_context) {
+	if (!p_state)
 		return false;
 
-	uint64_t count = dyn_array_length(p_state->registered[code].events);
-	for (uint64_t i = 0; i < count; ++i) {
-		register_event_t e = p_state->registered[code].events[i];
-		if (e.callback(code, sender, e.listener, ev_context))
+	uint8_t policy = code <= MAX_EVENT_CODE ? p_state->coalesce[code]
+											: EVENT_COALESCE_NONE;
+	if (policy != EVENT_COALESCE_NONE) {
+		uint32_t index = p_state->pending[code];
+		if (index != INVALID_ID) {
+			queued_event_t *queued = &p_state->queue[p_state->write][index];
+			queued->sender = sender;
+			if (policy == EVENT_COALESCE_LAST) {
+				queued->context = ev_context;
+			} else {
+				/* unsigned lanes, wrapping adds give the same bits */
+				for (uint8_t i = 0; i < 4; ++i)
+					queued->context.data.u32[i] += ev_context.data.u32[i];
+			}
 			return true;
+		}
 	}
 
-	return false;
+	queued_event_t queued;
+	queued.code = code;
+	queued.sender = sender;
+	queued.context = ev_context;
+
+	/* A push that could not grow the queue leaves its length alone. */
+	uint64_t index = dyn_array_length(p_state->queue[p_state->write]);
+	dyn_array_push(p_state->queue[p_state->write], queued);
+	if (dyn_array_length(p_state->queue[p_state->write]) == index) {
+		ar_ERROR("event_post - queue full, event %u dropped", code);
+		return false;
+	}
+
+	if (policy != EVENT_COALESCE_NONE)
+		p_state->pending[code] = (uint32_t)index;
+	return true;
+}
+
+void event_coalesce_set(uint16_t code, event_coalesce_t policy) {
+	if (!p_state || code > MAX_EVENT_CODE)
+		return;
+
+	/* Already queued posts keep the policy they were queued under, a new
+	 * one starts a fresh entry. */
+	p_state->coalesce[code] = (uint8_t)policy;
+	p_state->pending[code] = INVALID_ID;
+}
+
+uint32_t event_dispatch(void) {
+	if (!p_state || p_state->dispatching)
+		return 0;
+
+	queued_event_t *queue = p_state->queue[p_state->write];
+	uint32_t count = (uint32_t)dyn_array_length(queue);
+	if (!count)
+		return 0;
+
+	/* Flip before any listener runs, what they post is next frame's. */
+	p_state->write ^= 1;
+	for (uint32_t i = 0; i < count; ++i) {
+		if (queue[i].code <= MAX_EVENT_CODE)
+			p_state->pending[queue[i].code] = INVALID_ID;
+	}
+
+	p_state->dispatching = true;
+	for (uint32_t i = 0; i < count; ++i)
+		event_push(queue[i].code, queue[i].sender, queue[i].context);
+	p_state->dispatching = false;
+
+	dyn_array_clear(queue);
+	return count;
 }
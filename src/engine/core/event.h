@@ -42,11 +42,43 @@ typedef enum event_code_t {
     MAX_EVENT_CODE              = 0xFF
 } event_code_t;
 
+/* What event_post does with several posts of one code inside a frame. */
+typedef enum event_coalesce_t {
+	EVENT_COALESCE_NONE = 0x00, // every post dispatched, in order
+	EVENT_COALESCE_LAST,        // one dispatch, with the newest data
+	EVENT_COALESCE_ACCUMULATE   // one dispatch, i32 lanes summed
+} event_coalesce_t;
+
 void event_init(uint64_t *memory_require, void *state);
 void event_shut(void *state);
 
-b8   event_reg(uint16_t code, void *listener, p_on_event event);
+/* Handle for event_unreg_handle, INVALID_ID when the code is out of range
+ * or the listener limit is hit. Higher priority listeners run first, equal
+ * ones in registration order; event_reg registers at 0. Registering the
+ * same pair twice gets it called twice. Listeners may register and unregister
+ * from inside a dispatch: one registered there is first called on the next
+ * push of its code. */
+uint32_t event_reg(uint16_t code, void *listener, p_on_event event);
+uint32_t event_reg_priority(uint16_t code, void *listener, p_on_event event,
+                            int16_t priority);
+
+b8   event_unreg_handle(uint32_t handle);
+/* Looks the pair up among the code's listeners, prefer the handle. */
 b8   event_unreg(uint16_t code, void *listener, p_on_event event);
+
+/* Dispatch right away, true when a listener handled it. */
 b8   event_push(uint16_t code, void *sender, event_context_t ev_context);
 
+/* Queue for the next event_dispatch, coalesced following the code's policy.
+ * A coalesced event keeps the queue position of its first post. Resize and
+ * mouse move default to LAST, mouse wheel to ACCUMULATE. False when the
+ * queue could not grow and the post was dropped. */
+b8   event_post(uint16_t code, void *sender, event_context_t ev_context);
+void event_coalesce_set(uint16_t code, event_coalesce_t policy);
+
+/* Dispatch everything posted so far, once per frame from application_run.
+ * Posts made by listeners wait for the next call. Returns the number of
+ * events dispatched. */
+uint32_t event_dispatch(void);
+
 #endif //__EVENT_H__
@@ -58,7 +58,7 @@ void input_process_key(keys key, b8 pressed) {
 
 		event_context_t ec;
 		ec.data.u16[0] = key;
-		event_push(pressed ? EVENT_CODE_KEY_PRESSED : EVENT_CODE_KEY_RELEASE, 0, ec);
+		event_post(pressed ? EVENT_CODE_KEY_PRESSED : EVENT_CODE_KEY_RELEASE, 0, ec);
 	}
 }
 
@@ -68,7 +68,7 @@ void input_process_button(buttons button, b8 pressed) {
 
 		event_context_t ec;
 		ec.data.u16[0] = button;
-		event_push(pressed ? EVENT_CODE_BUTTON_PRESSED : EVENT_CODE_BUTTON_RELEASE, 0, ec);
+		event_post(pressed ? EVENT_CODE_BUTTON_PRESSED : EVENT_CODE_BUTTON_RELEASE, 0, ec);
 		
 	}
 }
@@ -81,7 +81,7 @@ void input_process_mouse_move(int16_t x, int16_t y) {
 		event_context_t ec;
 		ec.data.u16[0] = (uint16_t)x;
 		ec.data.u16[1] = (uint16_t)y;
-		event_push(EVENT_CODE_MOUSE_MOVE, 0, ec);
+		event_post(EVENT_CODE_MOUSE_MOVE, 0, ec);
 	}
 }
 
@@ -89,9 +89,11 @@ void input_process_mouse_wheel(int8_t z_delta) {
 	p_state->mouse_current.mouse_wheel_delta = z_delta;
 
 	if (z_delta) {
-		event_context_t ec;
-		ec.data.u8[0] = (uint8_t)z_delta;
-		event_push(EVENT_CODE_MOUSE_WHEEL, 0, ec);
+		/* i32 so a frame's worth of notches can add up, the low byte still
+		 * reads as the old int8 delta */
+		event_context_t ec = {0};
+		ec.data.i32[0] = z_delta;
+		event_post(EVENT_CODE_MOUSE_WHEEL, 0, ec);
 	}
 }
 
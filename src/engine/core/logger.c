@@ -4,6 +4,7 @@
 
 #include "engine/platform/filesystem.h"
 #include "engine/memory/memory.h"
+#include "engine/memory/scratch.h"
 
 #define LENGTH 32000
 
@@ -152,15 +153,30 @@ void log_output(log_type_t type, const char *message, ...) {
 
 	b8 is_error = type < LOG_TYPE_ERROR;
 
-	char buffer[LENGTH];
-	memory_zero(buffer, sizeof(buffer));
+	/* Big enough for anything, and off the C stack of whatever thread is
+	 * logging. If scratch is gone the message gets cut short instead. */
+	char fallback[256];
+	scratch_t scratch = scratch_begin();
+	char *buffer = scratch_alloc(&scratch, LENGTH);
+	uint64_t length = LENGTH;
+	if (!buffer) {
+		buffer = fallback;
+		length = sizeof(fallback);
+	}
+
+	/* Prefix first, then the message behind it, keeping a byte back for the
+	 * newline. Everything stays inside 'length', whichever buffer it is. */
+	uint64_t used = string_length(type_string[type]);
+	memory_copy(buffer, type_string[type], used);
 
 	va_list p_arg;
 	va_start(p_arg, message);
-	vsprintf(buffer, message, p_arg);
+	vsnprintf(buffer + used, length - used - 1, message, p_arg);
 	va_end(p_arg);
 
-	string_format(buffer, "%s%s\n", type_string[type],buffer);
+	used += string_length(buffer + used);
+	buffer[used] = '\n';
+	buffer[used + 1] = 0;
 
 	if (is_error) {
 		console_write_error(buffer, type);
@@ -170,4 +186,5 @@ void log_output(log_type_t type, const char *message, ...) {
 
 	// save file to computer
 	append_to_log_file(buffer);
+	scratch_end(scratch);
 }
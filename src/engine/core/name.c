@@ -0,0 +1,244 @@
+#include "engine/core/name.h"
+
+#include "engine/container/dyn_array.h"
+#include "engine/container/hashtable.h"
+#include "engine/core/ar_strings.h"
+#include "engine/core/logger.h"
+#include "engine/memory/memory.h"
+#include "engine/memory/scratch.h"
+
+/* Sized for the first names, the table grows on its own past that. */
+#define NAME_INITIAL_COUNT 1024
+
+typedef struct name_entry_t {
+	uint64_t hash;
+	char *text; // spelling first interned
+} name_entry_t;
+
+typedef struct name_state_t {
+	hashtable_t table;     // lower case text -> atom
+	name_entry_t *entries; // entry of atom n at n - 1
+} name_state_t;
+
+static name_state_t *p_state = 0;
+
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+uint64_t name_hash_text(const char *text) {
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (const unsigned char *us = (const unsigned char *)text; *us; us++) {
+		hash ^= *us;
+		hash *= 0x100000001B3ull;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+/* Lower case copy of 'str' in scratch, the table key. */
+char *name_lower(scratch_t *scratch, const char *str) {
+	uint64_t length = string_length(str);
+	char *lower = scratch_alloc(scratch, length + 1);
+	if (!lower)
+		return 0;
+
+	for (uint64_t i = 0; i <= length; ++i)
+		lower[i] = (char)tolower((unsigned char)str[i]);
+	return lower;
+}
+
+name_t name_lookup(const char *str, b8 add) {
+	if (!p_state || !str || !str[0])
+		return NAME_NONE;
+
+	scratch_t scratch = scratch_begin();
+	char *lower = name_lower(&scratch, str);
+	if (!lower) {
+		ar_ERROR("name - no scratch left for '%s'", str);
+		scratch_end(scratch);
+		return NAME_NONE;
+	}
+
+	name_t name = NAME_NONE;
+	hashtable_get(&p_state->table, lower, &name);
+	if (name == NAME_NONE && add) {
+		name_entry_t entry;
+		entry.hash = name_hash_text(lower);
+		entry.text = string_duplicate(str);
+		if (!entry.text) {
+			ar_ERROR("name - unable to copy '%s'", str);
+			scratch_end(scratch);
+			return NAME_NONE;
+		}
+
+		/* A failed grow leaves the length where it was. */
+		uint64_t length = dyn_array_length(p_state->entries);
+		dyn_array_push(p_state->entries, entry);
+		name = (name_t)dyn_array_length(p_state->entries);
+		if (name == length || !hashtable_set(&p_state->table, lower, &name)) {
+			ar_ERROR("name - unable to intern '%s'", str);
+			if (name != length)
+				dyn_array_pop(p_state->entries, &entry);
+			memory_free(entry.text, string_length(entry.text) + 1,
+						MEMTAG_STRING);
+			name = NAME_NONE;
+		}
+	}
+
+	scratch_end(scratch);
+	return name;
+}
+
+name_entry_t *name_entry(name_t name) {
+	if (!p_state || name == NAME_NONE ||
+		name > dyn_array_length(p_state->entries))
+		return 0;
+
+	return &p_state->entries[name - 1];
+}
+
+uint32_t name_map_home(name_map_t *map, name_t name) {
+	uint32_t mix = name * 0x9E3779B1u;
+	return (mix ^ (mix >> 16)) & (map->capacity - 1);
+}
+
+/* Slot holding 'name', or the empty slot ending its probe. */
+uint32_t name_map_probe(name_map_t *map, name_t name) {
+	uint32_t mask = map->capacity - 1;
+	uint32_t index = name_map_home(map, name);
+	while (map->slots[index].name != NAME_NONE &&
+		   map->slots[index].name != name)
+		index = (index + 1) & mask;
+	return index;
+}
+
+uint32_t name_map_capacity(uint32_t max_count) {
+	uint32_t capacity = 16;
+	while (capacity < max_count * 2)
+		capacity <<= 1;
+	return capacity;
+}
+/* ========================================================================== */
+/* ========================================================================== */
+
+void name_init(uint64_t *memory_require, void *state) {
+	uint64_t struct_req = sizeof(name_state_t);
+	uint64_t table_req =
+		hashtable_memory_require(sizeof(name_t), NAME_INITIAL_COUNT);
+	*memory_require = struct_req + table_req;
+
+	if (!state)
+		return;
+
+	p_state = state;
+	hashtable_init(sizeof(name_t), NAME_INITIAL_COUNT,
+				   (char *)state + struct_req, false, &p_state->table);
+	p_state->entries = dyn_array_reserved(name_entry_t, NAME_INITIAL_COUNT);
+
+	ar_INFO("Name System Initialized");
+}
+
+void name_shut(void *state) {
+	(void)state;
+
+	if (p_state) {
+		uint64_t count = dyn_array_length(p_state->entries);
+		for (uint64_t i = 0; i < count; ++i) {
+			char *text = p_state->entries[i].text;
+			memory_free(text, string_length(text) + 1, MEMTAG_STRING);
+		}
+
+		dyn_array_destroy(p_state->entries);
+		hashtable_shut(&p_state->table);
+	}
+
+	p_state = 0;
+}
+
+name_t name_intern(const char *str) {
+	return name_lookup(str, true);
+}
+
+name_t name_find(const char *str) {
+	return name_lookup(str, false);
+}
+
+const char *name_string(name_t name) {
+	name_entry_t *entry = name_entry(name);
+	return entry ? entry->text : "";
+}
+
+uint64_t name_hash(name_t name) {
+	name_entry_t *entry = name_entry(name);
+	return entry ? entry->hash : 0;
+}
+
+uint32_t name_count(void) {
+	return p_state ? (uint32_t)dyn_array_length(p_state->entries) : 0;
+}
+
+uint64_t name_map_memory_require(uint32_t max_count) {
+	return sizeof(name_map_slot_t) * name_map_capacity(max_count);
+}
+
+void name_map_init(uint32_t max_count, void *memory, name_map_t *map) {
+	map->capacity = name_map_capacity(max_count);
+	map->count = 0;
+	map->max_count = max_count;
+	map->slots = memory;
+	memory_zero(map->slots, sizeof(name_map_slot_t) * map->capacity);
+}
+
+uint32_t name_map_get(name_map_t *map, name_t name) {
+	if (name == NAME_NONE)
+		return INVALID_ID;
+
+	name_map_slot_t *slot = &map->slots[name_map_probe(map, name)];
+	return slot->name == name ? slot->value : INVALID_ID;
+}
+
+b8 name_map_set(name_map_t *map, name_t name, uint32_t value) {
+	if (name == NAME_NONE)
+		return false;
+
+	name_map_slot_t *slot = &map->slots[name_map_probe(map, name)];
+	if (slot->name == NAME_NONE) {
+		if (map->count >= map->max_count)
+			return false;
+
+		slot->name = name;
+		map->count++;
+	}
+
+	slot->value = value;
+	return true;
+}
+
+b8 name_map_erase(name_map_t *map, name_t name) {
+	if (name == NAME_NONE)
+		return false;
+
+	uint32_t mask = map->capacity - 1;
+	uint32_t hole = name_map_probe(map, name);
+	if (map->slots[hole].name != name)
+		return false;
+
+	/* Shift the rest of the run back over the hole, no tombstones. An entry
+	 * moves when its home is not between the hole and where it sits. */
+	for (uint32_t index = (hole + 1) & mask;
+		 map->slots[index].name != NAME_NONE; index = (index + 1) & mask) {
+		uint32_t home = name_map_home(map, map->slots[index].name);
+		if (((index - home) & mask) >= ((index - hole) & mask)) {
+			map->slots[hole] = map->slots[index];
+			hole = index;
+		}
+	}
+
+	map->slots[hole].name = NAME_NONE;
+	map->count--;
+	return true;
+}
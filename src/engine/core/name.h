@@ -0,0 +1,58 @@
+#ifndef __NAME_H__
+#define __NAME_H__
+
+#include "engine/define.h"
+
+/* Interned resource names. name_intern maps a string to a 32 bit atom that
+ * stays the same for the whole run, so resources keep an atom instead of a
+ * name buffer and compare names as integers. Atoms ignore case: "Paving"
+ * and "paving" are one atom, which keeps the spelling it was first interned
+ * with for name_string (file lookups need it). Every atom also carries a 64
+ * bit hash of its lower case text, computed once at intern time.
+ *
+ * Atoms are never released. Main thread only, like the resource systems. */
+
+typedef uint32_t name_t;
+
+#define NAME_NONE 0
+
+void name_init(uint64_t *memory_require, void *state);
+void name_shut(void *state);
+
+/* NAME_NONE for a null or empty string. */
+name_t name_intern(const char *str);
+
+/* Atom of a string interned before, NAME_NONE otherwise. */
+name_t name_find(const char *str);
+
+/* "" for NAME_NONE. */
+const char *name_string(name_t name);
+uint64_t name_hash(name_t name);
+uint32_t name_count(void);
+
+/* Fixed size map from atom to a 32 bit value (a registry handle), for the
+ * systems that look resources up by name. Linear probing over at least twice
+ * the slots it was sized for, so a probe is a few integer compares. */
+typedef struct name_map_slot_t {
+	name_t name;
+	uint32_t value;
+} name_map_slot_t;
+
+typedef struct name_map_t {
+	uint32_t capacity; // slots, a power of two
+	uint32_t count;
+	uint32_t max_count;
+	name_map_slot_t *slots;
+} name_map_t;
+
+uint64_t name_map_memory_require(uint32_t max_count);
+void name_map_init(uint32_t max_count, void *memory, name_map_t *map);
+
+/* INVALID_ID when the name is not in the map. */
+uint32_t name_map_get(name_map_t *map, name_t name);
+
+/* False when the map already holds max_count names. */
+b8 name_map_set(name_map_t *map, name_t name, uint32_t value);
+b8 name_map_erase(name_map_t *map, name_t name);
+
+#endif //__NAME_H__
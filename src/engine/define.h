@@ -33,19 +33,41 @@ typedef _Bool b8;
 #endif
 
 // Inline
-#if defined(__clang__) || defined(__gcc__)
+#if defined(__clang__)
 	#define _arinline static __attribute__((always_inline)) inline
 	#define _arnoinline __attribute__((noinline))
+#elif defined(__GNUC__)
+	// gcc refuse to force inline variadic helper like string_format
+	#define _arinline static inline
+	#define _arnoinline __attribute__((noinline))
 #elif defined(_MSC_VER)
 	#define _arinline __forceinline
 	#define _arnoinline __declspec(noinline)
 #endif
 
+// Thread local
+#ifdef _MSC_VER
+	#define _arthreadlocal __declspec(thread)
+#else
+	#define _arthreadlocal __thread
+#endif
+
 // SIMD
+#define AR_SIMD_ALIGNMENT 0x10 // 16
 #ifdef _MSC_VER
 	#define _aralignas __declspec(align(16))
+	#define _aralignof(type) __alignof(type)
 #else
 	#define _aralignas __attribute__((aligned(16)))
+	#define _aralignof(type) __alignof__(type)
+#endif
+
+// Cache line, keeps fields written by different threads off each other's line
+#define AR_CACHE_LINE 0x40 // 64
+#ifdef _MSC_VER
+	#define _aralignline __declspec(align(AR_CACHE_LINE))
+#else
+	#define _aralignline __attribute__((aligned(AR_CACHE_LINE)))
 #endif
 
 #endif //__DEFINE_H__
@@ -25,7 +25,9 @@
  Messaging: Event System
 --------------------------
 - Subsystems communicate using the event system.
-- Events are pushed and processed: `event_push()`, `event_process()`.
+- Platform and input events are queued with `event_post()` and dispatched
+  once per frame by `event_dispatch()`, bursts coalesced per code.
+- `event_push()` still dispatches on the spot.
 - Example: WINDOW_RESIZE, APP_QUIT, etc.
 
  Runtime Flow (Simplified)
@@ -38,7 +40,8 @@ main()
       │    └── game_init()
 
 main_loop:
-  ├── platform_push()         ← input + OS events
+  ├── platform_push()         ← input + OS events, posted
+  ├── event_dispatch()        ← the frame's events, once
   ├── input_update()
   ├── game.update()
   └── game.render()
@@ -11,7 +11,8 @@
 extern b8 game_entry_point(game_entry *game);
 
 int main(void) {
-	game_entry game_inst;
+	/* Config fields the game leaves alone stay 0. */
+	game_entry game_inst = {0};
 
 	if (!game_entry_point(&game_inst)) {
 		ar_FATAL("Could not access game entry point");
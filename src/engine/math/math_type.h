@@ -31,6 +31,16 @@ typedef union _aralignas {
 
 typedef vec4 quat;
 
+/* Build fails here if one of the SIMD types lost its alignment. */
+typedef char math_align_vec3[_aralignof(vec3) == AR_SIMD_ALIGNMENT ? 1 : -1];
+typedef char math_align_vec4[_aralignof(vec4) == AR_SIMD_ALIGNMENT ? 1 : -1];
+typedef char math_align_mat4[_aralignof(mat4) == AR_SIMD_ALIGNMENT ? 1 : -1];
+
+/* Heap blocks from memory_alloc always start on AR_SIMD_ALIGNMENT. For
+ * debug checks on math data handed in from anywhere else. */
+#define math_is_aligned(ptr)                                                   \
+	(((uintptr_t)(ptr) & (AR_SIMD_ALIGNMENT - 1)) == 0)
+
 typedef struct vertex_3d {
     vec3 position;
     vec2 texcoord;
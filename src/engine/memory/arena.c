@@ -2,14 +2,45 @@
 #include "engine/memory/memory.h"
 #include "engine/core/logger.h"
 #include "engine/core/assertion.h"
+#include "engine/platform/platform.h"
 
 #define DEFAULT_ALIGNMENT 0x10 // 16
 
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+b8 arena_commit_to(arena_allocator_t *allocator, uint64_t end) {
+	uint64_t chunk = allocator->commit_chunk;
+	uint64_t target = ((end + chunk - 1) / chunk) * chunk;
+	if (target > allocator->total_size)
+		target = allocator->total_size;
+
+	if (!platform_commit((uint8_t *)allocator->memory + allocator->committed,
+						 target - allocator->committed)) {
+		ar_ERROR("Arena Allocator - failed to commit %lluB",
+				 target - allocator->committed);
+		return false;
+	}
+
+	/* Tag stats follow what is committed, not the reserve. */
+	memory_track_free(allocator->committed, MEMTAG_ARENA_ALLOCATOR);
+	memory_track_alloc(target, MEMTAG_ARENA_ALLOCATOR);
+	allocator->committed = target;
+	return true;
+}
+/* ========================================================================== */
+/* ========================================================================== */
+
 void arena_init(uint64_t total_size, void *memory, arena_allocator_t *allocator) {
 	if (allocator) {
 		allocator->total_size = total_size;
+		allocator->prev_offset = 0;
 		allocator->curr_offset = 0;
 		allocator->own_memory = memory == 0;
+		allocator->virtual_memory = false;
+		allocator->huge_pages = false;
+		allocator->committed = total_size;
+		allocator->commit_chunk = 0;
+		allocator->temp_count = 0;
 
 		if (memory) {
 			allocator->memory = memory;
@@ -19,10 +50,47 @@ void arena_init(uint64_t total_size, void *memory, arena_allocator_t *allocator)
 	}
 }
 
+b8 arena_init_virtual(uint64_t reserve_size, b8 huge_pages,
+                      arena_allocator_t *allocator) {
+	if (!allocator)
+		return false;
+
+	platform_page_mode_t mode =
+		huge_pages ? PLATFORM_PAGES_HUGE : PLATFORM_PAGES_NORMAL;
+	uint64_t chunk = huge_pages ? platform_huge_page_size() : KIBIBYTES(64);
+	reserve_size = ((reserve_size + chunk - 1) / chunk) * chunk;
+
+	void *memory = platform_reserve(reserve_size, mode);
+	if (!memory) {
+		ar_ERROR("Arena Allocator - unable to reserve %lluB", reserve_size);
+		return false;
+	}
+
+	allocator->total_size = reserve_size;
+	allocator->prev_offset = 0;
+	allocator->curr_offset = 0;
+	allocator->memory = memory;
+	allocator->own_memory = false;
+	allocator->virtual_memory = true;
+	allocator->huge_pages = huge_pages;
+	allocator->committed = 0;
+	allocator->commit_chunk = chunk;
+	allocator->temp_count = 0;
+
+	/* Shows up in the tag stats as one block that grows with the commits. */
+	memory_track_alloc(0, MEMTAG_ARENA_ALLOCATOR);
+	return true;
+}
+
 void arena_shut(arena_allocator_t *allocator) {
 	if (allocator) {
 		allocator->curr_offset = 0;
 
+		if (allocator->virtual_memory && allocator->memory) {
+			memory_track_free(allocator->committed, MEMTAG_ARENA_ALLOCATOR);
+			platform_release(allocator->memory, allocator->total_size);
+		}
+
 		if (allocator->own_memory && allocator->memory)
 		  	memory_free(allocator->memory, allocator->total_size,
 					  	MEMTAG_ARENA_ALLOCATOR);
@@ -30,6 +98,8 @@ void arena_shut(arena_allocator_t *allocator) {
         allocator->memory = 0;
 		allocator->total_size = 0;
 		allocator->own_memory = 0;
+		allocator->virtual_memory = 0;
+		allocator->committed = 0;
 	}
 }
 
@@ -59,6 +129,10 @@ void *arena_allocate_align(arena_allocator_t *allocator, uint64_t size,
         return 0;
     }
 
+	if (allocator->curr_offset + total_size > allocator->committed &&
+		!arena_commit_to(allocator, allocator->curr_offset + total_size))
+		return 0;
+
 	allocator->prev_offset = allocator->curr_offset;
 	allocator->curr_offset += total_size;
 
@@ -67,8 +141,50 @@ void *arena_allocate_align(arena_allocator_t *allocator, uint64_t size,
 
 void arena_free_all(arena_allocator_t *allocator) {
 	if (allocator && allocator->memory) {
+		allocator->prev_offset = 0;
 		allocator->curr_offset = 0;
+
+		if (allocator->virtual_memory) {
+			platform_decommit(allocator->memory, allocator->committed);
+			memory_track_free(allocator->committed, MEMTAG_ARENA_ALLOCATOR);
+			memory_track_alloc(0, MEMTAG_ARENA_ALLOCATOR);
+			allocator->committed = 0;
+			return;
+		}
+
 		memory_zero(allocator->memory, allocator->total_size);
 	}
 }
 
+void arena_reset(arena_allocator_t *allocator) {
+	if (allocator) {
+		allocator->prev_offset = 0;
+		allocator->curr_offset = 0;
+	}
+}
+
+arena_temp_t arena_temp_begin(arena_allocator_t *allocator) {
+	arena_temp_t temp = {0};
+	if (allocator) {
+		temp.arena = allocator;
+		temp.prev_offset = allocator->prev_offset;
+		temp.curr_offset = allocator->curr_offset;
+		allocator->temp_count++;
+	}
+	return temp;
+}
+
+void arena_temp_end(arena_temp_t temp) {
+	arena_allocator_t *allocator = temp.arena;
+	if (!allocator)
+		return;
+
+	ar_assert_msg(allocator->temp_count > 0,
+				  "arena_temp_end without a matching arena_temp_begin");
+	ar_assert_msg(temp.curr_offset <= allocator->curr_offset,
+				  "arena temp scopes ended out of order");
+
+	allocator->prev_offset = temp.prev_offset;
+	allocator->curr_offset = temp.curr_offset;
+	allocator->temp_count--;
+}
@@ -10,14 +10,44 @@ typedef struct arena_allocator_t {
 	void *memory;
 	uint8_t *buff;
 	b8 own_memory;
+
+	/* Virtual arenas: total_size is reserved address space, pages get
+	 * committed in commit_chunk steps as the offset reaches them. */
+	b8 virtual_memory;
+	b8 huge_pages;
+	uint64_t committed;
+	uint64_t commit_chunk;
+	uint32_t temp_count;
 } arena_allocator_t;
 
+/* Saved offset to roll the arena back to, scopes nest like a stack. */
+typedef struct arena_temp_t {
+	arena_allocator_t *arena;
+	uint64_t prev_offset;
+	uint64_t curr_offset;
+} arena_temp_t;
+
 void arena_init(uint64_t total_size, void *memory,
                       arena_allocator_t *allocator);
+
+/* Arena on its own address space straight from the platform rather than
+ * the heap. Only 'reserve_size' of address space up front, it commits as it
+ * grows, so a generous reserve costs nothing until used. 'huge_pages' asks
+ * for huge page backing. */
+b8 arena_init_virtual(uint64_t reserve_size, b8 huge_pages,
+                      arena_allocator_t *allocator);
 void arena_shut(arena_allocator_t *allocator);
 void *arena_allocate(arena_allocator_t *allocator, uint64_t size);
 void *arena_allocate_align(arena_allocator_t *allocator, uint64_t size,
                            uintptr_t alignment);
+/* Empty and cleared. A virtual arena hands its pages back instead of
+ * clearing them, they read as zero once committed again. */
 void arena_free_all(arena_allocator_t *allocator);
 
+/* Rewind to empty without touching the memory. */
+void arena_reset(arena_allocator_t *allocator);
+
+arena_temp_t arena_temp_begin(arena_allocator_t *allocator);
+void arena_temp_end(arena_temp_t temp);
+
 #endif //__ARENA_ALLOCATOR_H__
@@ -3,17 +3,88 @@
 #include "engine/container/free_list.h"
 #include "engine/core/logger.h"
 #include "engine/memory/memory.h"
+#include "engine/memory/tlsf.h"
+#include "engine/platform/platform.h"
+
+/* Lazy heaps commit in steps of this many bytes by default, whole pages at
+ * a time. */
+#define COMMIT_CHUNK KIBIBYTES(64)
 
 typedef struct dyn_alloc_state_t {
+	dyn_alloc_type_t type;
+	b8 lazy_commit;
 	uint64_t total_size;
+	uint64_t block_size; // size of mem_block, engine bookkeeping included
+	uint64_t header_size; // this state plus freelist nodes
+	uint64_t committed; // bytes of mem_block backed so far
+	uint64_t commit_chunk;
+	uint64_t pool_size; // bytes TLSF currently manages
 	freelist_t freelist;
+	tlsf_t tlsf;
 	void *freelist_block;
 	void *mem_block;
 } dyn_alloc_state_t;
 
-b8 dyn_alloc_init(uint64_t total_size, uint64_t *mem_require,
-                         void *memory, dyn_alloc_t *dyn_alloc) {
-	if (total_size < 1) {
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+/* Freelist ranges are whole DYN_ALLOC_ALIGNMENT units, so every block starts
+ * on one. Alloc, free and resize all round the same way. */
+_arinline uint64_t freelist_size(uint64_t size) {
+	return (size + DYN_ALLOC_ALIGNMENT - 1) & ~(uint64_t)(DYN_ALLOC_ALIGNMENT - 1);
+}
+
+b8 dyn_alloc_commit_to(dyn_alloc_state_t *state, uint64_t end) {
+	if (end <= state->committed)
+		return true;
+
+	/* Steps end on chunk boundaries of the address, not of the offset, so
+	 * a huge page sized chunk lines up with the huge pages themselves. */
+	uintptr_t base = (uintptr_t)state->mem_block;
+	uint64_t chunk = state->commit_chunk;
+	uint64_t target = ((base + end + chunk - 1) & ~(uintptr_t)(chunk - 1)) - base;
+	if (target > state->block_size)
+		target = state->block_size;
+
+    if (!platform_commit((char *)state->mem_block + state->committed,
+                         target - state->committed)) {
+        ar_ERROR("dyn_alloc - failed to commit %lluB of heap",
+                 target - state->committed);
+        return false;
+    }
+
+	state->committed = target;
+	return true;
+}
+
+/* Push the TLSF pool further into the reservation, far enough that a block
+ * of 'size' fits after rounding to its bin. */
+b8 dyn_alloc_grow_pool(dyn_alloc_state_t *state, uint64_t size) {
+	uint64_t remain = state->total_size - state->pool_size;
+	if (!state->lazy_commit || !remain)
+		return false;
+
+	uint64_t grow = size + (size >> 4) + 64;
+	grow = ((grow + COMMIT_CHUNK - 1) / COMMIT_CHUNK) * COMMIT_CHUNK;
+	if (grow > remain)
+		grow = remain;
+
+	uint64_t require = 0;
+	tlsf_init(state->pool_size + grow, &require, 0, 0);
+	if (!dyn_alloc_commit_to(state, require))
+		return false;
+
+	if (!tlsf_grow(&state->tlsf, grow))
+		return false;
+
+	state->pool_size += grow;
+	return true;
+}
+/* ========================================================================== */
+/* ========================================================================== */
+
+b8 dyn_alloc_init(dyn_alloc_config_t config, uint64_t *mem_require,
+                  void *memory, dyn_alloc_t *dyn_alloc) {
+	if (config.total_size < 1) {
 		ar_ERROR("dyn_alloc_init - cannot have total size of 0.");
 		return false;
 	}
@@ -23,33 +94,83 @@ b8 dyn_alloc_init(uint64_t total_size, uint64_t *mem_require,
 		return false;
 	}
 
+	if (config.commit_chunk & (config.commit_chunk - 1)) {
+		ar_ERROR("dyn_alloc_init - commit chunk %llu is not a power of two",
+				 config.commit_chunk);
+		return false;
+	}
+
+	/* Freelist keeps its nodes apart from the heap, TLSF keeps its control
+	 * block and block headers inside it. */
 	uint64_t freelist_req = 0;
-	freelist_init(total_size, &freelist_req, 0, 0);
-	*mem_require = freelist_req + sizeof(dyn_alloc_state_t) + total_size;
+	uint64_t block_req = config.total_size;
+	uint64_t page_size = platform_page_size();
+	if (config.type == DYN_ALLOC_TLSF) {
+		tlsf_init(config.total_size, &block_req, 0, 0);
+	} else {
+		/* Freelist aligns offsets, so the heap behind the nodes starts on a
+		 * page to keep them aligned as addresses too. */
+		freelist_init(config.total_size, DYN_ALLOC_ALIGNMENT, &freelist_req, 0, 0);
+		uint64_t header = sizeof(dyn_alloc_state_t) + freelist_req;
+		header = (header + page_size - 1) & ~(page_size - 1);
+		freelist_req = header - sizeof(dyn_alloc_state_t);
+	}
+	*mem_require = freelist_req + sizeof(dyn_alloc_state_t) + block_req;
 
 	if (!memory)
 		return true;
 
+	uint64_t header_size = sizeof(dyn_alloc_state_t) + freelist_req;
+	if (config.lazy_commit && !platform_commit(memory, header_size)) {
+		ar_ERROR("dyn_alloc_init - failed to commit allocator header");
+		return false;
+	}
+
 	dyn_alloc->memory = memory;
 	dyn_alloc_state_t *state = dyn_alloc->memory;
-	state->total_size = total_size;
+	state->type = config.type;
+	state->lazy_commit = config.lazy_commit;
+	state->total_size = config.total_size;
+	state->block_size = block_req;
+	state->header_size = header_size;
+	state->committed = config.lazy_commit ? 0 : block_req;
+	state->commit_chunk = config.commit_chunk ? config.commit_chunk : COMMIT_CHUNK;
+	state->pool_size = config.total_size;
     state->freelist_block =
         (void *)((char *)dyn_alloc->memory + sizeof(dyn_alloc_state_t));
     state->mem_block = (void *)((char *)state->freelist_block + freelist_req);
 
-    /* Actual Freelist create */
-    freelist_init(total_size, &freelist_req, state->freelist_block,
-                  &state->freelist);
+	if (config.type == DYN_ALLOC_TLSF) {
+		state->freelist_block = 0;
+
+		/* Lazy pool starts with one chunk and grows on demand. */
+		if (config.lazy_commit && config.total_size > COMMIT_CHUNK)
+			state->pool_size = COMMIT_CHUNK;
 
-    memory_zero(state->mem_block, total_size);
+		uint64_t pool_req = 0;
+		tlsf_init(state->pool_size, &pool_req, 0, 0);
+		if (!dyn_alloc_commit_to(state, pool_req))
+			return false;
+
+		tlsf_init(state->pool_size, &pool_req, state->mem_block, &state->tlsf);
+		return true;
+	}
+
+    /* Actual Freelist create. Nodes live outside the heap, offsets are
+     * committed once they get handed out. */
+    freelist_init(config.total_size, DYN_ALLOC_ALIGNMENT, &freelist_req,
+                  state->freelist_block, &state->freelist);
 	return true;
 }
 
 b8 dyn_alloc_shut(dyn_alloc_t *dyn_alloc) {
 	if (dyn_alloc) {
 		dyn_alloc_state_t *state = dyn_alloc->memory;
-		freelist_shut(&state->freelist);
-		memory_zero(state->mem_block, state->total_size);
+		if (state->type == DYN_ALLOC_TLSF) {
+			tlsf_shut(&state->tlsf);
+		} else {
+			freelist_shut(&state->freelist);
+		}
 		state->total_size = 0;
 		dyn_alloc->memory = 0;
 		return true;
@@ -62,26 +183,79 @@ b8 dyn_alloc_shut(dyn_alloc_t *dyn_alloc) {
 void *dyn_alloc_allocate(dyn_alloc_t *dyn_alloc, uint64_t size) {
 	if (dyn_alloc && size) {
 		dyn_alloc_state_t *state = dyn_alloc->memory;
-		uint64_t offset = 0;
 
-		if (freelist_block_alloc(&state->freelist, size, &offset)) {
-			void *block = (void *)((char *)state->mem_block + offset);
-			return block;
+		if (state->type == DYN_ALLOC_TLSF) {
+			void *block = tlsf_block_alloc(&state->tlsf, size);
+			if (!block && dyn_alloc_grow_pool(state, size))
+				block = tlsf_block_alloc(&state->tlsf, size);
+
+			if (block)
+				return block;
 		} else {
-            ar_ERROR("dyn_alloc_allocate - no blocks of memory large enough to "
-                     "allocate");
-            uint64_t avail = freelist_space_free(&state->freelist);
-            ar_ERROR("Requested Size: %llu, available: %llu", size, avail);
+			uint64_t offset = 0;
+			size = freelist_size(size);
+			if (freelist_block_alloc(&state->freelist, size, &offset)) {
+				if (dyn_alloc_commit_to(state, offset + size)) {
+					void *block = (void *)((char *)state->mem_block + offset);
+					return block;
+				}
 
-			// TODO: Report Fragmentation
-			return 0;
+				freelist_block_free(&state->freelist, size, offset);
+			}
 		}
+
+		ar_ERROR("dyn_alloc_allocate - no blocks of memory large enough to "
+				 "allocate");
+		dyn_alloc_frag_t frag = dyn_alloc_fragmentation(dyn_alloc);
+		ar_ERROR("Requested Size: %llu, available: %llu, largest block: %llu "
+				 "in %llu free blocks (%.1f%% fragmented)",
+				 size, frag.free_space, frag.largest_free, frag.free_blocks,
+				 frag.fragmentation * 100.0f);
+		return 0;
 	}
 
 	ar_ERROR("dyn_alloc_allocate - require a valid allocator & size");
 	return 0;
 }
 
+void *dyn_alloc_allocate_aligned(dyn_alloc_t *dyn_alloc, uint64_t size,
+                                 uint64_t alignment) {
+	if (alignment <= DYN_ALLOC_ALIGNMENT)
+		return dyn_alloc_allocate(dyn_alloc, size);
+
+	if (!dyn_alloc || !size || (alignment & (alignment - 1))) {
+		ar_ERROR("dyn_alloc_allocate_aligned - require a valid allocator, size "
+				 "& power of two alignment (%llu)", alignment);
+		return 0;
+	}
+
+	dyn_alloc_state_t *state = dyn_alloc->memory;
+	if (state->type == DYN_ALLOC_TLSF) {
+		void *block = tlsf_block_alloc_aligned(&state->tlsf, size, alignment);
+		if (!block && dyn_alloc_grow_pool(state, size + alignment))
+			block = tlsf_block_alloc_aligned(&state->tlsf, size, alignment);
+
+		if (block)
+			return block;
+	} else {
+		/* Heap base is only page aligned, anything above would be off. */
+		uint64_t offset = 0;
+		size = freelist_size(size);
+		if (alignment <= platform_page_size() &&
+			freelist_block_alloc_aligned(&state->freelist, size, alignment,
+										 &offset)) {
+			if (dyn_alloc_commit_to(state, offset + size))
+				return (void *)((char *)state->mem_block + offset);
+
+			freelist_block_free(&state->freelist, size, offset);
+		}
+	}
+
+	ar_ERROR("dyn_alloc_allocate_aligned - no block of %lluB on a %lluB "
+			 "boundary", size, alignment);
+	return 0;
+}
+
 b8 dyn_alloc_free(dyn_alloc_t *dyn_alloc, void *block, uint64_t size) {
     if (!dyn_alloc || !block || !size) {
         ar_ERROR("dyn_alloc_free - require both a valid allocator (0x%p) and "
@@ -91,17 +265,24 @@ b8 dyn_alloc_free(dyn_alloc_t *dyn_alloc, void *block, uint64_t size) {
     }
 
     dyn_alloc_state_t *state = dyn_alloc->memory;
-    if ((char *)block < (char *)state->mem_block ||
-        (char *)block > (char *)state->mem_block + state->total_size) {
-        void *end_block = (void *)((char *)state->mem_block + state->total_size);
+    if (!dyn_alloc_contains(dyn_alloc, block)) {
+        void *end_block = (void *)((char *)state->mem_block + state->block_size);
         ar_ERROR("dyn_alloc_free - try to release block (0x%p) outside of "
                  "allocator range (0x%p)-(0x%p)",
                  block, state->mem_block, end_block);
         return false;
     }
 
+	if (state->type == DYN_ALLOC_TLSF) {
+		if (!tlsf_block_free(&state->tlsf, block)) {
+			ar_ERROR("dyn_alloc_free - Failed");
+			return false;
+		}
+		return true;
+	}
+
 	uint64_t offset = (uint64_t)((char *)block - (char *)state->mem_block);
-	if (!freelist_block_free(&state->freelist, size, offset)) {
+	if (!freelist_block_free(&state->freelist, freelist_size(size), offset)) {
 		ar_ERROR("dyn_alloc_free - Failed");
 		return false;
 	}
@@ -109,8 +290,130 @@ b8 dyn_alloc_free(dyn_alloc_t *dyn_alloc, void *block, uint64_t size) {
 	return true;
 }
 
+b8 dyn_alloc_resize(dyn_alloc_t *dyn_alloc, void *block, uint64_t size,
+                    uint64_t new_size) {
+	if (!dyn_alloc || !block || !size || !new_size)
+		return false;
+
+	dyn_alloc_state_t *state = dyn_alloc->memory;
+	if (!dyn_alloc_contains(dyn_alloc, block))
+		return false;
+
+	if (state->type == DYN_ALLOC_TLSF) {
+		if (tlsf_block_resize(&state->tlsf, block, new_size))
+			return true;
+
+		/* Last block before the end of the pool, growing the pool puts the
+		 * room right behind it. */
+		return new_size > size && tlsf_block_at_end(&state->tlsf, block) &&
+			   dyn_alloc_grow_pool(state, new_size - size) &&
+			   tlsf_block_resize(&state->tlsf, block, new_size);
+	}
+
+	uint64_t offset = (uint64_t)((char *)block - (char *)state->mem_block);
+	size = freelist_size(size);
+	new_size = freelist_size(new_size);
+	if (new_size > size && !dyn_alloc_commit_to(state, offset + new_size))
+		return false;
+
+	return freelist_block_resize(&state->freelist, offset, size, new_size);
+}
+
 uint64_t dyn_alloc_free_space(dyn_alloc_t *dyn_alloc) {
 	dyn_alloc_state_t *state = dyn_alloc->memory;
+	if (state->type == DYN_ALLOC_TLSF) {
+		uint64_t unclaimed = state->total_size - state->pool_size;
+		return tlsf_space_free(&state->tlsf) + unclaimed;
+	}
+
 	return freelist_space_free(&state->freelist);
 }
 
+uint64_t dyn_alloc_committed(dyn_alloc_t *dyn_alloc) {
+	dyn_alloc_state_t *state = dyn_alloc->memory;
+	return state->header_size + state->committed;
+}
+
+b8 dyn_alloc_contains(dyn_alloc_t *dyn_alloc, void *block) {
+	dyn_alloc_state_t *state = dyn_alloc->memory;
+	return (char *)block >= (char *)state->mem_block &&
+		   (char *)block < (char *)state->mem_block + state->block_size;
+}
+
+dyn_alloc_frag_t dyn_alloc_fragmentation(dyn_alloc_t *dyn_alloc) {
+	dyn_alloc_frag_t frag = {0};
+	dyn_alloc_state_t *state = dyn_alloc->memory;
+
+	if (state->type == DYN_ALLOC_TLSF) {
+		frag.free_space = tlsf_space_free(&state->tlsf);
+		frag.largest_free = tlsf_largest_free(&state->tlsf);
+		frag.free_blocks = tlsf_free_count(&state->tlsf);
+
+		/* Reserve the pool has not grown into yet is one more free range,
+		 * joined with the free block at the end of the pool if any. */
+		uint64_t unclaimed = state->total_size - state->pool_size;
+		if (unclaimed) {
+			uint64_t tail = tlsf_tail_free(&state->tlsf);
+			if (tail + unclaimed > frag.largest_free)
+				frag.largest_free = tail + unclaimed;
+			if (!tail)
+				frag.free_blocks++;
+			frag.free_space += unclaimed;
+		}
+	} else {
+		frag.free_space = freelist_space_free(&state->freelist);
+		frag.largest_free = freelist_largest_free(&state->freelist);
+		frag.free_blocks = freelist_block_count(&state->freelist);
+	}
+
+	if (frag.free_space)
+		frag.fragmentation =
+			1.0f - (float)frag.largest_free / (float)frag.free_space;
+	return frag;
+}
+
+void *dyn_alloc_relocate(dyn_alloc_t *dyn_alloc, void *block, uint64_t size) {
+	if (!dyn_alloc || !block || !size)
+		return 0;
+
+	dyn_alloc_state_t *state = dyn_alloc->memory;
+	void *moved = 0;
+
+	if (state->type == DYN_ALLOC_TLSF) {
+		/* TLSF picks a fit by size, not by address, so the block it hands
+		 * back may well sit above the one being moved. */
+		moved = tlsf_block_alloc(&state->tlsf, size);
+		if (!moved)
+			return 0;
+
+		if ((char *)moved > (char *)block) {
+			tlsf_block_free(&state->tlsf, moved);
+			return 0;
+		}
+
+		memory_copy(moved, block, size);
+		tlsf_block_free(&state->tlsf, block);
+		return moved;
+	}
+
+	/* Best fit, like TLSF it may land above the block, then it stays.
+	 * Check for a range up front, a failed freelist alloc is loud. */
+	size = freelist_size(size);
+	if (freelist_largest_free(&state->freelist) < size)
+		return 0;
+
+	uint64_t offset = 0;
+	uint64_t old_offset = (uint64_t)((char *)block - (char *)state->mem_block);
+	if (!freelist_block_alloc(&state->freelist, size, &offset))
+		return 0;
+
+	if (offset > old_offset || !dyn_alloc_commit_to(state, offset + size)) {
+		freelist_block_free(&state->freelist, size, offset);
+		return 0;
+	}
+
+	moved = (void *)((char *)state->mem_block + offset);
+	memory_copy(moved, block, size);
+	freelist_block_free(&state->freelist, size, old_offset);
+	return moved;
+}
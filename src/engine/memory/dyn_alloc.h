@@ -3,16 +3,70 @@
 
 #include "engine/define.h"
 
+/* Every block starts on this boundary, enough for the _aralignas math
+ * types. Bigger ones go through dyn_alloc_allocate_aligned. */
+#define DYN_ALLOC_ALIGNMENT 0x10 // 16
+
+typedef enum dyn_alloc_type_t {
+	DYN_ALLOC_FREELIST = 0x00, // best fit, ranges indexed by offset and size
+	DYN_ALLOC_TLSF,            // two-level segregated fit, O(1) alloc/free
+} dyn_alloc_type_t;
+
+typedef struct dyn_alloc_config_t {
+	dyn_alloc_type_t type;
+	uint64_t total_size;
+
+	/* Memory handed to init is only reserved. Pages get committed as the
+	 * heap reaches them instead of all up front. */
+	b8 lazy_commit;
+
+	/* Lazy heaps commit in steps ending on multiples of this, a power of
+	 * two. 0 takes the default 64KiB, huge page backed heaps pass the huge
+	 * page size so every step is whole huge pages. */
+	uint64_t commit_chunk;
+} dyn_alloc_config_t;
+
+typedef struct dyn_alloc_frag_t {
+	uint64_t free_space;   // everything still free, unclaimed reserve included
+	uint64_t largest_free; // biggest single block an allocation can get
+	uint64_t free_blocks;  // number of separate free ranges
+
+	/* 1 - largest_free / free_space. 0 means all free space is one block,
+	 * close to 1 means it is scattered in holes too small to use. */
+	float fragmentation;
+} dyn_alloc_frag_t;
+
 typedef struct dyn_alloc_t {
 	void *memory;
 } dyn_alloc_t;
 
-_arapi b8 dyn_alloc_init(uint64_t total_size, uint64_t *mem_require,
+_arapi b8 dyn_alloc_init(dyn_alloc_config_t config, uint64_t *mem_require,
                          void *memory, dyn_alloc_t *dyn_alloc);
 
 _arapi b8 dyn_alloc_shut(dyn_alloc_t *dyn_alloc);
 _arapi void *dyn_alloc_allocate(dyn_alloc_t *dyn_alloc, uint64_t size);
+
+/* Block starting on 'alignment', a power of two. Freelist heaps go up to
+ * the page size. Freed with dyn_alloc_free like any other block. */
+_arapi void *dyn_alloc_allocate_aligned(dyn_alloc_t *dyn_alloc, uint64_t size,
+                                        uint64_t alignment);
 _arapi b8 dyn_alloc_free(dyn_alloc_t *dyn_alloc, void *block, uint64_t size);
+
+/* Grow or shrink 'block' from 'size' to 'new_size' without moving it.
+ * False when the space after it is taken, the block is left as it was and
+ * the caller has to move it. */
+_arapi b8 dyn_alloc_resize(dyn_alloc_t *dyn_alloc, void *block, uint64_t size,
+                           uint64_t new_size);
+
 _arapi uint64_t dyn_alloc_free_space(dyn_alloc_t *dyn_alloc);
+_arapi uint64_t dyn_alloc_committed(dyn_alloc_t *dyn_alloc);
+_arapi b8 dyn_alloc_contains(dyn_alloc_t *dyn_alloc, void *block);
+_arapi dyn_alloc_frag_t dyn_alloc_fragmentation(dyn_alloc_t *dyn_alloc);
+
+/* Move 'block' to a free range at a lower address if there is one, copying
+ * its contents. Returns the new block, or 0 when it stays where it is. Used
+ * to compact the heap, never grows the pool. */
+_arapi void *dyn_alloc_relocate(dyn_alloc_t *dyn_alloc, void *block,
+                                uint64_t size);
 
 #endif //__DYNAMIC_ALLOCATOR_H__
@@ -0,0 +1,139 @@
+#include "engine/memory/frame_alloc.h"
+
+#include "engine/core/assertion.h"
+#include "engine/core/logger.h"
+#include "engine/memory/memory.h"
+
+#define DEFAULT_ALIGNMENT 0x10 // 16
+
+#ifdef _DEBUG
+/* Sits right before every block in debug builds. */
+typedef struct frame_stamp_t {
+	uint64_t frame_index;
+	uint64_t magic;
+} frame_stamp_t;
+
+#define FRAME_STAMP_MAGIC 0xF4A3E5A1C0DEF00Dull
+#define FRAME_POISON 0xDD
+#endif
+
+b8 frame_alloc_init(uint64_t frame_size, uint8_t buffer_count, void *memory,
+                    frame_alloc_t *allocator) {
+	if (!allocator || !frame_size) {
+		ar_ERROR("frame_alloc_init - require an allocator and a frame size");
+		return false;
+	}
+
+	if (buffer_count < FRAME_ALLOC_MIN_BUFFERS)
+		buffer_count = FRAME_ALLOC_MIN_BUFFERS;
+	if (buffer_count > FRAME_ALLOC_MAX_BUFFERS)
+		buffer_count = FRAME_ALLOC_MAX_BUFFERS;
+
+	allocator->buffer_count = buffer_count;
+	allocator->current = 0;
+	allocator->frame_index = 0;
+	allocator->frame_size = frame_size;
+	allocator->own_memory = memory == 0;
+	allocator->memory = memory;
+
+	/* Nothing in here is read before written, no need to clear it. */
+	if (!memory)
+		allocator->memory = memory_alloc_uninit(frame_size * buffer_count,
+												MEMTAG_ARENA_ALLOCATOR);
+	if (!allocator->memory) {
+		ar_ERROR("frame_alloc_init - failed to get %lluB for %u frames",
+				 frame_size * buffer_count, buffer_count);
+		return false;
+	}
+
+	for (uint8_t i = 0; i < buffer_count; ++i)
+		arena_init(frame_size, (char *)allocator->memory + frame_size * i,
+				   &allocator->arenas[i]);
+
+	return true;
+}
+
+void frame_alloc_shut(frame_alloc_t *allocator) {
+	if (allocator) {
+		for (uint8_t i = 0; i < allocator->buffer_count; ++i)
+			arena_shut(&allocator->arenas[i]);
+
+		if (allocator->own_memory && allocator->memory)
+			memory_free(allocator->memory,
+						allocator->frame_size * allocator->buffer_count,
+						MEMTAG_ARENA_ALLOCATOR);
+
+		allocator->memory = 0;
+		allocator->buffer_count = 0;
+		allocator->own_memory = 0;
+	}
+}
+
+void *frame_alloc_allocate(frame_alloc_t *allocator, uint64_t size) {
+	return frame_alloc_allocate_align(allocator, size, DEFAULT_ALIGNMENT);
+}
+
+void *frame_alloc_allocate_align(frame_alloc_t *allocator, uint64_t size,
+                                 uintptr_t alignment) {
+	arena_allocator_t *arena = &allocator->arenas[allocator->current];
+
+#ifdef _DEBUG
+	/* Stamp goes in its own aligned slot so the block keeps its alignment. */
+	uint64_t stamp_size = sizeof(frame_stamp_t) > alignment
+							  ? sizeof(frame_stamp_t)
+							  : alignment;
+	char *block = arena_allocate_align(arena, size + stamp_size, alignment);
+	if (!block)
+		return 0;
+
+	block += stamp_size;
+	frame_stamp_t *stamp = (frame_stamp_t *)(void *)block - 1;
+	stamp->frame_index = allocator->frame_index;
+	stamp->magic = FRAME_STAMP_MAGIC;
+	return block;
+#else
+	return arena_allocate_align(arena, size, alignment);
+#endif
+}
+
+void frame_alloc_next(frame_alloc_t *allocator) {
+	allocator->frame_index++;
+	allocator->current = (uint8_t)((allocator->current + 1) %
+								   allocator->buffer_count);
+
+	arena_allocator_t *arena = &allocator->arenas[allocator->current];
+#ifdef _DEBUG
+	memory_set(arena->memory, FRAME_POISON, arena->curr_offset);
+#endif
+	arena_reset(arena);
+}
+
+b8 frame_alloc_is_live(frame_alloc_t *allocator, const void *block) {
+	const char *ptr = block;
+	const char *begin = allocator->memory;
+	const char *end = begin + allocator->frame_size * allocator->buffer_count;
+	if (ptr < begin || ptr >= end)
+		return false;
+
+	/* Must sit below the fill line of its arena. */
+	uint64_t index = (uint64_t)(ptr - begin) / allocator->frame_size;
+	arena_allocator_t *arena = &allocator->arenas[index];
+	if (ptr >= (const char *)arena->memory + arena->curr_offset)
+		return false;
+
+#ifdef _DEBUG
+	const frame_stamp_t *stamp = (const frame_stamp_t *)(const void *)ptr - 1;
+	return stamp->magic == FRAME_STAMP_MAGIC &&
+		   stamp->frame_index + allocator->buffer_count >
+			   allocator->frame_index;
+#else
+	return true;
+#endif
+}
+
+#ifdef _DEBUG
+void frame_alloc_check(frame_alloc_t *allocator, const void *block) {
+	ar_assert_msg(frame_alloc_is_live(allocator, block),
+				  "Frame allocation used after its frame retired");
+}
+#endif
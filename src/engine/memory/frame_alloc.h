@@ -0,0 +1,49 @@
+#ifndef __FRAME_ALLOC_H__
+#define __FRAME_ALLOC_H__
+
+#include "engine/define.h"
+#include "engine/memory/arena.h"
+
+/* Rotating linear arenas for data that lives one frame: render packets,
+ * temporary strings, event payloads. A block allocated in frame N stays
+ * valid until frame_alloc_next() brings its arena around again, that is
+ * 'buffer_count' frames later, so the GPU can still read it while in flight.
+ * Retired arenas are rewound without being cleared. */
+
+#define FRAME_ALLOC_MIN_BUFFERS 2
+#define FRAME_ALLOC_MAX_BUFFERS 3
+
+typedef struct frame_alloc_t {
+	arena_allocator_t arenas[FRAME_ALLOC_MAX_BUFFERS];
+	uint8_t buffer_count;
+	uint8_t current;
+	uint64_t frame_index;
+	uint64_t frame_size;
+	void *memory;
+	b8 own_memory;
+} frame_alloc_t;
+
+/* 'memory' needs frame_size * buffer_count bytes, null lets the allocator
+ * take it from memory_alloc. */
+b8 frame_alloc_init(uint64_t frame_size, uint8_t buffer_count, void *memory,
+                    frame_alloc_t *allocator);
+void frame_alloc_shut(frame_alloc_t *allocator);
+
+void *frame_alloc_allocate(frame_alloc_t *allocator, uint64_t size);
+void *frame_alloc_allocate_align(frame_alloc_t *allocator, uint64_t size,
+                                 uintptr_t alignment);
+
+/* Frame boundary. Retires the oldest arena and makes it current. */
+void frame_alloc_next(frame_alloc_t *allocator);
+
+/* Debug builds stamp each block with its frame and poison retired arenas,
+ * so a pointer kept past its frame fails the check below. */
+b8 frame_alloc_is_live(frame_alloc_t *allocator, const void *block);
+
+#ifdef _DEBUG
+void frame_alloc_check(frame_alloc_t *allocator, const void *block);
+#else
+	#define frame_alloc_check(allocator, block) ((void)0)
+#endif
+
+#endif //__FRAME_ALLOC_H__
@@ -1,14 +1,24 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
 #include "engine/memory/memory.h"
 
+#include "engine/core/assertion.h"
 #include "engine/core/logger.h"
 #include "engine/core/ar_strings.h"
 #include "engine/memory/dyn_alloc.h"
+#include "engine/memory/memory_profile.h"
+#include "engine/memory/memory_trace.h"
+#include "engine/memory/slab.h"
 #include "engine/platform/platform.h"
+#include "engine/platform/platform_thread.h"
 
 static const char *memtag_string[MEMTAG_MAX_TAGS] = {
     "MEMTAG_UNKNOWN",
 	"MEMTAG_ARENA_ALLOCATOR",
 	"MEMTAG_STACK_ALLOCATOR",
+	"MEMTAG_SLAB_ALLOCATOR",
     "MEMTAG_ARRAY",
     "MEMTAG_DYN_ARRAY",
     "MEMTAG_STRING",
@@ -20,33 +30,412 @@ static const char *memtag_string[MEMTAG_MAX_TAGS] = {
     "MEMTAG_TRANSFORM",
     "MEMTAG_ENTITY",
     "MEMTAG_ENTITY_NODE",
-    "MEMTAG_SCENE"
+    "MEMTAG_SCENE",
+    "MEMTAG_HASHTABLE"
 };
 
 struct mem_status {
 	uint64_t total_allocated;
+	uint64_t total_zeroed;
 	uint64_t tagged_alloc_count[MEMTAG_MAX_TAGS];
 	uint64_t tagged_allocation[MEMTAG_MAX_TAGS];
 };
 
+typedef struct mem_handle_slot_t {
+	void *block; // 0 while the slot is free
+	uint64_t size;
+	uint32_t generation;
+	uint32_t next_free; // free slot chain, INVALID_ID ends it
+	mem_tag_t tag;
+	uint32_t pins;
+} mem_handle_slot_t;
+
+#define HANDLE_INITIAL_CAPACITY 256
+
+typedef struct memory_heap_t {
+	memory_heap_config_t config;
+	dyn_alloc_t allocator;
+	void *block; // the heap's own reservation
+	uint64_t block_size;
+	slab_classes_t slabs; // MEMORY_ENGINE_SLAB only
+
+	uint64_t used;
+	uint64_t peak_used;
+	uint64_t alloc_count;
+	uint64_t spilled;
+
+	/* Guards everything above, the main heap lock is never taken with it. */
+	platform_mutex_t lock;
+} memory_heap_t;
+
 typedef struct memory_state_t {
 	struct mem_status status;
 	memory_sys_config_t config;
 	uint64_t alloc_count;
 	uint64_t alloc_mem_require;
+	uint64_t state_size;
+	uint32_t generation;
 	dyn_alloc_t allocator;
 	void *allocator_block;
+
+	memory_heap_t heaps[MEMORY_MAX_HEAPS];
+	uint32_t heap_count;
+	uint8_t tag_heap[MEMTAG_MAX_TAGS]; // heap index, 0 is the main heap
+
+	/* Handle table, lives in the heap and doubles when full. The compact
+	 * cursor walks it across calls, a whole pass without a move clears the
+	 * dirty flag until something gets freed again. */
+	mem_handle_slot_t *handles;
+	uint32_t handle_capacity;
+	uint32_t handle_live;
+	uint32_t handle_free;
+	uint32_t compact_cursor;
+	uint32_t compact_pass_moves;
+	b8 compact_dirty;
+
+	/* Guards the heap and the status above. Only the cache refill / return
+	 * and the large allocations take it. */
+	platform_mutex_t lock;
 } memory_state_t;
 
+/* Small blocks go through per thread magazines, one per power of two size
+ * class from 16B up to 1KiB. A thread only hits the shared heap when a
+ * magazine runs empty or full, and then moves CACHE_BATCH blocks at once. */
+#define CACHE_CLASS_SHIFT 4
+#define CACHE_CLASS_COUNT 7
+#define CACHE_MAGAZINE_SIZE 64
+#define CACHE_BATCH 32
+
+typedef struct thread_cache_t {
+	void *blocks[CACHE_CLASS_COUNT][CACHE_MAGAZINE_SIZE];
+	uint32_t count[CACHE_CLASS_COUNT];
+
+	/* Accounting not folded into the shared status yet. Unsigned wrap keeps
+	 * the deltas right when a thread frees more than it allocated. */
+	struct mem_status status;
+	uint64_t alloc_count;
+
+	uint32_t generation; // magazines from an older memory_init are dropped
+} thread_cache_t;
+
 static memory_state_t *p_state;
+static uint32_t memory_generation;
+static _arthreadlocal thread_cache_t thread_cache;
+
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+b8 cache_class(uint64_t size, uint32_t *cls) {
+	if (size > (1ull << (CACHE_CLASS_SHIFT + CACHE_CLASS_COUNT - 1)))
+		return false;
+
+	uint32_t shift = size <= (1u << CACHE_CLASS_SHIFT)
+						 ? CACHE_CLASS_SHIFT
+						 : (uint32_t)(64 - __builtin_clzll(size - 1));
+	*cls = shift - CACHE_CLASS_SHIFT;
+	return true;
+}
+
+uint64_t cache_class_size(uint32_t cls) {
+	return 1ull << (cls + CACHE_CLASS_SHIFT);
+}
+
+thread_cache_t *cache_get(void) {
+	thread_cache_t *cache = &thread_cache;
+	if (cache->generation != p_state->generation) {
+		memory_zero(cache, sizeof(thread_cache_t));
+		cache->generation = p_state->generation;
+	}
+
+	return cache;
+}
+
+/* Caller holds the lock. */
+void cache_fold_status(thread_cache_t *cache) {
+	struct mem_status *status = &p_state->status;
+	status->total_allocated += cache->status.total_allocated;
+	status->total_zeroed += cache->status.total_zeroed;
+	for (uint32_t i = 0; i < MEMTAG_MAX_TAGS; ++i) {
+		status->tagged_allocation[i] += cache->status.tagged_allocation[i];
+		status->tagged_alloc_count[i] += cache->status.tagged_alloc_count[i];
+	}
+	p_state->alloc_count += cache->alloc_count;
+
+	memory_zero(&cache->status, sizeof(cache->status));
+	cache->alloc_count = 0;
+}
+
+/* Caller holds the lock. Frees the oldest 'count' blocks of a magazine. */
+void cache_release(thread_cache_t *cache, uint32_t cls, uint32_t count) {
+	uint64_t size = cache_class_size(cls);
+	for (uint32_t i = 0; i < count; ++i)
+		dyn_alloc_free(&p_state->allocator, cache->blocks[cls][i], size);
+	if (count)
+		p_state->compact_dirty = true;
+
+	cache->count[cls] -= count;
+	memory_copy(cache->blocks[cls], cache->blocks[cls] + count,
+				sizeof(void *) * cache->count[cls]);
+}
+
+void cache_refill(thread_cache_t *cache, uint32_t cls) {
+	uint64_t size = cache_class_size(cls);
+
+	platform_mutex_lock(&p_state->lock);
+	while (cache->count[cls] < CACHE_BATCH) {
+		void *block = dyn_alloc_allocate(&p_state->allocator, size);
+		if (!block)
+			break;
+		cache->blocks[cls][cache->count[cls]++] = block;
+	}
+	cache_fold_status(cache);
+	platform_mutex_unlock(&p_state->lock);
+}
+
+b8 heap_init(memory_heap_t *heap, memory_heap_config_t config,
+			   b8 huge_pages) {
+	dyn_alloc_config_t alloc_config = {0};
+	alloc_config.type = config.engine == MEMORY_ENGINE_FREELIST
+							? DYN_ALLOC_FREELIST
+							: DYN_ALLOC_TLSF;
+	alloc_config.total_size = config.budget;
+	alloc_config.lazy_commit = true;
+	alloc_config.commit_chunk = huge_pages ? platform_huge_page_size() : 0;
+
+	uint64_t require = 0;
+	dyn_alloc_init(alloc_config, &require, 0, 0);
+
+	void *block = platform_reserve(
+		require, huge_pages ? PLATFORM_PAGES_HUGE : PLATFORM_PAGES_NORMAL);
+	if (!block)
+		return false;
+
+	if (!dyn_alloc_init(alloc_config, &require, block, &heap->allocator)) {
+		platform_release(block, require);
+		return false;
+	}
+
+	if (!platform_mutex_init(&heap->lock)) {
+		dyn_alloc_shut(&heap->allocator);
+		platform_release(block, require);
+		return false;
+	}
+
+	heap->config = config;
+	heap->block = block;
+	heap->block_size = require;
+	heap->used = 0;
+	heap->peak_used = 0;
+	heap->alloc_count = 0;
+	heap->spilled = 0;
+	if (config.engine == MEMORY_ENGINE_SLAB)
+		slab_classes_init(&heap->slabs, &heap->allocator);
+	return true;
+}
+
+void heap_shut(memory_heap_t *heap) {
+	if (heap->config.engine == MEMORY_ENGINE_SLAB)
+		slab_classes_shut(&heap->slabs);
+	if (heap->used)
+		ar_WARNING("Memory heap '%s' shut with %llu bytes still in use",
+				   heap->config.name, (unsigned long long)heap->used);
+
+	dyn_alloc_shut(&heap->allocator);
+	platform_mutex_shut(&heap->lock);
+	platform_release(heap->block, heap->block_size);
+}
+
+memory_heap_t *heap_for_tag(mem_tag_t tag) {
+	uint32_t index = p_state->tag_heap[tag];
+	return index ? &p_state->heaps[index - 1] : 0;
+}
+
+/* Sub-heap holding 'block', 0 for the main heap or outside of any. */
+memory_heap_t *heap_owner(void *block) {
+	for (uint32_t i = 0; i < p_state->heap_count; ++i) {
+		if (dyn_alloc_contains(&p_state->heaps[i].allocator, block))
+			return &p_state->heaps[i];
+	}
+	return 0;
+}
+
+b8 heap_slab_sized(memory_heap_t *heap, uint64_t size, uint64_t alignment) {
+	return heap->config.engine == MEMORY_ENGINE_SLAB &&
+		   size <= SLAB_OBJECT_MAX && alignment <= DYN_ALLOC_ALIGNMENT;
+}
+
+/* 0 once the budget is used up, the caller goes to the main heap then.
+ * The budget caps the bytes handed out, checked first so a planned spill
+ * does not go through the allocator's out of memory reporting. */
+void *heap_allocate(memory_heap_t *heap, uint64_t size, uint64_t alignment) {
+	platform_mutex_lock(&heap->lock);
+	void *block = 0;
+	if (heap->used + size > heap->config.budget) {
+		/* Over budget, left at 0. */
+	} else if (heap_slab_sized(heap, size, alignment)) {
+		block = slab_classes_pop(&heap->slabs, size);
+	} else {
+		block = dyn_alloc_allocate_aligned(&heap->allocator, size, alignment);
+	}
+
+	if (block) {
+		heap->used += size;
+		if (heap->used > heap->peak_used)
+			heap->peak_used = heap->used;
+		heap->alloc_count++;
+	} else {
+		if (!heap->spilled)
+			ar_WARNING("Memory heap '%s' is over its %llu byte budget, "
+					   "spilling to the main heap",
+					   heap->config.name,
+					   (unsigned long long)heap->config.budget);
+		heap->spilled++;
+	}
+	platform_mutex_unlock(&heap->lock);
+	return block;
+}
+
+void heap_release(memory_heap_t *heap, void *block, uint64_t size,
+				  uint64_t alignment) {
+	platform_mutex_lock(&heap->lock);
+	if (heap_slab_sized(heap, size, alignment))
+		slab_classes_push(&heap->slabs, block, size);
+	else
+		dyn_alloc_free(&heap->allocator, block, size);
+	heap->used -= size;
+	platform_mutex_unlock(&heap->lock);
+}
+
+/* In place only. A slab block keeps its spot within its size class, it
+ * never turns into a dyn_alloc block or back. Growth past the budget is
+ * refused, memory_realloc then moves the block and the allocation spills
+ * the way any other over budget one does. */
+b8 heap_resize(memory_heap_t *heap, void *block, uint64_t size,
+			   uint64_t new_size) {
+	b8 slab = heap_slab_sized(heap, size, 0);
+	b8 new_slab = heap_slab_sized(heap, new_size, 0);
+
+	platform_mutex_lock(&heap->lock);
+	b8 resized = false;
+	if (new_size > size && heap->used + (new_size - size) > heap->config.budget) {
+		/* Over budget, left false. */
+	} else if (slab && new_slab) {
+		resized = slab_class_index(size) == slab_class_index(new_size);
+	} else if (!slab && !new_slab) {
+		resized = dyn_alloc_resize(&heap->allocator, block, size, new_size);
+	}
+
+	if (resized) {
+		heap->used += new_size - size;
+		if (heap->used > heap->peak_used)
+			heap->peak_used = heap->used;
+	}
+	platform_mutex_unlock(&heap->lock);
+	return resized;
+}
+
+/* Caller holds the lock. */
+b8 handle_grow(void) {
+	uint32_t capacity = p_state->handle_capacity
+							? p_state->handle_capacity * 2
+							: HANDLE_INITIAL_CAPACITY;
+	mem_handle_slot_t *slots = dyn_alloc_allocate(
+		&p_state->allocator, sizeof(mem_handle_slot_t) * capacity);
+	if (!slots)
+		return false;
+
+	uint32_t old_capacity = p_state->handle_capacity;
+	if (p_state->handles) {
+		memory_copy(slots, p_state->handles,
+					sizeof(mem_handle_slot_t) * old_capacity);
+		dyn_alloc_free(&p_state->allocator, p_state->handles,
+					   sizeof(mem_handle_slot_t) * old_capacity);
+	}
+
+	/* New slots chain in front of whatever was still free. */
+	for (uint32_t i = old_capacity; i < capacity; ++i) {
+		slots[i].block = 0;
+		slots[i].size = 0;
+		slots[i].generation = 1;
+		slots[i].next_free = i + 1 < capacity ? i + 1 : p_state->handle_free;
+		slots[i].tag = MEMTAG_UNKNOWN;
+		slots[i].pins = 0;
+	}
+
+	p_state->handles = slots;
+	p_state->handle_capacity = capacity;
+	p_state->handle_free = old_capacity;
+	return true;
+}
+
+/* Caller holds the lock, the table moves when it grows. */
+mem_handle_slot_t *handle_slot(mem_handle_t handle) {
+	uint32_t index = (uint32_t)(handle & 0xFFFFFFFFu);
+	uint32_t generation = (uint32_t)(handle >> 32);
+	if (index >= p_state->handle_capacity)
+		return 0;
+
+	mem_handle_slot_t *slot = &p_state->handles[index];
+	if (!slot->block || slot->generation != generation)
+		return 0;
+
+	return slot;
+}
+
+/* Caller holds the lock. A deadline of 0 runs until a full pass over the
+ * table moves nothing. */
+uint64_t handle_compact(double deadline) {
+	uint64_t moved = 0;
+	while (p_state->compact_dirty && p_state->handle_live) {
+		if (p_state->compact_cursor >= p_state->handle_capacity) {
+			if (!p_state->compact_pass_moves)
+				p_state->compact_dirty = false;
+			p_state->compact_cursor = 0;
+			p_state->compact_pass_moves = 0;
+			continue;
+		}
+
+		mem_handle_slot_t *slot = &p_state->handles[p_state->compact_cursor++];
+		if (slot->block && !slot->pins) {
+			void *block =
+				dyn_alloc_relocate(&p_state->allocator, slot->block, slot->size);
+			if (block) {
+				slot->block = block;
+				moved += slot->size;
+				p_state->compact_pass_moves++;
+			}
+		}
+
+		if (deadline > 0.0 && get_absolute_time() >= deadline)
+			break;
+	}
+
+	return moved;
+}
+/* ========================================================================== */
+/* ========================================================================== */
 
 b8 memory_init(memory_sys_config_t config) {
-	uint64_t state_memory_require = sizeof(memory_state_t);
+	/* State sits on its own pages so the heap behind it starts page aligned
+	 * and gets committed separately. */
+	uint64_t page_size = platform_page_size();
+	uint64_t state_memory_require =
+		((sizeof(memory_state_t) + page_size - 1) / page_size) * page_size;
+
+    dyn_alloc_config_t alloc_config = {0};
+    alloc_config.type = config.alloc_type;
+    alloc_config.total_size = config.total_alloc_size;
+    alloc_config.lazy_commit = true;
+    alloc_config.commit_chunk =
+        config.huge_pages ? platform_huge_page_size() : 0;
+
 	uint64_t alloc_req = 0;
-	dyn_alloc_init(config.total_alloc_size, &alloc_req, 0, 0);
+	dyn_alloc_init(alloc_config, &alloc_req, 0, 0);
 
-	void *block = platform_allocate(state_memory_require + alloc_req, false);
-	if (!block) {
+	/* Only address space here, nothing gets touched until used. */
+	platform_page_mode_t page_mode =
+		config.huge_pages ? PLATFORM_PAGES_HUGE : PLATFORM_PAGES_NORMAL;
+	void *block = platform_reserve(state_memory_require + alloc_req, page_mode);
+	if (!block || !platform_commit(block, state_memory_require)) {
 		ar_FATAL("Memory allocation failed.");
 		return false;
 	}
@@ -55,53 +444,204 @@ b8 memory_init(memory_sys_config_t config) {
 	p_state->config = config;
 	p_state->alloc_count = 0;
 	p_state->alloc_mem_require = alloc_req;
+	p_state->state_size = state_memory_require;
+	p_state->generation = ++memory_generation;
 	memory_zero(&p_state->status, sizeof(p_state->status));
+	p_state->handles = 0;
+	p_state->handle_capacity = 0;
+	p_state->handle_live = 0;
+	p_state->handle_free = INVALID_ID;
+	p_state->compact_cursor = 0;
+	p_state->compact_pass_moves = 0;
+	p_state->compact_dirty = false;
+
+	if (!platform_mutex_init(&p_state->lock)) {
+		ar_FATAL("Memory unable to create heap lock.");
+		return false;
+	}
 
 	p_state->allocator_block = ((void *)((char *)block + state_memory_require));
 
-    if (!dyn_alloc_init(config.total_alloc_size,
-						&p_state->alloc_mem_require,
+    if (!dyn_alloc_init(alloc_config, &p_state->alloc_mem_require,
                         p_state->allocator_block, &p_state->allocator)) {
         ar_FATAL("Memory unable to setup internal allocator.");
         return false;
     }
 
-    ar_INFO("Memory System Initialized. Allocated %llu bytes",
+    if (!memory_profile_init())
+        ar_WARNING("Memory profiling unavailable, running without it.");
+
+    /* Sub-heaps get their own reservation each, tags follow the heap that
+     * could be carved. */
+    p_state->heap_count = 0;
+    memory_zero(p_state->tag_heap, sizeof(p_state->tag_heap));
+    for (uint32_t i = 0; i < config.heap_count && i < MEMORY_MAX_HEAPS; ++i) {
+        memory_heap_config_t *heap_config = &config.heaps[i];
+        memory_heap_t *heap = &p_state->heaps[p_state->heap_count];
+        if (!heap_init(heap, *heap_config, config.huge_pages)) {
+            ar_ERROR("Memory unable to carve heap '%s', its tags stay on the "
+                     "main heap", heap_config->name);
+            continue;
+        }
+        p_state->heap_count++;
+
+        for (uint32_t tag = 0; tag < MEMTAG_MAX_TAGS; ++tag) {
+            if (!(heap_config->tags & MEMTAG_BIT(tag)))
+                continue;
+
+            if (p_state->tag_heap[tag]) {
+                ar_WARNING("Memory heap '%s' - %s already goes to '%s'",
+                           heap_config->name, memtag_string[tag],
+                           heap_for_tag(tag)->config.name);
+                continue;
+            }
+            p_state->tag_heap[tag] = (uint8_t)p_state->heap_count;
+        }
+
+        ar_INFO("Memory heap '%s' carved, %llu byte budget", heap_config->name,
+                (unsigned long long)heap_config->budget);
+    }
+
+    slab_sys_init();
+
+    if (config.trace_path)
+        memory_trace_begin(config.trace_path);
+
+    ar_INFO("Memory System Initialized. Reserved %llu bytes",
                                 config.total_alloc_size);
     return true;
 }
 
 void memory_shut() {
     if (p_state) {
+        memory_trace_end();
+        slab_sys_shut();
+        memory_thread_flush();
+        memory_profile_shut();
+        for (uint32_t i = 0; i < p_state->heap_count; ++i)
+            heap_shut(&p_state->heaps[i]);
         dyn_alloc_shut(&p_state->allocator);
-        platform_free(p_state,
-                      p_state->alloc_mem_require + sizeof(memory_state_t));
+        platform_mutex_shut(&p_state->lock);
+        platform_release(p_state,
+                         p_state->alloc_mem_require + p_state->state_size);
     }
     p_state = 0;
 }
 
-void *memory_alloc_debug(uint64_t size, mem_tag_t tag, const char *file,
-                         int line, const char *func) {
+void *memory_alloc_debug(uint64_t size, mem_tag_t tag, b8 zeroed,
+                         const char *file, int line, const char *func) {
     if (tag == MEMTAG_UNKNOWN)
         ar_WARNING("Memory allocation with MEMTAG_UNKNOWN at %s:%d (%s)", file,
                    line, func);
 
     void *block = 0;
     if (p_state) {
-        p_state->status.total_allocated += size;
-        p_state->status.tagged_allocation[tag] += size;
-        p_state->status.tagged_alloc_count[tag]++;
-        p_state->alloc_count++;
-        block = dyn_alloc_allocate(&p_state->allocator, size);
+        thread_cache_t *cache = cache_get();
+        cache->status.total_allocated += size;
+        cache->status.tagged_allocation[tag] += size;
+        cache->status.tagged_alloc_count[tag]++;
+        cache->alloc_count++;
+
+        memory_heap_t *heap = heap_for_tag(tag);
+        if (heap)
+            block = heap_allocate(heap, size, DYN_ALLOC_ALIGNMENT);
+
+        uint32_t cls = 0;
+        if (block) {
+            /* The tag's own heap had room. */
+        } else if (cache_class(size, &cls)) {
+            if (!cache->count[cls])
+                cache_refill(cache, cls);
+            if (cache->count[cls])
+                block = cache->blocks[cls][--cache->count[cls]];
+        } else {
+            platform_mutex_lock(&p_state->lock);
+
+            /* Holes left between handle blocks can be closed up, do it all
+             * at once before giving up on a large block. */
+            if (p_state->handle_live && p_state->compact_dirty &&
+                dyn_alloc_fragmentation(&p_state->allocator).largest_free <
+                    size)
+                handle_compact(0.0);
+
+            block = dyn_alloc_allocate(&p_state->allocator, size);
+            platform_mutex_unlock(&p_state->lock);
+        }
     } else {
         block = platform_allocate(size, false);
     }
 
-    if (block) {
-        memory_set(block, 0, size);
-        return block;
+    if (!block)
+        return 0;
+
+    /* The math types count on it, see DYN_ALLOC_ALIGNMENT. */
+    ar_assert_debug(((uintptr_t)block & (DYN_ALLOC_ALIGNMENT - 1)) == 0);
+
+    memory_trace_alloc(block, size, 0, tag, file, line, func);
+    if (p_state)
+        memory_profile_alloc(block, size, tag, file, line, func);
+
+    if (zeroed) {
+        memory_zero(block, size);
+        if (p_state)
+            cache_get()->status.total_zeroed += size;
     }
-    return 0;
+    return block;
+}
+
+void *memory_realloc_debug(void *block, uint64_t size, uint64_t new_size,
+                           mem_tag_t tag, const char *file, int line,
+                           const char *func) {
+    if (!block)
+        return memory_alloc_debug(new_size, tag, false, file, line, func);
+
+    if (!new_size) {
+        memory_free(block, size, tag);
+        return 0;
+    }
+
+    memory_heap_t *heap = p_state ? heap_owner(block) : 0;
+    if (heap || (p_state && dyn_alloc_contains(&p_state->allocator, block))) {
+        /* Magazine blocks are a whole class, staying inside it is free.
+         * Anything crossing into or out of the classes has to move, the
+         * magazines and the heap would disagree on its size. */
+        uint32_t cls = 0, new_cls = 0;
+        b8 cached = cache_class(size, &cls);
+        b8 new_cached = cache_class(new_size, &new_cls);
+
+        b8 resized = false;
+        if (heap) {
+            resized = heap_resize(heap, block, size, new_size);
+        } else if (cached && new_cached) {
+            resized = cls == new_cls;
+        } else if (!cached && !new_cached) {
+            platform_mutex_lock(&p_state->lock);
+            resized =
+                dyn_alloc_resize(&p_state->allocator, block, size, new_size);
+            if (resized && new_size < size)
+                p_state->compact_dirty = true;
+            platform_mutex_unlock(&p_state->lock);
+        }
+
+        if (resized) {
+            thread_cache_t *cache = cache_get();
+            cache->status.total_allocated += new_size - size;
+            cache->status.tagged_allocation[tag] += new_size - size;
+
+            memory_trace_realloc(block, new_size, tag);
+            memory_profile_free(block, size, tag);
+            memory_profile_alloc(block, new_size, tag, file, line, func);
+            return block;
+        }
+    }
+
+    void *moved = memory_alloc_debug(new_size, tag, false, file, line, func);
+    if (!moved)
+        return 0;
+
+    memory_copy(moved, block, size < new_size ? size : new_size);
+    memory_free(block, size, tag);
+    return moved;
 }
 
 void memory_free(void *block, uint64_t size, mem_tag_t tag) {
@@ -109,12 +649,45 @@ void memory_free(void *block, uint64_t size, mem_tag_t tag) {
 		return;
 	}
 
+	/* Before the block goes back, another thread may get it right away. */
+	memory_trace_free(block, size, tag);
+
     if (p_state) {
-        p_state->status.total_allocated -= size;
-        p_state->status.tagged_allocation[tag] -= size;
-        p_state->status.tagged_alloc_count[tag]--;
+        memory_profile_free(block, size, tag);
+
+        thread_cache_t *cache = cache_get();
+        cache->status.total_allocated -= size;
+        cache->status.tagged_allocation[tag] -= size;
+        cache->status.tagged_alloc_count[tag]--;
 
-        b8 result = dyn_alloc_free(&p_state->allocator, block, size);
+        memory_heap_t *heap = heap_owner(block);
+        if (heap) {
+            heap_release(heap, block, size, DYN_ALLOC_ALIGNMENT);
+            return;
+        }
+
+        /* Blocks from before memory_init never enter a magazine, they may
+         * be smaller than their class. */
+        uint32_t cls = 0;
+        b8 owned = dyn_alloc_contains(&p_state->allocator, block);
+        if (owned && cache_class(size, &cls)) {
+            if (cache->count[cls] == CACHE_MAGAZINE_SIZE) {
+                platform_mutex_lock(&p_state->lock);
+                cache_release(cache, cls, CACHE_BATCH);
+                cache_fold_status(cache);
+                platform_mutex_unlock(&p_state->lock);
+            }
+            cache->blocks[cls][cache->count[cls]++] = block;
+            return;
+        }
+
+        b8 result = false;
+        if (owned) {
+            platform_mutex_lock(&p_state->lock);
+            result = dyn_alloc_free(&p_state->allocator, block, size);
+            p_state->compact_dirty = true;
+            platform_mutex_unlock(&p_state->lock);
+        }
         if (!result)
             platform_free(block, false);
     } else {
@@ -122,6 +695,258 @@ void memory_free(void *block, uint64_t size, mem_tag_t tag) {
     }
 }
 
+void *memory_alloc_aligned_debug(uint64_t size, uint64_t alignment,
+                                 mem_tag_t tag, b8 zeroed, const char *file,
+                                 int line, const char *func) {
+    if (!alignment || (alignment & (alignment - 1)) ||
+        alignment > platform_page_size()) {
+        ar_ERROR("memory_alloc_aligned - alignment %llu at %s:%d is not a "
+                 "power of two up to the page size",
+                 (unsigned long long)alignment, file, line);
+        return 0;
+    }
+
+    if (alignment <= DYN_ALLOC_ALIGNMENT)
+        return memory_alloc_debug(size, tag, zeroed, file, line, func);
+
+    void *block = 0;
+    if (p_state) {
+        thread_cache_t *cache = cache_get();
+        cache->status.total_allocated += size;
+        cache->status.tagged_allocation[tag] += size;
+        cache->status.tagged_alloc_count[tag]++;
+        cache->alloc_count++;
+
+        memory_heap_t *heap = heap_for_tag(tag);
+        if (heap)
+            block = heap_allocate(heap, size, alignment);
+
+        if (!block) {
+            platform_mutex_lock(&p_state->lock);
+            block = dyn_alloc_allocate_aligned(&p_state->allocator, size,
+                                               alignment);
+            platform_mutex_unlock(&p_state->lock);
+        }
+    } else if (alignment <= AR_CACHE_LINE) {
+        block = platform_allocate(size, true);
+    } else {
+        block = platform_allocate_pages(size, PLATFORM_PAGES_NORMAL);
+    }
+
+    if (!block)
+        return 0;
+
+    memory_trace_alloc(block, size, alignment, tag, file, line, func);
+    if (p_state)
+        memory_profile_alloc(block, size, tag, file, line, func);
+
+    if (zeroed) {
+        memory_zero(block, size);
+        if (p_state)
+            cache_get()->status.total_zeroed += size;
+    }
+    return block;
+}
+
+void memory_free_aligned(void *block, uint64_t size, uint64_t alignment,
+                         mem_tag_t tag) {
+    if (!block)
+        return;
+
+    if (alignment <= DYN_ALLOC_ALIGNMENT) {
+        memory_free(block, size, tag);
+        return;
+    }
+
+    memory_trace_free(block, size, tag);
+    if (p_state) {
+        memory_profile_free(block, size, tag);
+
+        thread_cache_t *cache = cache_get();
+        cache->status.total_allocated -= size;
+        cache->status.tagged_allocation[tag] -= size;
+        cache->status.tagged_alloc_count[tag]--;
+
+        memory_heap_t *heap = heap_owner(block);
+        if (heap) {
+            heap_release(heap, block, size, alignment);
+            return;
+        }
+
+        if (dyn_alloc_contains(&p_state->allocator, block)) {
+            platform_mutex_lock(&p_state->lock);
+            dyn_alloc_free(&p_state->allocator, block, size);
+            p_state->compact_dirty = true;
+            platform_mutex_unlock(&p_state->lock);
+            return;
+        }
+    }
+
+    /* Made before memory_init, see memory_alloc_aligned_debug. */
+    if (alignment <= AR_CACHE_LINE) {
+        platform_free(block, true);
+    } else {
+        platform_free_pages(block, size, PLATFORM_PAGES_NORMAL);
+    }
+}
+
+void memory_track_alloc(uint64_t size, mem_tag_t tag) {
+	if (p_state) {
+		thread_cache_t *cache = cache_get();
+		cache->status.tagged_allocation[tag] += size;
+		cache->status.tagged_alloc_count[tag]++;
+	}
+}
+
+void memory_track_free(uint64_t size, mem_tag_t tag) {
+	if (p_state) {
+		thread_cache_t *cache = cache_get();
+		cache->status.tagged_allocation[tag] -= size;
+		cache->status.tagged_alloc_count[tag]--;
+	}
+}
+
+void memory_thread_flush(void) {
+	if (!p_state)
+		return;
+
+	thread_cache_t *cache = cache_get();
+	platform_mutex_lock(&p_state->lock);
+	for (uint32_t cls = 0; cls < CACHE_CLASS_COUNT; ++cls)
+		cache_release(cache, cls, cache->count[cls]);
+	cache_fold_status(cache);
+	platform_mutex_unlock(&p_state->lock);
+}
+
+mem_handle_t memory_handle_alloc(uint64_t size, mem_tag_t tag) {
+	if (!p_state || !size) {
+		ar_ERROR("memory_handle_alloc - require memory system & a size");
+		return INVALID_HANDLE;
+	}
+
+	/* Straight from the heap, a magazine block could not be moved. */
+	platform_mutex_lock(&p_state->lock);
+	if (p_state->handle_free == INVALID_ID && !handle_grow()) {
+		platform_mutex_unlock(&p_state->lock);
+		ar_ERROR("memory_handle_alloc - unable to grow handle table");
+		return INVALID_HANDLE;
+	}
+
+	if (p_state->compact_dirty &&
+		dyn_alloc_fragmentation(&p_state->allocator).largest_free < size)
+		handle_compact(0.0);
+
+	void *block = dyn_alloc_allocate(&p_state->allocator, size);
+	if (!block) {
+		platform_mutex_unlock(&p_state->lock);
+		return INVALID_HANDLE;
+	}
+
+	uint32_t index = p_state->handle_free;
+	mem_handle_slot_t *slot = &p_state->handles[index];
+	p_state->handle_free = slot->next_free;
+	p_state->handle_live++;
+
+	slot->block = block;
+	slot->size = size;
+	slot->tag = tag;
+	slot->pins = 0;
+	slot->next_free = INVALID_ID;
+
+	struct mem_status *status = &p_state->status;
+	status->total_allocated += size;
+	status->tagged_allocation[tag] += size;
+	status->tagged_alloc_count[tag]++;
+	p_state->alloc_count++;
+
+	mem_handle_t handle = ((uint64_t)slot->generation << 32) | index;
+	platform_mutex_unlock(&p_state->lock);
+	return handle;
+}
+
+void memory_handle_free(mem_handle_t handle) {
+	if (handle == INVALID_HANDLE)
+		return;
+
+	if (!p_state)
+		return;
+
+	/* Looked up under the lock, so of two frees of one handle only the
+	 * first still finds its generation. */
+	platform_mutex_lock(&p_state->lock);
+	mem_handle_slot_t *slot = handle_slot(handle);
+	if (!slot) {
+		platform_mutex_unlock(&p_state->lock);
+		ar_WARNING("memory_handle_free - stale or invalid handle 0x%llx",
+				   handle);
+		return;
+	}
+
+	dyn_alloc_free(&p_state->allocator, slot->block, slot->size);
+
+	struct mem_status *status = &p_state->status;
+	status->total_allocated -= slot->size;
+	status->tagged_allocation[slot->tag] -= slot->size;
+	status->tagged_alloc_count[slot->tag]--;
+
+	/* Generation 0 never goes out, so INVALID_HANDLE never matches. */
+	slot->block = 0;
+	slot->size = 0;
+	slot->pins = 0;
+	slot->generation = slot->generation + 1 ? slot->generation + 1 : 1;
+	slot->next_free = p_state->handle_free;
+	p_state->handle_free = (uint32_t)(slot - p_state->handles);
+	p_state->handle_live--;
+	p_state->compact_dirty = true;
+	platform_mutex_unlock(&p_state->lock);
+}
+
+void *memory_handle_get(mem_handle_t handle) {
+	if (!p_state)
+		return 0;
+
+	platform_mutex_lock(&p_state->lock);
+	mem_handle_slot_t *slot = handle_slot(handle);
+	void *block = slot ? slot->block : 0;
+	platform_mutex_unlock(&p_state->lock);
+	return block;
+}
+
+/* Pins change under the same lock the compactor checks them with, a block
+ * pinned here can't be in the middle of a move. */
+void memory_handle_pin(mem_handle_t handle) {
+	if (!p_state)
+		return;
+
+	platform_mutex_lock(&p_state->lock);
+	mem_handle_slot_t *slot = handle_slot(handle);
+	if (slot)
+		slot->pins++;
+	platform_mutex_unlock(&p_state->lock);
+}
+
+void memory_handle_unpin(mem_handle_t handle) {
+	if (!p_state)
+		return;
+
+	platform_mutex_lock(&p_state->lock);
+	mem_handle_slot_t *slot = handle_slot(handle);
+	if (slot && slot->pins)
+		slot->pins--;
+	platform_mutex_unlock(&p_state->lock);
+}
+
+uint64_t memory_compact(double budget) {
+	if (!p_state || !p_state->compact_dirty)
+		return 0;
+
+	double deadline = budget > 0.0 ? get_absolute_time() + budget : 0.0;
+	platform_mutex_lock(&p_state->lock);
+	uint64_t moved = handle_compact(deadline);
+	platform_mutex_unlock(&p_state->lock);
+	return moved;
+}
+
 void *memory_zero(void *block, uint64_t size) {
 	return memset(block, 0, size);
 }
@@ -134,6 +959,13 @@ void *memory_set(void *target, int32_t value, uint64_t size) {
 	return memset(target, value, size);
 }
 
+const char *memory_tag_string(mem_tag_t tag) {
+	if (tag >= MEMTAG_MAX_TAGS)
+		return "MEMTAG_INVALID";
+
+	return memtag_string[tag];
+}
+
 char *memory_debug_stats(void) {
 	const uint64_t Gib = 1024 * 1024 * 1024;
 	const uint64_t Mib = 1024 * 1024;
@@ -143,6 +975,31 @@ char *memory_debug_stats(void) {
 //	uint64_t offset = strlen(buffer);
 	uint64_t offset = string_length(buffer);
 
+	memory_stats_t stats = memory_get_stats();
+	int32_t header = snprintf(buffer + offset, sizeof(buffer) - offset,
+		"--> Reserved: %.2fMib, Committed: %.2fMib, Used: %.2fMib\n",
+		stats.reserved / (float)Mib, stats.committed / (float)Mib,
+		stats.used / (float)Mib);
+	offset += (uint32_t)header;
+
+	header = snprintf(buffer + offset, sizeof(buffer) - offset,
+		"--> Largest free: %.2fMib in %llu free blocks, %.1f%% fragmented\n",
+		stats.largest_free / (float)Mib, (unsigned long long)stats.free_blocks,
+		stats.fragmentation * 100.0f);
+	offset += (uint32_t)header;
+
+	for (uint32_t i = 1; i < memory_heap_count(); ++i) {
+		memory_heap_stats_t heap;
+		memory_get_heap_stats(i, &heap);
+		header = snprintf(buffer + offset, sizeof(buffer) - offset,
+			"--> Heap %s: Used %.2fMib of %.2fMib (peak %.2fMib), "
+			"%.1f%% fragmented, %llu spilled\n",
+			heap.name, heap.used / (float)Mib, heap.reserved / (float)Mib,
+			heap.peak_used / (float)Mib, heap.fragmentation * 100.0f,
+			(unsigned long long)heap.spilled);
+		offset += (uint32_t)header;
+	}
+
 	for (uint32_t i = 0; i < MEMTAG_MAX_TAGS; ++i) {
 		char unit[4] = "Xib";
 		uint32_t count = 0;
@@ -186,9 +1043,98 @@ char *memory_debug_stats(void) {
 	return out;
 }
 
+memory_stats_t memory_get_stats(void) {
+	memory_stats_t stats = {0};
+	if (p_state) {
+		platform_mutex_lock(&p_state->lock);
+		cache_fold_status(cache_get());
+		stats.reserved = p_state->state_size + p_state->alloc_mem_require;
+		stats.committed =
+			p_state->state_size + dyn_alloc_committed(&p_state->allocator);
+		stats.used = p_state->status.total_allocated;
+		stats.zeroed = p_state->status.total_zeroed;
+
+		dyn_alloc_frag_t frag = dyn_alloc_fragmentation(&p_state->allocator);
+		stats.largest_free = frag.largest_free;
+		stats.free_blocks = frag.free_blocks;
+		stats.fragmentation = frag.fragmentation;
+		platform_mutex_unlock(&p_state->lock);
+
+		for (uint32_t i = 0; i < p_state->heap_count; ++i) {
+			memory_heap_t *heap = &p_state->heaps[i];
+			platform_mutex_lock(&heap->lock);
+			stats.reserved += heap->block_size;
+			stats.committed += dyn_alloc_committed(&heap->allocator);
+			platform_mutex_unlock(&heap->lock);
+		}
+	}
+
+	return stats;
+}
+
+uint32_t memory_tag_heap(mem_tag_t tag) {
+	if (!p_state || tag >= MEMTAG_MAX_TAGS)
+		return 0;
+
+	return p_state->tag_heap[tag];
+}
+
+uint32_t memory_heap_count(void) {
+	return p_state ? p_state->heap_count + 1 : 0;
+}
+
+b8 memory_get_heap_stats(uint32_t index, memory_heap_stats_t *out_stats) {
+	if (!p_state || !out_stats || index > p_state->heap_count)
+		return false;
+
+	memory_zero(out_stats, sizeof(memory_heap_stats_t));
+	if (index) {
+		memory_heap_t *heap = &p_state->heaps[index - 1];
+		platform_mutex_lock(&heap->lock);
+		out_stats->name = heap->config.name;
+		out_stats->reserved = heap->block_size;
+		out_stats->committed = dyn_alloc_committed(&heap->allocator);
+		out_stats->used = heap->used;
+		out_stats->peak_used = heap->peak_used;
+		out_stats->alloc_count = heap->alloc_count;
+		out_stats->spilled = heap->spilled;
+
+		dyn_alloc_frag_t frag = dyn_alloc_fragmentation(&heap->allocator);
+		out_stats->largest_free = frag.largest_free;
+		out_stats->free_blocks = frag.free_blocks;
+		out_stats->fragmentation = frag.fragmentation;
+		platform_mutex_unlock(&heap->lock);
+		return true;
+	}
+
+	/* The main heap is whatever the sub-heaps did not take. */
+	uint64_t sub_used = 0, sub_count = 0;
+	for (uint32_t i = 0; i < p_state->heap_count; ++i) {
+		platform_mutex_lock(&p_state->heaps[i].lock);
+		sub_used += p_state->heaps[i].used;
+		sub_count += p_state->heaps[i].alloc_count;
+		platform_mutex_unlock(&p_state->heaps[i].lock);
+	}
+
+	platform_mutex_lock(&p_state->lock);
+	cache_fold_status(cache_get());
+	out_stats->name = "main";
+	out_stats->reserved = p_state->alloc_mem_require;
+	out_stats->committed = dyn_alloc_committed(&p_state->allocator);
+	out_stats->used = p_state->status.total_allocated - sub_used;
+	out_stats->alloc_count = p_state->alloc_count - sub_count;
+
+	dyn_alloc_frag_t frag = dyn_alloc_fragmentation(&p_state->allocator);
+	out_stats->largest_free = frag.largest_free;
+	out_stats->free_blocks = frag.free_blocks;
+	out_stats->fragmentation = frag.fragmentation;
+	platform_mutex_unlock(&p_state->lock);
+	return true;
+}
+
 uint64_t get_mem_alloc_count(void) {
     if (p_state)
-        return p_state->alloc_count;
+        return p_state->alloc_count + cache_get()->alloc_count;
 
     return 0;
 }
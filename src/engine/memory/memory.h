@@ -2,11 +2,13 @@
 #define __MEMORY_H__
 
 #include "engine/define.h"
+#include "engine/memory/dyn_alloc.h"
 
 typedef enum mem_tag_t {
     MEMTAG_UNKNOWN = 0x00,
 	MEMTAG_ARENA_ALLOCATOR,
 	MEMTAG_STACK_ALLOCATOR,
+	MEMTAG_SLAB_ALLOCATOR,
     MEMTAG_ARRAY,
     MEMTAG_DYN_ARRAY,
     MEMTAG_STRING,
@@ -19,27 +21,171 @@ typedef enum mem_tag_t {
     MEMTAG_ENTITY,
     MEMTAG_ENTITY_NODE,
     MEMTAG_SCENE,
+    MEMTAG_HASHTABLE,
     MEMTAG_MAX_TAGS,
 } mem_tag_t;
 
+#define MEMTAG_BIT(tag) (1ull << (tag))
+
+/* Sub-heaps. Tags that churn differently from the rest of the engine get a
+ * heap of their own next to the main one, so their holes stay among their
+ * own blocks. Each has its own reservation, lock and budget. An allocation
+ * the budget cannot take goes to the main heap instead and is counted as
+ * spilled. Handles and memory_compact only work on the main heap. */
+#define MEMORY_MAX_HEAPS 8
+
+typedef enum memory_heap_engine_t {
+	MEMORY_ENGINE_TLSF = 0x00, // any size in O(1)
+	MEMORY_ENGINE_FREELIST,    // few large long lived blocks
+	MEMORY_ENGINE_SLAB,        // small blocks in size classes, TLSF above
+} memory_heap_engine_t;
+
+typedef struct memory_heap_config_t {
+	const char *name; // kept as is, a literal
+	uint64_t budget;
+	memory_heap_engine_t engine;
+	uint64_t tags; // MEMTAG_BIT of every tag routed here
+} memory_heap_config_t;
+
 typedef struct memory_sys_config_t {
 	uint64_t total_alloc_size;
+	dyn_alloc_type_t alloc_type;
+
+	/* A tag claimed by two heaps stays with the first. */
+	uint32_t heap_count;
+	memory_heap_config_t heaps[MEMORY_MAX_HEAPS];
+
+	/* Back the heap with huge pages where the system has them, fewer TLB
+	 * misses for a heap every subsystem touches. Falls back to normal
+	 * pages on its own. */
+	b8 huge_pages;
+
+	/* Record every heap allocation from init to shut into this file, see
+	 * memory_trace.h. Null to skip. */
+	const char *trace_path;
 } memory_sys_config_t;
 
-#define memory_alloc(size, tag)                                                \
-  memory_alloc_debug(size, tag, __FILE__, __LINE__, __func__)
+/* Whole system, sub-heaps included. */
+typedef struct memory_stats_t {
+	uint64_t reserved;  // address space held for the heaps
+	uint64_t committed; // pages actually backed so far
+	uint64_t used;      // bytes handed out through memory_alloc
+	uint64_t zeroed;    // bytes cleared by zeroing allocations since init
+
+	/* Main heap fragmentation, see dyn_alloc_frag_t. Blocks parked in
+	 * thread magazines count as used here. */
+	uint64_t largest_free;
+	uint64_t free_blocks;
+	float fragmentation;
+} memory_stats_t;
+
+/* One heap, index 0 is the main heap and the sub-heaps follow in config
+ * order. 'used' counts bytes handed out, slab class rounding aside. */
+typedef struct memory_heap_stats_t {
+	const char *name;
+	uint64_t reserved;
+	uint64_t committed;
+	uint64_t used;
+	uint64_t peak_used; // sub-heaps only
+	uint64_t alloc_count;
+	uint64_t spilled; // allocations sent on to the main heap, over budget
+
+	uint64_t largest_free;
+	uint64_t free_blocks;
+	float fragmentation;
+} memory_heap_stats_t;
+
+/* Relocatable allocation. The heap may move a handle block while compacting,
+ * so keep the handle and ask for the pointer when it is needed. Contents
+ * start uninitialised.
+ *
+ * All handle calls take the heap lock and can be made from any thread. A
+ * pointer from memory_handle_get is not: it stays valid only until the next
+ * compaction, which memory_compact runs and memory_handle_alloc may run on
+ * any thread. Pin the handle first to keep the pointer across threads or
+ * across frames, a pinned block never moves. */
+typedef uint64_t mem_handle_t;
+#define INVALID_HANDLE 0
+
+/* memory_alloc_uninit hands back whatever the heap had there, for callers
+ * that overwrite the whole block right away (file reads, copies, generated
+ * buffers). memory_alloc_zeroed clears it first. Plain memory_alloc stays
+ * the zeroed one. */
+#define memory_alloc_zeroed(size, tag)                                         \
+  memory_alloc_debug(size, tag, true, __FILE__, __LINE__, __func__)
+#define memory_alloc_uninit(size, tag)                                         \
+  memory_alloc_debug(size, tag, false, __FILE__, __LINE__, __func__)
+#define memory_alloc(size, tag) memory_alloc_zeroed(size, tag)
+
+/* Every memory_alloc block starts on DYN_ALLOC_ALIGNMENT (16), enough for
+ * vec3/vec4/mat4. For more, up to the page size, use memory_alloc_aligned
+ * and give the block back through memory_free_aligned with the same size
+ * and alignment, it never goes through the thread magazines. */
+#define memory_alloc_aligned(size, alignment, tag)                             \
+  memory_alloc_aligned_debug(size, alignment, tag, true, __FILE__, __LINE__,   \
+                             __func__)
+#define memory_alloc_aligned_uninit(size, alignment, tag)                      \
+  memory_alloc_aligned_debug(size, alignment, tag, false, __FILE__, __LINE__,  \
+                             __func__)
+
+/* Resize a memory_alloc block from 'size' to 'new_size' bytes. Grows or
+ * shrinks in place when the heap has room right after the block, otherwise
+ * moves it. Contents up to the smaller size are kept, anything past that is
+ * uninitialised. A null block allocates, a new_size of 0 frees. */
+#define memory_realloc(block, size, new_size, tag)                             \
+  memory_realloc_debug(block, size, new_size, tag, __FILE__, __LINE__,         \
+                       __func__)
 
 _arapi b8 memory_init(memory_sys_config_t config);
 _arapi void memory_shut();
 
-void *memory_alloc_debug(uint64_t size, mem_tag_t tag, const char *file,
-                         int line, const char *func);
+void *memory_alloc_debug(uint64_t size, mem_tag_t tag, b8 zeroed,
+                         const char *file, int line, const char *func);
+void *memory_realloc_debug(void *block, uint64_t size, uint64_t new_size,
+                           mem_tag_t tag, const char *file, int line,
+                           const char *func);
 _arapi void memory_free(void *block, uint64_t size, mem_tag_t tag);
 
+void *memory_alloc_aligned_debug(uint64_t size, uint64_t alignment,
+                                 mem_tag_t tag, b8 zeroed, const char *file,
+                                 int line, const char *func);
+_arapi void memory_free_aligned(void *block, uint64_t size, uint64_t alignment,
+                                mem_tag_t tag);
+
+/* Count a block handed out by a sub-allocator (slab, pools) against its tag.
+ * Only the per tag numbers move, the backing memory is already counted
+ * under the sub-allocator's own tag. */
+_arapi void memory_track_alloc(uint64_t size, mem_tag_t tag);
+_arapi void memory_track_free(uint64_t size, mem_tag_t tag);
+
+/* Hand the calling thread's cached blocks back to the heap and fold its
+ * tag accounting into the shared stats. Worker threads call it before they
+ * exit, memory_shut does it for the thread shutting down. */
+_arapi void memory_thread_flush(void);
+
+_arapi mem_handle_t memory_handle_alloc(uint64_t size, mem_tag_t tag);
+_arapi void memory_handle_free(mem_handle_t handle);
+_arapi void *memory_handle_get(mem_handle_t handle);
+_arapi void memory_handle_pin(mem_handle_t handle);
+_arapi void memory_handle_unpin(mem_handle_t handle);
+
+/* Slide handle blocks towards the start of the heap so the free space
+ * between them joins up. Stops once 'budget' seconds are spent, the next
+ * call picks up where this one left, a budget of 0 runs until nothing moves.
+ * Returns the bytes moved. */
+_arapi uint64_t memory_compact(double budget);
+
 _arapi void *memory_zero(void *block, uint64_t size);
 _arapi void *memory_copy(void *target, const void *source, uint64_t size);
 _arapi void *memory_set(void *target, int32_t value, uint64_t size);
 
+_arapi const char *memory_tag_string(mem_tag_t tag);
+_arapi memory_stats_t memory_get_stats(void);
+
+/* Sub-heap index of a tag, 0 for the main heap. */
+_arapi uint32_t memory_tag_heap(mem_tag_t tag);
+_arapi uint32_t memory_heap_count(void);
+_arapi b8 memory_get_heap_stats(uint32_t index, memory_heap_stats_t *out_stats);
 char *memory_debug_stats(void);
 uint64_t get_mem_alloc_count(void);
 #endif //__MEMORY_H__
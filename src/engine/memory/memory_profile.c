@@ -0,0 +1,389 @@
+#include "engine/memory/memory_profile.h"
+
+#if MEMORY_PROFILE
+
+#include "engine/core/logger.h"
+#include "engine/memory/memory.h"
+#include "engine/platform/filesystem.h"
+#include "engine/platform/platform.h"
+#include "engine/platform/platform_thread.h"
+
+#include <stdio.h>
+
+#define PROFILE_MAX_SITES 4096 // power of two
+#define PROFILE_BLOCK_MIN 4096 // power of two
+
+typedef struct profile_record_t {
+	uint64_t live_bytes;
+	uint64_t peak_bytes; // high-water mark of live_bytes
+	uint64_t alloc_count;
+	uint64_t free_count;
+	uint64_t frame_allocs;
+	uint64_t peak_frame_allocs;
+} profile_record_t;
+
+typedef struct profile_site_t {
+	const char *file;
+	const char *func;
+	int32_t line;
+	uint32_t tag;
+	profile_record_t record;
+} profile_site_t;
+
+/* Live block -> site it came from. Linear probing, deletes shift the
+ * following entries back so there are no tombstones. */
+typedef struct profile_blocks_t {
+	const void **keys;
+	uint32_t *sites;
+	uint64_t capacity;
+	uint64_t count;
+} profile_blocks_t;
+
+typedef struct profile_state_t {
+	platform_mutex_t lock;
+	profile_site_t sites[PROFILE_MAX_SITES];
+	uint32_t site_count;
+	b8 site_overflow;
+	profile_record_t tags[MEMTAG_MAX_TAGS];
+	profile_record_t total;
+	uint64_t frame_index;
+	profile_blocks_t blocks;
+} profile_state_t;
+
+static profile_state_t *p_profile;
+
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+uint64_t profile_hash(uint64_t key) {
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDull;
+	key ^= key >> 33;
+	return key;
+}
+
+void record_alloc(profile_record_t *record, uint64_t size) {
+	record->live_bytes += size;
+	record->alloc_count++;
+	record->frame_allocs++;
+	if (record->live_bytes > record->peak_bytes)
+		record->peak_bytes = record->live_bytes;
+}
+
+void record_free(profile_record_t *record, uint64_t size) {
+	record->live_bytes -= size;
+	record->free_count++;
+}
+
+void record_frame(profile_record_t *record) {
+	if (record->frame_allocs > record->peak_frame_allocs)
+		record->peak_frame_allocs = record->frame_allocs;
+	record->frame_allocs = 0;
+}
+
+uint32_t site_find(const char *file, int32_t line, const char *func,
+				   uint32_t tag) {
+	uint64_t mask = PROFILE_MAX_SITES - 1;
+	uint64_t slot = profile_hash((uint64_t)(uintptr_t)file ^
+								 ((uint64_t)line << 40) ^ tag) & mask;
+
+	for (;;) {
+		profile_site_t *site = &p_profile->sites[slot];
+		if (!site->file) {
+			/* Keep one slot free so lookups always terminate. */
+			if (p_profile->site_count + 1 >= PROFILE_MAX_SITES)
+				return INVALID_ID;
+
+			site->file = file;
+			site->func = func;
+			site->line = line;
+			site->tag = tag;
+			p_profile->site_count++;
+			return (uint32_t)slot;
+		}
+
+		if (site->file == file && site->line == line && site->tag == tag)
+			return (uint32_t)slot;
+
+		slot = (slot + 1) & mask;
+	}
+}
+
+b8 blocks_insert(profile_blocks_t *blocks, const void *key, uint32_t site);
+
+b8 blocks_grow(profile_blocks_t *blocks) {
+	profile_blocks_t grown = {0};
+	grown.capacity = blocks->capacity ? blocks->capacity * 2 : PROFILE_BLOCK_MIN;
+	grown.keys = platform_allocate(sizeof(void *) * grown.capacity, false);
+	grown.sites = platform_allocate(sizeof(uint32_t) * grown.capacity, false);
+	if (!grown.keys || !grown.sites) {
+		platform_free(grown.keys, false);
+		platform_free(grown.sites, false);
+		return false;
+	}
+	platform_zero_mem(grown.keys, sizeof(void *) * grown.capacity);
+
+	for (uint64_t i = 0; i < blocks->capacity; ++i) {
+		if (blocks->keys[i])
+			blocks_insert(&grown, blocks->keys[i], blocks->sites[i]);
+	}
+
+	platform_free(blocks->keys, false);
+	platform_free(blocks->sites, false);
+	*blocks = grown;
+	return true;
+}
+
+b8 blocks_insert(profile_blocks_t *blocks, const void *key, uint32_t site) {
+	if ((blocks->count + 1) * 2 > blocks->capacity && !blocks_grow(blocks))
+		return false;
+
+	uint64_t mask = blocks->capacity - 1;
+	uint64_t slot = profile_hash((uint64_t)(uintptr_t)key) & mask;
+	while (blocks->keys[slot] && blocks->keys[slot] != key)
+		slot = (slot + 1) & mask;
+
+	if (!blocks->keys[slot])
+		blocks->count++;
+	blocks->keys[slot] = key;
+	blocks->sites[slot] = site;
+	return true;
+}
+
+b8 blocks_remove(profile_blocks_t *blocks, const void *key, uint32_t *site) {
+	if (!blocks->capacity)
+		return false;
+
+	uint64_t mask = blocks->capacity - 1;
+	uint64_t slot = profile_hash((uint64_t)(uintptr_t)key) & mask;
+	while (blocks->keys[slot] != key) {
+		if (!blocks->keys[slot])
+			return false;
+		slot = (slot + 1) & mask;
+	}
+
+	*site = blocks->sites[slot];
+	blocks->keys[slot] = 0;
+	blocks->count--;
+
+	/* Pull back every entry of the run that could live in the hole. */
+	uint64_t hole = slot;
+	for (uint64_t next = (hole + 1) & mask; blocks->keys[next];
+		 next = (next + 1) & mask) {
+		uint64_t home = profile_hash((uint64_t)(uintptr_t)blocks->keys[next]) &
+						mask;
+		if (((next - home) & mask) >= ((next - hole) & mask)) {
+			blocks->keys[hole] = blocks->keys[next];
+			blocks->sites[hole] = blocks->sites[next];
+			blocks->keys[next] = 0;
+			hole = next;
+		}
+	}
+	return true;
+}
+
+void write_record_json(char *line, uint64_t max, const profile_record_t *r) {
+	snprintf(line, max,
+			 "\"live_bytes\": %llu, \"peak_bytes\": %llu, \"alloc_count\": "
+			 "%llu, \"free_count\": %llu, \"frame_allocs\": %llu, "
+			 "\"peak_frame_allocs\": %llu",
+			 (unsigned long long)r->live_bytes,
+			 (unsigned long long)r->peak_bytes,
+			 (unsigned long long)r->alloc_count,
+			 (unsigned long long)r->free_count,
+			 (unsigned long long)r->frame_allocs,
+			 (unsigned long long)r->peak_frame_allocs);
+}
+
+void write_record_csv(char *line, uint64_t max, const profile_record_t *r) {
+	snprintf(line, max, "%llu,%llu,%llu,%llu,%llu,%llu",
+			 (unsigned long long)r->live_bytes,
+			 (unsigned long long)r->peak_bytes,
+			 (unsigned long long)r->alloc_count,
+			 (unsigned long long)r->free_count,
+			 (unsigned long long)r->frame_allocs,
+			 (unsigned long long)r->peak_frame_allocs);
+}
+
+void dump_json(file_handle_t *f) {
+	char line[1024];
+	char record[512];
+
+	filesystem_write_line(f, "{");
+	snprintf(line, sizeof(line), "  \"frame\": %llu,",
+			 (unsigned long long)p_profile->frame_index);
+	filesystem_write_line(f, line);
+
+	write_record_json(record, sizeof(record), &p_profile->total);
+	snprintf(line, sizeof(line), "  \"total\": { %s },", record);
+	filesystem_write_line(f, line);
+
+	filesystem_write_line(f, "  \"tags\": [");
+	for (uint32_t i = 0; i < MEMTAG_MAX_TAGS; ++i) {
+		write_record_json(record, sizeof(record), &p_profile->tags[i]);
+		snprintf(line, sizeof(line), "    { \"tag\": \"%s\", %s }%s",
+				 memory_tag_string((mem_tag_t)i), record,
+				 i + 1 < MEMTAG_MAX_TAGS ? "," : "");
+		filesystem_write_line(f, line);
+	}
+	filesystem_write_line(f, "  ],");
+
+	filesystem_write_line(f, "  \"sites\": [");
+	uint32_t written = 0;
+	for (uint32_t i = 0; i < PROFILE_MAX_SITES; ++i) {
+		const profile_site_t *site = &p_profile->sites[i];
+		if (!site->file)
+			continue;
+
+		written++;
+		write_record_json(record, sizeof(record), &site->record);
+		snprintf(line, sizeof(line),
+				 "    { \"file\": \"%s\", \"line\": %d, \"func\": \"%s\", "
+				 "\"tag\": \"%s\", %s }%s",
+				 site->file, site->line, site->func,
+				 memory_tag_string((mem_tag_t)site->tag), record,
+				 written < p_profile->site_count ? "," : "");
+		filesystem_write_line(f, line);
+	}
+	filesystem_write_line(f, "  ]");
+	filesystem_write_line(f, "}");
+}
+
+void dump_csv(file_handle_t *f) {
+	char line[1024];
+	char record[512];
+
+	filesystem_write_line(f, "kind,name,file,line,func,live_bytes,peak_bytes,"
+							 "alloc_count,free_count,frame_allocs,"
+							 "peak_frame_allocs");
+
+	write_record_csv(record, sizeof(record), &p_profile->total);
+	snprintf(line, sizeof(line), "total,,,,,%s", record);
+	filesystem_write_line(f, line);
+
+	for (uint32_t i = 0; i < MEMTAG_MAX_TAGS; ++i) {
+		write_record_csv(record, sizeof(record), &p_profile->tags[i]);
+		snprintf(line, sizeof(line), "tag,%s,,,,%s",
+				 memory_tag_string((mem_tag_t)i), record);
+		filesystem_write_line(f, line);
+	}
+
+	for (uint32_t i = 0; i < PROFILE_MAX_SITES; ++i) {
+		const profile_site_t *site = &p_profile->sites[i];
+		if (!site->file)
+			continue;
+
+		write_record_csv(record, sizeof(record), &site->record);
+		snprintf(line, sizeof(line), "site,%s,%s,%d,%s,%s",
+				 memory_tag_string((mem_tag_t)site->tag), site->file,
+				 site->line, site->func, record);
+		filesystem_write_line(f, line);
+	}
+}
+/* ========================================================================== */
+/* ========================================================================== */
+
+b8 memory_profile_init(void) {
+	p_profile = platform_allocate(sizeof(profile_state_t), false);
+	if (!p_profile) {
+		ar_ERROR("memory_profile_init - failed to allocate profile state");
+		return false;
+	}
+
+	platform_zero_mem(p_profile, sizeof(profile_state_t));
+	if (!platform_mutex_init(&p_profile->lock) ||
+		!blocks_grow(&p_profile->blocks)) {
+		ar_ERROR("memory_profile_init - failed to set up block table");
+		platform_free(p_profile, false);
+		p_profile = 0;
+		return false;
+	}
+
+	return true;
+}
+
+void memory_profile_shut(void) {
+	if (p_profile) {
+		platform_mutex_shut(&p_profile->lock);
+		platform_free(p_profile->blocks.keys, false);
+		platform_free(p_profile->blocks.sites, false);
+		platform_free(p_profile, false);
+		p_profile = 0;
+	}
+}
+
+void memory_profile_alloc(const void *block, uint64_t size, uint32_t tag,
+                          const char *file, int32_t line, const char *func) {
+	if (!p_profile || !block)
+		return;
+
+	platform_mutex_lock(&p_profile->lock);
+	uint32_t site = site_find(file, line, func, tag);
+	if (site == INVALID_ID) {
+		if (!p_profile->site_overflow)
+			ar_WARNING("memory_profile - more than %d callsites, new ones "
+					   "are not tracked", PROFILE_MAX_SITES);
+		p_profile->site_overflow = true;
+	} else if (blocks_insert(&p_profile->blocks, block, site)) {
+		record_alloc(&p_profile->sites[site].record, size);
+		record_alloc(&p_profile->tags[tag], size);
+		record_alloc(&p_profile->total, size);
+	}
+	platform_mutex_unlock(&p_profile->lock);
+}
+
+void memory_profile_free(const void *block, uint64_t size, uint32_t tag) {
+	if (!p_profile || !block)
+		return;
+
+	/* Blocks from before init or from an untracked site are skipped. */
+	platform_mutex_lock(&p_profile->lock);
+	uint32_t site = 0;
+	if (blocks_remove(&p_profile->blocks, block, &site)) {
+		record_free(&p_profile->sites[site].record, size);
+		record_free(&p_profile->tags[tag], size);
+		record_free(&p_profile->total, size);
+	}
+	platform_mutex_unlock(&p_profile->lock);
+}
+
+void memory_profile_frame(void) {
+	if (!p_profile)
+		return;
+
+	platform_mutex_lock(&p_profile->lock);
+	for (uint32_t i = 0; i < PROFILE_MAX_SITES; ++i) {
+		if (p_profile->sites[i].file)
+			record_frame(&p_profile->sites[i].record);
+	}
+	for (uint32_t i = 0; i < MEMTAG_MAX_TAGS; ++i)
+		record_frame(&p_profile->tags[i]);
+	record_frame(&p_profile->total);
+	p_profile->frame_index++;
+	platform_mutex_unlock(&p_profile->lock);
+}
+
+b8 memory_profile_dump(const char *path, memory_profile_format_t format) {
+	if (!p_profile) {
+		ar_WARNING("memory_profile_dump - profiling is not running");
+		return false;
+	}
+
+	file_handle_t f;
+	if (!filesystem_open(path, MODE_WRITE, false, &f)) {
+		ar_ERROR("memory_profile_dump - unable to open '%s'", path);
+		return false;
+	}
+
+	platform_mutex_lock(&p_profile->lock);
+	if (format == MEMORY_PROFILE_CSV) {
+		dump_csv(&f);
+	} else {
+		dump_json(&f);
+	}
+	platform_mutex_unlock(&p_profile->lock);
+
+	filesystem_close(&f);
+	return true;
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef __MEMORY_PROFILE_H__
+#define __MEMORY_PROFILE_H__
+
+#include "engine/define.h"
+
+/* Callsite allocation profiling. Every memory_alloc is attributed to the
+ * file:line that made it, frees are matched back through a block table, and
+ * each site and tag keeps live/peak bytes, alloc/free counts and how many
+ * allocations it made in the current and busiest frame.
+ *
+ * On by default in debug builds, build with -DMEMORY_PROFILE=0 to drop it.
+ * Release builds compile every hook below down to nothing. */
+
+#ifndef MEMORY_PROFILE
+	#ifdef _DEBUG
+		#define MEMORY_PROFILE 1
+	#else
+		#define MEMORY_PROFILE 0
+	#endif
+#endif
+
+typedef enum memory_profile_format_t {
+	MEMORY_PROFILE_JSON = 0x00,
+	MEMORY_PROFILE_CSV
+} memory_profile_format_t;
+
+#if MEMORY_PROFILE
+
+/* Hooks for memory.c. */
+b8 memory_profile_init(void);
+void memory_profile_shut(void);
+void memory_profile_alloc(const void *block, uint64_t size, uint32_t tag,
+                          const char *file, int32_t line, const char *func);
+void memory_profile_free(const void *block, uint64_t size, uint32_t tag);
+
+/* Close the current frame, its per-frame counts feed the frame peaks. */
+_arapi void memory_profile_frame(void);
+
+_arapi b8 memory_profile_dump(const char *path, memory_profile_format_t format);
+
+#else
+
+_arinline b8 memory_profile_init(void) { return true; }
+_arinline void memory_profile_shut(void) {}
+
+_arinline void memory_profile_alloc(const void *block, uint64_t size,
+                                    uint32_t tag, const char *file,
+                                    int32_t line, const char *func) {
+	(void)block, (void)size, (void)tag, (void)file, (void)line, (void)func;
+}
+
+_arinline void memory_profile_free(const void *block, uint64_t size,
+                                   uint32_t tag) {
+	(void)block, (void)size, (void)tag;
+}
+
+_arinline void memory_profile_frame(void) {}
+
+_arinline b8 memory_profile_dump(const char *path,
+                                 memory_profile_format_t format) {
+	(void)path, (void)format;
+	return false;
+}
+
+#endif
+
+#endif //__MEMORY_PROFILE_H__
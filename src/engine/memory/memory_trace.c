@@ -0,0 +1,205 @@
+/* This should be include first before anything
+else since platform_time using _POSIX_C_SOURCE. */
+#include "engine/platform/platform_time.h"
+
+#include "engine/memory/memory_trace.h"
+
+#include "engine/core/logger.h"
+#include "engine/memory/memory.h"
+#include "engine/platform/filesystem.h"
+#include "engine/platform/platform.h"
+#include "engine/platform/platform_thread.h"
+
+#include <stdio.h>
+
+#define TRACE_BUFFER_SIZE KIBIBYTES(256) // written out whenever it fills
+#define TRACE_MAX_SITES 4096 // power of two
+#define TRACE_SITE_TEXT 256
+
+typedef struct trace_site_t {
+	const char *file;
+	int32_t line;
+	uint32_t id;
+} trace_site_t;
+
+typedef struct trace_state_t {
+	platform_mutex_t lock;
+	file_handle_t file;
+	double start;
+	uint64_t events;
+	uint64_t buffer_used;
+	uint32_t site_count;
+	trace_site_t sites[TRACE_MAX_SITES];
+	uint8_t buffer[TRACE_BUFFER_SIZE];
+} trace_state_t;
+
+static trace_state_t *p_trace;
+
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+/* Caller holds the lock. */
+b8 trace_flush(void) {
+	if (!p_trace->buffer_used)
+		return true;
+
+	uint64_t written = 0;
+	b8 result = filesystem_write(&p_trace->file, p_trace->buffer_used,
+								 p_trace->buffer, &written);
+	p_trace->buffer_used = 0;
+	return result;
+}
+
+/* Caller holds the lock. */
+void trace_write(const void *data, uint64_t size) {
+	if (p_trace->buffer_used + size > TRACE_BUFFER_SIZE)
+		trace_flush();
+
+	memory_copy(p_trace->buffer + p_trace->buffer_used, data, size);
+	p_trace->buffer_used += size;
+}
+
+/* Caller holds the lock. */
+void trace_event(memory_trace_kind_t kind, const void *block, uint64_t size,
+				 uint32_t tag, uint32_t site, uint8_t align_log2) {
+	memory_trace_event_t event;
+	event.time =
+		(uint64_t)((get_absolute_time() - p_trace->start) * 1000000000.0);
+	event.block = (uint64_t)(uintptr_t)block;
+	event.size = size;
+	event.site = site;
+	event.kind = (uint8_t)kind;
+	event.tag = (uint8_t)tag;
+	event.align_log2 = align_log2;
+	event.reserved = 0;
+	trace_write(&event, sizeof(event));
+	p_trace->events++;
+}
+
+/* Caller holds the lock. Callsite id, the first time a site shows up its
+ * name goes into the trace ahead of the event. */
+uint32_t trace_site(const char *file, int32_t line, const char *func) {
+	uint64_t mask = TRACE_MAX_SITES - 1;
+	uint64_t key = (uint64_t)(uintptr_t)file ^ ((uint64_t)line << 40);
+	uint64_t slot = ((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+
+	for (;;) {
+		trace_site_t *site = &p_trace->sites[slot];
+		if (site->file == file && site->line == line)
+			return site->id;
+
+		if (!site->file) {
+			/* Keep one slot free so lookups always terminate. */
+			if (p_trace->site_count + 1 >= TRACE_MAX_SITES)
+				return INVALID_ID;
+
+			site->file = file;
+			site->line = line;
+			site->id = p_trace->site_count++;
+
+			char text[TRACE_SITE_TEXT];
+			int32_t length =
+				snprintf(text, sizeof(text), "%s:%d %s", file, line, func);
+			if (length < 0)
+				length = 0;
+			if (length >= TRACE_SITE_TEXT)
+				length = TRACE_SITE_TEXT - 1;
+
+			trace_event(MEMORY_TRACE_SITE, 0, (uint64_t)length, 0, site->id,
+						0);
+			trace_write(text, (uint64_t)length);
+			return site->id;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+}
+/* ========================================================================== */
+/* ========================================================================== */
+
+b8 memory_trace_begin(const char *path) {
+	if (p_trace) {
+		ar_WARNING("memory_trace_begin - a trace is already running");
+		return false;
+	}
+
+	/* Outside the heap, tracing it from inside would recurse. */
+	trace_state_t *trace = platform_allocate(sizeof(trace_state_t), false);
+	if (!trace)
+		return false;
+
+	memory_zero(trace, sizeof(trace_state_t));
+	if (!filesystem_open(path, MODE_WRITE, true, &trace->file) ||
+		!platform_mutex_init(&trace->lock)) {
+		filesystem_close(&trace->file);
+		platform_free(trace, false);
+		ar_ERROR("memory_trace_begin - unable to trace to '%s'", path);
+		return false;
+	}
+
+	memory_trace_header_t header = {0};
+	header.magic = MEMORY_TRACE_MAGIC;
+	header.version = MEMORY_TRACE_VERSION;
+	header.event_size = sizeof(memory_trace_event_t);
+	uint64_t written = 0;
+	filesystem_write(&trace->file, sizeof(header), &header, &written);
+
+	trace->start = get_absolute_time();
+	p_trace = trace;
+	ar_INFO("Memory trace started: '%s'", path);
+	return true;
+}
+
+void memory_trace_end(void) {
+	if (!p_trace)
+		return;
+
+	trace_state_t *trace = p_trace;
+	platform_mutex_lock(&trace->lock);
+	trace_flush();
+	p_trace = 0;
+	platform_mutex_unlock(&trace->lock);
+
+	ar_INFO("Memory trace ended, %llu events from %u callsites",
+			(unsigned long long)trace->events, trace->site_count);
+	filesystem_close(&trace->file);
+	platform_mutex_shut(&trace->lock);
+	platform_free(trace, false);
+}
+
+b8 memory_trace_active(void) {
+	return p_trace != 0;
+}
+
+void memory_trace_alloc(const void *block, uint64_t size, uint64_t alignment,
+                        uint32_t tag, const char *file, int32_t line,
+                        const char *func) {
+	if (!p_trace)
+		return;
+
+	uint8_t align_log2 = 0;
+	while (alignment > 1 && ((uint64_t)1 << align_log2) < alignment)
+		align_log2++;
+
+	platform_mutex_lock(&p_trace->lock);
+	uint32_t site = trace_site(file, line, func);
+	trace_event(MEMORY_TRACE_ALLOC, block, size, tag, site, align_log2);
+	platform_mutex_unlock(&p_trace->lock);
+}
+
+void memory_trace_free(const void *block, uint64_t size, uint32_t tag) {
+	if (!p_trace)
+		return;
+
+	platform_mutex_lock(&p_trace->lock);
+	trace_event(MEMORY_TRACE_FREE, block, size, tag, INVALID_ID, 0);
+	platform_mutex_unlock(&p_trace->lock);
+}
+
+void memory_trace_realloc(const void *block, uint64_t new_size, uint32_t tag) {
+	if (!p_trace)
+		return;
+
+	platform_mutex_lock(&p_trace->lock);
+	trace_event(MEMORY_TRACE_REALLOC, block, new_size, tag, INVALID_ID, 0);
+	platform_mutex_unlock(&p_trace->lock);
+}
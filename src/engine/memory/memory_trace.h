@@ -0,0 +1,62 @@
+#ifndef __MEMORY_TRACE_H__
+#define __MEMORY_TRACE_H__
+
+#include "engine/define.h"
+
+/* Allocation trace. While a trace runs, every memory_alloc, memory_free and
+ * in place memory_realloc is appended to a binary file, timestamped, with
+ * its size, tag and callsite. bench_replay plays the file back against an
+ * allocator of choice, so allocator changes get measured on a recorded
+ * session instead of a synthetic pattern.
+ *
+ * Works in every build, costs one check per allocation while off. Handle
+ * blocks and sub-allocators (slab, arena, stack) are not traced, only what
+ * goes through the heap entry points.
+ *
+ * File layout: one memory_trace_header_t, then memory_trace_event_t records
+ * back to back. A MEMORY_TRACE_SITE record is followed by 'size' bytes of
+ * "file:line func" text naming the callsite id it carries. */
+
+#define MEMORY_TRACE_MAGIC 0x544D5241 // "ARMT"
+#define MEMORY_TRACE_VERSION 1
+
+typedef enum memory_trace_kind_t {
+	MEMORY_TRACE_ALLOC = 0x00,
+	MEMORY_TRACE_FREE,
+	MEMORY_TRACE_REALLOC, // resized in place, size is the new size
+	MEMORY_TRACE_SITE
+} memory_trace_kind_t;
+
+typedef struct memory_trace_header_t {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t event_size; // sizeof(memory_trace_event_t) of the writer
+	uint32_t reserved;
+} memory_trace_header_t;
+
+typedef struct memory_trace_event_t {
+	uint64_t time;  // ns since the trace began
+	uint64_t block; // address, only good for pairing frees with allocs
+	uint64_t size;
+	uint32_t site;  // callsite id of allocs, INVALID_ID otherwise
+	uint8_t kind;   // memory_trace_kind_t
+	uint8_t tag;    // mem_tag_t
+	uint8_t align_log2; // memory_alloc_aligned boundary, 0 for plain blocks
+	uint8_t reserved;
+} memory_trace_event_t;
+
+/* Start writing a trace to 'path', replacing the file. One trace at a
+ * time, memory_shut ends it if still running. End it while no other thread
+ * is allocating. */
+_arapi b8 memory_trace_begin(const char *path);
+_arapi void memory_trace_end(void);
+_arapi b8 memory_trace_active(void);
+
+/* Hooks for memory.c. */
+void memory_trace_alloc(const void *block, uint64_t size, uint64_t alignment,
+                        uint32_t tag, const char *file, int32_t line,
+                        const char *func);
+void memory_trace_free(const void *block, uint64_t size, uint32_t tag);
+void memory_trace_realloc(const void *block, uint64_t new_size, uint32_t tag);
+
+#endif //__MEMORY_TRACE_H__
@@ -0,0 +1,48 @@
+#include "engine/memory/scratch.h"
+
+#include "engine/platform/platform.h"
+
+#define SCRATCH_ALIGNMENT 0x10 // 16
+
+static _arthreadlocal stack_allocator_t scratch_stack;
+
+scratch_t scratch_begin(void) {
+	scratch_t scratch = {0};
+	if (!scratch_stack.memory) {
+		void *memory = platform_allocate_pages(SCRATCH_SIZE, PLATFORM_PAGES_NORMAL);
+		if (!memory)
+			return scratch;
+
+		stack_init(SCRATCH_SIZE, memory, &scratch_stack);
+	}
+
+	scratch.stack = &scratch_stack;
+	scratch.marker = stack_get_marker(&scratch_stack);
+	return scratch;
+}
+
+void scratch_end(scratch_t scratch) {
+	if (scratch.stack)
+		stack_free_to_marker(scratch.stack, scratch.marker);
+}
+
+void *scratch_alloc(scratch_t *scratch, uint64_t size) {
+	stack_allocator_t *stack = scratch->stack;
+	if (!stack || !stack->memory)
+		return 0;
+
+	/* Check here, a full stack_allocate logs and logging needs scratch. */
+	if (stack->offset + size + SCRATCH_ALIGNMENT > stack->total_size)
+		return 0;
+
+	return stack_allocate_align(stack, size, SCRATCH_ALIGNMENT);
+}
+
+void scratch_thread_shut(void) {
+	if (!scratch_stack.memory)
+		return;
+
+	void *memory = scratch_stack.memory;
+	stack_shut(&scratch_stack);
+	platform_free_pages(memory, SCRATCH_SIZE, PLATFORM_PAGES_NORMAL);
+}
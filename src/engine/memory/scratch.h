@@ -0,0 +1,38 @@
+#ifndef __SCRATCH_H__
+#define __SCRATCH_H__
+
+#include "engine/define.h"
+#include "engine/memory/stack.h"
+
+/* Per thread scratch memory for temporaries that would otherwise sit on the
+ * C stack or take a trip through the heap: paths, format buffers, pixels
+ * generated before upload. Each thread gets its own stack_allocator_t over
+ * SCRATCH_SIZE of lazily backed pages, taken on first use.
+ *
+ * scratch_begin takes a marker and scratch_end rolls back to it, so scopes
+ * nest as long as they end in reverse order:
+ *
+ *     scratch_t scratch = scratch_begin();
+ *     char *path = scratch_alloc(&scratch, 512);
+ *     ...
+ *     scratch_end(scratch);
+ *
+ * scratch_alloc returns 0 without logging once the stack is full, the
+ * logger runs on scratch memory too. */
+
+#define SCRATCH_SIZE MEBIBYTES(4)
+
+typedef struct scratch_t {
+	stack_allocator_t *stack;
+	stack_marker marker;
+} scratch_t;
+
+scratch_t scratch_begin(void);
+void scratch_end(scratch_t scratch);
+void *scratch_alloc(scratch_t *scratch, uint64_t size);
+
+/* Give the calling thread's scratch pages back. Worker threads call it
+ * before they exit, the next scratch_begin maps them again. */
+void scratch_thread_shut(void);
+
+#endif //__SCRATCH_H__
@@ -0,0 +1,192 @@
+#include "engine/memory/slab.h"
+
+#include "engine/core/logger.h"
+
+#define SLAB_ALIGNMENT 0x10 // 16
+
+/* 16B steps up to 128B, then four classes per power of two up to 1KiB. */
+static const uint16_t slab_class_size[SLAB_CLASS_COUNT] = {
+	16,  32,  48,  64,  80,  96,  112, 128, 160, 192,
+	224, 256, 320, 384, 448, 512, 640, 768, 896, 1024
+};
+
+static slab_classes_t slab_classes;
+static b8 slab_classes_ready;
+
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+b8 slab_grow(slab_t *slab) {
+	slab_span_t *span =
+		slab->heap ? dyn_alloc_allocate(slab->heap, slab->span_size)
+				   : memory_alloc_uninit(slab->span_size, MEMTAG_SLAB_ALLOCATOR);
+	if (!span) {
+		ar_ERROR("slab - failed to get a %lluB span", slab->span_size);
+		return false;
+	}
+
+	span->next = slab->spans;
+	span->size = slab->span_size;
+	slab->spans = span;
+	slab->span_count++;
+
+	/* Objects get carved off lazily so a fresh span is not touched. */
+	uint64_t header = (sizeof(slab_span_t) + SLAB_ALIGNMENT - 1) &
+					  ~(uint64_t)(SLAB_ALIGNMENT - 1);
+	slab->span_cursor = (char *)span + header;
+	slab->span_end = (char *)span + slab->span_size;
+	return true;
+}
+/* ========================================================================== */
+/* ========================================================================== */
+
+void *slab_pop(slab_t *slab) {
+	void *block = slab->free_list;
+	if (block) {
+		slab->free_list = *(void **)block;
+	} else {
+		if (slab->span_cursor + slab->object_size > slab->span_end &&
+			!slab_grow(slab))
+			return 0;
+
+		block = slab->span_cursor;
+		slab->span_cursor += slab->object_size;
+	}
+
+	slab->live_count++;
+	return block;
+}
+
+void slab_push(slab_t *slab, void *block) {
+	*(void **)block = slab->free_list;
+	slab->free_list = block;
+	slab->live_count--;
+}
+
+void slab_init(uint64_t object_size, uint32_t objects_per_span, mem_tag_t tag,
+               slab_t *slab) {
+	if (!slab)
+		return;
+
+	memory_zero(slab, sizeof(slab_t));
+
+	/* Free objects hold the next pointer, and everything stays 16B
+	 * aligned. */
+	if (object_size < sizeof(void *))
+		object_size = sizeof(void *);
+	slab->object_size = (object_size + SLAB_ALIGNMENT - 1) &
+						~(uint64_t)(SLAB_ALIGNMENT - 1);
+
+	if (!objects_per_span)
+		objects_per_span = 1;
+	uint64_t header = (sizeof(slab_span_t) + SLAB_ALIGNMENT - 1) &
+					  ~(uint64_t)(SLAB_ALIGNMENT - 1);
+	slab->span_size = header + slab->object_size * objects_per_span;
+	slab->tag = tag;
+}
+
+void slab_shut(slab_t *slab) {
+	if (!slab)
+		return;
+
+	if (slab->live_count)
+		ar_WARNING("slab_shut - %llu objects of %lluB still alive",
+				   slab->live_count, slab->object_size);
+
+	slab_span_t *span = slab->spans;
+	while (span) {
+		slab_span_t *next = span->next;
+		if (slab->heap)
+			dyn_alloc_free(slab->heap, span, span->size);
+		else
+			memory_free(span, span->size, MEMTAG_SLAB_ALLOCATOR);
+		span = next;
+	}
+
+	memory_zero(slab, sizeof(slab_t));
+}
+
+void *slab_allocate(slab_t *slab) {
+	void *block = slab_pop(slab);
+	if (block)
+		memory_track_alloc(slab->object_size, slab->tag);
+	return block;
+}
+
+void slab_release(slab_t *slab, void *block) {
+	if (block) {
+		slab_push(slab, block);
+		memory_track_free(slab->object_size, slab->tag);
+	}
+}
+
+uint32_t slab_class_index(uint64_t size) {
+	if (size <= 128)
+		return size ? (uint32_t)((size - 1) >> 4) : 0;
+
+	/* Top bit picks the power of two, next two bits the quarter in it. */
+	uint32_t top = (uint32_t)(63 - __builtin_clzll(size - 1));
+	uint32_t quarter = (uint32_t)((size - 1) >> (top - 2)) & 0x3;
+	return 8 + (top - 7) * 4 + quarter;
+}
+
+void slab_classes_init(slab_classes_t *set, dyn_alloc_t *heap) {
+	for (uint32_t i = 0; i < SLAB_CLASS_COUNT; ++i) {
+		slab_init(slab_class_size[i],
+				  (uint32_t)(SLAB_SPAN_SIZE / slab_class_size[i]) - 1,
+				  MEMTAG_SLAB_ALLOCATOR, &set->classes[i]);
+		set->classes[i].heap = heap;
+	}
+}
+
+void slab_classes_shut(slab_classes_t *set) {
+	for (uint32_t i = 0; i < SLAB_CLASS_COUNT; ++i)
+		slab_shut(&set->classes[i]);
+}
+
+void *slab_classes_pop(slab_classes_t *set, uint64_t size) {
+	return slab_pop(&set->classes[slab_class_index(size)]);
+}
+
+void slab_classes_push(slab_classes_t *set, void *block, uint64_t size) {
+	slab_push(&set->classes[slab_class_index(size)], block);
+}
+
+void slab_sys_init(void) {
+	slab_classes_init(&slab_classes, 0);
+	slab_classes_ready = true;
+}
+
+void slab_sys_shut(void) {
+	if (!slab_classes_ready)
+		return;
+
+	slab_classes_shut(&slab_classes);
+	slab_classes_ready = false;
+}
+
+void *slab_alloc(uint64_t size, mem_tag_t tag) {
+	if (size > SLAB_OBJECT_MAX || !slab_classes_ready ||
+		memory_tag_heap(tag))
+		return memory_alloc_uninit(size, tag);
+
+	/* Class slabs are shared between tags, the object is counted against
+	 * the caller's tag at the size it asked for. */
+	void *block = slab_classes_pop(&slab_classes, size);
+	if (block)
+		memory_track_alloc(size, tag);
+	return block;
+}
+
+void slab_free(void *block, uint64_t size, mem_tag_t tag) {
+	if (!block)
+		return;
+
+	if (size > SLAB_OBJECT_MAX || !slab_classes_ready ||
+		memory_tag_heap(tag)) {
+		memory_free(block, size, tag);
+		return;
+	}
+
+	slab_classes_push(&slab_classes, block, size);
+	memory_track_free(size, tag);
+}
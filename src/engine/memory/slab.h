@@ -0,0 +1,78 @@
+#ifndef __SLAB_H__
+#define __SLAB_H__
+
+#include "engine/define.h"
+#include "engine/memory/memory.h"
+
+/* Slab allocator for small fixed size objects. A slab carves same sized
+ * objects out of spans taken from the heap and keeps freed ones on an
+ * intrusive free list, so alloc and free are a pointer pop/push with no
+ * heap walk and no per object header. Spans stay with the slab until
+ * slab_shut.
+ *
+ * A slab_t on its own is a per type pool. slab_alloc / slab_free route a
+ * size to one of the shared size class slabs between 16B and 1KiB, larger
+ * requests go to memory_alloc, and so does every size for a tag that has a
+ * memory sub-heap of its own. Objects are counted against their tag, the
+ * spans under MEMTAG_SLAB_ALLOCATOR.
+ *
+ * Not thread safe, same as the arena and stack allocators. */
+
+#define SLAB_OBJECT_MAX 1024
+#define SLAB_SPAN_SIZE KIBIBYTES(64)
+#define SLAB_CLASS_COUNT 20
+
+typedef struct slab_span_t {
+	struct slab_span_t *next;
+	uint64_t size;
+} slab_span_t;
+
+typedef struct slab_t {
+	uint64_t object_size;
+	uint64_t span_size;
+	mem_tag_t tag;
+
+	void *free_list;
+	char *span_cursor; // untouched tail of the newest span
+	char *span_end;
+	slab_span_t *spans;
+
+	uint64_t span_count;
+	uint64_t live_count;
+
+	dyn_alloc_t *heap; // spans come from here, 0 takes them from memory_alloc
+} slab_t;
+
+/* One slab per size class, what slab_alloc runs on. A memory sub-heap keeps
+ * a set of its own over its own dyn_alloc. */
+typedef struct slab_classes_t {
+	slab_t classes[SLAB_CLASS_COUNT];
+} slab_classes_t;
+
+void slab_init(uint64_t object_size, uint32_t objects_per_span, mem_tag_t tag,
+               slab_t *slab);
+void slab_shut(slab_t *slab);
+
+void *slab_allocate(slab_t *slab);
+void slab_release(slab_t *slab, void *block);
+
+/* Without tag accounting, for owners that count on their own. */
+void *slab_pop(slab_t *slab);
+void slab_push(slab_t *slab, void *block);
+
+/* Size classes over 'heap', 0 for memory_alloc spans. Sizes up to
+ * SLAB_OBJECT_MAX, a block goes back with the size it was taken with. */
+uint32_t slab_class_index(uint64_t size);
+void slab_classes_init(slab_classes_t *set, dyn_alloc_t *heap);
+void slab_classes_shut(slab_classes_t *set);
+void *slab_classes_pop(slab_classes_t *set, uint64_t size);
+void slab_classes_push(slab_classes_t *set, void *block, uint64_t size);
+
+/* Size class slabs. Created with memory_init and gone with memory_shut. */
+void slab_sys_init(void);
+void slab_sys_shut(void);
+
+_arapi void *slab_alloc(uint64_t size, mem_tag_t tag);
+_arapi void slab_free(void *block, uint64_t size, mem_tag_t tag);
+
+#endif //__SLAB_H__
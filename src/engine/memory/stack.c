@@ -43,7 +43,7 @@ void stack_shut(stack_allocator_t *allocator) {
 
 		if (allocator->own_memory && allocator->memory)
 		  	memory_free(allocator->memory, allocator->total_size,
-					  	MEMTAG_ARENA_ALLOCATOR);
+					  	MEMTAG_STACK_ALLOCATOR);
 
         allocator->memory = 0;
 		allocator->total_size = 0;
@@ -0,0 +1,527 @@
+#include "engine/memory/tlsf.h"
+
+#include "engine/core/logger.h"
+#include "engine/memory/memory.h"
+
+#define TLSF_ALIGN_LOG2 4
+#define SL_INDEX_COUNT_LOG2 5
+#define SL_INDEX_COUNT (1 << SL_INDEX_COUNT_LOG2)
+
+/* Blocks below SMALL_BLOCK_SIZE all live in first level 0, split linearly
+ * into SL_INDEX_COUNT bins of TLSF_ALIGN_SIZE each. */
+#define FL_INDEX_SHIFT (SL_INDEX_COUNT_LOG2 + TLSF_ALIGN_LOG2)
+#define FL_INDEX_MAX 40 // blocks stay under 1 TiB
+#define FL_INDEX_COUNT (FL_INDEX_MAX - FL_INDEX_SHIFT + 1)
+#define SMALL_BLOCK_SIZE ((uint64_t)1 << FL_INDEX_SHIFT)
+
+#define BLOCK_FREE_BIT 0x1
+#define BLOCK_PREV_FREE_BIT 0x2
+
+typedef struct tlsf_block_t {
+	struct tlsf_block_t *prev_phys;
+	uint64_t size; // payload size, low bits hold the free flags
+
+	/* Only valid while the block is free, they sit inside the payload. */
+	struct tlsf_block_t *next_free;
+	struct tlsf_block_t *prev_free;
+} tlsf_block_t;
+
+#define BLOCK_HEADER_SIZE (sizeof(tlsf_block_t *) + sizeof(uint64_t))
+#define BLOCK_SIZE_MIN (sizeof(tlsf_block_t) - BLOCK_HEADER_SIZE)
+/* Exclusive, a block of 1 << FL_INDEX_MAX would map one level past the
+ * tables and the 32 bit fl_bitmap. */
+#define BLOCK_SIZE_MAX ((uint64_t)1 << FL_INDEX_MAX)
+
+typedef struct internal_state_t {
+	uint64_t total_size;
+	uint64_t free_size;
+	uint64_t free_count;
+	uint32_t fl_bitmap;
+	uint32_t sl_bitmap[FL_INDEX_COUNT];
+	tlsf_block_t *blocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
+	tlsf_block_t *pool;
+	tlsf_block_t *sentinel;
+} internal_state_t;
+
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+_arinline int32_t bit_ffs(uint32_t word) {
+	return word ? __builtin_ctz(word) : -1;
+}
+
+_arinline int32_t bit_fls(uint64_t word) {
+	return word ? 63 - __builtin_clzll(word) : -1;
+}
+
+_arinline uint64_t align_up(uint64_t x, uint64_t align) {
+	return (x + (align - 1)) & ~(align - 1);
+}
+
+_arinline uint64_t block_size(const tlsf_block_t *block) {
+	return block->size & ~(uint64_t)(BLOCK_FREE_BIT | BLOCK_PREV_FREE_BIT);
+}
+
+_arinline void block_set_size(tlsf_block_t *block, uint64_t size) {
+	block->size = size | (block->size & (BLOCK_FREE_BIT | BLOCK_PREV_FREE_BIT));
+}
+
+_arinline b8 block_is_free(const tlsf_block_t *block) {
+	return (block->size & BLOCK_FREE_BIT) != 0;
+}
+
+_arinline b8 block_is_prev_free(const tlsf_block_t *block) {
+	return (block->size & BLOCK_PREV_FREE_BIT) != 0;
+}
+
+_arinline b8 block_is_last(const tlsf_block_t *block) {
+	return block_size(block) == 0;
+}
+
+_arinline void *block_to_ptr(tlsf_block_t *block) {
+	return (char *)block + BLOCK_HEADER_SIZE;
+}
+
+_arinline tlsf_block_t *block_from_ptr(void *ptr) {
+	return (tlsf_block_t *)((char *)ptr - BLOCK_HEADER_SIZE);
+}
+
+_arinline tlsf_block_t *block_next(tlsf_block_t *block) {
+	return (tlsf_block_t *)((char *)block_to_ptr(block) + block_size(block));
+}
+
+/* Tell the physical neighbour after this block where we start. */
+_arinline tlsf_block_t *block_link_next(tlsf_block_t *block) {
+	tlsf_block_t *next = block_next(block);
+	next->prev_phys    = block;
+	return next;
+}
+
+static void block_mark_free(tlsf_block_t *block) {
+	tlsf_block_t *next = block_link_next(block);
+	next->size |= BLOCK_PREV_FREE_BIT;
+	block->size |= BLOCK_FREE_BIT;
+}
+
+static void block_mark_used(tlsf_block_t *block) {
+	tlsf_block_t *next = block_next(block);
+	next->size &= ~(uint64_t)BLOCK_PREV_FREE_BIT;
+	block->size &= ~(uint64_t)BLOCK_FREE_BIT;
+}
+
+/* Exact bin for a block of this size. */
+static void mapping_insert(uint64_t size, int32_t *fl, int32_t *sl) {
+	if (size < SMALL_BLOCK_SIZE) {
+		*fl = 0;
+		*sl = (int32_t)(size / (SMALL_BLOCK_SIZE / SL_INDEX_COUNT));
+	} else {
+		int32_t f = bit_fls(size);
+		*sl = (int32_t)(size >> (f - SL_INDEX_COUNT_LOG2)) ^
+			  (1 << SL_INDEX_COUNT_LOG2);
+		*fl = f - (FL_INDEX_SHIFT - 1);
+	}
+}
+
+/* Round the request up to the next bin, so any block found there fits. */
+static void mapping_search(uint64_t size, int32_t *fl, int32_t *sl) {
+	if (size >= SMALL_BLOCK_SIZE) {
+		uint64_t round = ((uint64_t)1 << (bit_fls(size) - SL_INDEX_COUNT_LOG2)) - 1;
+		size += round;
+	}
+	mapping_insert(size, fl, sl);
+}
+
+static tlsf_block_t *search_suitable(internal_state_t *state, int32_t *fl,
+                                     int32_t *sl) {
+	int32_t f = *fl;
+	int32_t s = *sl;
+	if (f >= FL_INDEX_COUNT)
+		return 0;
+
+	uint32_t sl_map = state->sl_bitmap[f] & (~0u << s);
+	if (!sl_map) {
+		/* Nothing left on this level, take the smallest non-empty level
+		 * above it. */
+		uint32_t fl_map = f + 1 < 32 ? state->fl_bitmap & (~0u << (f + 1)) : 0;
+		if (!fl_map)
+			return 0;
+
+		f = bit_ffs(fl_map);
+		sl_map = state->sl_bitmap[f];
+	}
+
+	s = bit_ffs(sl_map);
+	*fl = f;
+	*sl = s;
+	return state->blocks[f][s];
+}
+
+static void remove_free_block(internal_state_t *state, tlsf_block_t *block,
+                              int32_t fl, int32_t sl) {
+	tlsf_block_t *prev = block->prev_free;
+	tlsf_block_t *next = block->next_free;
+	if (next)
+		next->prev_free = prev;
+	if (prev)
+		prev->next_free = next;
+
+	if (state->blocks[fl][sl] == block) {
+		state->blocks[fl][sl] = next;
+
+		if (!next) {
+			state->sl_bitmap[fl] &= ~(1u << sl);
+			if (!state->sl_bitmap[fl])
+				state->fl_bitmap &= ~(1u << fl);
+		}
+	}
+
+	state->free_size -= block_size(block);
+	state->free_count--;
+}
+
+static void insert_free_block(internal_state_t *state, tlsf_block_t *block,
+                              int32_t fl, int32_t sl) {
+	tlsf_block_t *curr = state->blocks[fl][sl];
+	block->next_free = curr;
+	block->prev_free = 0;
+	if (curr)
+		curr->prev_free = block;
+
+	state->blocks[fl][sl] = block;
+	state->fl_bitmap |= (1u << fl);
+	state->sl_bitmap[fl] |= (1u << sl);
+	state->free_size += block_size(block);
+	state->free_count++;
+}
+
+static void block_remove(internal_state_t *state, tlsf_block_t *block) {
+	int32_t fl, sl;
+	mapping_insert(block_size(block), &fl, &sl);
+	remove_free_block(state, block, fl, sl);
+}
+
+static void block_insert(internal_state_t *state, tlsf_block_t *block) {
+	int32_t fl, sl;
+	mapping_insert(block_size(block), &fl, &sl);
+	insert_free_block(state, block, fl, sl);
+}
+
+_arinline b8 block_can_split(tlsf_block_t *block, uint64_t size) {
+	return block_size(block) >= sizeof(tlsf_block_t) + size;
+}
+
+/* Cut 'size' bytes off the front, the tail becomes its own free block. */
+static tlsf_block_t *block_split(tlsf_block_t *block, uint64_t size) {
+	tlsf_block_t *remain = (tlsf_block_t *)((char *)block_to_ptr(block) + size);
+	uint64_t remain_size = block_size(block) - (size + BLOCK_HEADER_SIZE);
+
+	remain->size = remain_size;
+	block_set_size(block, size);
+	block_mark_free(remain);
+	return remain;
+}
+
+/* Swallow 'block' into its physical predecessor 'prev'. */
+static tlsf_block_t *block_absorb(tlsf_block_t *prev, tlsf_block_t *block) {
+	prev->size += block_size(block) + BLOCK_HEADER_SIZE;
+	block_link_next(prev);
+	return prev;
+}
+
+static tlsf_block_t *block_merge_prev(internal_state_t *state,
+                                      tlsf_block_t *block) {
+	if (block_is_prev_free(block)) {
+		tlsf_block_t *prev = block->prev_phys;
+		block_remove(state, prev);
+		block = block_absorb(prev, block);
+	}
+
+	return block;
+}
+
+static tlsf_block_t *block_merge_next(internal_state_t *state,
+                                      tlsf_block_t *block) {
+	tlsf_block_t *next = block_next(block);
+	if (block_is_free(next)) {
+		block_remove(state, next);
+		block = block_absorb(block, next);
+	}
+
+	return block;
+}
+
+static void block_trim_free(internal_state_t *state, tlsf_block_t *block,
+                            uint64_t size) {
+	if (block_can_split(block, size)) {
+		tlsf_block_t *remain = block_split(block, size);
+		block_link_next(block);
+		remain->size |= BLOCK_PREV_FREE_BIT;
+		block_insert(state, remain);
+	}
+}
+
+static uint64_t adjust_request(uint64_t size) {
+	uint64_t adjust = align_up(size, TLSF_ALIGN_SIZE);
+	return adjust < BLOCK_SIZE_MIN ? BLOCK_SIZE_MIN : adjust;
+}
+
+/* ========================================================================== */
+/* ========================================================================== */
+void tlsf_init(uint64_t total_size, uint64_t *mem_require, void *memory,
+               tlsf_t *tlsf) {
+	uint64_t pool_size = align_up(total_size, TLSF_ALIGN_SIZE);
+	uint64_t state_size = align_up(sizeof(internal_state_t), TLSF_ALIGN_SIZE);
+
+	/* Pool needs room for the first block header and the zero sized
+	 * sentinel header that closes it. Extra align slack for the caller
+	 * handing in an unaligned block. */
+	*mem_require = state_size + TLSF_ALIGN_SIZE + BLOCK_HEADER_SIZE +
+				   pool_size + BLOCK_HEADER_SIZE;
+	if (!memory)
+		return;
+
+	if (pool_size < BLOCK_SIZE_MIN || pool_size >= BLOCK_SIZE_MAX) {
+		ar_ERROR("tlsf_init - pool size %llu must be at least %llu and "
+				 "under %llu",
+				 pool_size, (uint64_t)BLOCK_SIZE_MIN, BLOCK_SIZE_MAX);
+		return;
+	}
+
+	tlsf->memory = memory;
+	internal_state_t *state = tlsf->memory;
+	memory_zero(state, sizeof(internal_state_t));
+	state->total_size = pool_size;
+
+	uintptr_t pool_addr =
+		align_up((uintptr_t)memory + state_size, TLSF_ALIGN_SIZE);
+	state->pool = (tlsf_block_t *)pool_addr;
+
+	/* One free block spanning the pool, its predecessor counts as used so
+	 * nothing ever tries to merge backwards out of the pool. */
+	tlsf_block_t *block = state->pool;
+	block->prev_phys = 0;
+	block->size = pool_size;
+	block_mark_free(block);
+	block_insert(state, block);
+
+	state->sentinel = block_link_next(block);
+	state->sentinel->size = 0 | BLOCK_PREV_FREE_BIT;
+}
+
+void tlsf_shut(tlsf_t *tlsf) {
+	if (tlsf && tlsf->memory) {
+		memory_zero(tlsf->memory, sizeof(internal_state_t));
+		tlsf->memory = 0;
+	}
+}
+
+b8 tlsf_grow(tlsf_t *tlsf, uint64_t size) {
+	if (!tlsf || !tlsf->memory)
+		return false;
+
+	size = align_up(size, TLSF_ALIGN_SIZE);
+	if (size < sizeof(tlsf_block_t)) {
+		ar_ERROR("tlsf_grow - need at least %lluB to grow, got %lluB",
+				 (uint64_t)sizeof(tlsf_block_t), size);
+		return false;
+	}
+
+	/* The grown range can merge with a free block in front of it, keep the
+	 * pool as a whole under the largest block. */
+	internal_state_t *state = tlsf->memory;
+	if (state->total_size + size >= BLOCK_SIZE_MAX) {
+		ar_ERROR("tlsf_grow - pool of %llu + %lluB would reach the %lluB "
+				 "block limit", state->total_size, size, BLOCK_SIZE_MAX);
+		return false;
+	}
+
+	/* Old sentinel becomes a free block over the new range, and a fresh
+	 * sentinel closes the pool again. */
+	tlsf_block_t *block = state->sentinel;
+	block->size = (size - BLOCK_HEADER_SIZE) |
+				  (block->size & BLOCK_PREV_FREE_BIT);
+	block_mark_free(block);
+
+	state->sentinel = block_next(block);
+	state->sentinel->size = 0 | BLOCK_PREV_FREE_BIT;
+
+	block = block_merge_prev(state, block);
+	block_insert(state, block);
+	state->total_size += size;
+	return true;
+}
+
+void *tlsf_block_alloc(tlsf_t *tlsf, uint64_t size) {
+	if (!tlsf || !tlsf->memory || !size || size >= BLOCK_SIZE_MAX)
+		return 0;
+
+	internal_state_t *state = tlsf->memory;
+	uint64_t adjust = adjust_request(size);
+
+	int32_t fl, sl;
+	mapping_search(adjust, &fl, &sl);
+	tlsf_block_t *block = search_suitable(state, &fl, &sl);
+	if (!block)
+		return 0;
+
+	remove_free_block(state, block, fl, sl);
+	block_trim_free(state, block, adjust);
+	block_mark_used(block);
+	return block_to_ptr(block);
+}
+
+void *tlsf_block_alloc_aligned(tlsf_t *tlsf, uint64_t size, uint64_t align) {
+	if (align <= TLSF_ALIGN_SIZE)
+		return tlsf_block_alloc(tlsf, size);
+
+	if (!tlsf || !tlsf->memory || !size || size >= BLOCK_SIZE_MAX ||
+		(align & (align - 1)))
+		return 0;
+
+	/* Search for enough slack to slide the start up to the boundary, with
+	 * the gap in front big enough to stand as a free block. */
+	internal_state_t *state = tlsf->memory;
+	uint64_t adjust = adjust_request(size);
+	uint64_t gap_min = sizeof(tlsf_block_t);
+
+	int32_t fl, sl;
+	mapping_search(adjust + align + gap_min, &fl, &sl);
+	tlsf_block_t *block = search_suitable(state, &fl, &sl);
+	if (!block)
+		return 0;
+
+	remove_free_block(state, block, fl, sl);
+
+	uintptr_t ptr = (uintptr_t)block_to_ptr(block);
+	uint64_t gap = align_up(ptr, align) - ptr;
+	if (gap && gap < gap_min)
+		gap = align_up(ptr + gap_min, align) - ptr;
+
+	if (gap) {
+		tlsf_block_t *aligned = block_split(block, gap - BLOCK_HEADER_SIZE);
+		block_link_next(block);
+		aligned->size |= BLOCK_PREV_FREE_BIT;
+		block_insert(state, block);
+		block = aligned;
+	}
+
+	block_trim_free(state, block, adjust);
+	block_mark_used(block);
+	return block_to_ptr(block);
+}
+
+b8 tlsf_block_free(tlsf_t *tlsf, void *block) {
+	if (!tlsf || !tlsf->memory || !block)
+		return false;
+
+	internal_state_t *state = tlsf->memory;
+	tlsf_block_t *b = block_from_ptr(block);
+	if (block_is_free(b)) {
+		ar_WARNING("tlsf_block_free - block (0x%p) already freed", block);
+		return false;
+	}
+
+	block_mark_free(b);
+	b = block_merge_prev(state, b);
+	b = block_merge_next(state, b);
+	block_insert(state, b);
+	return true;
+}
+
+b8 tlsf_block_resize(tlsf_t *tlsf, void *block, uint64_t size) {
+	if (!tlsf || !tlsf->memory || !block || !size || size >= BLOCK_SIZE_MAX)
+		return false;
+
+	internal_state_t *state = tlsf->memory;
+	tlsf_block_t *b = block_from_ptr(block);
+	uint64_t adjust = adjust_request(size);
+
+	/* Growing takes the free block right after, if it is big enough. */
+	if (adjust > block_size(b)) {
+		tlsf_block_t *next = block_next(b);
+		if (!block_is_free(next) ||
+			block_size(b) + BLOCK_HEADER_SIZE + block_size(next) < adjust)
+			return false;
+
+		block_remove(state, next);
+		block_absorb(b, next);
+		block_mark_used(b);
+	}
+
+	/* Whatever is left over past 'adjust' goes back, joined with a free
+	 * block after it. */
+	if (block_can_split(b, adjust)) {
+		tlsf_block_t *remain = block_split(b, adjust);
+		block_link_next(b);
+		remain = block_merge_next(state, remain);
+		block_insert(state, remain);
+	}
+
+	return true;
+}
+
+b8 tlsf_block_at_end(tlsf_t *tlsf, void *block) {
+	if (!tlsf || !tlsf->memory || !block)
+		return false;
+
+	internal_state_t *state = tlsf->memory;
+	tlsf_block_t *next = block_next(block_from_ptr(block));
+	if (next == state->sentinel)
+		return true;
+
+	return block_is_free(next) && block_next(next) == state->sentinel;
+}
+
+uint64_t tlsf_block_size(void *block) {
+	if (!block)
+		return 0;
+
+	return block_size(block_from_ptr(block));
+}
+
+uint64_t tlsf_space_free(tlsf_t *tlsf) {
+	if (!tlsf || !tlsf->memory)
+		return 0;
+
+	internal_state_t *state = tlsf->memory;
+	return state->free_size;
+}
+
+uint64_t tlsf_largest_free(tlsf_t *tlsf) {
+	if (!tlsf || !tlsf->memory)
+		return 0;
+
+	internal_state_t *state = tlsf->memory;
+	if (!state->fl_bitmap)
+		return 0;
+
+	/* Highest non-empty bin holds the biggest block, but a bin spans a
+	 * range of sizes so its list still needs a look. */
+	int32_t fl = bit_fls(state->fl_bitmap);
+	int32_t sl = bit_fls(state->sl_bitmap[fl]);
+	uint64_t largest = 0;
+	for (tlsf_block_t *b = state->blocks[fl][sl]; b; b = b->next_free) {
+		if (block_size(b) > largest)
+			largest = block_size(b);
+	}
+
+	return largest;
+}
+
+uint64_t tlsf_free_count(tlsf_t *tlsf) {
+	if (!tlsf || !tlsf->memory)
+		return 0;
+
+	internal_state_t *state = tlsf->memory;
+	return state->free_count;
+}
+
+uint64_t tlsf_tail_free(tlsf_t *tlsf) {
+	if (!tlsf || !tlsf->memory)
+		return 0;
+
+	internal_state_t *state = tlsf->memory;
+	if (!block_is_prev_free(state->sentinel))
+		return 0;
+
+	return block_size(state->sentinel->prev_phys);
+}
@@ -0,0 +1,50 @@
+#ifndef __TLSF_H__
+#define __TLSF_H__
+
+#include "engine/define.h"
+
+/* Two-Level Segregated Fit allocator. Free blocks are binned by a first level
+ * (power of two) and a second level (linear subdivision of that power), so
+ * both allocate and free are a handful of bit scans with no list walk.
+ * Neighbouring free blocks are merged immediately on free. */
+
+#define TLSF_ALIGN_SIZE 0x10 // 16
+
+typedef struct tlsf_t {
+	void *memory;
+} tlsf_t;
+
+_arapi void tlsf_init(uint64_t total_size, uint64_t *mem_require,
+                      void *memory, tlsf_t *tlsf);
+_arapi void tlsf_shut(tlsf_t *tlsf);
+
+/* Extend the pool by 'size' bytes right after its current end. Caller makes
+ * sure that memory is backed. */
+_arapi b8 tlsf_grow(tlsf_t *tlsf, uint64_t size);
+
+_arapi void *tlsf_block_alloc(tlsf_t *tlsf, uint64_t size);
+
+/* Block starting on 'align', a power of two. The slack in front goes back
+ * as a free block, so it frees like any other block. */
+_arapi void *tlsf_block_alloc_aligned(tlsf_t *tlsf, uint64_t size,
+                                      uint64_t align);
+_arapi b8    tlsf_block_free(tlsf_t *tlsf, void *block);
+
+/* Grow or shrink a used block where it is. Growing needs a free block right
+ * after it with enough room, false leaves the block untouched. End tells if
+ * only free space sits between the block and the end of the pool, so that
+ * tlsf_grow would make room for it. */
+_arapi b8 tlsf_block_resize(tlsf_t *tlsf, void *block, uint64_t size);
+_arapi b8 tlsf_block_at_end(tlsf_t *tlsf, void *block);
+
+_arapi uint64_t tlsf_block_size(void *block);
+_arapi uint64_t tlsf_space_free(tlsf_t *tlsf);
+
+/* Fragmentation queries. Largest looks at one bin only, the count is kept
+ * as blocks enter and leave the bins. Tail is the free block right before
+ * the end of the pool, the one tlsf_grow would extend, or 0. */
+_arapi uint64_t tlsf_largest_free(tlsf_t *tlsf);
+_arapi uint64_t tlsf_free_count(tlsf_t *tlsf);
+_arapi uint64_t tlsf_tail_free(tlsf_t *tlsf);
+
+#endif //__TLSF_H__
@@ -8,11 +8,36 @@ b8   platform_init(uint64_t *memory_require, void *state, const char *name,
 void platform_shut(void *state);
 b8 platform_push(void);
 
-/* Function for memory allocation */
+/* Function for memory allocation. Aligned blocks start on an
+ * AR_CACHE_LINE boundary, free them with aligned set too. */
+
 void *platform_allocate(uint64_t size, b8 aligned);
 void platform_free(void *block, b8 aligned);
 void* platform_zero_mem(void* block, uint64_t size);
 void* platform_copy_mem(void* dest, const void* source, uint64_t size);
 void* platform_set_mem(void* dest, int32_t value, uint64_t size);
 
+/* Page backing for big, randomly touched blocks. Huge asks the kernel for
+ * 2MiB pages (explicit hugetlb first, transparent huge pages otherwise) and
+ * quietly ends up with normal pages when neither is there. */
+typedef enum platform_page_mode_t {
+	PLATFORM_PAGES_NORMAL = 0x00,
+	PLATFORM_PAGES_HUGE
+} platform_page_mode_t;
+
+/* Whole pages straight from the OS, committed and zeroed. Free with the
+ * same size and mode it was allocated with. */
+void *platform_allocate_pages(uint64_t size, platform_page_mode_t mode);
+void platform_free_pages(void *block, uint64_t size, platform_page_mode_t mode);
+
+/* Function for virtual memory. Reserve only claims address space, pages are
+ * backed once they get committed. A huge reservation starts on a huge page
+ * boundary so committed ranges can be backed by huge pages. */
+uint64_t platform_page_size(void);
+uint64_t platform_huge_page_size(void);
+void *platform_reserve(uint64_t size, platform_page_mode_t mode);
+b8 platform_commit(void *block, uint64_t size);
+void platform_decommit(void *block, uint64_t size);
+void platform_release(void *block, uint64_t size);
+
 #endif //__PLATFORM_H__
@@ -292,7 +292,7 @@ b8 platform_push(void) {
 					c.data.u16[0] = cfg_ev->width;
 					c.data.u16[1] = cfg_ev->height;
 
-					event_push(EVENT_CODE_RESIZED, 0, c);
+					event_post(EVENT_CODE_RESIZED, 0, c);
 				} break;
 
 				case XCB_UNMAP_NOTIFY:
@@ -300,9 +300,9 @@ b8 platform_push(void) {
 
                     event_context_t c = {0};
                     if (is_window_minimized(p_state->conn, p_state->window)) {
-						event_push(EVENT_CODE_APP_SUSPEND, 0, c);
+						event_post(EVENT_CODE_APP_SUSPEND, 0, c);
 					} else {
-						event_push(EVENT_CODE_APP_RESUME, 0, c);
+						event_post(EVENT_CODE_APP_RESUME, 0, c);
 					}
 				} break;
 
@@ -314,7 +314,7 @@ b8 platform_push(void) {
 
 						event_context_t c;
 						c.data.u8[0] = cm->window;
-						event_push(EVENT_CODE_APPLICATION_QUIT, 0, c);
+						event_post(EVENT_CODE_APPLICATION_QUIT, 0, c);
 					}
 				} break;
 				default: break;
@@ -327,28 +327,6 @@ b8 platform_push(void) {
 	return true;
 }
 
-void *platform_allocate(uint64_t size, b8 aligned) {
-	(void)aligned;
-	return malloc(size);
-}
-
-void platform_free(void *block, b8 aligned) {
-	(void)aligned;
-	free(block);
-}
-
-void* platform_zero_mem(void* block, uint64_t size) {
-	return memset(block, 0, size);
-}
-
-void* platform_copy_mem(void* dest, const void* source, uint64_t size) {
-	return memcpy(dest, source, size);
-}
-
-void* platform_set_mem(void* dest, int32_t value, uint64_t size) {
-	return memset(dest, value, size);
-}
-
 b8 platform_create_vulkan_surface(struct vulkan_context_t *context) {
 	if (!p_state)
 		return false;
@@ -0,0 +1,197 @@
+/* mmap flags like MAP_ANONYMOUS are hidden under strict c99. */
+#define _GNU_SOURCE
+#include "engine/platform/platform.h"
+
+#if OS_LINUX
+
+/* Memory half of the linux platform layer. Kept apart from the window and
+ * input code so headless tools can link the allocators without X11/Vulkan. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Widen a range to the whole pages it touches. */
+static void page_range(void *block, uint64_t size, uintptr_t *start,
+                       uint64_t *length) {
+	uintptr_t page = (uintptr_t)platform_page_size();
+	uintptr_t begin = (uintptr_t)block & ~(page - 1);
+	uintptr_t end = ((uintptr_t)block + size + (page - 1)) & ~(page - 1);
+	*start = begin;
+	*length = end - begin;
+}
+
+/* Map 'size' bytes starting on an 'align' boundary. Over-map and cut the
+ * slack off both ends, so the result unmaps like any other mapping. */
+static void *map_aligned(uint64_t size, uint64_t align, int32_t prot,
+                         int32_t flags) {
+	uint64_t page = platform_page_size();
+	size = (size + page - 1) & ~(page - 1);
+
+	void *raw = mmap(0, size + align, prot, flags, -1, 0);
+	if (raw == MAP_FAILED)
+		return 0;
+
+	uintptr_t begin = (uintptr_t)raw;
+	uintptr_t start = (begin + (align - 1)) & ~(uintptr_t)(align - 1);
+	if (start > begin)
+		munmap(raw, start - begin);
+
+	uintptr_t tail = begin + size + align - (start + size);
+	if (tail)
+		munmap((void *)(start + size), tail);
+
+	return (void *)start;
+}
+
+void *platform_allocate(uint64_t size, b8 aligned) {
+	if (!aligned)
+		return malloc(size);
+
+	void *block = 0;
+	if (posix_memalign(&block, AR_CACHE_LINE, size))
+		return 0;
+	return block;
+}
+
+void platform_free(void *block, b8 aligned) {
+	/* posix_memalign blocks go back through plain free. */
+	(void)aligned;
+	free(block);
+}
+
+void* platform_zero_mem(void* block, uint64_t size) {
+	return memset(block, 0, size);
+}
+
+void* platform_copy_mem(void* dest, const void* source, uint64_t size) {
+	return memcpy(dest, source, size);
+}
+
+void* platform_set_mem(void* dest, int32_t value, uint64_t size) {
+	return memset(dest, value, size);
+}
+
+uint64_t platform_page_size(void) {
+	static uint64_t page_size = 0;
+	if (!page_size)
+		page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+
+	return page_size;
+}
+
+uint64_t platform_huge_page_size(void) {
+	static uint64_t huge_size = 0;
+	if (huge_size)
+		return huge_size;
+
+	huge_size = MEBIBYTES(2);
+	FILE *meminfo = fopen("/proc/meminfo", "r");
+	if (meminfo) {
+		char line[128];
+		unsigned long long kib = 0;
+		while (fgets(line, sizeof(line), meminfo)) {
+			if (sscanf(line, "Hugepagesize: %llu kB", &kib) == 1) {
+				huge_size = kib * 1024;
+				break;
+			}
+		}
+		fclose(meminfo);
+	}
+
+	return huge_size;
+}
+
+void *platform_allocate_pages(uint64_t size, platform_page_mode_t mode) {
+	if (!size)
+		return 0;
+
+	int32_t prot = PROT_READ | PROT_WRITE;
+	int32_t flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	if (mode == PLATFORM_PAGES_NORMAL) {
+		void *block = mmap(0, size, prot, flags, -1, 0);
+		return block == MAP_FAILED ? 0 : block;
+	}
+
+	/* Explicit huge pages only exist if the admin set some aside
+	 * (vm.nr_hugepages). Without MAP_NORESERVE the map fails up front
+	 * instead of faulting later when the pool runs dry. */
+	uint64_t huge = platform_huge_page_size();
+	size = (size + huge - 1) & ~(huge - 1);
+	void *block = mmap(0, size, prot, flags | MAP_HUGETLB, -1, 0);
+	if (block != MAP_FAILED)
+		return block;
+
+	/* Transparent huge pages, as long as the range is huge page aligned.
+	 * madvise failing only means THP is off, normal pages still work. */
+	block = map_aligned(size, huge, prot, flags);
+	if (block)
+		madvise(block, size, MADV_HUGEPAGE);
+
+	return block;
+}
+
+void platform_free_pages(void *block, uint64_t size,
+                         platform_page_mode_t mode) {
+	if (!block || !size)
+		return;
+
+	if (mode == PLATFORM_PAGES_HUGE) {
+		uint64_t huge = platform_huge_page_size();
+		size = (size + huge - 1) & ~(huge - 1);
+	}
+
+	munmap(block, size);
+}
+
+void *platform_reserve(uint64_t size, platform_page_mode_t mode) {
+	int32_t flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+	if (mode == PLATFORM_PAGES_NORMAL) {
+		void *block = mmap(0, size, PROT_NONE, flags, -1, 0);
+		return block == MAP_FAILED ? 0 : block;
+	}
+
+	/* Lazy commit and hugetlb do not mix, a NORESERVE hugetlb page that
+	 * cannot be had is a SIGBUS on first touch. Transparent huge pages
+	 * only, the advice sticks through the later mprotect commits. */
+	void *block = map_aligned(size, platform_huge_page_size(), PROT_NONE, flags);
+	if (block)
+		madvise(block, size, MADV_HUGEPAGE);
+
+	return block;
+}
+
+b8 platform_commit(void *block, uint64_t size) {
+	if (!block || !size)
+		return false;
+
+	uintptr_t start;
+	uint64_t length;
+	page_range(block, size, &start, &length);
+	return mprotect((void *)start, length, PROT_READ | PROT_WRITE) == 0;
+}
+
+void platform_decommit(void *block, uint64_t size) {
+	if (!block || !size)
+		return;
+
+	/* Only pages fully inside the range, a page shared with a live
+	 * neighbour stays. They read as zero if committed again. */
+	uintptr_t page = (uintptr_t)platform_page_size();
+	uintptr_t start = ((uintptr_t)block + (page - 1)) & ~(page - 1);
+	uintptr_t end = ((uintptr_t)block + size) & ~(page - 1);
+	if (end <= start)
+		return;
+
+	madvise((void *)start, end - start, MADV_DONTNEED);
+	mprotect((void *)start, end - start, PROT_NONE);
+}
+
+void platform_release(void *block, uint64_t size) {
+	if (block && size)
+		munmap(block, size);
+}
+
+#endif
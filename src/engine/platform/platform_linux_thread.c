@@ -0,0 +1,24 @@
+/* syscall() is hidden under strict c99. */
+#define _GNU_SOURCE
+#include "engine/platform/platform_thread.h"
+
+#if OS_LINUX
+
+/* Thread half of the linux platform layer, kept out of platform_linux.c
+ * for the same reason as the memory half: headless tools link it. */
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+void platform_futex_wait(void *address, uint32_t expected) {
+	/* EAGAIN (value moved on) and EINTR both mean go and recheck. */
+	syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, 0, 0, 0);
+}
+
+void platform_futex_wake(void *address, uint32_t count) {
+	syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE,
+			count > INT32_MAX ? INT32_MAX : count, 0, 0, 0);
+}
+
+#endif
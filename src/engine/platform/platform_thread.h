@@ -0,0 +1,51 @@
+#ifndef __PLATFORM_THREAD_H__
+#define __PLATFORM_THREAD_H__
+
+#include <pthread.h>
+
+#include "engine/define.h"
+
+typedef struct platform_mutex_t {
+	pthread_mutex_t handle;
+} platform_mutex_t;
+
+typedef struct platform_thread_t {
+	pthread_t handle;
+} platform_thread_t;
+
+typedef void *(*platform_thread_fn)(void *arg);
+
+_arinline b8 platform_mutex_init(platform_mutex_t *mutex) {
+	return pthread_mutex_init(&mutex->handle, 0) == 0;
+}
+
+_arinline void platform_mutex_shut(platform_mutex_t *mutex) {
+	pthread_mutex_destroy(&mutex->handle);
+}
+
+_arinline void platform_mutex_lock(platform_mutex_t *mutex) {
+	pthread_mutex_lock(&mutex->handle);
+}
+
+_arinline void platform_mutex_unlock(platform_mutex_t *mutex) {
+	pthread_mutex_unlock(&mutex->handle);
+}
+
+_arinline b8 platform_thread_create(platform_thread_fn func, void *arg,
+									platform_thread_t *thread) {
+	return pthread_create(&thread->handle, 0, func, arg) == 0;
+}
+
+_arinline void *platform_thread_join(platform_thread_t *thread) {
+	void *result = 0;
+	pthread_join(thread->handle, &result);
+	return result;
+}
+
+/* Futex style sleep on a 32 bit word. Wait returns once woken or right
+ * away when '*address' no longer holds 'expected', spurious returns are
+ * possible so callers recheck. Wake gets up to 'count' waiters going. */
+void platform_futex_wait(void *address, uint32_t expected);
+void platform_futex_wake(void *address, uint32_t count);
+
+#endif // __PLATFORM_THREAD_H__
@@ -1,6 +1,7 @@
 #include "engine/renderer/renderer_fe.h"
 #include "engine/renderer/renderer_be.h"
 
+#include "engine/core/assertion.h"
 #include "engine/core/logger.h"
 #include "engine/math/maths.h"
 #include "engine/resources/resc_type.h"
@@ -97,6 +98,13 @@ void renderer_resize(uint32_t width, uint32_t height) {
 }
 
 b8 renderer_draw_frame(render_packet_t *packet) {
+    if (packet->frame_alloc) {
+        if (packet->geo_count)
+            frame_alloc_check(packet->frame_alloc, packet->geometries);
+        if (packet->ui_geo_count)
+            frame_alloc_check(packet->frame_alloc, packet->ui_geometries);
+    }
+
     if (p_state->backend.begin_frame(&p_state->backend, packet->delta)) {
 
         /* World Render Layer */
@@ -158,8 +166,12 @@ void renderer_set_view(mat4 view) {
 	p_state->view = view;
 }
 
-void renderer_tex_init(const uint8_t *pixel, texture_t *texture) {
-    p_state->backend.init_tex(pixel, texture);
+uint8_t renderer_frames_in_flight(void) {
+	return p_state->backend.frames_in_flight;
+}
+
+b8 renderer_tex_init(const uint8_t *pixel, texture_t *texture) {
+    return p_state->backend.init_tex(pixel, texture);
 }
 
 void renderer_tex_shut(texture_t *texture) {
@@ -178,6 +190,8 @@ b8 renderer_geometry_init(geometry_t *geometry, uint32_t vertex_size,
                           uint32_t vertex_count, const void *vertices,
                           uint32_t idx_size, uint32_t idx_count,
                           const void *indices) {
+    /* Vertex structs hold vec2/vec3, SIMD loads need them aligned. */
+    ar_assert_debug(math_is_aligned(vertices));
     return p_state->backend.init_geo(geometry, vertex_size, vertex_count,
                                      vertices, idx_size, idx_count, indices);
 }
@@ -9,8 +9,9 @@ void renderer_shut(void *state);
 void renderer_resize(uint32_t width, uint32_t height);
 b8 renderer_draw_frame(render_packet_t *packet);
 void renderer_set_view(mat4 view);
+uint8_t renderer_frames_in_flight(void);
 
-void renderer_tex_init(const uint8_t *pixel, texture_t *texture);
+b8 renderer_tex_init(const uint8_t *pixel, texture_t *texture);
 void renderer_tex_shut(texture_t *texture);
 
 b8 renderer_material_init(material_t *material);
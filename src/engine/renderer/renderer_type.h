@@ -3,6 +3,7 @@
 
 #include "engine/define.h"
 #include "engine/math/math_type.h"
+#include "engine/memory/frame_alloc.h"
 #include "engine/resources/resc_type.h"
 
 typedef enum render_backend_type_t {
@@ -22,6 +23,7 @@ typedef enum builtin_renderpass_t {
 
 typedef struct render_backend_t {
 	uint64_t frame_number;
+	uint8_t frames_in_flight;
 	texture_t *default_diffuse;
 
 	b8 (*init)(struct render_backend_t *backend, const char *name);
@@ -39,7 +41,7 @@ typedef struct render_backend_t {
 	b8 (*begin_renderpass)(struct render_backend_t *backend, uint8_t renderpass_id);
 	b8 (*end_renderpass)(struct render_backend_t *backend, uint8_t renderpass_id);
 
-    void (*init_tex)(const uint8_t *pixel, texture_t *texture);
+    b8 (*init_tex)(const uint8_t *pixel, texture_t *texture);
     void (*shut_tex)(texture_t *texture);
 
 	b8 (*init_material)(material_t *material);
@@ -61,6 +63,8 @@ typedef struct render_packet_t {
 	uint32_t geo_count;
 	uint32_t ui_geo_count;
 
+	/* Both arrays come from this allocator and only live for the frame. */
+	frame_alloc_t *frame_alloc;
 	geo_render_data_t *geometries;
 	geo_render_data_t *ui_geometries;
 } render_packet_t;
@@ -404,7 +404,7 @@ void vk_ui_shader_apply_material(vulkan_context_t   *ctx,
 	/*
     if (material->diffuse_map.texture) {
         ar_TRACE("Diffuse Map - Texture: %s",
-                 material->diffuse_map.texture->name);
+                 name_string(material->diffuse_map.texture->name));
     } else {
         ar_TRACE("Diffuse Map - Texture: NULL texture");
     }
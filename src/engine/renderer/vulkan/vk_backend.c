@@ -5,6 +5,7 @@
 #include "engine/define.h"
 #include "engine/core/logger.h"
 #include "engine/math/math_type.h"
+#include "engine/memory/slab.h"
 
 #include "engine/renderer/renderer_type.h"
 #include "engine/renderer/vulkan/vk_type.h"
@@ -29,6 +30,7 @@
 
 // static vulkan context related
 static vulkan_context_t context;
+static slab_t texture_data_pool;
 static uint32_t cache_framebuffer_width = 0;
 static uint32_t cache_framebuffer_height = 0;
 
@@ -257,6 +259,10 @@ b8 vk_backend_init(render_backend_t *backend, const char *name) {
 	context.find_mem_idx = find_mem_idx;
 	context.alloc = 0;
 
+	/* One vulkan_texture_data_t per texture, same size every time. */
+	slab_init(sizeof(vulkan_texture_data_t), 64, MEMTAG_TEXTURE,
+			  &texture_data_pool);
+
 	application_get_framebuffer_size(&cache_framebuffer_width,
 									 &cache_framebuffer_height);
 	context.framebuffer_w =
@@ -319,6 +325,7 @@ b8 vk_backend_init(render_backend_t *backend, const char *name) {
 
 	/* ======================== Vulkan Swapchain ============================= */
 	vk_swapchain_init(&context, &context.swapchain);
+	backend->frames_in_flight = context.swapchain.max_frame_in_flight;
 
 	/* ======================= Vulkan Renderpass ============================= */
     // World Render Layer
@@ -383,10 +390,16 @@ b8 vk_backend_init(render_backend_t *backend, const char *name) {
 
 	buffer_init(&context);
 
-	/* Mark all geometries as INVALID_ID */
-	for (uint32_t i = 0; i < VULKAN_GEOMETRY_MAX_COUNT; ++i) {
-		context.geometries[i].id = INVALID_ID;
+	/* Geometry registry */
+	uint64_t geometry_req = slot_map_memory_require(sizeof(vulkan_geo_data_t),
+													VULKAN_GEOMETRY_MAX_COUNT);
+	context.geometry_block = memory_alloc(geometry_req, MEMTAG_RENDERER);
+	if (!context.geometry_block) {
+		ar_ERROR("vk_backend_init - unable to allocate the geometry registry");
+		return false;
 	}
+	slot_map_init(sizeof(vulkan_geo_data_t), VULKAN_GEOMETRY_MAX_COUNT,
+				  context.geometry_block, &context.geometries);
 
     ar_DEBUG("Vulkan API Granted Access Successfully");
 
@@ -407,6 +420,12 @@ void vk_backend_shut(render_backend_t *backend) {
 	vk_buffer_shut(&context, &context.obj_idx_buffer);
 	vk_buffer_shut(&context, &context.obj_vert_buffer);
 
+	memory_free(context.geometry_block,
+				slot_map_memory_require(sizeof(vulkan_geo_data_t),
+										VULKAN_GEOMETRY_MAX_COUNT),
+				MEMTAG_RENDERER);
+	context.geometry_block = 0;
+
 	ar_DEBUG("Kill Vulkan Object Shaders");
     vk_ui_shader_shut(&context, &context.ui_shader);
 	vk_material_shader_shut(&context, &context.material_shader);
@@ -473,6 +492,8 @@ void vk_backend_shut(render_backend_t *backend) {
 
 	ar_DEBUG("Kill Vulkan Instance");
 	vkDestroyInstance(context.instance, context.alloc);
+
+	slab_shut(&texture_data_pool);
 }
 
 void vk_backend_resize(render_backend_t *backend, uint32_t width,
@@ -732,15 +753,19 @@ b8 vk_backend_end_renderpass(render_backend_t *be, uint8_t renderpass_id) {
     return true;
 }
 
-void vk_backend_tex_init(const uint8_t *pixel, texture_t *texture) {
+b8 vk_backend_tex_init(const uint8_t *pixel, texture_t *texture) {
 	texture->gen = INVALID_ID;
 
-	// TODO: use an allocator
-    texture->internal_data =
-        (vulkan_texture_data_t *)memory_alloc(sizeof(vulkan_texture_data_t),
-                                              MEMTAG_TEXTURE);
+    texture->internal_data = slab_allocate(&texture_data_pool);
+    if (!texture->internal_data) {
+        ar_ERROR("vk_backend_tex_init - no texture data left for '%s'",
+                 name_string(texture->name));
+        return false;
+    }
+
     vulkan_texture_data_t *data =
         (vulkan_texture_data_t *)texture->internal_data;
+    memory_zero(data, sizeof(vulkan_texture_data_t));
 	VkDeviceSize image_size = texture->width * texture->height * texture->channel_count;
 
 	// NOTE: 8-bit per channel.
@@ -811,10 +836,11 @@ void vk_backend_tex_init(const uint8_t *pixel, texture_t *texture) {
     if (!vk_result_is_success(VK_SUCCESS)) {
         ar_ERROR("Error creating texture sampler: %s",
                  vk_result_string(result, true));
-        return;
+        return false;
     }
 
 	texture->gen++;
+	return true;
 }
 
 void vk_backend_tex_shut(texture_t *texture) {
@@ -830,8 +856,7 @@ void vk_backend_tex_shut(texture_t *texture) {
         vkDestroySampler(context.device.logic_dev, data->sampler,
                          context.alloc);
         data->sampler = 0;
-        memory_free(texture->internal_data, sizeof(vulkan_texture_data_t),
-                    MEMTAG_TEXTURE);
+        slab_release(&texture_data_pool, texture->internal_data);
     }
 
     memory_zero(texture, sizeof(texture_t));
@@ -913,7 +938,12 @@ b8 vk_backend_geometry_init(geometry_t *geometry, uint32_t vertex_size, uint32_t
     vulkan_geo_data_t *internal_data = 0;
 
     if (is_reupload) {
-        internal_data              = &context.geometries[geometry->internal_id];
+        internal_data = slot_map_get(&context.geometries, geometry->internal_id);
+        if (!internal_data) {
+            ar_ERROR("vk_backend_geometry_init - stale geometry handle %u",
+                     geometry->internal_id);
+            return false;
+        }
 
         // take copy of old data
         old_data.idx_buffer_offset = internal_data->idx_buffer_offset;
@@ -923,14 +953,10 @@ b8 vk_backend_geometry_init(geometry_t *geometry, uint32_t vertex_size, uint32_t
         old_data.vertex_count         = internal_data->vertex_count;
         old_data.vertex_element_size  = internal_data->vertex_element_size;
     } else {
-        for (uint32_t i = 0; i < VULKAN_GEOMETRY_MAX_COUNT; ++i) {
-            if (context.geometries[i].id == INVALID_ID) {
-                geometry->internal_id    = i;
-                context.geometries[i].id = i;
-                internal_data            = &context.geometries[i];
-                break;
-            }
-        }
+        geometry->internal_id =
+            slot_map_insert(&context.geometries, (void **)&internal_data);
+        if (internal_data)
+            internal_data->gen = INVALID_ID;
     }
 
     if (!internal_data) {
@@ -990,7 +1016,12 @@ void vk_backend_geometry_shut(geometry_t *geometry) {
     if (geometry && geometry->internal_id != INVALID_ID) {
         vkDeviceWaitIdle(context.device.logic_dev);
         vulkan_geo_data_t *internal_data =
-            &context.geometries[geometry->internal_id];
+            slot_map_get(&context.geometries, geometry->internal_id);
+        if (!internal_data) {
+            ar_WARNING("vk_backend_geometry_shut - stale geometry handle %u",
+                       geometry->internal_id);
+            return;
+        }
 
         /* Free Vertex Data */
         free_data(&context.obj_vert_buffer, internal_data->vertex_buffer_offset,
@@ -1002,9 +1033,8 @@ void vk_backend_geometry_shut(geometry_t *geometry) {
                       internal_data->idx_element_size * internal_data->idx_count);
         }
 
-        memory_zero(internal_data, sizeof(vulkan_geo_data_t));
-        internal_data->id  = INVALID_ID;
-        internal_data->gen = INVALID_ID;
+        slot_map_remove(&context.geometries, geometry->internal_id);
+        geometry->internal_id = INVALID_ID;
     }
 }
 
@@ -1014,7 +1044,10 @@ void vk_backend_geo_render(geo_render_data_t data) {
     }
 
     vulkan_geo_data_t *buffer_data =
-        &context.geometries[data.geometry->internal_id];
+        slot_map_get(&context.geometries, data.geometry->internal_id);
+    if (!buffer_data) {
+        return;
+    }
     vulkan_commandbuffer_t *combuff =
         &context.graphic_comm_buffer[context.image_idx];
 
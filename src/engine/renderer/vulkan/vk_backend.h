@@ -19,7 +19,7 @@ b8 vk_backend_end_renderpass(render_backend_t *be, uint8_t renderpass_id);
 
 void vk_backend_geo_render(geo_render_data_t data);
 
-void vk_backend_tex_init(const uint8_t *pixel, texture_t *texture);
+b8 vk_backend_tex_init(const uint8_t *pixel, texture_t *texture);
 void vk_backend_tex_shut(texture_t *texture);
 
 b8 vk_backend_material_init(material_t *material);
@@ -1,6 +1,7 @@
 #ifndef __VULKAN_TYPE_H__
 #define __VULKAN_TYPE_H__
 
+#include "engine/container/slot_map.h"
 #include "engine/core/assertion.h"
 #include "engine/renderer/renderer_type.h"
 
@@ -220,7 +221,6 @@ typedef struct vulkan_material_shader_t {
 #define VULKAN_GEOMETRY_MAX_COUNT 4096
 
 typedef struct vulkan_geo_data_t {
-	uint32_t id;
 	uint32_t gen;
 	uint32_t vertex_count;
 	uint32_t vertex_element_size;
@@ -255,7 +255,8 @@ typedef struct vulkan_context_t {
 	vulkan_material_shader_t material_shader;
 	vulkan_ui_shader_t ui_shader;
 
-	vulkan_geo_data_t geometries[VULKAN_GEOMETRY_MAX_COUNT];
+	slot_map_t geometries; // of vulkan_geo_data_t, geometry_t::internal_id
+	void *geometry_block;
 
 	int32_t (*find_mem_idx)(uint32_t type_filter, uint32_t prop_flag);
 	float frame_delta;
@@ -22,12 +22,14 @@ b8 image_loader_load(resource_loader_t *self, const char *name,
                      resource_t *resc) {
     if (!self || !name || !resc) return false;
 
-    char *format_str = "%s/%s/%s%s";
 	const int32_t req_channel_count = 4;
 	stbi_set_flip_vertically_on_load(true);
-	char full_path[512];
-    string_format(full_path, format_str, resource_sys_base_path(),
-                  self->type_path, name, ".png");
+	scratch_t scratch = scratch_begin();
+	char *full_path = resc_path_format(&scratch, self->type_path, name, ".png");
+	if (!full_path) {
+		scratch_end(scratch);
+		return false;
+	}
 
 	int32_t width, height, channel_count;
 
@@ -43,19 +45,31 @@ b8 image_loader_load(resource_loader_t *self, const char *name,
 		stbi__err(0, 0);
 
 		if (data) stbi_image_free(data);
+		scratch_end(scratch);
 		return false;
 	}
 
 	if (!data) {
 		ar_ERROR("failed to load file %s", full_path);
+		scratch_end(scratch);
 		return false;
 	}
 
-    // TODO: Should use allocator.
-	resc->full_path = string_duplicate(full_path);
+	resc->full_path = resc_path_duplicate(full_path);
+	scratch_end(scratch);
+	if (!resc->full_path) {
+		stbi_image_free(data);
+		return false;
+	}
 
     image_resc_data_t *resc_data =
-        memory_alloc(sizeof(image_resc_data_t), MEMTAG_TEXTURE);
+        memory_alloc_uninit(sizeof(image_resc_data_t), MEMTAG_TEXTURE);
+    if (!resc_data) {
+        ar_ERROR("image_loader_load - no memory for '%s'", resc->full_path);
+        stbi_image_free(data);
+        return false;
+    }
+
 	resc_data->pixels = data;
 	resc_data->width = (uint32_t)width;
 	resc_data->height = (uint32_t)height;
@@ -2,22 +2,31 @@
 
 #include "engine/core/logger.h"
 #include "engine/core/ar_strings.h"
+#include "engine/memory/slab.h"
+#include "engine/systems/resource_sys.h"
 
-b8 resc_unload(struct resource_loader_t *self, resource_t *resource,
-               mem_tag_t mem_tag) {
+/* ========================= PRIVATE FUNCTION =============================== */
+/* ========================================================================== */
+b8 unload_resource(struct resource_loader_t *self, resource_t *resource,
+                   mem_tag_t mem_tag, b8 from_slab) {
     if (!self || !resource) {
         ar_WARNING("resc_unload - called with nullptr");
         return false;
     }
 
-    uint32_t path_length = string_length(resource->full_path);
-    if (path_length) {
+    if (resource->full_path) {
+        uint64_t path_length = string_length(resource->full_path);
         memory_free(resource->full_path, sizeof(char) * path_length + 1,
                     MEMTAG_STRING);
+        resource->full_path = 0;
     }
 
     if (resource->data) {
-        memory_free(resource->data, resource->data_size, mem_tag);
+        if (from_slab) {
+            slab_free(resource->data, resource->data_size, mem_tag);
+        } else {
+            memory_free(resource->data, resource->data_size, mem_tag);
+        }
         resource->data      = 0;
         resource->data_size = 0;
         resource->id_loader = INVALID_ID;
@@ -25,3 +34,40 @@ b8 resc_unload(struct resource_loader_t *self, resource_t *resource,
 
     return true;
 }
+/* ========================================================================== */
+/* ========================================================================== */
+
+char *resc_path_format(scratch_t *scratch, const char *type_path,
+                       const char *name, const char *extension) {
+    char *full_path = scratch_alloc(scratch, sizeof(char) * RESC_PATH_MAX);
+    if (!full_path) {
+        ar_ERROR("resc_path_format - no scratch left for '%s'", name);
+        return 0;
+    }
+
+    string_format(full_path, "%s/%s/%s%s", resource_sys_base_path(),
+                  type_path, name, extension);
+    return full_path;
+}
+
+char *resc_path_duplicate(const char *full_path) {
+    uint64_t length = string_length(full_path);
+    char *copy = memory_alloc_uninit(sizeof(char) * length + 1, MEMTAG_STRING);
+    if (!copy) {
+        ar_ERROR("resc_path_duplicate - unable to copy '%s'", full_path);
+        return 0;
+    }
+
+    memory_copy(copy, full_path, length + 1);
+    return copy;
+}
+
+b8 resc_unload(struct resource_loader_t *self, resource_t *resource,
+               mem_tag_t mem_tag) {
+    return unload_resource(self, resource, mem_tag, false);
+}
+
+b8 resc_unload_slab(struct resource_loader_t *self, resource_t *resource,
+                    mem_tag_t mem_tag) {
+    return unload_resource(self, resource, mem_tag, true);
+}
@@ -3,11 +3,29 @@
 
 #include "engine/define.h"
 #include "engine/memory/memory.h"
+#include "engine/memory/scratch.h"
 #include "engine/resources/resc_type.h"
 
+#define RESC_PATH_MAX 512
+
 struct resource_loader_t;
 
+/* '<base>/<type_path>/<name><extension>' in the caller's scratch scope,
+ * 0 if the scratch is full. */
+char *resc_path_format(scratch_t *scratch, const char *type_path,
+                       const char *name, const char *extension);
+
+/* Copy of a resource path, MEMTAG_STRING so it lands on the strings heap.
+ * 0 when the copy could not be allocated. */
+char *resc_path_duplicate(const char *full_path);
+
 b8 resc_unload(struct resource_loader_t *self, resource_t *resource,
                mem_tag_t mem_tag);
 
+/* Same as resc_unload for loaders whose data came from slab_alloc. Only
+ * worth it for tags without a memory sub-heap, slab_alloc hands a heap's
+ * tags to memory_alloc and its classes never see them. */
+b8 resc_unload_slab(struct resource_loader_t *self, resource_t *resource,
+                    mem_tag_t mem_tag);
+
 #endif //__LOADER_UTILS_H__
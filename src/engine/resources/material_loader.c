@@ -3,6 +3,7 @@
 #include "engine/core/ar_strings.h"
 #include "engine/core/logger.h"
 #include "engine/memory/memory.h"
+#include "engine/memory/slab.h"
 #include "engine/math/maths.h"
 #include "engine/platform/filesystem.h"
 #include "engine/resources/resc_type.h"
@@ -15,23 +16,36 @@ b8 material_loader_load(resource_loader_t *self, const char *name,
                         resource_t *resc) {
     if (!self || !name || !resc) return false;
 
-    char *format_str = "%s/%s/%s%s";
-	char full_path[512];
-    string_format(full_path, format_str, resource_sys_base_path(),
-                  self->type_path, name, ".ar_mat");
+	scratch_t scratch = scratch_begin();
+	char *full_path =
+		resc_path_format(&scratch, self->type_path, name, ".ar_mat");
+	if (!full_path) {
+		scratch_end(scratch);
+		return false;
+	}
 
 	file_handle_t f;
 	if (!filesystem_open(full_path, MODE_READ, false, &f)) {
 		ar_ERROR("material_loader_load - unable to open file: '%s'", full_path);
+		scratch_end(scratch);
 		return false;
 	}
 
-    // TODO: Should use allocator.
-	resc->full_path = string_duplicate(full_path);
+	resc->full_path = resc_path_duplicate(full_path);
+	scratch_end(scratch);
+	if (!resc->full_path) {
+		filesystem_close(&f);
+		return false;
+	}
 
-	// TODO: Should use allocator.
     material_config_t *resc_data =
-        memory_alloc(sizeof(material_config_t), MEMTAG_MATERIAL);
+        slab_alloc(sizeof(material_config_t), MEMTAG_MATERIAL);
+    if (!resc_data) {
+        ar_ERROR("material_loader_load - no memory for '%s'", name);
+        filesystem_close(&f);
+        return false;
+    }
+    memory_zero(resc_data, sizeof(material_config_t));
 	resc_data->type = MATERIAL_TYPE_WORLD;
 	resc_data->auto_release = true;
 	resc_data->diffuse_color = vec4_one();
@@ -56,7 +70,7 @@ b8 material_loader_load(resource_loader_t *self, const char *name,
 		int32_t equal_idx = string_index_of(trim, '=');
 		if (equal_idx == -1) {
             ar_WARNING("Format issue on: '%s'->'=' token not found. Skip line",
-                       full_path, line_number);
+                       resc->full_path, line_number);
             line_number++;
             continue;
 		}
@@ -82,7 +96,8 @@ b8 material_loader_load(resource_loader_t *self, const char *name,
         } else if (string_equali(trim_name, "diffuse_color")) {
             // parse Color
 			if (!string_to_vec4(trim_value, &resc_data->diffuse_color)) {
-				ar_WARNING("Error parsing diffuse_color in file: '%s'", full_path);
+				ar_WARNING("Error parsing diffuse_color in file: '%s'",
+				           resc->full_path);
 				resc_data->diffuse_color = vec4_one(); // set white
 			}
 		} else if (string_equali(trim_name, "type")) {
@@ -92,7 +107,7 @@ b8 material_loader_load(resource_loader_t *self, const char *name,
 			}
         } else {
             ar_WARNING("Unknown field '%s' in material file: '%s'",
-                       trim_name, full_path);
+                       trim_name, resc->full_path);
         }
 
 		// TODO: More fields
@@ -109,7 +124,7 @@ b8 material_loader_load(resource_loader_t *self, const char *name,
 }
 
 void material_loader_unload(resource_loader_t *self, resource_t *resc) {
-	if (!resc_unload(self, resc, MEMTAG_MATERIAL)) {
+	if (!resc_unload_slab(self, resc, MEMTAG_MATERIAL)) {
 		ar_WARNING("material_loader_unload - call with nullptr");
 	}
 }
@@ -1,6 +1,7 @@
 #ifndef __RESOURCE_TYPE_H__
 #define __RESOURCE_TYPE_H__
 
+#include "engine/core/name.h"
 #include "engine/math/math_type.h"
 
 #define TEXTURE_NAME_MAX_LENGTH 512
@@ -39,8 +40,8 @@ typedef struct texture_t {
 	uint32_t gen;
 
 	uint8_t channel_count;
-	char name[TEXTURE_NAME_MAX_LENGTH];
 	b8 has_transparent;
+	name_t name;
 
 	void *internal_data;
 } texture_t;
@@ -73,7 +74,7 @@ typedef struct material_t {
 	uint32_t id;
 	uint32_t gen;
 	uint32_t internal_id;
-	char name[MATERIAL_NAME_MAX_LENGTH];
+	name_t name;
 	vec4 diffuse_color;
 	texture_map_t diffuse_map;
 	material_type_t type;
@@ -84,7 +85,7 @@ typedef struct geometry_t {
 	uint32_t id;
 	uint32_t gen;
 	uint32_t internal_id;
-	char name[GEOMETRY_NAME_MAX_LENGTH];
+	name_t name;
 	material_t *material;
 } geometry_t;
 
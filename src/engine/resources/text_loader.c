@@ -14,32 +14,40 @@
 b8 text_loader_load(resource_loader_t *self, const char *name, resource_t *resc) {
 	if (!self || !name || !resc) return false;
 
-	char *format_str = "%s/%s/%s%s";
-	char full_path[512];
-    string_format(full_path, format_str, resource_sys_base_path(),
-                  self->type_path, name, "");
+	scratch_t scratch = scratch_begin();
+	char *full_path = resc_path_format(&scratch, self->type_path, name, "");
+	if (!full_path) {
+		scratch_end(scratch);
+		return false;
+	}
 
 	file_handle_t f;
 	if (!filesystem_open(full_path, MODE_READ, false, &f)) {
 		ar_ERROR("text_loader_load - unable to open file: '%s'", full_path);
+		scratch_end(scratch);
 		return false;
 	}
 
-    // TODO: Should use allocator.
-	resc->full_path = string_duplicate(full_path);
+	resc->full_path = resc_path_duplicate(full_path);
+	scratch_end(scratch);
+	if (!resc->full_path) {
+		filesystem_close(&f);
+		return false;
+	}
 
 	uint64_t file_size = 0;
 	if (!filesystem_size(&f, &file_size)) {
-		ar_ERROR("unknown size of text file: %s", full_path);
+		ar_ERROR("unknown size of text file: %s", resc->full_path);
 		filesystem_close(&f);
 		return false;
 	}
 
 	// TODO: Should use allocator.
-	char *resc_data = memory_alloc(sizeof(char) * file_size, MEMTAG_ARRAY);
+	char *resc_data =
+		memory_alloc_uninit(sizeof(char) * file_size, MEMTAG_ARRAY);
 	uint64_t read_size = 0;
 	if (!filesystem_read_all_text(&f, resc_data, &read_size)) {
-		ar_ERROR("unable to text read text file: %s", full_path);
+		ar_ERROR("unable to text read text file: %s", resc->full_path);
 		filesystem_close(&f);
 		return false;
 	}
@@ -1,7 +1,9 @@
 #include "engine/systems/geometry_sys.h"
 
+#include "engine/container/slot_map.h"
 #include "engine/core/ar_strings.h"
 #include "engine/core/logger.h"
+#include "engine/core/name.h"
 #include "engine/memory/memory.h"
 
 #include "engine/renderer/renderer_fe.h"
@@ -17,7 +19,7 @@ typedef struct geometry_sys_state_t {
 	geo_sys_cfg_t sys_cfg;
 	geometry_t default_geometry;
 	geometry_t default_2d_geometry;
-	geo_ref_t *reg_geometry;
+	slot_map_t reg_geometry; // geometry_t::id is the handle
 } geometry_sys_state_t;
 
 static geometry_sys_state_t *p_state = 0;
@@ -57,7 +59,9 @@ b8 default_geo_init(geometry_sys_state_t *state) {
 	
 	uint32_t indices[6] = {0, 1, 2, 0, 3, 1};
 
-	/* Send geometry to renderer to be upload to GPU */
+	/* Send geometry to renderer to be upload to GPU, as a first upload */
+	state->default_geometry.id = INVALID_ID;
+	state->default_geometry.internal_id = INVALID_ID;
     if (!renderer_geometry_init(&state->default_geometry, sizeof(vertex_3d), 4,
                                 verts, sizeof(uint32_t), 6, indices)) {
         ar_FATAL("Failed to create default geometry");
@@ -99,6 +103,8 @@ b8 default_geo_init(geometry_sys_state_t *state) {
     uint32_t indices2d[6] = {0, 1, 2, 0, 3, 1};
 
 	/* Send geometry to renderer to be upload to GPU */
+	state->default_2d_geometry.id = INVALID_ID;
+	state->default_2d_geometry.internal_id = INVALID_ID;
     if (!renderer_geometry_init(&state->default_2d_geometry, sizeof(vertex_2d),
                                 4, verts2d, sizeof(uint32_t), 6, indices2d)) {
         ar_FATAL("Failed to create default 2D geometry");
@@ -115,15 +121,12 @@ b8 geo_init(geometry_sys_state_t *state, geo_config_t config, geometry_t *geo) {
     if (!renderer_geometry_init(geo, config.vertex_size, config.vertex_count,
                                 config.vertices, config.idx_size,
                                 config.idx_count, config.indices)) {
-        state->reg_geometry[geo->id].ref_count    = 0;
-        state->reg_geometry[geo->id].auto_release = false;
-        geo->id                                   = INVALID_ID;
-        geo->gen                                  = INVALID_ID;
-        geo->internal_id                          = INVALID_ID;
-
+        slot_map_remove(&state->reg_geometry, geo->id);
         return false;
     }
 
+    geo->name = name_intern(config.name);
+
     /* acquire material */
     if (string_length(config.material_name) > 0) {
         geo->material = material_sys_acquire(config.material_name);
@@ -143,11 +146,11 @@ void geo_shut(geometry_sys_state_t *state, geometry_t *geo) {
 	geo->gen = INVALID_ID;
 	geo->id = INVALID_ID;
 
-	string_empty(geo->name);
+	geo->name = NAME_NONE;
 
 	/* release material */
-	if (geo->material && string_length(geo->material->name) > 0) {
-		material_sys_release(geo->material->name);
+	if (geo->material && geo->material->name != NAME_NONE) {
+		material_sys_release_name(geo->material->name);
 		geo->material = 0;
 	}
 }
@@ -161,10 +164,11 @@ b8 geometry_sys_init(uint64_t *memory_require, void *state,
         return false;
     }
 
-    /* Block of memory will contain state structure, then block for array, then
-     * block for hashtable.*/
+    /* Block of memory will contain state structure, then block for the
+     * registry. */
     uint64_t struct_req = sizeof(geometry_sys_state_t);
-    uint64_t array_req  = sizeof(geo_ref_t) * sys_cfg.max_geo_count;
+    uint64_t array_req  = slot_map_memory_require(sizeof(geo_ref_t),
+                                                  sys_cfg.max_geo_count);
     *memory_require     = struct_req + array_req;
 
     if (!state) {
@@ -174,17 +178,10 @@ b8 geometry_sys_init(uint64_t *memory_require, void *state,
     p_state               = state;
     p_state->sys_cfg      = sys_cfg;
 
-    /* The array block is after the state. Already allocated, so just set the
-     * pointer. */
+    /* The array block is after the state. Already allocated */
     void *array_block     = (char *)state + struct_req;
-    p_state->reg_geometry = array_block;
-
-    uint32_t count        = p_state->sys_cfg.max_geo_count;
-    for (uint32_t i = 0; i < count; ++i) {
-        p_state->reg_geometry[i].geometry.id          = INVALID_ID;
-        p_state->reg_geometry[i].geometry.internal_id = INVALID_ID;
-        p_state->reg_geometry[i].geometry.gen         = INVALID_ID;
-    }
+    slot_map_init(sizeof(geo_ref_t), sys_cfg.max_geo_count, array_block,
+                  &p_state->reg_geometry);
 
     if (!default_geo_init(p_state)) {
         ar_FATAL("Failed to create default geometry. Application stop");
@@ -200,10 +197,10 @@ void geometry_sys_shut(void *state) {
 }
 
 geometry_t *geometry_sys_acquire_by_id(uint32_t id) {
-    if (id != INVALID_ID &&
-        p_state->reg_geometry[id].geometry.id != INVALID_ID) {
-        p_state->reg_geometry[id].ref_count++;
-        return &p_state->reg_geometry[id].geometry;
+    geo_ref_t *ref = slot_map_get(&p_state->reg_geometry, id);
+    if (ref) {
+        ref->ref_count++;
+        return &ref->geometry;
     }
 
     // NOTE: Should return default geometry instead?
@@ -214,25 +211,22 @@ geometry_t *geometry_sys_acquire_by_id(uint32_t id) {
 
 geometry_t *geometry_sys_acquire_by_config(geo_config_t config,
                                            b8           auto_release) {
-    geometry_t *g = 0;
-    for (uint32_t i = 0; i < p_state->sys_cfg.max_geo_count; ++i) {
-        if (p_state->reg_geometry[i].geometry.id == INVALID_ID) {
-
-            // found empty slot
-            p_state->reg_geometry[i].auto_release = auto_release;
-            p_state->reg_geometry[i].ref_count    = 1;
-            g     = &p_state->reg_geometry[i].geometry;
-            g->id = i;
-            break;
-        }
-    }
-
-    if (!g) {
+    geo_ref_t *ref    = 0;
+    uint32_t   handle = slot_map_insert(&p_state->reg_geometry, (void **)&ref);
+    if (!ref) {
         ar_ERROR("Unable to obtain free slot for geometry. Adjust "
                  "configuration to allow more space. Returning nullptr.");
         return 0;
     }
 
+    ref->auto_release = auto_release;
+    ref->ref_count    = 1;
+
+    geometry_t *g     = &ref->geometry;
+    g->id             = handle;
+    g->gen            = INVALID_ID;
+    g->internal_id    = INVALID_ID;
+
     if (!geo_init(p_state, config, g)) {
         ar_ERROR("Failed to create geometry. Returning nullptr.");
         return 0;
@@ -261,29 +255,28 @@ geometry_t *geometry_sys_get_default_2d(void) {
 }
 
 void geometry_sys_release(geometry_t *geometry) {
-    if (geometry && geometry->id != INVALID_ID) {
-        geo_ref_t *ref = &p_state->reg_geometry[geometry->id];
-
-        // take copy of ID
-        uint32_t id    = geometry->id;
-        if (ref->geometry.id == geometry->id) {
-            if (ref->ref_count > 0) {
-                ref->ref_count--;
-            }
-
-            // blank geometry id.
-            if (ref->ref_count < 1 && ref->auto_release) {
-                geo_shut(p_state, &ref->geometry);
-                ref->ref_count    = 0;
-                ref->auto_release = false;
-            }
-        } else {
+    geo_ref_t *ref = geometry ? slot_map_get(&p_state->reg_geometry,
+                                             geometry->id)
+                              : 0;
+    if (ref) {
+        if (&ref->geometry != geometry) {
             ar_FATAL("Geometry id mismatch. Check registration logic, as this "
                      "should never occur.");
+            return;
+        }
+
+        if (ref->ref_count > 0) {
+            ref->ref_count--;
+        }
+
+        // take copy of ID, geo_shut blanks it.
+        uint32_t id = geometry->id;
+        if (ref->ref_count < 1 && ref->auto_release) {
+            geo_shut(p_state, &ref->geometry);
+            slot_map_remove(&p_state->reg_geometry, id);
         }
 
         return;
-		(void)id;
     }
 
     ar_WARNING("geometry_sys_release cannot release invalid geometry "
@@ -330,10 +323,11 @@ geo_config_t geometry_sys_gen_plane_config(float width, float height,
     config.vertex_count = x_segcount * y_segcount * 4; // vertex per segment
 	config.idx_size = sizeof(uint32_t);
     config.idx_count    = x_segcount * y_segcount * 6; // indices per segment
-    config.vertices =
-        memory_alloc(sizeof(vertex_3d) * config.vertex_count, MEMTAG_ARRAY);
+    /* Every vertex and index gets written below, z included. */
+    config.vertices = memory_alloc_uninit(
+        sizeof(vertex_3d) * config.vertex_count, MEMTAG_ARRAY);
     config.indices =
-        memory_alloc(sizeof(uint32_t) * config.idx_count, MEMTAG_ARRAY);
+        memory_alloc_uninit(sizeof(uint32_t) * config.idx_count, MEMTAG_ARRAY);
 
     float seg_w  = width / x_segcount;
     float seg_h  = height / y_segcount;
@@ -360,21 +354,25 @@ geo_config_t geometry_sys_gen_plane_config(float width, float height,
 
             v0->position.x      = min_x;
             v0->position.y      = min_y;
+            v0->position.z      = 0.0f;
             v0->texcoord.x      = min_uvx;
             v0->texcoord.y      = min_uvy;
 
             v1->position.x      = max_x;
             v1->position.y      = max_y;
+            v1->position.z      = 0.0f;
             v1->texcoord.x      = max_uvx;
             v1->texcoord.y      = max_uvy;
 
             v2->position.x      = min_x;
             v2->position.y      = max_y;
+            v2->position.z      = 0.0f;
             v2->texcoord.x      = min_uvx;
             v2->texcoord.y      = max_uvy;
 
             v3->position.x      = max_x;
             v3->position.y      = min_y;
+            v3->position.z      = 0.0f;
             v3->texcoord.x      = max_uvx;
             v3->texcoord.y      = min_uvy;
 
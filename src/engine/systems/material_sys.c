@@ -1,26 +1,27 @@
 #include "engine/systems/material_sys.h"
 
-#include "engine/container/hashtable.h"
+#include "engine/container/slot_map.h"
 #include "engine/core/logger.h"
+#include "engine/core/name.h"
 #include "engine/core/ar_strings.h"
 #include "engine/math/maths.h"
 #include "engine/renderer/renderer_fe.h"
 #include "engine/systems/texture_sys.h"
 #include "engine/systems/resource_sys.h"
 
-typedef struct material_sys_state_t {
-	material_sys_config_t config;
-	material_t default_material;
-	material_t *reg_materials;
-	hashtable_t reg_material_table;
-} material_sys_state_t;
-
 typedef struct material_ref_t {
 	uint64_t ref_count;
-	uint32_t handle;
+	material_t material;
 	b8 auto_release;
 } material_ref_t;
 
+typedef struct material_sys_state_t {
+	material_sys_config_t config;
+	material_t default_material;
+	slot_map_t reg_materials; // material_t::id is the handle
+	name_map_t reg_material_map;
+} material_sys_state_t;
+
 static material_sys_state_t *p_state = 0;
 
 /* ========================= PRIVATE FUNCTION =============================== */
@@ -31,8 +32,7 @@ b8 default_material_init(material_sys_state_t *state) {
 	state->default_material.id = INVALID_ID;
 	state->default_material.gen = INVALID_ID;
 
-    string_ncopy(state->default_material.name, DEFAULT_MATERIAL_NAME,
-                 MATERIAL_NAME_MAX_LENGTH);
+    state->default_material.name = name_intern(DEFAULT_MATERIAL_NAME);
 
     state->default_material.diffuse_color = vec4_one();
 	state->default_material.diffuse_map.used = TEXTURE_USE_MAP_DIFFUSE;
@@ -49,10 +49,10 @@ b8 default_material_init(material_sys_state_t *state) {
     return true;
 }
 
-b8 load_material(material_config_t config, material_t *mt) {
+b8 load_material(material_config_t config, name_t name, material_t *mt) {
 	memory_zero(mt, sizeof(material_t));
 
-	string_ncopy(mt->name, config.name, MATERIAL_NAME_MAX_LENGTH);
+	mt->name = name;
 
 	/* Type */
 	mt->type = config.type;
@@ -68,7 +68,7 @@ b8 load_material(material_config_t config, material_t *mt) {
 
 		if (!mt->diffuse_map.texture) {
             ar_WARNING("Unable to load texture '%s', using default material.",
-                       config.diffuse_map_name, mt->name);
+                       config.diffuse_map_name, name_string(mt->name));
             mt->diffuse_map.texture = texture_sys_get_default_tex();
         }
     } else {
@@ -80,7 +80,7 @@ b8 load_material(material_config_t config, material_t *mt) {
 
 	if (!renderer_material_init(mt)) {
         ar_ERROR("Failed to acquire renderer resources for material '%s'",
-                 mt->name);
+                 name_string(mt->name));
         return false;
     }
 
@@ -88,10 +88,10 @@ b8 load_material(material_config_t config, material_t *mt) {
 }
 
 void default_material_shut(material_t *mt) {
-	ar_TRACE("Kill Material '%s'...", mt->name);
+	ar_TRACE("Kill Material '%s'...", name_string(mt->name));
 
 	if (mt->diffuse_map.texture) {
-		texture_sys_release(mt->diffuse_map.texture->name);
+		texture_sys_release_name(mt->diffuse_map.texture->name);
 	}
 
 	renderer_material_shut(mt);
@@ -112,9 +112,10 @@ b8   material_sys_init(uint64_t *memory_require, void *state,
 	}
 
 	uint64_t struct_req = sizeof(material_sys_state_t);
-	uint64_t array_req = sizeof(material_t) * config.max_material_count;
-	uint64_t table_req = sizeof(material_ref_t) * config.max_material_count;
-	*memory_require = struct_req + array_req + table_req;
+	uint64_t array_req = slot_map_memory_require(sizeof(material_ref_t),
+												 config.max_material_count);
+	uint64_t map_req = name_map_memory_require(config.max_material_count);
+	*memory_require = struct_req + array_req + map_req;
 
 	if (!state) {
 		return true;
@@ -124,26 +125,12 @@ b8   material_sys_init(uint64_t *memory_require, void *state,
 	p_state->config = config;
 
 	void *array_block = (char *)state + struct_req;
-	p_state->reg_materials = array_block;
-
-	void *table_block = (char *)array_block + table_req;
-    hashtable_init(sizeof(material_ref_t), config.max_material_count,
-                   table_block, false, &p_state->reg_material_table);
-
-	// fill hashtable 
-	material_ref_t invalid_ref;
-	invalid_ref.auto_release = false;
-	invalid_ref.handle = INVALID_ID;
-	invalid_ref.ref_count = 0;
-	hashtable_fill(&p_state->reg_material_table, &invalid_ref);
-
-	// invalidate all material in array
-	uint32_t count = p_state->config.max_material_count;
-	for (uint32_t i = 0; i < count; ++i) {
-		p_state->reg_materials[i].id = INVALID_ID;
-		p_state->reg_materials[i].gen = INVALID_ID;
-		p_state->reg_materials[i].internal_id = INVALID_ID;
-	}
+	slot_map_init(sizeof(material_ref_t), config.max_material_count,
+				  array_block, &p_state->reg_materials);
+
+	void *map_block = (char *)array_block + array_req;
+	name_map_init(config.max_material_count, map_block,
+				  &p_state->reg_material_map);
 
 	if (!default_material_init(p_state)) {
 		ar_FATAL("Failed to create default material. Application Stop");
@@ -157,11 +144,10 @@ void material_sys_shut(void *state) {
 	material_sys_state_t *s = (material_sys_state_t *)state;
 
 	if (s) {
-		uint32_t count = s->config.max_material_count;
+		uint32_t count = slot_map_count(&s->reg_materials);
 		for (uint32_t i = 0; i < count; ++i) {
-			if (s->reg_materials[i].id != INVALID_ID) {
-				default_material_shut(&s->reg_materials[i]);
-			}
+			material_ref_t *ref = slot_map_at(&s->reg_materials, i);
+			default_material_shut(&ref->material);
 		}
 
 		default_material_shut(&s->default_material);
@@ -199,102 +185,101 @@ material_t *material_sys_acquire(const char *name) {
 }
 
 material_t *material_sys_acquire_from_config(material_config_t config) {
+    if (!p_state) {
+        ar_ERROR("material_sys_acquire_from_config - Failed to aqcuire "
+                 "material '%s'. Null pointer return",
+                 config.name);
+        return 0;
+    }
+
     /* Return default material*/
-    if (string_equali(config.name, DEFAULT_MATERIAL_NAME)) {
+    name_t name = name_intern(config.name);
+    if (name == p_state->default_material.name) {
         return &p_state->default_material;
     }
 
-    material_ref_t ref;
-    if (p_state &&
-        hashtable_get(&p_state->reg_material_table, config.name, &ref)) {
-        if (ref.ref_count == 0) {
-            ref.auto_release = config.auto_release;
+    material_ref_t *ref     = 0;
+    uint32_t        handle  = name_map_get(&p_state->reg_material_map, name);
+    b8              created = handle == INVALID_ID;
+    if (created) {
+        handle = slot_map_insert(&p_state->reg_materials, (void **)&ref);
+        if (!ref) {
+            ar_FATAL("material_sys_acquire_from_config - cannot hold "
+                     "material anymore. Adjust configuration");
+            return 0;
+        }
+
+        // Create new material
+        material_t *mm = &ref->material;
+        if (!load_material(config, name, mm)) {
+            ar_ERROR("Failed to load material '%s'", config.name);
+            slot_map_remove(&p_state->reg_materials, handle);
+            return 0;
         }
-        ref.ref_count++;
-
-        if (ref.handle == INVALID_ID) {
-            uint32_t    count = p_state->config.max_material_count;
-            material_t *mm    = 0;
-
-            for (uint32_t i = 0; i < count; ++i) {
-                if (p_state->reg_materials[i].id == INVALID_ID) {
-                    ref.handle = i;
-                    mm         = &p_state->reg_materials[i];
-                    break;
-                }
-            }
-
-            if (!mm || ref.handle == INVALID_ID) {
-                ar_FATAL("material_sys_acquire_from_config - cannot hold "
-                         "material anymore. Adjust configuration");
-                return 0;
-            }
-
-            // Create new material
-            if (!load_material(config, mm)) {
-                ar_ERROR("Failed to load material '%s'", config.name);
-                return 0;
-            }
-
-            if (mm->gen == INVALID_ID) {
-                mm->gen = 0;
-            } else {
-                mm->gen++;
-            }
-
-            mm->id = ref.handle;
-            ar_TRACE("Material '%s' does not exist yet. Create & ref_count is "
-                     "%i",
-                     config.diffuse_map_name, ref.ref_count);
+
+        if (mm->gen == INVALID_ID) {
+            mm->gen = 0;
         } else {
-            ar_TRACE("Material '%s' already exists, ref_count increased to %i.",
-                     config.name, ref.ref_count);
+            mm->gen++;
         }
 
-        hashtable_set(&p_state->reg_material_table, config.name, &ref);
-        return &p_state->reg_materials[ref.handle];
+        mm->id = handle;
+        name_map_set(&p_state->reg_material_map, name, handle);
+    } else {
+        ref = slot_map_get(&p_state->reg_materials, handle);
     }
 
-    ar_ERROR("material_sys_acquire_from_config - Failed to aqcuire material "
-             "'%s'. Null pointer return",
-             config.name);
-    return 0;
+    if (ref->ref_count == 0) {
+        ref->auto_release = config.auto_release;
+    }
+    ref->ref_count++;
+
+    if (created) {
+        ar_TRACE("Material '%s' does not exist yet. Create & ref_count is %i",
+                 config.name, ref->ref_count);
+    } else {
+        ar_TRACE("Material '%s' already exists, ref_count increased to %i.",
+                 config.name, ref->ref_count);
+    }
+    return &ref->material;
 }
 
 void material_sys_release(const char *name) {
-    if (string_equali(name, DEFAULT_MATERIAL_NAME)) {
+    material_sys_release_name(name_find(name));
+}
+
+void material_sys_release_name(name_t name) {
+    if (!p_state) {
+        ar_ERROR("material_system_release failed to release material '%s'.",
+                 name_string(name));
         return;
     }
 
-    material_ref_t ref;
-    if (p_state && hashtable_get(&p_state->reg_material_table, name, &ref)) {
-        if (ref.ref_count == 0) {
-            ar_WARNING("Tried to release non-existent material: '%s'", name);
-            return;
-        }
-        ref.ref_count--;
-        if (ref.ref_count == 0 && ref.auto_release) {
-            material_t *m = &p_state->reg_materials[ref.handle];
-
-            // Destroy/reset material.
-            default_material_shut(m);
-
-            // Reset the reference.
-            ref.handle       = INVALID_ID;
-            ref.auto_release = false;
-            ar_TRACE("Released material '%s', Material unloaded because "
-                     "reference count=0 and auto_release=true.",
-                     name);
-        } else {
-            ar_TRACE("Released material '%s', now has a reference count of "
-                     "'%i' (auto_release=%s).",
-                     name, ref.ref_count, ref.auto_release ? "true" : "false");
-        }
+    if (name == p_state->default_material.name) {
+        return;
+    }
 
-        // Update the entry.
-        hashtable_set(&p_state->reg_material_table, name, &ref);
+    uint32_t        handle = name_map_get(&p_state->reg_material_map, name);
+    material_ref_t *ref    = slot_map_get(&p_state->reg_materials, handle);
+    if (!ref || ref->ref_count == 0) {
+        ar_WARNING("Tried to release non-existent material: '%s'",
+                   name_string(name));
+        return;
+    }
+
+    ref->ref_count--;
+    if (ref->ref_count == 0 && ref->auto_release) {
+        // Destroy/reset material, an unloaded material leaves the registry.
+        default_material_shut(&ref->material);
+        slot_map_remove(&p_state->reg_materials, handle);
+        name_map_erase(&p_state->reg_material_map, name);
+        ar_TRACE("Released material '%s', Material unloaded because "
+                 "reference count=0 and auto_release=true.",
+                 name_string(name));
     } else {
-        ar_ERROR("material_system_release failed to release material '%s'.",
-                 name);
+        ar_TRACE("Released material '%s', now has a reference count of "
+                 "'%i' (auto_release=%s).",
+                 name_string(name), ref->ref_count,
+                 ref->auto_release ? "true" : "false");
     }
 }
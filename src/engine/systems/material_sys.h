@@ -19,4 +19,7 @@ material_t *material_sys_acquire(const char *name);
 material_t *material_sys_acquire_from_config(material_config_t config);
 void        material_sys_release(const char *name);
 
+/* For a name already interned, material_t::name included. */
+void        material_sys_release_name(name_t name);
+
 #endif //__MATERIAL_SYSTEM_H__
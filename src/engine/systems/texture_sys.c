@@ -1,26 +1,28 @@
 #include "engine/systems/texture_sys.h"
 
-#include "engine/container/hashtable.h"
+#include "engine/container/slot_map.h"
 #include "engine/core/logger.h"
+#include "engine/core/name.h"
 #include "engine/core/ar_strings.h"
 #include "engine/memory/memory.h"
+#include "engine/memory/scratch.h"
 #include "engine/renderer/renderer_fe.h"
 #include "engine/systems/resource_sys.h"
 
+typedef struct texture_ref_t {
+	uint64_t ref_count;
+	texture_t texture;
+	b8 auto_release;
+} texture_ref_t;
+
 typedef struct texture_sys_state_t {
 	texture_sys_config_t config;
 	texture_t default_texture;
 
-	texture_t *reg_textures; // array of registered texture
-	
-	hashtable_t reg_texture_table; // hashtable for lookup
-} texture_sys_state_t;
+	slot_map_t reg_textures; // registered textures, texture_t::id is the handle
 
-typedef struct texture_ref_t {
-	uint64_t ref_count;
-	uint32_t handle;
-	b8 auto_release;
-} texture_ref_t;
+	name_map_t reg_texture_map; // name to handle
+} texture_sys_state_t;
 
 static texture_sys_state_t *p_state = 0;
 
@@ -32,7 +34,14 @@ b8 default_texture_init(texture_sys_state_t *state) {
     const uint32_t tex_dimension = 256;
     const uint32_t channels      = 4;
     const uint32_t pixel_count   = tex_dimension * tex_dimension;
-    uint8_t        pixels[pixel_count * channels];
+    scratch_t      scratch       = scratch_begin();
+    uint8_t       *pixels =
+        scratch_alloc(&scratch, sizeof(uint8_t) * pixel_count * channels);
+    if (!pixels) {
+        ar_ERROR("default_texture_init - no scratch left for pixels");
+        scratch_end(scratch);
+        return false;
+    }
     memory_set(pixels, 255, sizeof(uint8_t) * pixel_count * channels);
 
     // each pixel
@@ -57,14 +66,18 @@ b8 default_texture_init(texture_sys_state_t *state) {
         }
     }
 
-    string_ncopy(state->default_texture.name, DEFAULT_TEXTURE_NAME,
-                 TEXTURE_NAME_MAX_LENGTH);
+    state->default_texture.name            = name_intern(DEFAULT_TEXTURE_NAME);
     state->default_texture.gen             = INVALID_ID;
     state->default_texture.width           = tex_dimension;
     state->default_texture.height          = tex_dimension;
     state->default_texture.channel_count   = 4;
     state->default_texture.has_transparent = false;
-    renderer_tex_init(pixels, &state->default_texture);
+    b8 uploaded = renderer_tex_init(pixels, &state->default_texture);
+    scratch_end(scratch);
+    if (!uploaded) {
+        ar_ERROR("default_texture_init - unable to upload default texture");
+        return false;
+    }
 
     state->default_texture.gen = INVALID_ID;
     return true;
@@ -73,7 +86,6 @@ b8 default_texture_init(texture_sys_state_t *state) {
 void texture_shut(texture_t *t) {
 	renderer_tex_shut(t);
 
-	memory_zero(t->name, sizeof(char) * TEXTURE_NAME_MAX_LENGTH);
 	memory_zero(t, sizeof(texture_t));
 
 	t->id = INVALID_ID;
@@ -86,7 +98,8 @@ void default_texture_shut(texture_sys_state_t *state) {
 	}
 }
 
-b8 load_texture(const char *texture_name, texture_t *tx) {
+b8 load_texture(name_t name, texture_t *tx) {
+	const char *texture_name = name_string(name);
 	resource_t image_resc;
 	if (!resource_sys_load(texture_name, RESC_TYPE_IMAGE, &image_resc)) {
 		ar_ERROR("Failed to load image resource for texture '%s'", texture_name);
@@ -114,10 +127,15 @@ b8 load_texture(const char *texture_name, texture_t *tx) {
 	}
 
     // acquire internal texture resource & upload to gpu.
-	string_ncopy(temp.name, texture_name, TEXTURE_NAME_MAX_LENGTH);
+	temp.name = name;
 	temp.gen = INVALID_ID;
 	temp.has_transparent = has_transparent;
-	renderer_tex_init(resc_data->pixels, &temp);
+	if (!renderer_tex_init(resc_data->pixels, &temp)) {
+		ar_ERROR("Failed to upload texture '%s'", texture_name);
+		tx->gen = curr_gen;
+		resource_sys_unload(&image_resc);
+		return false;
+	}
 
 	texture_t old = *tx;
 	*tx           = temp;
@@ -143,9 +161,10 @@ b8 texture_sys_init(uint64_t *memory_require, void *state,
     }
 
     uint64_t struct_req = sizeof(texture_sys_state_t);
-    uint64_t array_req  = sizeof(texture_t) * config.max_texture_count;
-    uint64_t table_req  = sizeof(texture_ref_t) * config.max_texture_count;
-    *memory_require     = struct_req + array_req + table_req;
+    uint64_t array_req  = slot_map_memory_require(sizeof(texture_ref_t),
+                                                  config.max_texture_count);
+    uint64_t map_req    = name_map_memory_require(config.max_texture_count);
+    *memory_require     = struct_req + array_req + map_req;
 
     if (!state) {
         return true;
@@ -154,42 +173,28 @@ b8 texture_sys_init(uint64_t *memory_require, void *state,
     p_state               = state;
     p_state->config       = config;
 
-    // Array block is after state. Just set pointer
+    // Array block is after state, then the name map
     void *array_block     = (char *)state + struct_req;
-    p_state->reg_textures = array_block;
+    slot_map_init(sizeof(texture_ref_t), config.max_texture_count, array_block,
+                  &p_state->reg_textures);
 
-    // Hash block is after array
-    void *hash_block      = (char *)array_block + array_req;
+    void *map_block       = (char *)array_block + array_req;
+    name_map_init(config.max_texture_count, map_block,
+                  &p_state->reg_texture_map);
 
-    hashtable_init(sizeof(texture_ref_t), config.max_texture_count, hash_block,
-                   false, &p_state->reg_texture_table);
-
-    // Set hashtable with invalid reference to use as default.
-    texture_ref_t inv_ref;
-    inv_ref.auto_release = false;
-    inv_ref.handle       = INVALID_ID;
-    inv_ref.ref_count    = 0;
-    hashtable_fill(&p_state->reg_texture_table, &inv_ref);
-
-    uint32_t count = p_state->config.max_texture_count;
-    for (uint32_t i = 0; i < count; ++i) {
-        p_state->reg_textures[i].id  = INVALID_ID;
-        p_state->reg_textures[i].gen = INVALID_ID;
+    if (!default_texture_init(p_state)) {
+        return false;
     }
-
-    default_texture_init(p_state);
     return true;
 }
 
 void texture_sys_shut(void *state) {
 	(void)state;
 	if (p_state) {
-		for (uint32_t i = 0; i < p_state->config.max_texture_count; ++i) {
-			texture_t *t = &p_state->reg_textures[i];
-
-			if (t->gen != INVALID_ID) {
-				renderer_tex_shut(t);
-			}
+		uint32_t count = slot_map_count(&p_state->reg_textures);
+		for (uint32_t i = 0; i < count; ++i) {
+			texture_ref_t *ref = slot_map_at(&p_state->reg_textures, i);
+			renderer_tex_shut(&ref->texture);
 		}
 
 		default_texture_shut(p_state);
@@ -198,96 +203,99 @@ void texture_sys_shut(void *state) {
 }
 
 texture_t *texture_sys_acquire(const char *name, b8 auto_release) {
-    if (string_equali(name, DEFAULT_TEXTURE_NAME)) {
+    return texture_sys_acquire_name(name_intern(name), auto_release);
+}
+
+texture_t *texture_sys_acquire_name(name_t name, b8 auto_release) {
+    if (!p_state || name == NAME_NONE) {
+        ar_ERROR("Failed to acquire texture '%s'. NULL pointer will returned",
+                 name_string(name));
+        return 0;
+    }
+
+    if (name == p_state->default_texture.name) {
         ar_WARNING("Call for default texture. Use texture_sys_get_default_tex "
                    "for texture 'Default'.");
         return &p_state->default_texture;
     }
 
-    texture_ref_t ref;
-    if (p_state && hashtable_get(&p_state->reg_texture_table, name, &ref)) {
-        if (ref.ref_count == 0) {
-            ref.auto_release = auto_release;
+    texture_ref_t *ref     = 0;
+    uint32_t       handle  = name_map_get(&p_state->reg_texture_map, name);
+    b8             created = handle == INVALID_ID;
+    if (created) {
+        handle = slot_map_insert(&p_state->reg_textures, (void **)&ref);
+        if (!ref) {
+            ar_FATAL("Texture system cannot hold more texture. Adjust "
+                     "configuration to allow more");
+            return 0;
         }
-        ref.ref_count++;
-
-        if (ref.handle == INVALID_ID) {
-            uint32_t   c  = p_state->config.max_texture_count;
-            texture_t *tt = 0;
-
-            for (uint32_t i = 0; i < c; ++i) {
-                if (p_state->reg_textures[i].id == INVALID_ID) {
-                    ref.handle = i;
-                    tt         = &p_state->reg_textures[i];
-                    break;
-                }
-            }
-
-            if (!tt || ref.handle == INVALID_ID) {
-                ar_FATAL("Texture system cannot hold more texture. Adjust "
-                         "configuration to allow more");
-                return 0;
-            }
 
-            /* Cretate New Texture */
-            if (!load_texture(name, tt)) {
-                ar_ERROR("Failed to load texture '%s'", name);
-                return 0;
-            }
-
-            /* Use handle as texture ID */
-            tt->id = ref.handle;
-            ar_TRACE("Texture '%s' not exist yet. Created, and ref_count is "
-                     "now %i",
-                     name, ref.ref_count);
-        } else {
-            ar_TRACE("Texture '%s' already exist. Ref_count increased to %i",
-                     name, ref.ref_count);
+        /* Cretate New Texture */
+        ref->texture.gen = INVALID_ID;
+        if (!load_texture(name, &ref->texture)) {
+            ar_ERROR("Failed to load texture '%s'", name_string(name));
+            slot_map_remove(&p_state->reg_textures, handle);
+            return 0;
         }
 
-        hashtable_set(&p_state->reg_texture_table, name, &ref);
-        return &p_state->reg_textures[ref.handle];
+        /* Use handle as texture ID */
+        ref->texture.id = handle;
+        name_map_set(&p_state->reg_texture_map, name, handle);
+    } else {
+        ref = slot_map_get(&p_state->reg_textures, handle);
+    }
+
+    if (ref->ref_count == 0) {
+        ref->auto_release = auto_release;
     }
+    ref->ref_count++;
 
-    ar_ERROR("Failed to acquire texture '%s'. NULL pointer will returned",
-             name);
-    return 0;
+    if (created) {
+        ar_TRACE("Texture '%s' not exist yet. Created, and ref_count is now %i",
+                 name_string(name), ref->ref_count);
+    } else {
+        ar_TRACE("Texture '%s' already exist. Ref_count increased to %i",
+                 name_string(name), ref->ref_count);
+    }
+    return &ref->texture;
 }
 
 void texture_sys_release(const char *name) {
-    if (string_equali(name, DEFAULT_TEXTURE_NAME)) {
+    texture_sys_release_name(name_find(name));
+}
+
+void texture_sys_release_name(name_t name) {
+    if (!p_state) {
+        ar_ERROR("Texture system failed to release texture '%s'",
+                 name_string(name));
         return;
     }
 
-    texture_ref_t ref;
-    if (p_state && hashtable_get(&p_state->reg_texture_table, name, &ref)) {
-        if (ref.ref_count == 0) {
-            ar_WARNING("Tried to release Non-Exist texture: '%s'", name);
-            return;
-        }
-
-		char name_copy[TEXTURE_NAME_MAX_LENGTH];
-		string_ncopy(name_copy, name, TEXTURE_NAME_MAX_LENGTH);
-
-        ref.ref_count--;
-        if (ref.ref_count == 0 && ref.auto_release) {
-            texture_t *tt = &p_state->reg_textures[ref.handle];
+    if (name == p_state->default_texture.name) {
+        return;
+    }
 
-			texture_shut(tt);
+    uint32_t       handle = name_map_get(&p_state->reg_texture_map, name);
+    texture_ref_t *ref    = slot_map_get(&p_state->reg_textures, handle);
+    if (!ref || ref->ref_count == 0) {
+        ar_WARNING("Tried to release Non-Exist texture: '%s'",
+                   name_string(name));
+        return;
+    }
 
-            ref.handle       = INVALID_ID;
-            ref.auto_release = false;
-            ar_TRACE("Release texture '%s'. Ref_count=0 and auto_release=true",
-                     name_copy);
-        } else {
-            ar_TRACE("Release texture '%s'. Ref_count=%i and auto_release=%s",
-                     name_copy, ref.ref_count, ref.auto_release ? "true" : "false");
-        }
+    ref->ref_count--;
+    if (ref->ref_count == 0 && ref->auto_release) {
+        texture_shut(&ref->texture);
 
-        /* Update Entry */
-        hashtable_set(&p_state->reg_texture_table, name_copy, &ref);
+        /* An unloaded texture leaves the registry and the map */
+        slot_map_remove(&p_state->reg_textures, handle);
+        name_map_erase(&p_state->reg_texture_map, name);
+        ar_TRACE("Release texture '%s'. Ref_count=0 and auto_release=true",
+                 name_string(name));
     } else {
-        ar_ERROR("Texture system failed to release texture '%s'", name);
+        ar_TRACE("Release texture '%s'. Ref_count=%i and auto_release=%s",
+                 name_string(name), ref->ref_count,
+                 ref->auto_release ? "true" : "false");
     }
 }
 
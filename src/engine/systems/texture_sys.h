@@ -16,6 +16,10 @@ void       texture_sys_shut(void *state);
 texture_t *texture_sys_acquire(const char *name, b8 auto_release);
 void       texture_sys_release(const char *name);
 
+/* Same as above for a name already interned, texture_t::name included. */
+texture_t *texture_sys_acquire_name(name_t name, b8 auto_release);
+void       texture_sys_release_name(name_t name);
+
 texture_t *texture_sys_get_default_tex(void);
 
 #endif //__TEXTURE_SYSTEM_H__